@@ -0,0 +1,295 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdAdjustment.h"
+
+#include "PsdAdjustmentLut.h"
+#include "PsdLayer.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include <cmath>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// 32-bit values are looked up in tables of this size, and interpolated linearly
+	static const unsigned int FLOAT_TABLE_SIZE = 4096u;
+
+	// maps a value of the given channel in the range [0, 1] to its adjusted value
+	typedef float32_t (*TransferFunction)(const Layer* layer, unsigned int channel, float32_t value);
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t Saturate(float32_t value)
+	{
+		return (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t BrightnessContrast(const Layer* layer, unsigned int channel, float32_t value)
+	{
+		PSD_UNUSED(channel);
+
+		// both values are stored as signed longs
+		const float32_t brightness = static_cast<float32_t>(static_cast<int32_t>(layer->brightness));
+		const float32_t contrast = static_cast<float32_t>(static_cast<int32_t>(layer->contrast)) / 100.0f;
+
+		if (layer->isBrightnessContrastLegacy)
+		{
+			// the legacy algorithm shifts all values by the brightness in the range [-100, 100], and scales them around
+			// the midpoint by the contrast in the range [-100, 100]. this clips shadows and highlights.
+			value += brightness / 255.0f;
+
+			const float32_t slope = (contrast >= 0.0f) ? 1.0f / (1.0f - ((contrast < 0.99f) ? contrast : 0.99f)) : 1.0f + contrast;
+			value = (value - 0.5f)*slope + 0.5f;
+
+			return Saturate(value);
+		}
+
+		// brightness in the range [-150, 150] bends the values using a gamma curve
+		value = std::pow(value, std::exp2(-brightness / 150.0f));
+
+		// contrast in the range [-50, 100] either steepens the values towards an S-curve, or flattens them towards the midpoint
+		if (contrast >= 0.0f)
+		{
+			const float32_t curve = (value < 0.5f) ? 2.0f*value*value : 1.0f - 2.0f*(1.0f - value)*(1.0f - value);
+			value += (curve - value)*contrast;
+		}
+		else
+		{
+			value += (0.5f - value)*(-contrast);
+		}
+
+		return Saturate(value);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t ApplyLevels(const LevelsRecord& levels, float32_t value)
+	{
+		const float32_t inputFloor = levels.inputFloor / 255.0f;
+		const float32_t inputCeiling = levels.inputCeiling / 255.0f;
+		const float32_t outputFloor = levels.outputFloor / 255.0f;
+		const float32_t outputCeiling = levels.outputCeiling / 255.0f;
+		const float32_t gamma = ((levels.gamma != 0u) ? levels.gamma : 100u) / 100.0f;
+
+		if (inputCeiling > inputFloor)
+			value = Saturate((value - inputFloor) / (inputCeiling - inputFloor));
+		else
+			value = (value < inputFloor) ? 0.0f : 1.0f;
+
+		value = std::pow(value, 1.0f / gamma);
+
+		return outputFloor + value*(outputCeiling - outputFloor);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t Levels(const Layer* layer, unsigned int channel, float32_t value)
+	{
+		// the levels of the channel itself are applied first, followed by the levels of the composite
+		value = ApplyLevels(layer->levels[channel + 1u], value);
+
+		return Saturate(ApplyLevels(layer->levels[0], value));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static TransferFunction GetTransferFunction(const Layer* layer)
+	{
+		// further adjustments that treat each channel independently, e.g. curves, only need to provide their own transfer
+		// function to be baked into the same tables.
+		if (layer->hasBrightnessContrast)
+			return &BrightnessContrast;
+
+		if (layer->hasLevels)
+			return &Levels;
+
+		return nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void FillTable(TransferFunction transfer, const Layer* layer, unsigned int channel, T* table, unsigned int entryCount, float32_t maxValue)
+	{
+		// entries above maxValue only exist for 16-bit tables, and clamp to white
+		const float32_t scale = 1.0f / maxValue;
+		for (unsigned int i=0; i < entryCount; ++i)
+		{
+			table[i] = static_cast<T>(transfer(layer, channel, Saturate(i*scale)) * maxValue + 0.5f);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void FillTable(TransferFunction transfer, const Layer* layer, unsigned int channel, float32_t* table, unsigned int entryCount, float32_t)
+	{
+		const float32_t scale = 1.0f / static_cast<float32_t>(entryCount - 1u);
+		for (unsigned int i=0; i < entryCount; ++i)
+		{
+			table[i] = transfer(layer, channel, i*scale);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ApplyTables(const AdjustmentLut* lut, const T* src, T* dest, unsigned int count)
+	{
+		// every value has its own entry, so this boils down to three loads per pixel
+		const T* red = static_cast<const T*>(lut->tables[0]);
+		const T* green = static_cast<const T*>(lut->tables[1]);
+		const T* blue = static_cast<const T*>(lut->tables[2]);
+		for (unsigned int i=0; i < count; ++i)
+		{
+			const T r = red[src[i*4u + 0u]];
+			const T g = green[src[i*4u + 1u]];
+			const T b = blue[src[i*4u + 2u]];
+			const T a = src[i*4u + 3u];
+
+			dest[i*4u + 0u] = r;
+			dest[i*4u + 1u] = g;
+			dest[i*4u + 2u] = b;
+			dest[i*4u + 3u] = a;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t LookUp(const float32_t* table, unsigned int entryCount, float32_t value)
+	{
+		const float32_t position = Saturate(value) * static_cast<float32_t>(entryCount - 1u);
+		unsigned int index = static_cast<unsigned int>(position);
+		index = (index < entryCount - 2u) ? index : entryCount - 2u;
+
+		const float32_t t = position - static_cast<float32_t>(index);
+		return table[index] + (table[index + 1u] - table[index])*t;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool IsAdjustmentLayer(const Layer* layer)
+{
+	PSD_ASSERT_NOT_NULL(layer);
+
+	return GetTransferFunction(layer) != nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+AdjustmentLut* CreateAdjustmentLut(const Layer* layer, unsigned int bitsPerChannel, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(layer);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT((bitsPerChannel == 8u) || (bitsPerChannel == 16u) || (bitsPerChannel == 32u), "Unsupported bits per channel %u.", bitsPerChannel);
+
+	const TransferFunction transfer = GetTransferFunction(layer);
+	if (!transfer)
+		return nullptr;
+
+	AdjustmentLut* lut = memoryUtil::Allocate<AdjustmentLut>(allocator);
+	lut->bitsPerChannel = bitsPerChannel;
+	lut->entryCount = (bitsPerChannel == 8u) ? 256u : ((bitsPerChannel == 16u) ? 65536u : FLOAT_TABLE_SIZE);
+
+	for (unsigned int c=0; c < 3u; ++c)
+	{
+		lut->tables[c] = allocator->Allocate(lut->entryCount * bitsPerChannel / 8u, 16u);
+		if (bitsPerChannel == 8u)
+		{
+			FillTable(transfer, layer, c, static_cast<uint8_t*>(lut->tables[c]), lut->entryCount, 255.0f);
+		}
+		else if (bitsPerChannel == 16u)
+		{
+			FillTable(transfer, layer, c, static_cast<uint16_t*>(lut->tables[c]), lut->entryCount, 32768.0f);
+		}
+		else
+		{
+			FillTable(transfer, layer, c, static_cast<float32_t*>(lut->tables[c]), lut->entryCount, 1.0f);
+		}
+	}
+
+	return lut;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyAdjustmentLut(AdjustmentLut*& lut, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(lut);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	for (unsigned int c=0; c < 3u; ++c)
+	{
+		allocator->Free(lut->tables[c]);
+	}
+
+	memoryUtil::Free(allocator, lut);
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const uint8_t* src, uint8_t* dest, unsigned int count)
+	{
+		PSD_ASSERT(lut->bitsPerChannel == 8u, "Cannot apply %u-bit tables to 8-bit pixels.", lut->bitsPerChannel);
+
+		ApplyTables(lut, src, dest, count);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const uint16_t* src, uint16_t* dest, unsigned int count)
+	{
+		PSD_ASSERT(lut->bitsPerChannel == 16u, "Cannot apply %u-bit tables to 16-bit pixels.", lut->bitsPerChannel);
+
+		ApplyTables(lut, src, dest, count);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const float32_t* src, float32_t* dest, unsigned int count)
+	{
+		PSD_ASSERT(lut->bitsPerChannel == 32u, "Cannot apply %u-bit tables to 32-bit pixels.", lut->bitsPerChannel);
+
+		const float32_t* red = static_cast<const float32_t*>(lut->tables[0]);
+		const float32_t* green = static_cast<const float32_t*>(lut->tables[1]);
+		const float32_t* blue = static_cast<const float32_t*>(lut->tables[2]);
+		for (unsigned int i=0; i < count; ++i)
+		{
+			const float32_t r = LookUp(red, lut->entryCount, src[i*4u + 0u]);
+			const float32_t g = LookUp(green, lut->entryCount, src[i*4u + 1u]);
+			const float32_t b = LookUp(blue, lut->entryCount, src[i*4u + 2u]);
+			const float32_t a = src[i*4u + 3u];
+
+			dest[i*4u + 0u] = r;
+			dest[i*4u + 1u] = g;
+			dest[i*4u + 2u] = b;
+			dest[i*4u + 3u] = a;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
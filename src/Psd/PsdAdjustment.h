@@ -0,0 +1,51 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+struct Layer;
+struct AdjustmentLut;
+class Allocator;
+
+
+/// \ingroup Renderer
+/// Returns whether the \a layer is an adjustment layer that can be evaluated by \ref CreateAdjustmentLut.
+/// Currently, Brightness/Contrast and Levels adjustments are supported, see Layer::hasBrightnessContrast and Layer::hasLevels.
+bool IsAdjustmentLayer(const Layer* layer);
+
+/// \ingroup Renderer
+/// Creates lookup tables evaluating the adjustment stored in the \a layer for pixels with \a bitsPerChannel bits per channel.
+/// The tables are computed once, and can then be applied to any number of pixels using \ref imageUtil::ApplyAdjustmentLut.
+/// \remark Photoshop's current Brightness/Contrast algorithm is not documented. Non-legacy adjustments are approximated with a
+/// gamma curve for brightness and an S-curve for contrast, both of which keep black and white intact.
+/// \return Returns a nullptr if the \a layer is no adjustment layer, otherwise the tables that need to be freed by a call to \ref DestroyAdjustmentLut.
+AdjustmentLut* CreateAdjustmentLut(const Layer* layer, unsigned int bitsPerChannel, Allocator* allocator);
+
+/// \ingroup Renderer
+/// Destroys and nullifies the given \a lut previously created by a call to \ref CreateAdjustmentLut.
+void DestroyAdjustmentLut(AdjustmentLut*& lut, Allocator* allocator);
+
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Applies the \a lut to \a count interleaved 8-bit RGBA pixels from \a src, and stores the result in \a dest.
+	/// The alpha of each pixel is left untouched. \a src and \a dest may point to the same pixels.
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const uint8_t* src, uint8_t* dest, unsigned int count);
+
+	/// \ingroup ImageUtil
+	/// Applies the \a lut to \a count interleaved 16-bit RGBA pixels from \a src, and stores the result in \a dest.
+	/// \sa ApplyAdjustmentLut
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const uint16_t* src, uint16_t* dest, unsigned int count);
+
+	/// \ingroup ImageUtil
+	/// Applies the \a lut to \a count interleaved 32-bit RGBA pixels from \a src, and stores the result in \a dest.
+	/// Values are expected to be in the range [0, 1].
+	/// \sa ApplyAdjustmentLut
+	void ApplyAdjustmentLut(const AdjustmentLut* lut, const float32_t* src, float32_t* dest, unsigned int count);
+}
+
+PSD_NAMESPACE_END
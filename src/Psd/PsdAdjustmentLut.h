@@ -0,0 +1,23 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class AdjustmentLut
+/// \brief A struct holding lookup tables that evaluate an adjustment layer, as created by \ref CreateAdjustmentLut.
+/// \details Adjustments that map each color channel independently of the others are baked into one table per channel.
+/// 8-bit and 16-bit tables hold one entry for each possible value, with 16-bit values being in the range [0, 32768] used by Photoshop.
+/// 32-bit tables hold \a entryCount samples in the range [0, 1] that are interpolated linearly.
+/// \sa imageUtil::ApplyAdjustmentLut
+struct AdjustmentLut
+{
+	unsigned int bitsPerChannel;			///< The bits per channel of the pixels the tables apply to. Can be 8, 16 or 32.
+	unsigned int entryCount;				///< The number of entries in each table.
+	void* tables[3];						///< The tables for the red, green and blue channel, holding values of the same type as the pixels.
+};
+
+PSD_NAMESPACE_END
@@ -0,0 +1,159 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdBitDepthConversion.h"
+
+#include "PsdBitDepthConversionKernels.h"
+#include "PsdSimd.h"
+#include "PsdAssert.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::BitDepthConversionKernelTable* table)
+	{
+		// the scalar kernels are used for levels without dedicated kernels, e.g. SSSE3 doesn't add anything over SSE2
+		imageUtil::RegisterBitDepthConversionKernels<imageUtil::ScalarVector>(&table->kernels16);
+		imageUtil::RegisterBitDepthConversionKernels<imageUtil::ScalarVector>(&table->kernels32);
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterBitDepthConversionKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterBitDepthConversionKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterBitDepthConversionKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterBitDepthConversionKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::BitDepthConversionKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::BitDepthConversionKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildPattern(unsigned int row, unsigned int channelCount, bool hasAlpha, ditherMode::Enum dither, imageUtil::BitDepthPattern* pattern)
+	{
+		// 8x8 Bayer matrix, holding thresholds in the range [0, 63]
+		static const uint8_t BAYER[8][8] =
+		{
+			{ 0u, 32u, 8u, 40u, 2u, 34u, 10u, 42u },
+			{ 48u, 16u, 56u, 24u, 50u, 18u, 58u, 26u },
+			{ 12u, 44u, 4u, 36u, 14u, 46u, 6u, 38u },
+			{ 60u, 28u, 52u, 20u, 62u, 30u, 54u, 22u },
+			{ 3u, 35u, 11u, 43u, 1u, 33u, 9u, 41u },
+			{ 51u, 19u, 59u, 27u, 49u, 17u, 57u, 25u },
+			{ 15u, 47u, 7u, 39u, 13u, 45u, 5u, 37u },
+			{ 63u, 31u, 55u, 23u, 61u, 29u, 53u, 21u }
+		};
+
+		// the pattern spans 8 pixels, and is repeated to fill the whole capacity
+		pattern->period = channelCount * 8u;
+		for (unsigned int i=0; i < imageUtil::BitDepthPattern::CAPACITY; ++i)
+		{
+			const unsigned int pixel = (i / channelCount) % 8u;
+			const bool isAlpha = hasAlpha && (i % channelCount == channelCount - 1u);
+			const float32_t threshold = (static_cast<float32_t>(BAYER[row % 8u][pixel]) + 0.5f) / 64.0f - 0.5f;
+
+			pattern->offsets[i] = ((dither == ditherMode::ORDERED) && !isAlpha) ? (threshold / 255.0f) : 0.0f;
+			pattern->encode[i] = isAlpha ? 0.0f : 1.0f;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ConvertTo8Bit(const imageUtil::BitDepthConversionKernels<T>& kernels, const T* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int channelCount, bool hasAlpha, transferFunction::Enum transfer, ditherMode::Enum dither)
+	{
+		PSD_ASSERT((channelCount > 0u) && (channelCount <= imageUtil::BitDepthPattern::MAX_CHANNEL_COUNT), "Unsupported channel count %u.", channelCount);
+
+		const typename imageUtil::BitDepthConversionKernels<T>::Function kernel = (transfer == transferFunction::SRGB) ? kernels.convertSrgb : kernels.convert;
+		const unsigned int rowCount = width * channelCount;
+
+		// without dithering, all rows share the same pattern
+		imageUtil::BitDepthPattern pattern;
+		BuildPattern(0u, channelCount, hasAlpha, dither, &pattern);
+
+		for (unsigned int y=0; y < height; ++y)
+		{
+			if ((dither != ditherMode::NONE) && (y > 0u))
+			{
+				BuildPattern(y, channelCount, hasAlpha, dither, &pattern);
+			}
+
+			const size_t offset = static_cast<size_t>(y) * rowCount;
+			kernel(src + offset, dest + offset, rowCount, &pattern);
+		}
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertPlanarTo8Bit(const uint16_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, transferFunction::Enum transfer, ditherMode::Enum dither)
+	{
+		ConvertTo8Bit(GetKernelTable().kernels16, src, dest, width, height, 1u, false, transfer, dither);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertPlanarTo8Bit(const float32_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, transferFunction::Enum transfer, ditherMode::Enum dither)
+	{
+		ConvertTo8Bit(GetKernelTable().kernels32, src, dest, width, height, 1u, false, transfer, dither);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertInterleavedTo8Bit(const uint16_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int channelCount, bool hasAlpha, transferFunction::Enum transfer, ditherMode::Enum dither)
+	{
+		ConvertTo8Bit(GetKernelTable().kernels16, src, dest, width, height, channelCount, hasAlpha, transfer, dither);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertInterleavedTo8Bit(const float32_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int channelCount, bool hasAlpha, transferFunction::Enum transfer, ditherMode::Enum dither)
+	{
+		ConvertTo8Bit(GetKernelTable().kernels32, src, dest, width, height, channelCount, hasAlpha, transfer, dither);
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,42 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdTransferFunction.h"
+#include "PsdDitherMode.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Converts one plane of 16-bit data into 8-bit data. Photoshop stores 16-bit values as 15-bit+1 integers in the range [0, 32768],
+	/// which is taken into account by the conversion.
+	/// The values can optionally be encoded using a \a transfer function, and dithered according to the \a dither mode.
+	/// The destination buffer \a dest must hold "width*height" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void ConvertPlanarTo8Bit(const uint16_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, transferFunction::Enum transfer, ditherMode::Enum dither);
+
+	/// \ingroup ImageUtil
+	/// Converts one plane of 32-bit data into 8-bit data. Photoshop stores 32-bit values as linear floats, which are clipped to [0, 1],
+	/// and usually need to be encoded using \ref transferFunction::SRGB.
+	/// \sa ConvertPlanarTo8Bit
+	void ConvertPlanarTo8Bit(const float32_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, transferFunction::Enum transfer, ditherMode::Enum dither);
+
+
+	/// \ingroup ImageUtil
+	/// Converts interleaved 16-bit data with \a channelCount channels per pixel into 8-bit data, see \ref ConvertPlanarTo8Bit.
+	/// If \a hasAlpha is true, the last channel of each pixel holds alpha, which is neither encoded nor dithered.
+	/// The destination buffer \a dest must hold "width*height*channelCount" bytes.
+	/// \remark At most 8 channels per pixel are supported. Buffers don't need to be aligned.
+	void ConvertInterleavedTo8Bit(const uint16_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int channelCount, bool hasAlpha, transferFunction::Enum transfer, ditherMode::Enum dither);
+
+	/// \ingroup ImageUtil
+	/// Converts interleaved 32-bit data with \a channelCount channels per pixel into 8-bit data.
+	/// \sa ConvertInterleavedTo8Bit
+	void ConvertInterleavedTo8Bit(const float32_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int channelCount, bool hasAlpha, transferFunction::Enum transfer, ditherMode::Enum dither);
+}
+
+PSD_NAMESPACE_END
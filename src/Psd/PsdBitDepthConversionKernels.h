@@ -0,0 +1,112 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdColorConversionKernels.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief The per-value pattern applied by the bit depth conversion kernels to one row of data.
+	/// \details The pattern repeats every \a period values, and holds \ref CAPACITY entries so that kernels can load a whole SIMD
+	/// register starting at any value within the period.
+	struct BitDepthPattern
+	{
+		static const unsigned int MAX_CHANNEL_COUNT = 8u;
+		static const unsigned int CAPACITY = MAX_CHANNEL_COUNT*8u + 16u;
+
+		float32_t offsets[CAPACITY];			///< Dither offset added before quantization.
+		float32_t encode[CAPACITY];				///< 1 for values that are encoded using the transfer function, 0 for alpha values.
+		unsigned int period;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief Implementations of the bit depth conversions for one pixel type and one \ref simd::Level.
+	/// \details Each kernel converts \a count values of one row into 8-bit values, starting at the beginning of the \a pattern.
+	/// \sa ConvertPlanarTo8Bit ConvertInterleavedTo8Bit
+	template <typename T>
+	struct BitDepthConversionKernels
+	{
+		typedef void (*Function)(const T* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int count, const BitDepthPattern* pattern);
+
+		Function convert;
+		Function convertSrgb;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The bit depth conversion kernels used for all pixel types at one \ref simd::Level.
+	struct BitDepthConversionKernelTable
+	{
+		BitDepthConversionKernels<uint16_t> kernels16;
+		BitDepthConversionKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table with the ones for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterBitDepthConversionKernelsSSE2(BitDepthConversionKernelTable* table);
+	void RegisterBitDepthConversionKernelsAVX2(BitDepthConversionKernelTable* table);
+	void RegisterBitDepthConversionKernelsAVX512(BitDepthConversionKernelTable* table);
+	void RegisterBitDepthConversionKernelsNEON(BitDepthConversionKernelTable* table);
+
+
+	// the conversions share the sRGB encoding with the color conversion kernels, and are generic over the same vector types.
+	namespace
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, bool ENCODE_SRGB, typename T>
+		PSD_INLINE void ConvertValues(const T* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, const BitDepthPattern* pattern, unsigned int phase)
+		{
+			typename V::Type value = V::LoadMask(src);
+			if (ENCODE_SRGB)
+			{
+				value = V::Select(V::Less(V::Splat(0.5f), V::LoadMask(pattern->encode + phase)), EncodeSrgb<V>(value), value);
+			}
+
+			V::StoreMask(dest, V::Add(value, V::LoadMask(pattern->offsets + phase)));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, bool ENCODE_SRGB, typename T>
+		void ConvertTo8BitKernel(const T* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int count, const BitDepthPattern* pattern)
+		{
+			const unsigned int period = pattern->period;
+			unsigned int phase = 0u;
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				ConvertValues<V, ENCODE_SRGB>(src + i, dest + i, pattern, phase);
+				phase = (phase + V::WIDTH) % period;
+			}
+
+			// remaining values
+			for (; i < count; ++i)
+			{
+				ConvertValues<ScalarVector, ENCODE_SRGB>(src + i, dest + i, pattern, phase);
+				phase = (phase + 1u) % period;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void RegisterBitDepthConversionKernels(BitDepthConversionKernels<T>* kernels)
+		{
+			kernels->convert = &ConvertTo8BitKernel<V, false, T>;
+			kernels->convertSrgb = &ConvertTo8BitKernel<V, true, T>;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
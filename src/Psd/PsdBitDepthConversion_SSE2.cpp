@@ -0,0 +1,25 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdBitDepthConversionKernels.h"
+
+#include "PsdVector_SSE2.h"
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterBitDepthConversionKernelsSSE2(BitDepthConversionKernelTable* table)
+	{
+		RegisterBitDepthConversionKernels<VectorSSE2>(&table->kernels16);
+		RegisterBitDepthConversionKernels<VectorSSE2>(&table->kernels32);
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
@@ -5,6 +5,10 @@
 
 #include "Psdisunsigned.h"
 
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
 
 PSD_NAMESPACE_BEGIN
 
@@ -24,6 +28,12 @@ namespace bitUtil
 	/// Rounds a number down to the next multiple of a power-of-two.
 	template <typename T>
 	inline T RoundDownToMultiple(T numToRound, T multipleOf);
+
+	/// Returns the index of the lowest set bit. \a x must not be zero.
+	inline unsigned int CountTrailingZeros(uint32_t x);
+
+	/// Returns the index of the lowest set bit. \a x must not be zero.
+	inline unsigned int CountTrailingZeros(uint64_t x);
 }
 
 #include "PsdBitUtil.inl"
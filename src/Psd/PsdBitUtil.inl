@@ -36,4 +36,40 @@ namespace bitUtil
 
 		return numToRound & ~(multipleOf - 1u);
 	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	inline unsigned int CountTrailingZeros(uint32_t x)
+	{
+		PSD_ASSERT(x != 0u, "The result is undefined for zero.");
+
+#if defined(_MSC_VER)
+		unsigned long index = 0u;
+		_BitScanForward(&index, x);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(x));
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	inline unsigned int CountTrailingZeros(uint64_t x)
+	{
+		PSD_ASSERT(x != 0u, "The result is undefined for zero.");
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long index = 0u;
+		_BitScanForward64(&index, x);
+		return static_cast<unsigned int>(index);
+#elif defined(_MSC_VER)
+		// 32-bit targets have no 64-bit bit scan
+		const uint32_t low = static_cast<uint32_t>(x);
+		return (low != 0u) ? CountTrailingZeros(low) : 32u + CountTrailingZeros(static_cast<uint32_t>(x >> 32u));
+#else
+		return static_cast<unsigned int>(__builtin_ctzll(x));
+#endif
+	}
 }
@@ -0,0 +1,97 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdBlend.h"
+
+#include "PsdBlendKernels.h"
+#include "PsdSimd.h"
+#include "PsdAssert.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::BlendKernelTable* table)
+	{
+		// the scalar kernels are used for levels without dedicated kernels, e.g. SSSE3 doesn't add anything over SSE2
+		imageUtil::RegisterBlendKernels<imageUtil::ScalarVector>(&table->kernels8);
+		imageUtil::RegisterBlendKernels<imageUtil::ScalarVector>(&table->kernels16);
+		imageUtil::RegisterBlendKernels<imageUtil::ScalarVector>(&table->kernels32);
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterBlendKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterBlendKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterBlendKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterBlendKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::BlendKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::BlendKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void BlendRow(blendMode::Enum mode, const uint8_t* PSD_RESTRICT src, const uint8_t* PSD_RESTRICT mask, uint8_t opacity, uint8_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y)
+	{
+		PSD_ASSERT(mode <= blendMode::UNKNOWN, "Invalid blend mode %d.", mode);
+		GetKernelTable().kernels8.blend[mode](src, mask, opacity / 255.0f, dest, count, x, y);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void BlendRow(blendMode::Enum mode, const uint16_t* PSD_RESTRICT src, const uint16_t* PSD_RESTRICT mask, uint8_t opacity, uint16_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y)
+	{
+		PSD_ASSERT(mode <= blendMode::UNKNOWN, "Invalid blend mode %d.", mode);
+		GetKernelTable().kernels16.blend[mode](src, mask, opacity / 255.0f, dest, count, x, y);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void BlendRow(blendMode::Enum mode, const float32_t* PSD_RESTRICT src, const float32_t* PSD_RESTRICT mask, uint8_t opacity, float32_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y)
+	{
+		PSD_ASSERT(mode <= blendMode::UNKNOWN, "Invalid blend mode %d.", mode);
+		GetKernelTable().kernels32.blend[mode](src, mask, opacity / 255.0f, dest, count, x, y);
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,36 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdBlendMode.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Blends \a count interleaved 8-bit RGBA pixels from \a src onto the interleaved RGBA pixels in \a dest, using the given blend \a mode.
+	/// The alpha of each source pixel is multiplied by the \a opacity in the range [0, 255] and, unless \a mask is a nullptr,
+	/// by the corresponding value in \a mask, which holds one value per pixel. The result is composited onto \a dest using
+	/// source-over compositing, so \a dest may be partially transparent.
+	/// \a x and \a y denote the position of the first pixel on the canvas, and are only used by blendMode::DISSOLVE.
+	/// \remark blendMode::PASS_THROUGH and blendMode::UNKNOWN blend like blendMode::NORMAL.
+	/// \remark Buffers don't need to be aligned.
+	void BlendRow(blendMode::Enum mode, const uint8_t* PSD_RESTRICT src, const uint8_t* PSD_RESTRICT mask, uint8_t opacity, uint8_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y);
+
+	/// \ingroup ImageUtil
+	/// Blends \a count interleaved 16-bit RGBA pixels from \a src onto the interleaved RGBA pixels in \a dest.
+	/// Values are expected to be in the range [0, 32768] used by Photoshop.
+	/// \sa BlendRow
+	void BlendRow(blendMode::Enum mode, const uint16_t* PSD_RESTRICT src, const uint16_t* PSD_RESTRICT mask, uint8_t opacity, uint16_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y);
+
+	/// \ingroup ImageUtil
+	/// Blends \a count interleaved 32-bit RGBA pixels from \a src onto the interleaved RGBA pixels in \a dest.
+	/// Values are expected to be in the range [0, 1].
+	/// \sa BlendRow
+	void BlendRow(blendMode::Enum mode, const float32_t* PSD_RESTRICT src, const float32_t* PSD_RESTRICT mask, uint8_t opacity, float32_t* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,438 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdBlendMode.h"
+#include "PsdVector_Scalar.h"
+
+#include <cmath>
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief Implementations of \ref BlendRow for one pixel type and one \ref simd::Level, one kernel per blend mode.
+	/// \details Each kernel blends \a count pixels, and has to deal with pixels that don't fill a whole SIMD register itself.
+	/// The \a opacity is already normalized to [0, 1].
+	/// \sa BlendRow
+	template <typename T>
+	struct BlendKernels
+	{
+		typedef void (*BlendFunction)(const T* PSD_RESTRICT src, const T* PSD_RESTRICT mask, float32_t opacity, T* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y);
+
+		BlendFunction blend[blendMode::UNKNOWN + 1];
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The blend kernels used for all pixel types at one \ref simd::Level.
+	struct BlendKernelTable
+	{
+		BlendKernels<uint8_t> kernels8;
+		BlendKernels<uint16_t> kernels16;
+		BlendKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table with the ones for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterBlendKernelsSSE2(BlendKernelTable* table);
+	void RegisterBlendKernelsAVX2(BlendKernelTable* table);
+	void RegisterBlendKernelsAVX512(BlendKernelTable* table);
+	void RegisterBlendKernelsNEON(BlendKernelTable* table);
+
+
+	// the blend modes are implemented once, generic over a vector type V that provides the arithmetic as well as loading
+	// and storing pixels. each instruction set supplies its own vector type, see PsdVector_SSE2.h and friends, and the scalar
+	// kernels simply use a vector of one float. like the interleave kernels, everything is given internal linkage because the SIMD instantiations are
+	// compiled with instruction set flags.
+	// all math is done in floats normalized to [0, 1], using the formulas of the W3C compositing specification.
+	namespace
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Screen(typename V::Type cb, typename V::Type cs)
+		{
+			return V::Sub(V::Add(cb, cs), V::Mul(cb, cs));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type HardLight(typename V::Type cb, typename V::Type cs)
+		{
+			const typename V::Type one = V::Splat(1.0f);
+			const typename V::Type cs2 = V::Add(cs, cs);
+			return V::Select(V::LessEqual(cs, V::Splat(0.5f)), V::Mul(cb, cs2), Screen<V>(cb, V::Sub(cs2, one)));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type ColorBurn(typename V::Type cb, typename V::Type cs)
+		{
+			const typename V::Type zero = V::Splat(0.0f);
+			const typename V::Type one = V::Splat(1.0f);
+			const typename V::Type burn = V::Sub(one, V::Min(one, V::Div(V::Sub(one, cb), cs)));
+			return V::Select(V::LessEqual(one, cb), one, V::Select(V::LessEqual(cs, zero), zero, burn));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type ColorDodge(typename V::Type cb, typename V::Type cs)
+		{
+			const typename V::Type zero = V::Splat(0.0f);
+			const typename V::Type one = V::Splat(1.0f);
+			const typename V::Type dodge = V::Min(one, V::Div(cb, V::Sub(one, cs)));
+			return V::Select(V::LessEqual(cb, zero), zero, V::Select(V::LessEqual(one, cs), one, dodge));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type SoftLight(typename V::Type cb, typename V::Type cs)
+		{
+			typedef typename V::Type Type;
+			const Type one = V::Splat(1.0f);
+			const Type cs2 = V::Add(cs, cs);
+
+			// D(cb) = ((16*cb - 12)*cb + 4)*cb for dark backdrops, and sqrt(cb) otherwise
+			const Type polynomial = V::Mul(V::Add(V::Mul(V::Sub(V::Mul(V::Splat(16.0f), cb), V::Splat(12.0f)), cb), V::Splat(4.0f)), cb);
+			const Type d = V::Select(V::LessEqual(cb, V::Splat(0.25f)), polynomial, V::Sqrt(V::Max(cb, V::Splat(0.0f))));
+
+			const Type darken = V::Sub(cb, V::Mul(V::Mul(V::Sub(one, cs2), cb), V::Sub(one, cb)));
+			const Type lighten = V::Add(cb, V::Mul(V::Sub(cs2, one), V::Sub(d, cb)));
+			return V::Select(V::LessEqual(cs, V::Splat(0.5f)), darken, lighten);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, blendMode::Enum MODE>
+		PSD_INLINE typename V::Type BlendChannel(typename V::Type cb, typename V::Type cs)
+		{
+			typedef typename V::Type Type;
+			const Type zero = V::Splat(0.0f);
+			const Type one = V::Splat(1.0f);
+			const Type half = V::Splat(0.5f);
+
+			switch (MODE)
+			{
+				case blendMode::DARKEN:
+					return V::Min(cb, cs);
+
+				case blendMode::MULTIPLY:
+					return V::Mul(cb, cs);
+
+				case blendMode::COLOR_BURN:
+					return ColorBurn<V>(cb, cs);
+
+				case blendMode::LINEAR_BURN:
+					return V::Max(zero, V::Sub(V::Add(cb, cs), one));
+
+				case blendMode::LIGHTEN:
+					return V::Max(cb, cs);
+
+				case blendMode::SCREEN:
+					return Screen<V>(cb, cs);
+
+				case blendMode::COLOR_DODGE:
+					return ColorDodge<V>(cb, cs);
+
+				case blendMode::LINEAR_DODGE:
+					return V::Min(one, V::Add(cb, cs));
+
+				case blendMode::OVERLAY:
+					return HardLight<V>(cs, cb);
+
+				case blendMode::SOFT_LIGHT:
+					return SoftLight<V>(cb, cs);
+
+				case blendMode::HARD_LIGHT:
+					return HardLight<V>(cb, cs);
+
+				case blendMode::VIVID_LIGHT:
+				{
+					const Type cs2 = V::Add(cs, cs);
+					return V::Select(V::LessEqual(cs, half), ColorBurn<V>(cb, cs2), ColorDodge<V>(cb, V::Sub(cs2, one)));
+				}
+
+				case blendMode::LINEAR_LIGHT:
+					return V::Min(one, V::Max(zero, V::Sub(V::Add(cb, V::Add(cs, cs)), one)));
+
+				case blendMode::PIN_LIGHT:
+				{
+					const Type cs2 = V::Add(cs, cs);
+					return V::Select(V::LessEqual(cs, half), V::Min(cb, cs2), V::Max(cb, V::Sub(cs2, one)));
+				}
+
+				case blendMode::HARD_MIX:
+					// the threshold is slightly below 1 to make up for the rounding error of normalizing the integer values
+					return V::Select(V::LessEqual(V::Splat(1.0f - 1.0f/(1u << 20u)), V::Add(cb, cs)), one, zero);
+
+				case blendMode::DIFFERENCE:
+					return V::Abs(V::Sub(cb, cs));
+
+				case blendMode::EXCLUSION:
+					return V::Sub(V::Add(cb, cs), V::Mul(V::Splat(2.0f), V::Mul(cb, cs)));
+
+				case blendMode::SUBTRACT:
+					return V::Max(zero, V::Sub(cb, cs));
+
+				case blendMode::DIVIDE:
+				{
+					const Type divided = V::Min(one, V::Div(cb, cs));
+					return V::Select(V::LessEqual(cs, zero), V::Select(V::LessEqual(cb, zero), zero, one), divided);
+				}
+
+				default:
+					return cs;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Lum(const typename V::Type c[3])
+		{
+			return V::Add(V::Add(V::Mul(V::Splat(0.3f), c[0]), V::Mul(V::Splat(0.59f), c[1])), V::Mul(V::Splat(0.11f), c[2]));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Sat(const typename V::Type c[3])
+		{
+			return V::Sub(V::Max(V::Max(c[0], c[1]), c[2]), V::Min(V::Min(c[0], c[1]), c[2]));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE void SetLum(const typename V::Type c[3], typename V::Type l, typename V::Type result[3])
+		{
+			typedef typename V::Type Type;
+			const Type d = V::Sub(l, Lum<V>(c));
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				result[i] = V::Add(c[i], d);
+			}
+
+			// clip the color to [0, 1] while preserving its luminosity
+			const Type lum = Lum<V>(result);
+			const Type n = V::Min(V::Min(result[0], result[1]), result[2]);
+			const Type x = V::Max(V::Max(result[0], result[1]), result[2]);
+			const typename V::Mask isBelow = V::Less(n, V::Splat(0.0f));
+			const typename V::Mask isAbove = V::Less(V::Splat(1.0f), x);
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				const Type offset = V::Sub(result[i], lum);
+				const Type below = V::Add(lum, V::Div(V::Mul(offset, lum), V::Sub(lum, n)));
+				result[i] = V::Select(isBelow, below, result[i]);
+
+				const Type aboveOffset = V::Sub(result[i], lum);
+				const Type above = V::Add(lum, V::Div(V::Mul(aboveOffset, V::Sub(V::Splat(1.0f), lum)), V::Sub(x, lum)));
+				result[i] = V::Select(isAbove, above, result[i]);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE void SetSat(const typename V::Type c[3], typename V::Type s, typename V::Type result[3])
+		{
+			typedef typename V::Type Type;
+			const Type n = V::Min(V::Min(c[0], c[1]), c[2]);
+			const Type x = V::Max(V::Max(c[0], c[1]), c[2]);
+			const typename V::Mask hasRange = V::Less(n, x);
+
+			// the largest component becomes s, the smallest becomes 0, and the middle one is scaled accordingly
+			const Type scale = V::Div(s, V::Sub(x, n));
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				result[i] = V::Select(hasRange, V::Mul(V::Sub(c[i], n), scale), V::Splat(0.0f));
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, blendMode::Enum MODE>
+		PSD_INLINE void BlendColor(const typename V::Type cb[3], const typename V::Type cs[3], typename V::Type result[3])
+		{
+			typedef typename V::Type Type;
+			switch (MODE)
+			{
+				case blendMode::DARKER_COLOR:
+				case blendMode::LIGHTER_COLOR:
+				{
+					// the whole color with the lower (or higher) luminosity wins
+					const typename V::Mask isSourceDarker = V::Less(Lum<V>(cs), Lum<V>(cb));
+					for (unsigned int i=0; i < 3u; ++i)
+					{
+						result[i] = (MODE == blendMode::DARKER_COLOR) ? V::Select(isSourceDarker, cs[i], cb[i]) : V::Select(isSourceDarker, cb[i], cs[i]);
+					}
+					break;
+				}
+
+				case blendMode::HUE:
+				{
+					Type saturated[3];
+					SetSat<V>(cs, Sat<V>(cb), saturated);
+					SetLum<V>(saturated, Lum<V>(cb), result);
+					break;
+				}
+
+				case blendMode::SATURATION:
+				{
+					Type saturated[3];
+					SetSat<V>(cb, Sat<V>(cs), saturated);
+					SetLum<V>(saturated, Lum<V>(cb), result);
+					break;
+				}
+
+				case blendMode::COLOR:
+					SetLum<V>(cs, Lum<V>(cb), result);
+					break;
+
+				case blendMode::LUMINOSITY:
+					SetLum<V>(cb, Lum<V>(cs), result);
+					break;
+
+				default:
+					for (unsigned int i=0; i < 3u; ++i)
+					{
+						result[i] = BlendChannel<V, MODE>(cb[i], cs[i]);
+					}
+					break;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T, blendMode::Enum MODE>
+		PSD_INLINE void BlendPixels(const T* PSD_RESTRICT src, const T* PSD_RESTRICT mask, float32_t opacity, T* PSD_RESTRICT dest, unsigned int x, unsigned int y)
+		{
+			typedef typename V::Type Type;
+			const Type zero = V::Splat(0.0f);
+			const Type one = V::Splat(1.0f);
+
+			Type cs[3];
+			Type as;
+			V::Load(src, cs[0], cs[1], cs[2], as);
+
+			Type cb[3];
+			Type ab;
+			V::Load(dest, cb[0], cb[1], cb[2], ab);
+
+			as = V::Mul(as, V::Splat(opacity));
+			if (mask)
+			{
+				as = V::Mul(as, V::LoadMask(mask));
+			}
+
+			if (MODE == blendMode::DISSOLVE)
+			{
+				// pixels are either kept or discarded depending on their alpha, dithered with interleaved gradient noise.
+				// the noise only depends on the position on the canvas, so that the pattern is stable across calls.
+				const Type px = V::Add(V::Splat(static_cast<float32_t>(x)), V::Ramp());
+				const Type py = V::Splat(static_cast<float32_t>(y));
+				const Type noise = V::Fract(V::Mul(V::Splat(52.9829189f), V::Fract(V::Add(V::Mul(V::Splat(0.06711056f), px), V::Mul(V::Splat(0.00583715f), py)))));
+				as = V::Select(V::Less(noise, as), one, zero);
+			}
+
+			Type blended[3];
+			BlendColor<V, MODE>(cb, cs, blended);
+
+			// source-over compositing of non-premultiplied colors, where the blended color is only used where the backdrop
+			// is opaque: co = (as*((1 - ab)*cs + ab*B(cb, cs)) + (1 - as)*ab*cb) / ao
+			const Type ao = V::Sub(V::Add(as, ab), V::Mul(as, ab));
+			const Type invAo = V::Select(V::Less(zero, ao), V::Div(one, ao), zero);
+			const Type backdropWeight = V::Mul(V::Sub(one, as), ab);
+
+			Type co[3];
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				const Type mixed = V::Add(cs[i], V::Mul(ab, V::Sub(blended[i], cs[i])));
+				co[i] = V::Mul(V::Add(V::Mul(as, mixed), V::Mul(backdropWeight, cb[i])), invAo);
+			}
+
+			V::Store(dest, co[0], co[1], co[2], ao);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T, blendMode::Enum MODE>
+		void BlendRowKernel(const T* PSD_RESTRICT src, const T* PSD_RESTRICT mask, float32_t opacity, T* PSD_RESTRICT dest, unsigned int count, unsigned int x, unsigned int y)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				BlendPixels<V, T, MODE>(src + i*4u, mask ? (mask + i) : nullptr, opacity, dest + i*4u, x + i, y);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				BlendPixels<ScalarVector, T, MODE>(src + i*4u, mask ? (mask + i) : nullptr, opacity, dest + i*4u, x + i, y);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void RegisterBlendKernels(BlendKernels<T>* kernels)
+		{
+			// pass-through only makes a difference when compositing groups, and unknown modes are treated like normal ones
+			kernels->blend[blendMode::PASS_THROUGH] = &BlendRowKernel<V, T, blendMode::NORMAL>;
+			kernels->blend[blendMode::NORMAL] = &BlendRowKernel<V, T, blendMode::NORMAL>;
+			kernels->blend[blendMode::DISSOLVE] = &BlendRowKernel<V, T, blendMode::DISSOLVE>;
+			kernels->blend[blendMode::DARKEN] = &BlendRowKernel<V, T, blendMode::DARKEN>;
+			kernels->blend[blendMode::MULTIPLY] = &BlendRowKernel<V, T, blendMode::MULTIPLY>;
+			kernels->blend[blendMode::COLOR_BURN] = &BlendRowKernel<V, T, blendMode::COLOR_BURN>;
+			kernels->blend[blendMode::LINEAR_BURN] = &BlendRowKernel<V, T, blendMode::LINEAR_BURN>;
+			kernels->blend[blendMode::DARKER_COLOR] = &BlendRowKernel<V, T, blendMode::DARKER_COLOR>;
+			kernels->blend[blendMode::LIGHTEN] = &BlendRowKernel<V, T, blendMode::LIGHTEN>;
+			kernels->blend[blendMode::SCREEN] = &BlendRowKernel<V, T, blendMode::SCREEN>;
+			kernels->blend[blendMode::COLOR_DODGE] = &BlendRowKernel<V, T, blendMode::COLOR_DODGE>;
+			kernels->blend[blendMode::LINEAR_DODGE] = &BlendRowKernel<V, T, blendMode::LINEAR_DODGE>;
+			kernels->blend[blendMode::LIGHTER_COLOR] = &BlendRowKernel<V, T, blendMode::LIGHTER_COLOR>;
+			kernels->blend[blendMode::OVERLAY] = &BlendRowKernel<V, T, blendMode::OVERLAY>;
+			kernels->blend[blendMode::SOFT_LIGHT] = &BlendRowKernel<V, T, blendMode::SOFT_LIGHT>;
+			kernels->blend[blendMode::HARD_LIGHT] = &BlendRowKernel<V, T, blendMode::HARD_LIGHT>;
+			kernels->blend[blendMode::VIVID_LIGHT] = &BlendRowKernel<V, T, blendMode::VIVID_LIGHT>;
+			kernels->blend[blendMode::LINEAR_LIGHT] = &BlendRowKernel<V, T, blendMode::LINEAR_LIGHT>;
+			kernels->blend[blendMode::PIN_LIGHT] = &BlendRowKernel<V, T, blendMode::PIN_LIGHT>;
+			kernels->blend[blendMode::HARD_MIX] = &BlendRowKernel<V, T, blendMode::HARD_MIX>;
+			kernels->blend[blendMode::DIFFERENCE] = &BlendRowKernel<V, T, blendMode::DIFFERENCE>;
+			kernels->blend[blendMode::EXCLUSION] = &BlendRowKernel<V, T, blendMode::EXCLUSION>;
+			kernels->blend[blendMode::SUBTRACT] = &BlendRowKernel<V, T, blendMode::SUBTRACT>;
+			kernels->blend[blendMode::DIVIDE] = &BlendRowKernel<V, T, blendMode::DIVIDE>;
+			kernels->blend[blendMode::HUE] = &BlendRowKernel<V, T, blendMode::HUE>;
+			kernels->blend[blendMode::SATURATION] = &BlendRowKernel<V, T, blendMode::SATURATION>;
+			kernels->blend[blendMode::COLOR] = &BlendRowKernel<V, T, blendMode::COLOR>;
+			kernels->blend[blendMode::LUMINOSITY] = &BlendRowKernel<V, T, blendMode::LUMINOSITY>;
+			kernels->blend[blendMode::UNKNOWN] = &BlendRowKernel<V, T, blendMode::NORMAL>;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
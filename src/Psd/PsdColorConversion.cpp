@@ -0,0 +1,244 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdColorConversion.h"
+
+#include "PsdColorConversionKernels.h"
+#include "PsdSimd.h"
+
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::ColorConversionKernelTable* table)
+	{
+		// the scalar kernels are used for levels without dedicated kernels, e.g. SSSE3 doesn't add anything over SSE2
+		imageUtil::RegisterColorConversionKernels<imageUtil::ScalarVector>(&table->kernels8);
+		imageUtil::RegisterColorConversionKernels<imageUtil::ScalarVector>(&table->kernels16);
+		imageUtil::RegisterColorConversionKernels<imageUtil::ScalarVector>(&table->kernels32);
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterColorConversionKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterColorConversionKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterColorConversionKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterColorConversionKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::ColorConversionKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::ColorConversionKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static const T* OffsetRow(const T* data, size_t offset)
+	{
+		return data ? (data + offset) : nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ConvertGrayscale(const imageUtil::ColorConversionKernels<T>& kernels, const T* PSD_RESTRICT gray, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		// the kernels work on single rows, which keeps the pixel count within range for large documents
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			kernels.grayscaleToRgba(gray + offset, OffsetRow(alpha, offset), dest + offset*4u, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ConvertCmyk(const imageUtil::ColorConversionKernels<T>& kernels, const T* PSD_RESTRICT c, const T* PSD_RESTRICT m, const T* PSD_RESTRICT y, const T* PSD_RESTRICT k, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		for (unsigned int row=0; row < height; ++row)
+		{
+			const size_t offset = static_cast<size_t>(row) * width;
+			kernels.cmykToRgba(c + offset, m + offset, y + offset, k + offset, OffsetRow(alpha, offset), dest + offset*4u, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ConvertLab(const imageUtil::ColorConversionKernels<T>& kernels, const T* PSD_RESTRICT l, const T* PSD_RESTRICT a, const T* PSD_RESTRICT b, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			kernels.labToRgba(l + offset, a + offset, b + offset, OffsetRow(alpha, offset), dest + offset*4u, width);
+		}
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertGrayscaleToRgba(const uint8_t* PSD_RESTRICT gray, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertGrayscale(GetKernelTable().kernels8, gray, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertGrayscaleToRgba(const uint16_t* PSD_RESTRICT gray, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertGrayscale(GetKernelTable().kernels16, gray, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertGrayscaleToRgba(const float32_t* PSD_RESTRICT gray, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertGrayscale(GetKernelTable().kernels32, gray, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertCmykToRgba(const uint8_t* PSD_RESTRICT c, const uint8_t* PSD_RESTRICT m, const uint8_t* PSD_RESTRICT y, const uint8_t* PSD_RESTRICT k, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertCmyk(GetKernelTable().kernels8, c, m, y, k, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertCmykToRgba(const uint16_t* PSD_RESTRICT c, const uint16_t* PSD_RESTRICT m, const uint16_t* PSD_RESTRICT y, const uint16_t* PSD_RESTRICT k, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertCmyk(GetKernelTable().kernels16, c, m, y, k, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertCmykToRgba(const float32_t* PSD_RESTRICT c, const float32_t* PSD_RESTRICT m, const float32_t* PSD_RESTRICT y, const float32_t* PSD_RESTRICT k, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertCmyk(GetKernelTable().kernels32, c, m, y, k, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertLabToRgba(const uint8_t* PSD_RESTRICT l, const uint8_t* PSD_RESTRICT a, const uint8_t* PSD_RESTRICT b, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertLab(GetKernelTable().kernels8, l, a, b, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertLabToRgba(const uint16_t* PSD_RESTRICT l, const uint16_t* PSD_RESTRICT a, const uint16_t* PSD_RESTRICT b, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertLab(GetKernelTable().kernels16, l, a, b, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertLabToRgba(const float32_t* PSD_RESTRICT l, const float32_t* PSD_RESTRICT a, const float32_t* PSD_RESTRICT b, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		ConvertLab(GetKernelTable().kernels32, l, a, b, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertIndexedToRgba(const uint8_t* PSD_RESTRICT indices, const uint8_t* PSD_RESTRICT palette, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		// a table lookup per pixel doesn't benefit from SIMD without gather instructions, so this is done in scalar code.
+		// packing the palette into whole pixels first turns each lookup into a single load and store.
+		uint32_t colors[256];
+		for (unsigned int i=0; i < 256u; ++i)
+		{
+			const uint8_t color[4] = { palette[i], palette[i + 256u], palette[i + 512u], 255u };
+			memcpy(&colors[i], color, sizeof(uint32_t));
+		}
+
+		const size_t count = static_cast<size_t>(width) * height;
+		for (size_t i=0; i < count; ++i)
+		{
+			memcpy(dest + i*4u, &colors[indices[i]], sizeof(uint32_t));
+		}
+
+		if (alpha)
+		{
+			for (size_t i=0; i < count; ++i)
+			{
+				dest[i*4u + 3u] = alpha[i];
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ConvertBitmapToRgba(const uint8_t* PSD_RESTRICT bits, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		const uint32_t white = 0xFFFFFFFFu;
+		const uint8_t blackColor[4] = { 0u, 0u, 0u, 255u };
+		uint32_t black = 0u;
+		memcpy(&black, blackColor, sizeof(uint32_t));
+
+		const unsigned int bytesPerRow = (width + 7u) / 8u;
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const uint8_t* PSD_RESTRICT row = bits + static_cast<size_t>(y) * bytesPerRow;
+			uint8_t* PSD_RESTRICT destRow = dest + static_cast<size_t>(y) * width * 4u;
+			for (unsigned int x=0; x < width; ++x)
+			{
+				const bool isBlack = ((row[x >> 3u] >> (7u - (x & 7u))) & 1u) != 0u;
+				memcpy(destRow + x*4u, isBlack ? &black : &white, sizeof(uint32_t));
+			}
+		}
+	}
+}
+
+PSD_NAMESPACE_END
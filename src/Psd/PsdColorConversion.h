@@ -0,0 +1,81 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Turns planar 8-bit grayscale data into interleaved RGBA data. Duotone data is stored as grayscale, and can be converted using this function, too.
+	/// Unless \a alpha is a nullptr, it holds one alpha value per pixel, otherwise all pixels are opaque.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void ConvertGrayscaleToRgba(const uint8_t* PSD_RESTRICT gray, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 16-bit grayscale data into interleaved RGBA data.
+	/// \sa ConvertGrayscaleToRgba
+	void ConvertGrayscaleToRgba(const uint16_t* PSD_RESTRICT gray, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 32-bit grayscale data into interleaved RGBA data.
+	/// \sa ConvertGrayscaleToRgba
+	void ConvertGrayscaleToRgba(const float32_t* PSD_RESTRICT gray, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Turns planar 8-bit CMYK data into interleaved RGBA data, using a naive conversion without any color management.
+	/// The data is expected as stored by Photoshop, where 0 denotes 100% ink. Unless \a alpha is a nullptr, it holds one alpha value
+	/// per pixel, otherwise all pixels are opaque.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void ConvertCmykToRgba(const uint8_t* PSD_RESTRICT c, const uint8_t* PSD_RESTRICT m, const uint8_t* PSD_RESTRICT y, const uint8_t* PSD_RESTRICT k, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 16-bit CMYK data into interleaved RGBA data.
+	/// \sa ConvertCmykToRgba
+	void ConvertCmykToRgba(const uint16_t* PSD_RESTRICT c, const uint16_t* PSD_RESTRICT m, const uint16_t* PSD_RESTRICT y, const uint16_t* PSD_RESTRICT k, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 32-bit CMYK data into interleaved RGBA data.
+	/// \sa ConvertCmykToRgba
+	void ConvertCmykToRgba(const float32_t* PSD_RESTRICT c, const float32_t* PSD_RESTRICT m, const float32_t* PSD_RESTRICT y, const float32_t* PSD_RESTRICT k, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Turns planar 8-bit Lab data into interleaved sRGB data with alpha, assuming a D50 white point. The a and b channels are stored
+	/// with an offset of 128, as done by Photoshop. Unless \a alpha is a nullptr, it holds one alpha value per pixel, otherwise all pixels are opaque.
+	/// Colors outside the sRGB gamut are clipped.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void ConvertLabToRgba(const uint8_t* PSD_RESTRICT l, const uint8_t* PSD_RESTRICT a, const uint8_t* PSD_RESTRICT b, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 16-bit Lab data into interleaved sRGB data with alpha. Like all 16-bit data, the channels are in the range [0, 32768], and the a and b channels are stored with an offset of 16384.
+	/// \sa ConvertLabToRgba
+	void ConvertLabToRgba(const uint16_t* PSD_RESTRICT l, const uint16_t* PSD_RESTRICT a, const uint16_t* PSD_RESTRICT b, const uint16_t* PSD_RESTRICT alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 32-bit Lab data into interleaved sRGB data with alpha. All channels are expected to be in the range [0, 1], with 0.5 denoting neutral a and b values.
+	/// \sa ConvertLabToRgba
+	void ConvertLabToRgba(const float32_t* PSD_RESTRICT l, const float32_t* PSD_RESTRICT a, const float32_t* PSD_RESTRICT b, const float32_t* PSD_RESTRICT alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Turns planar 8-bit indexed data into interleaved RGBA data, looking up each index in the \a palette. The palette is the color data
+	/// stored in the ColorModeDataSection of indexed documents, holding 256 red values, followed by 256 green and 256 blue values.
+	/// Unless \a alpha is a nullptr, it holds one alpha value per pixel, otherwise all pixels are opaque.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	void ConvertIndexedToRgba(const uint8_t* PSD_RESTRICT indices, const uint8_t* PSD_RESTRICT palette, const uint8_t* PSD_RESTRICT alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Expands 1-bit bitmap data into opaque, interleaved 8-bit RGBA data. Set bits denote black pixels, the most significant bit of
+	/// each byte holds the leftmost pixel, and each row starts at a new byte. \a bits therefore holds "(width+7)/8*height" bytes.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	void ConvertBitmapToRgba(const uint8_t* PSD_RESTRICT bits, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,246 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdVector_Scalar.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief Implementations of the color mode conversions for one pixel type and one \ref simd::Level.
+	/// \details Each kernel converts \a count planar pixels into interleaved RGBA pixels, and has to deal with pixels that don't fill
+	/// a whole SIMD register itself. If \a alpha is a nullptr, all pixels are opaque.
+	/// \sa ConvertGrayscaleToRgba ConvertCmykToRgba ConvertLabToRgba
+	template <typename T>
+	struct ColorConversionKernels
+	{
+		typedef void (*GrayscaleFunction)(const T* PSD_RESTRICT gray, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count);
+		typedef void (*CmykFunction)(const T* PSD_RESTRICT c, const T* PSD_RESTRICT m, const T* PSD_RESTRICT y, const T* PSD_RESTRICT k, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count);
+		typedef void (*LabFunction)(const T* PSD_RESTRICT l, const T* PSD_RESTRICT a, const T* PSD_RESTRICT b, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count);
+
+		GrayscaleFunction grayscaleToRgba;
+		CmykFunction cmykToRgba;
+		LabFunction labToRgba;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The color conversion kernels used for all pixel types at one \ref simd::Level.
+	struct ColorConversionKernelTable
+	{
+		ColorConversionKernels<uint8_t> kernels8;
+		ColorConversionKernels<uint16_t> kernels16;
+		ColorConversionKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table with the ones for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterColorConversionKernelsSSE2(ColorConversionKernelTable* table);
+	void RegisterColorConversionKernelsAVX2(ColorConversionKernelTable* table);
+	void RegisterColorConversionKernelsAVX512(ColorConversionKernelTable* table);
+	void RegisterColorConversionKernelsNEON(ColorConversionKernelTable* table);
+
+
+	// like the blend kernels, the conversions are implemented once, generic over the vector types found in PsdVector_SSE2.h and
+	// friends. all math is done in floats normalized to [0, 1].
+	namespace
+	{
+		// Lab stores the a and b channels with an offset, so that 0 ends up in the middle of the range of each pixel type
+		template <typename T>
+		struct LabEncoding;
+
+		template <>
+		struct LabEncoding<uint8_t>
+		{
+			static PSD_INLINE float32_t Center(void) { return 128.0f / 255.0f; }
+			static PSD_INLINE float32_t Range(void) { return 255.0f; }
+		};
+
+		template <>
+		struct LabEncoding<uint16_t>
+		{
+			static PSD_INLINE float32_t Center(void) { return 0.5f; }
+			static PSD_INLINE float32_t Range(void) { return 256.0f; }
+		};
+
+		template <>
+		struct LabEncoding<float32_t>
+		{
+			static PSD_INLINE float32_t Center(void) { return 0.5f; }
+			static PSD_INLINE float32_t Range(void) { return 255.0f; }
+		};
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE typename V::Type LoadAlpha(const T* alpha)
+		{
+			return alpha ? V::LoadMask(alpha) : V::Splat(1.0f);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type LabInverse(typename V::Type t)
+		{
+			// inverse of the CIE Lab companding function, with a linear segment below 6/29
+			const typename V::Type cube = V::Mul(V::Mul(t, t), t);
+			const typename V::Type linear = V::Mul(V::Splat(3.0f * (6.0f / 29.0f) * (6.0f / 29.0f)), V::Sub(t, V::Splat(4.0f / 29.0f)));
+			return V::Select(V::LessEqual(t, V::Splat(6.0f / 29.0f)), linear, cube);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type EncodeSrgb(typename V::Type x)
+		{
+			typedef typename V::Type Type;
+			x = V::Min(V::Max(x, V::Splat(0.0f)), V::Splat(1.0f));
+
+			// x^(1/2.4) is computed as q*p(q) with q = x^(1/4), using a polynomial p approximating x^(1/2.4 - 1/4) on the range of q
+			// that is relevant to the gamma segment. the polynomial is evaluated in t, which maps that range to [-1, 1].
+			// the maximum error is below 2e-6, well below the precision of 16-bit output.
+			const Type q = V::Sqrt(V::Sqrt(x));
+			const Type t = V::Sub(V::Mul(q, V::Splat(2.619669900441418f)), V::Splat(1.619669900441418f));
+			Type p = V::Splat(0.000501522089f);
+			p = V::Add(V::Mul(p, t), V::Splat(-0.000954891711f));
+			p = V::Add(V::Mul(p, t), V::Splat(0.00104196839f));
+			p = V::Add(V::Mul(p, t), V::Splat(-0.00275397193f));
+			p = V::Add(V::Mul(p, t), V::Splat(0.00849741145f));
+			p = V::Add(V::Mul(p, t), V::Splat(-0.030799875f));
+			p = V::Add(V::Mul(p, t), V::Splat(0.298718225f));
+			p = V::Add(V::Mul(p, t), V::Splat(0.725751283f));
+
+			const Type gamma = V::Sub(V::Mul(V::Mul(V::Splat(1.055f), q), p), V::Splat(0.055f));
+			const Type linear = V::Mul(x, V::Splat(12.92f));
+			return V::Select(V::LessEqual(x, V::Splat(0.0031308f)), linear, gamma);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void ConvertGrayscalePixels(const T* PSD_RESTRICT gray, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			const typename V::Type g = V::LoadMask(gray);
+			V::Store(dest, g, g, g, LoadAlpha<V>(alpha));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void ConvertCmykPixels(const T* PSD_RESTRICT c, const T* PSD_RESTRICT m, const T* PSD_RESTRICT y, const T* PSD_RESTRICT k, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			// Photoshop stores CMYK inverted, with 0 meaning full ink. this turns the naive conversion r = (1-c)*(1-k) into a product.
+			const typename V::Type black = V::LoadMask(k);
+			V::Store(dest, V::Mul(V::LoadMask(c), black), V::Mul(V::LoadMask(m), black), V::Mul(V::LoadMask(y), black), LoadAlpha<V>(alpha));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void ConvertLabPixels(const T* PSD_RESTRICT l, const T* PSD_RESTRICT a, const T* PSD_RESTRICT b, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			typedef typename V::Type Type;
+
+			// Lab -> XYZ relative to the D50 white point
+			const Type center = V::Splat(LabEncoding<T>::Center());
+			const Type range = V::Splat(LabEncoding<T>::Range());
+			const Type fy = V::Add(V::Mul(V::LoadMask(l), V::Splat(100.0f / 116.0f)), V::Splat(16.0f / 116.0f));
+			const Type fx = V::Add(fy, V::Mul(V::Mul(V::Sub(V::LoadMask(a), center), range), V::Splat(1.0f / 500.0f)));
+			const Type fz = V::Sub(fy, V::Mul(V::Mul(V::Sub(V::LoadMask(b), center), range), V::Splat(1.0f / 200.0f)));
+
+			const Type x = V::Mul(LabInverse<V>(fx), V::Splat(0.96422f));
+			const Type y = LabInverse<V>(fy);
+			const Type z = V::Mul(LabInverse<V>(fz), V::Splat(0.82521f));
+
+			// XYZ -> linear sRGB, using the Bradford-adapted matrix for D50
+			const Type red = V::Add(V::Add(V::Mul(x, V::Splat(3.1338561f)), V::Mul(y, V::Splat(-1.6168667f))), V::Mul(z, V::Splat(-0.4906146f)));
+			const Type green = V::Add(V::Add(V::Mul(x, V::Splat(-0.9787684f)), V::Mul(y, V::Splat(1.9161415f))), V::Mul(z, V::Splat(0.0334540f)));
+			const Type blue = V::Add(V::Add(V::Mul(x, V::Splat(0.0719453f)), V::Mul(y, V::Splat(-0.2289914f))), V::Mul(z, V::Splat(1.4052427f)));
+
+			V::Store(dest, EncodeSrgb<V>(red), EncodeSrgb<V>(green), EncodeSrgb<V>(blue), LoadAlpha<V>(alpha));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void GrayscaleToRgbaKernel(const T* PSD_RESTRICT gray, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				ConvertGrayscalePixels<V>(gray + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				ConvertGrayscalePixels<ScalarVector>(gray + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void CmykToRgbaKernel(const T* PSD_RESTRICT c, const T* PSD_RESTRICT m, const T* PSD_RESTRICT y, const T* PSD_RESTRICT k, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				ConvertCmykPixels<V>(c + i, m + i, y + i, k + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				ConvertCmykPixels<ScalarVector>(c + i, m + i, y + i, k + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void LabToRgbaKernel(const T* PSD_RESTRICT l, const T* PSD_RESTRICT a, const T* PSD_RESTRICT b, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				ConvertLabPixels<V>(l + i, a + i, b + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				ConvertLabPixels<ScalarVector>(l + i, a + i, b + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void RegisterColorConversionKernels(ColorConversionKernels<T>* kernels)
+		{
+			kernels->grayscaleToRgba = &GrayscaleToRgbaKernel<V, T>;
+			kernels->cmykToRgba = &CmykToRgbaKernel<V, T>;
+			kernels->labToRgba = &LabToRgbaKernel<V, T>;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
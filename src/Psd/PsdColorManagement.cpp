@@ -0,0 +1,523 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdColorManagement.h"
+
+#include "PsdColorManagementKernels.h"
+#include "PsdColorTransform.h"
+#include "PsdIccProfile.h"
+#include "PsdParseIccProfile.h"
+#include "PsdKey.h"
+#include "PsdSimd.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include <cmath>
+#include <mutex>
+
+
+PSD_NAMESPACE_BEGIN
+
+struct ColorTransformCache
+{
+	std::mutex mutex;
+	ColorTransform** transforms;
+	unsigned int count;
+	unsigned int capacity;
+};
+
+
+namespace
+{
+	// grid points per dimension. 3D tables use the common size of 33 points, and 4D tables trade resolution for size.
+	static const unsigned int GRID_SIZE_1D = 1024u;
+	static const unsigned int GRID_SIZE_3D = 33u;
+	static const unsigned int GRID_SIZE_4D = 17u;
+
+	// the D50 white point of the profile connection space
+	static const float32_t WHITE_X = 0.96422f;
+	static const float32_t WHITE_Y = 1.0f;
+	static const float32_t WHITE_Z = 0.82521f;
+
+	// converts XYZ relative to D50 into linear RGB of each target color space, using Bradford chromatic adaptation
+	static const float32_t TARGET_MATRIX[2][9] =
+	{
+		// sRGB
+		{
+			3.1342599f, -1.6171978f, -0.4906852f,
+			-0.9787551f, 1.9161350f, 0.0334462f,
+			0.0719423f, -0.2289582f, 1.4052060f
+		},
+
+		// Display P3
+		{
+			2.4040433f, -0.9898969f, -0.3976319f,
+			-0.8422268f, 1.7988489f, 0.0160481f,
+			0.0481869f, -0.0973737f, 1.2735073f
+		}
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::ColorTransformKernelTable* table)
+	{
+		// the scalar kernels are used for levels without dedicated kernels, e.g. SSSE3 doesn't add anything over SSE2
+		imageUtil::RegisterColorTransformKernels<imageUtil::ScalarVector>(&table->kernels8);
+		imageUtil::RegisterColorTransformKernels<imageUtil::ScalarVector>(&table->kernels16);
+		imageUtil::RegisterColorTransformKernels<imageUtil::ScalarVector>(&table->kernels32);
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterColorTransformKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterColorTransformKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterColorTransformKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterColorTransformKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::ColorTransformKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::ColorTransformKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t Saturate(float32_t value)
+	{
+		return (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t EvaluateCurve(const IccCurve& curve, float32_t x)
+	{
+		x = Saturate(x);
+		if (curve.table)
+		{
+			const float32_t position = x * static_cast<float32_t>(curve.entryCount - 1u);
+			const uint32_t index = (position >= static_cast<float32_t>(curve.entryCount - 1u)) ? (curve.entryCount - 2u) : static_cast<uint32_t>(position);
+			const float32_t fraction = position - static_cast<float32_t>(index);
+			return curve.table[index] + (curve.table[index + 1u] - curve.table[index]) * fraction;
+		}
+
+		// parametric curves as defined by the ICC specification, with parameters g, a, b, c, d, e, f
+		const float32_t* p = curve.parameters;
+		float32_t y = 0.0f;
+		switch (curve.functionType)
+		{
+			case 0u:
+				y = std::pow(x, p[0]);
+				break;
+
+			case 1u:
+				y = (x >= -p[2] / p[1]) ? std::pow(p[1]*x + p[2], p[0]) : 0.0f;
+				break;
+
+			case 2u:
+				y = (x >= -p[2] / p[1]) ? (std::pow(p[1]*x + p[2], p[0]) + p[3]) : p[3];
+				break;
+
+			case 3u:
+				y = (x >= p[4]) ? std::pow(p[1]*x + p[2], p[0]) : (p[3]*x);
+				break;
+
+			case 4u:
+				y = (x >= p[4]) ? (std::pow(p[1]*x + p[2], p[0]) + p[5]) : (p[3]*x + p[6]);
+				break;
+
+			default:
+				y = x;
+				break;
+		}
+
+		return Saturate(y);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void EvaluateClut(const IccProfile* profile, const float32_t* input, float32_t* output)
+	{
+		// multilinear interpolation between the 2^n grid points enclosing the input
+		const unsigned int channelCount = profile->channelCount;
+		unsigned int index[4] = {};
+		float32_t fraction[4] = {};
+		unsigned int stride[4] = {};
+		unsigned int currentStride = 3u;
+		for (unsigned int i=channelCount; i-- > 0u; )
+		{
+			const unsigned int lastIndex = profile->gridPoints[i] - 1u;
+			const float32_t position = Saturate(input[i]) * static_cast<float32_t>(lastIndex);
+			index[i] = (position >= static_cast<float32_t>(lastIndex)) ? ((lastIndex > 0u) ? (lastIndex - 1u) : 0u) : static_cast<unsigned int>(position);
+			fraction[i] = (lastIndex > 0u) ? (position - static_cast<float32_t>(index[i])) : 0.0f;
+			stride[i] = (lastIndex > 0u) ? currentStride : 0u;
+			currentStride *= profile->gridPoints[i];
+		}
+
+		unsigned int base = 0u;
+		for (unsigned int i=0; i < channelCount; ++i)
+		{
+			base += index[i] * stride[i];
+		}
+
+		output[0] = output[1] = output[2] = 0.0f;
+		for (unsigned int corner=0; corner < (1u << channelCount); ++corner)
+		{
+			float32_t weight = 1.0f;
+			unsigned int offset = base;
+			for (unsigned int i=0; i < channelCount; ++i)
+			{
+				const bool isUpper = ((corner >> i) & 1u) != 0u;
+				weight *= isUpper ? fraction[i] : (1.0f - fraction[i]);
+				offset += isUpper ? stride[i] : 0u;
+			}
+
+			if (weight == 0.0f)
+				continue;
+
+			for (unsigned int c=0; c < 3u; ++c)
+			{
+				output[c] += profile->clut[offset + c] * weight;
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void LabToXyz(float32_t l, float32_t a, float32_t b, float32_t* xyz)
+	{
+		const float32_t fy = (l + 16.0f) / 116.0f;
+		const float32_t f[3] = { fy + a / 500.0f, fy, fy - b / 200.0f };
+		const float32_t white[3] = { WHITE_X, WHITE_Y, WHITE_Z };
+		for (unsigned int i=0; i < 3u; ++i)
+		{
+			const float32_t t = f[i];
+			xyz[i] = white[i] * ((t > 6.0f / 29.0f) ? (t*t*t) : (3.0f * (6.0f / 29.0f) * (6.0f / 29.0f) * (t - 4.0f / 29.0f)));
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DecodeConnectionSpace(const IccProfile* profile, const float32_t* pcs, float32_t* xyz)
+	{
+		if (profile->connectionSpace == util::Key<'X', 'Y', 'Z', ' '>::VALUE)
+		{
+			// u1Fixed15Number, where 0xFFFF denotes 1 + 32767/32768
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				xyz[i] = pcs[i] * (65535.0f / 32768.0f);
+			}
+		}
+		else if (profile->isLegacyLabEncoding)
+		{
+			LabToXyz(pcs[0] * (65535.0f / 65280.0f) * 100.0f, pcs[1] * (65535.0f / 256.0f) - 128.0f, pcs[2] * (65535.0f / 256.0f) - 128.0f, xyz);
+		}
+		else
+		{
+			LabToXyz(pcs[0] * 100.0f, pcs[1] * 255.0f - 128.0f, pcs[2] * 255.0f - 128.0f, xyz);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void EvaluateProfile(const IccProfile* profile, const float32_t* device, float32_t* xyz)
+	{
+		if (profile->hasLut)
+		{
+			float32_t input[4] = {};
+			for (unsigned int i=0; i < profile->channelCount; ++i)
+			{
+				input[i] = EvaluateCurve(profile->inputCurves[i], device[i]);
+			}
+
+			float32_t values[3] = { input[0], input[1], input[2] };
+			if (profile->clut)
+			{
+				EvaluateClut(profile, input, values);
+			}
+
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				values[i] = EvaluateCurve(profile->matrixCurves[i], values[i]);
+			}
+
+			const float32_t* m = profile->matrix;
+			float32_t pcs[3] = {};
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				const float32_t value = m[i*3u] * values[0] + m[i*3u + 1u] * values[1] + m[i*3u + 2u] * values[2] + m[9u + i];
+				pcs[i] = EvaluateCurve(profile->outputCurves[i], value);
+			}
+
+			DecodeConnectionSpace(profile, pcs, xyz);
+		}
+		else if (profile->colorSpace == util::Key<'G', 'R', 'A', 'Y'>::VALUE)
+		{
+			const float32_t y = EvaluateCurve(profile->toneCurves[0], device[0]);
+			xyz[0] = y * WHITE_X;
+			xyz[1] = y * WHITE_Y;
+			xyz[2] = y * WHITE_Z;
+		}
+		else if (profile->colorSpace == util::Key<'R', 'G', 'B', ' '>::VALUE)
+		{
+			float32_t linear[3] = {};
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				linear[i] = EvaluateCurve(profile->toneCurves[i], device[i]);
+			}
+
+			const float32_t* m = profile->colorants;
+			for (unsigned int i=0; i < 3u; ++i)
+			{
+				xyz[i] = m[i*3u] * linear[0] + m[i*3u + 1u] * linear[1] + m[i*3u + 2u] * linear[2];
+			}
+		}
+		else
+		{
+			// Lab data is stored using the same encoding as the connection space
+			LabToXyz(device[0] * 100.0f, device[1] * 255.0f - 128.0f, device[2] * 255.0f - 128.0f, xyz);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t EncodeSrgb(float32_t x)
+	{
+		x = Saturate(x);
+		return (x <= 0.0031308f) ? (12.92f * x) : (1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void TransformRows(const imageUtil::ColorTransformKernels<T>& kernels, const ColorTransform* transform, const T* const* planes, const T* alpha, T* dest, unsigned int width, unsigned int height)
+	{
+		PSD_ASSERT_NOT_NULL(transform);
+		PSD_ASSERT_NOT_NULL(planes);
+
+		typename imageUtil::ColorTransformKernels<T>::TransformFunction function = kernels.transform3;
+		if (transform->channelCount == 1u)
+			function = kernels.transform1;
+		else if (transform->channelCount == 4u)
+			function = kernels.transform4;
+
+		// the kernels work on single rows, which keeps the pixel count within range for large documents
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			const T* rows[4] = {};
+			for (unsigned int c=0; c < transform->channelCount; ++c)
+			{
+				rows[c] = planes[c] + offset;
+			}
+
+			function(transform, rows, alpha ? (alpha + offset) : nullptr, dest + offset*4u, width);
+		}
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ColorTransform* CreateColorTransform(const IccProfile* profile, colorSpace::Enum target, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(profile);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT((target == colorSpace::SRGB) || (target == colorSpace::DISPLAY_P3), "Unknown color space %d.", target);
+
+	const unsigned int channelCount = profile->channelCount;
+	const unsigned int gridSize = (channelCount == 1u) ? GRID_SIZE_1D : ((channelCount == 4u) ? GRID_SIZE_4D : GRID_SIZE_3D);
+	unsigned int pointCount = 1u;
+	for (unsigned int i=0; i < channelCount; ++i)
+	{
+		pointCount *= gridSize;
+	}
+
+	ColorTransform* transform = memoryUtil::Allocate<ColorTransform>(allocator);
+	transform->profileHash = profile->hash;
+	transform->targetColorSpace = target;
+	transform->channelCount = channelCount;
+	transform->gridSize = gridSize;
+	transform->lut = memoryUtil::AllocateArray<float32_t>(allocator, pointCount*3u);
+
+	// Photoshop stores CMYK inverted, with 0 meaning full ink
+	const bool isInverted = (profile->colorSpace == util::Key<'C', 'M', 'Y', 'K'>::VALUE);
+	const float32_t* matrix = TARGET_MATRIX[target];
+	for (unsigned int point=0; point < pointCount; ++point)
+	{
+		// the first channel varies slowest
+		float32_t device[4] = {};
+		unsigned int remainder = point;
+		for (unsigned int i=channelCount; i-- > 0u; )
+		{
+			const float32_t value = static_cast<float32_t>(remainder % gridSize) / static_cast<float32_t>(gridSize - 1u);
+			device[i] = isInverted ? (1.0f - value) : value;
+			remainder /= gridSize;
+		}
+
+		float32_t xyz[3] = {};
+		EvaluateProfile(profile, device, xyz);
+
+		float32_t* rgb = transform->lut + point*3u;
+		for (unsigned int i=0; i < 3u; ++i)
+		{
+			rgb[i] = EncodeSrgb(matrix[i*3u] * xyz[0] + matrix[i*3u + 1u] * xyz[1] + matrix[i*3u + 2u] * xyz[2]);
+		}
+	}
+
+	return transform;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyColorTransform(ColorTransform*& transform, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(transform);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	memoryUtil::FreeArray(allocator, transform->lut);
+	memoryUtil::Free(allocator, transform);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ColorTransformCache* CreateColorTransformCache(Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	ColorTransformCache* cache = memoryUtil::Allocate<ColorTransformCache>(allocator);
+	cache->transforms = nullptr;
+	cache->count = 0u;
+	cache->capacity = 0u;
+
+	return cache;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const ColorTransform* GetColorTransform(ColorTransformCache* cache, const void* data, uint32_t size, colorSpace::Enum target, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(cache);
+	PSD_ASSERT_NOT_NULL(data);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	const uint64_t hash = HashIccProfile(data, size);
+
+	// the lock is held while creating a new transform, so that threads asking for the same profile don't create it twice
+	std::lock_guard<std::mutex> lock(cache->mutex);
+	for (unsigned int i=0; i < cache->count; ++i)
+	{
+		const ColorTransform* transform = cache->transforms[i];
+		if ((transform->profileHash == hash) && (transform->targetColorSpace == static_cast<unsigned int>(target)))
+			return transform;
+	}
+
+	IccProfile* profile = ParseIccProfile(data, size, allocator);
+	if (!profile)
+		return nullptr;
+
+	ColorTransform* transform = CreateColorTransform(profile, target, allocator);
+	DestroyIccProfile(profile, allocator);
+
+	if (cache->count == cache->capacity)
+	{
+		const unsigned int capacity = (cache->capacity == 0u) ? 4u : (cache->capacity * 2u);
+		ColorTransform** transforms = memoryUtil::AllocateArray<ColorTransform*>(allocator, capacity);
+		for (unsigned int i=0; i < cache->count; ++i)
+		{
+			transforms[i] = cache->transforms[i];
+		}
+
+		memoryUtil::FreeArray(allocator, cache->transforms);
+		cache->transforms = transforms;
+		cache->capacity = capacity;
+	}
+
+	cache->transforms[cache->count++] = transform;
+	return transform;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyColorTransformCache(ColorTransformCache*& cache, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(cache);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	for (unsigned int i=0; i < cache->count; ++i)
+	{
+		DestroyColorTransform(cache->transforms[i], allocator);
+	}
+
+	memoryUtil::FreeArray(allocator, cache->transforms);
+	memoryUtil::Free(allocator, cache);
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyColorTransform(const ColorTransform* transform, const uint8_t* const* planes, const uint8_t* alpha, uint8_t* dest, unsigned int width, unsigned int height)
+	{
+		TransformRows(GetKernelTable().kernels8, transform, planes, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyColorTransform(const ColorTransform* transform, const uint16_t* const* planes, const uint16_t* alpha, uint16_t* dest, unsigned int width, unsigned int height)
+	{
+		TransformRows(GetKernelTable().kernels16, transform, planes, alpha, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void ApplyColorTransform(const ColorTransform* transform, const float32_t* const* planes, const float32_t* alpha, float32_t* dest, unsigned int width, unsigned int height)
+	{
+		TransformRows(GetKernelTable().kernels32, transform, planes, alpha, dest, width, height);
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,69 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdColorSpace.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+class Allocator;
+struct IccProfile;
+struct ColorTransform;
+struct ColorTransformCache;
+
+
+/// \ingroup Renderer
+/// Creates a lookup table converting data described by the \a profile into the \a target color space, which can then be applied
+/// to any number of pixels using \ref imageUtil::ApplyColorTransform.
+/// \remark The transform uses the perceptual lookup tables of the profile if there are any, and relative colorimetric intent otherwise.
+/// Colors outside the target gamut are clipped.
+/// \return Returns a newly created transform that needs to be freed by a call to \ref DestroyColorTransform.
+ColorTransform* CreateColorTransform(const IccProfile* profile, colorSpace::Enum target, Allocator* allocator);
+
+/// \ingroup Renderer
+/// Destroys and nullifies the given \a transform previously created by a call to \ref CreateColorTransform.
+void DestroyColorTransform(ColorTransform*& transform, Allocator* allocator);
+
+
+/// \ingroup Renderer
+/// Creates an empty cache of color transforms, which needs to be freed by a call to \ref DestroyColorTransformCache.
+/// Documents embedding the same profile share a single transform, so creating the lookup table is only paid for once.
+ColorTransformCache* CreateColorTransformCache(Allocator* allocator);
+
+/// \ingroup Renderer
+/// Returns the transform converting data described by the raw ICC profile \a data into the \a target color space, e.g. using
+/// ImageResourcesSection::iccProfile. Transforms are keyed by the hash of the profile, see \ref HashIccProfile, and are only created
+/// the first time a profile is encountered.
+/// \remark The cache can be used from several threads at the same time, in which case \a allocator must be thread-safe.
+/// \return Returns a nullptr if the profile cannot be parsed, otherwise a transform owned by the cache.
+const ColorTransform* GetColorTransform(ColorTransformCache* cache, const void* data, uint32_t size, colorSpace::Enum target, Allocator* allocator);
+
+/// \ingroup Renderer
+/// Destroys and nullifies the given \a cache previously created by a call to \ref CreateColorTransformCache, including all its transforms.
+void DestroyColorTransformCache(ColorTransformCache*& cache, Allocator* allocator);
+
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Converts planar 8-bit data into interleaved RGBA data using the given \a transform. \a planes holds one plane per input channel
+	/// of the transform, see ColorTransform::channelCount, in the channel order of the document. Unless \a alpha is a nullptr, it holds
+	/// one alpha value per pixel, otherwise all pixels are opaque.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void ApplyColorTransform(const ColorTransform* transform, const uint8_t* const* planes, const uint8_t* alpha, uint8_t* dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Converts planar 16-bit data into interleaved RGBA data using the given \a transform.
+	/// \sa ApplyColorTransform
+	void ApplyColorTransform(const ColorTransform* transform, const uint16_t* const* planes, const uint16_t* alpha, uint16_t* dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Converts planar 32-bit data into interleaved RGBA data using the given \a transform. Values are expected to be in the range [0, 1].
+	/// \sa ApplyColorTransform
+	void ApplyColorTransform(const ColorTransform* transform, const float32_t* const* planes, const float32_t* alpha, float32_t* dest, unsigned int width, unsigned int height);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,269 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdColorTransform.h"
+#include "PsdVector_Scalar.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief Implementations of \ref ApplyColorTransform for one pixel type and one \ref simd::Level, one kernel per number of input channels.
+	/// \details Each kernel converts \a count pixels from the planar \a planes into interleaved RGBA pixels, and has to deal with pixels
+	/// that don't fill a whole SIMD register itself. If \a alpha is a nullptr, all pixels are opaque.
+	/// \sa ApplyColorTransform
+	template <typename T>
+	struct ColorTransformKernels
+	{
+		typedef void (*TransformFunction)(const ColorTransform* PSD_RESTRICT transform, const T* const* PSD_RESTRICT planes, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count);
+
+		TransformFunction transform1;
+		TransformFunction transform3;
+		TransformFunction transform4;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The color transform kernels used for all pixel types at one \ref simd::Level.
+	struct ColorTransformKernelTable
+	{
+		ColorTransformKernels<uint8_t> kernels8;
+		ColorTransformKernels<uint16_t> kernels16;
+		ColorTransformKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table with the ones for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterColorTransformKernelsSSE2(ColorTransformKernelTable* table);
+	void RegisterColorTransformKernelsAVX2(ColorTransformKernelTable* table);
+	void RegisterColorTransformKernelsAVX512(ColorTransformKernelTable* table);
+	void RegisterColorTransformKernelsNEON(ColorTransformKernelTable* table);
+
+
+	// like the blend kernels, the transforms are implemented once, generic over the vector types found in PsdVector_SSE2.h and
+	// friends. grid indices are held in floats, which represent all indices of the tables exactly, and table entries are
+	// fetched using V::Gather.
+	namespace
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE void GetGridCoordinate(typename V::Type value, float32_t lastIndex, typename V::Type& index, typename V::Type& fraction)
+		{
+			typedef typename V::Type Type;
+
+			// the last cell is extended to include the last grid point, which keeps all lookups inside the table
+			const Type x = V::Mul(V::Min(V::Max(value, V::Splat(0.0f)), V::Splat(1.0f)), V::Splat(lastIndex));
+			index = V::Min(V::Sub(x, V::Fract(x)), V::Splat(lastIndex - 1.0f));
+			fraction = V::Sub(x, index);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Lerp(typename V::Type a, typename V::Type b, typename V::Type t)
+		{
+			return V::Add(a, V::Mul(V::Sub(b, a), t));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE void InterpolateTetrahedral(const float32_t* lut, typename V::Type base, typename V::Type fx, typename V::Type fy, typename V::Type fz,
+			float32_t strideX, float32_t strideY, float32_t strideZ, typename V::Type* rgb)
+		{
+			typedef typename V::Type Type;
+
+			// the cube is split into six tetrahedra along its main diagonal. the one containing the point is found by sorting the
+			// fractions, and the point is interpolated from the cube's first and last corner and the two corners reached by walking
+			// along the axes with the largest fractions. ties yield zero weights for the ambiguous corners.
+			const Type sx = V::Splat(strideX);
+			const Type sy = V::Splat(strideY);
+			const Type sz = V::Splat(strideZ);
+			const Type largestStride = V::Select(V::LessEqual(fy, fx), V::Select(V::LessEqual(fz, fx), sx, sz), V::Select(V::LessEqual(fz, fy), sy, sz));
+			const Type smallestStride = V::Select(V::LessEqual(fx, fy), V::Select(V::LessEqual(fx, fz), sx, sz), V::Select(V::LessEqual(fy, fz), sy, sz));
+
+			const Type largest = V::Max(fx, V::Max(fy, fz));
+			const Type smallest = V::Min(fx, V::Min(fy, fz));
+			const Type middle = V::Sub(V::Sub(V::Add(V::Add(fx, fy), fz), largest), smallest);
+
+			const Type corner1 = V::Add(base, largestStride);
+			const Type corner3 = V::Add(base, V::Add(V::Add(sx, sy), sz));
+			const Type corner2 = V::Sub(corner3, smallestStride);
+
+			const Type weight0 = V::Sub(V::Splat(1.0f), largest);
+			const Type weight1 = V::Sub(largest, middle);
+			const Type weight2 = V::Sub(middle, smallest);
+			for (unsigned int c=0; c < 3u; ++c)
+			{
+				const float32_t* table = lut + c;
+				Type value = V::Mul(V::Gather(table, base), weight0);
+				value = V::Add(value, V::Mul(V::Gather(table, corner1), weight1));
+				value = V::Add(value, V::Mul(V::Gather(table, corner2), weight2));
+				rgb[c] = V::Add(value, V::Mul(V::Gather(table, corner3), smallest));
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void TransformPixels1(const ColorTransform* PSD_RESTRICT transform, const T* PSD_RESTRICT gray, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			typedef typename V::Type Type;
+
+			Type index;
+			Type fraction;
+			GetGridCoordinate<V>(V::LoadMask(gray), static_cast<float32_t>(transform->gridSize - 1u), index, fraction);
+
+			const Type base = V::Mul(index, V::Splat(3.0f));
+			const Type next = V::Add(base, V::Splat(3.0f));
+			Type rgb[3];
+			for (unsigned int c=0; c < 3u; ++c)
+			{
+				const float32_t* table = transform->lut + c;
+				rgb[c] = Lerp<V>(V::Gather(table, base), V::Gather(table, next), fraction);
+			}
+
+			V::Store(dest, rgb[0], rgb[1], rgb[2], alpha ? V::LoadMask(alpha) : V::Splat(1.0f));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void TransformPixels3(const ColorTransform* PSD_RESTRICT transform, const T* PSD_RESTRICT c0, const T* PSD_RESTRICT c1, const T* PSD_RESTRICT c2, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			typedef typename V::Type Type;
+
+			const unsigned int gridSize = transform->gridSize;
+			const float32_t lastIndex = static_cast<float32_t>(gridSize - 1u);
+			Type i0, i1, i2;
+			Type f0, f1, f2;
+			GetGridCoordinate<V>(V::LoadMask(c0), lastIndex, i0, f0);
+			GetGridCoordinate<V>(V::LoadMask(c1), lastIndex, i1, f1);
+			GetGridCoordinate<V>(V::LoadMask(c2), lastIndex, i2, f2);
+
+			// strides are given in floats, three per grid point
+			const float32_t stride2 = 3.0f;
+			const float32_t stride1 = stride2 * static_cast<float32_t>(gridSize);
+			const float32_t stride0 = stride1 * static_cast<float32_t>(gridSize);
+			const Type base = V::Add(V::Add(V::Mul(i0, V::Splat(stride0)), V::Mul(i1, V::Splat(stride1))), V::Mul(i2, V::Splat(stride2)));
+
+			Type rgb[3];
+			InterpolateTetrahedral<V>(transform->lut, base, f0, f1, f2, stride0, stride1, stride2, rgb);
+
+			V::Store(dest, rgb[0], rgb[1], rgb[2], alpha ? V::LoadMask(alpha) : V::Splat(1.0f));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void TransformPixels4(const ColorTransform* PSD_RESTRICT transform, const T* PSD_RESTRICT c0, const T* PSD_RESTRICT c1, const T* PSD_RESTRICT c2, const T* PSD_RESTRICT c3, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest)
+		{
+			typedef typename V::Type Type;
+
+			const unsigned int gridSize = transform->gridSize;
+			const float32_t lastIndex = static_cast<float32_t>(gridSize - 1u);
+			Type i0, i1, i2, i3;
+			Type f0, f1, f2, f3;
+			GetGridCoordinate<V>(V::LoadMask(c0), lastIndex, i0, f0);
+			GetGridCoordinate<V>(V::LoadMask(c1), lastIndex, i1, f1);
+			GetGridCoordinate<V>(V::LoadMask(c2), lastIndex, i2, f2);
+			GetGridCoordinate<V>(V::LoadMask(c3), lastIndex, i3, f3);
+
+			// the first three channels are interpolated tetrahedrally in the two slices of the fourth channel enclosing the point
+			const float32_t stride3 = 3.0f;
+			const float32_t stride2 = stride3 * static_cast<float32_t>(gridSize);
+			const float32_t stride1 = stride2 * static_cast<float32_t>(gridSize);
+			const float32_t stride0 = stride1 * static_cast<float32_t>(gridSize);
+			const Type base = V::Add(V::Add(V::Mul(i0, V::Splat(stride0)), V::Mul(i1, V::Splat(stride1))), V::Add(V::Mul(i2, V::Splat(stride2)), V::Mul(i3, V::Splat(stride3))));
+
+			Type lower[3];
+			Type upper[3];
+			InterpolateTetrahedral<V>(transform->lut, base, f0, f1, f2, stride0, stride1, stride2, lower);
+			InterpolateTetrahedral<V>(transform->lut, V::Add(base, V::Splat(stride3)), f0, f1, f2, stride0, stride1, stride2, upper);
+
+			V::Store(dest, Lerp<V>(lower[0], upper[0], f3), Lerp<V>(lower[1], upper[1], f3), Lerp<V>(lower[2], upper[2], f3), alpha ? V::LoadMask(alpha) : V::Splat(1.0f));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void TransformKernel1(const ColorTransform* PSD_RESTRICT transform, const T* const* PSD_RESTRICT planes, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				TransformPixels1<V>(transform, planes[0] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				TransformPixels1<ScalarVector>(transform, planes[0] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void TransformKernel3(const ColorTransform* PSD_RESTRICT transform, const T* const* PSD_RESTRICT planes, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				TransformPixels3<V>(transform, planes[0] + i, planes[1] + i, planes[2] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				TransformPixels3<ScalarVector>(transform, planes[0] + i, planes[1] + i, planes[2] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void TransformKernel4(const ColorTransform* PSD_RESTRICT transform, const T* const* PSD_RESTRICT planes, const T* PSD_RESTRICT alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				TransformPixels4<V>(transform, planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				TransformPixels4<ScalarVector>(transform, planes[0] + i, planes[1] + i, planes[2] + i, planes[3] + i, alpha ? (alpha + i) : nullptr, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void RegisterColorTransformKernels(ColorTransformKernels<T>* kernels)
+		{
+			kernels->transform1 = &TransformKernel1<V, T>;
+			kernels->transform3 = &TransformKernel3<V, T>;
+			kernels->transform4 = &TransformKernel4<V, T>;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
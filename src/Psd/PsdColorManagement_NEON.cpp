@@ -0,0 +1,26 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdColorManagementKernels.h"
+
+#include "PsdVector_NEON.h"
+
+
+#if PSD_SIMD_NEON
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterColorTransformKernelsNEON(ColorTransformKernelTable* table)
+	{
+		RegisterColorTransformKernels<VectorNEON>(&table->kernels8);
+		RegisterColorTransformKernels<VectorNEON>(&table->kernels16);
+		RegisterColorTransformKernels<VectorNEON>(&table->kernels32);
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
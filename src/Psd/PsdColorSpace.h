@@ -0,0 +1,22 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace colorSpace
+/// \brief A namespace holding the color spaces that document data can be converted to using ICC profiles.
+/// \details Both color spaces use the sRGB transfer curve, and differ in their primaries only.
+namespace colorSpace
+{
+	enum Enum
+	{
+		SRGB = 0,
+		DISPLAY_P3 = 1
+	};
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,26 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class ColorTransform
+/// \brief A struct holding a lookup table that converts document data described by an ICC profile into a target color space, as created by \ref CreateColorTransform.
+/// \details The table samples the whole transform on a regular grid spanning the normalized channel values of the document, with
+/// \a gridSize points in each dimension. Grayscale data uses a one-dimensional table that is interpolated linearly. Three-channel data
+/// uses a 3D table that is interpolated tetrahedrally, and CMYK data interpolates linearly between the 3D tables of the two nearest black values.
+/// The grid follows the channel encoding of Photoshop, e.g. CMYK values are inverted before being fed into the profile.
+/// \sa imageUtil::ApplyColorTransform
+struct ColorTransform
+{
+	uint64_t profileHash;					///< The hash of the ICC profile the table was created from, see IccProfile::hash.
+	unsigned int targetColorSpace;			///< The color space the table converts to, can be any of \ref colorSpace::Enum.
+	unsigned int channelCount;				///< The number of input channels, either 1, 3 or 4.
+	unsigned int gridSize;					///< The number of grid points in each dimension.
+	float32_t* lut;							///< The encoded RGB values at all grid points, with the first channel varying slowest.
+};
+
+PSD_NAMESPACE_END
@@ -0,0 +1,156 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdAssert.h"
+#include "PsdBitUtil.h"
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief The PackBits encoder used at one \ref simd::Level.
+	/// \details All encoders produce exactly the same output, they only differ in how fast they find the boundaries of runs.
+	/// \sa CompressRle
+	struct RleKernelTable
+	{
+		typedef unsigned int (*CompressFunction)(const uint8_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int size);
+
+		CompressFunction compressRle;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the encoder in \a table with the one for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterRleKernelsSSE2(RleKernelTable* table);
+	void RegisterRleKernelsAVX2(RleKernelTable* table);
+	void RegisterRleKernelsAVX512(RleKernelTable* table);
+	void RegisterRleKernelsNEON(RleKernelTable* table);
+
+
+	// the encoder is implemented once, generic over a scanner that searches for the start and end of runs. the SIMD scanners
+	// compare whole registers of bytes at once, and turn the comparison into a bit mask whose lowest set bit is the byte sought.
+	namespace
+	{
+		struct ScalarRunScanner
+		{
+			// returns the offset of the first byte in [offset, size) that is repeated by the byte following it, or size if there is none
+			static PSD_INLINE unsigned int FindRepeat(const uint8_t* src, unsigned int offset, unsigned int size)
+			{
+				for (; offset + 1u < size; ++offset)
+				{
+					if (src[offset] == src[offset + 1u])
+						return offset;
+				}
+
+				return size;
+			}
+
+			// returns the offset of the first byte in [offset, size) that is different from value, or size if there is none
+			static PSD_INLINE unsigned int FindMismatch(const uint8_t* src, unsigned int offset, unsigned int size, uint8_t value)
+			{
+				for (; offset < size; ++offset)
+				{
+					if (src[offset] != value)
+						return offset;
+				}
+
+				return size;
+			}
+		};
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		PSD_INLINE uint8_t* WriteLiterals(uint8_t* PSD_RESTRICT dest, const uint8_t* PSD_RESTRICT src, unsigned int count)
+		{
+			// a literal packet holds at most 128 bytes
+			while (count != 0u)
+			{
+				const unsigned int packetSize = (count < 128u) ? count : 128u;
+				*dest++ = static_cast<uint8_t>(packetSize - 1u);
+				memcpy(dest, src, packetSize);
+				dest += packetSize;
+				src += packetSize;
+				count -= packetSize;
+			}
+
+			return dest;
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		PSD_INLINE uint8_t* WriteRun(uint8_t* dest, uint8_t value, unsigned int length)
+		{
+			*dest++ = static_cast<uint8_t>(257u - length);
+			*dest++ = value;
+
+			return dest;
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class Scanner>
+		unsigned int CompressRleKernel(const uint8_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int size)
+		{
+			uint8_t* const start = dest;
+
+			// bytes that are not part of a run are collected, and written as literals when the next run starts
+			unsigned int literalStart = 0u;
+			unsigned int offset = 0u;
+			while (offset < size)
+			{
+				const unsigned int runStart = Scanner::FindRepeat(src, offset, size);
+				if (runStart == size)
+					break;
+
+				// the first two bytes of the run are known to be equal
+				const uint8_t value = src[runStart];
+				const unsigned int runEnd = Scanner::FindMismatch(src, runStart + 2u, size, value);
+				dest = WriteLiterals(dest, src + literalStart, runStart - literalStart);
+
+				// a run holds at most 128 bytes. longer runs are split, and a single byte left over is not worth a run of
+				// its own, so it becomes the first literal of the next packet.
+				unsigned int runLength = runEnd - runStart;
+				while (runLength > 128u)
+				{
+					dest = WriteRun(dest, value, 128u);
+					runLength -= 128u;
+				}
+
+				if (runLength == 1u)
+				{
+					literalStart = runEnd - 1u;
+				}
+				else
+				{
+					dest = WriteRun(dest, value, runLength);
+					literalStart = runEnd;
+				}
+
+				offset = runEnd;
+			}
+
+			dest = WriteLiterals(dest, src + literalStart, size - literalStart);
+
+			// pad to an even number of bytes
+			unsigned int rleDataSize = static_cast<unsigned int>(dest - start);
+			if (rleDataSize & 1u)
+			{
+				*dest++ = 0x80;
+				++rleDataSize;
+			}
+
+			return rleDataSize;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
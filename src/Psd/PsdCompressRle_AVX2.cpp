@@ -0,0 +1,88 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdCompressRleKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	namespace
+	{
+		// 32 bytes per register.
+		// most runs and literal packets in real images are short, and end within the first few bytes. the first 16 bytes are
+		// therefore checked using SSE, which has a lower latency than going through a whole register right away.
+		struct RunScannerAVX2
+		{
+			static PSD_INLINE unsigned int FindRepeat(const uint8_t* src, unsigned int offset, unsigned int size)
+			{
+				// each byte is compared with its successor, hence the loads need one byte more than a register holds
+				if (offset + 17u <= size)
+				{
+					const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+					const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset + 1u));
+					const uint32_t repeats = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(current, next)));
+					if (repeats != 0u)
+						return offset + bitUtil::CountTrailingZeros(repeats);
+
+					offset += 16u;
+				}
+
+				for (; offset + 33u <= size; offset += 32u)
+				{
+					const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
+					const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset + 1u));
+					const uint32_t repeats = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(current, next)));
+					if (repeats != 0u)
+						return offset + bitUtil::CountTrailingZeros(repeats);
+				}
+
+				return ScalarRunScanner::FindRepeat(src, offset, size);
+			}
+
+			static PSD_INLINE unsigned int FindMismatch(const uint8_t* src, unsigned int offset, unsigned int size, uint8_t value)
+			{
+				if (offset + 16u <= size)
+				{
+					const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+					const uint32_t mismatches = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(value))))) ^ 0xFFFFu;
+					if (mismatches != 0u)
+						return offset + bitUtil::CountTrailingZeros(mismatches);
+
+					offset += 16u;
+				}
+
+				const __m256i splat = _mm256_set1_epi8(static_cast<char>(value));
+				for (; offset + 32u <= size; offset += 32u)
+				{
+					const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
+					const uint32_t mismatches = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, splat)));
+					if (mismatches != 0u)
+						return offset + bitUtil::CountTrailingZeros(mismatches);
+				}
+
+				return ScalarRunScanner::FindMismatch(src, offset, size, value);
+			}
+		};
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterRleKernelsAVX2(RleKernelTable* table)
+	{
+		table->compressRle = &CompressRleKernel<RunScannerAVX2>;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
@@ -0,0 +1,68 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdCompressRleKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#if PSD_SIMD_NEON
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	namespace
+	{
+		// sixteen bytes per register. NEON has no movemask instruction, but narrowing the comparison result by four bits per
+		// 16-bit lane yields a 64-bit mask with four bits per byte.
+		struct RunScannerNEON
+		{
+			static PSD_INLINE uint64_t ToMask(uint8x16_t comparison)
+			{
+				return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4)), 0);
+			}
+
+			static PSD_INLINE unsigned int FindRepeat(const uint8_t* src, unsigned int offset, unsigned int size)
+			{
+				// each byte is compared with its successor, hence the loads need one byte more than a register holds
+				for (; offset + 17u <= size; offset += 16u)
+				{
+					const uint64_t repeats = ToMask(vceqq_u8(vld1q_u8(src + offset), vld1q_u8(src + offset + 1u)));
+					if (repeats != 0u)
+						return offset + bitUtil::CountTrailingZeros(repeats) / 4u;
+				}
+
+				return ScalarRunScanner::FindRepeat(src, offset, size);
+			}
+
+			static PSD_INLINE unsigned int FindMismatch(const uint8_t* src, unsigned int offset, unsigned int size, uint8_t value)
+			{
+				const uint8x16_t splat = vdupq_n_u8(value);
+				for (; offset + 16u <= size; offset += 16u)
+				{
+					const uint64_t mismatches = ~ToMask(vceqq_u8(vld1q_u8(src + offset), splat));
+					if (mismatches != 0u)
+						return offset + bitUtil::CountTrailingZeros(mismatches) / 4u;
+				}
+
+				return ScalarRunScanner::FindMismatch(src, offset, size, value);
+			}
+		};
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterRleKernelsNEON(RleKernelTable* table)
+	{
+		table->compressRle = &CompressRleKernel<RunScannerNEON>;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
@@ -0,0 +1,223 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdCompressZip.h"
+
+#include "PsdAssert.h"
+#include "PsdAllocator.h"
+#include "PsdMemoryUtil.h"
+#include "PsdThreadPool.h"
+#include "Psdminiz.h"
+#include <cstdlib>
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// size of the chunks that are deflated independently. each chunk starts with an empty dictionary, so smaller chunks
+	// lose some compression, while larger chunks leave threads idle. at 1 MB, the loss is well below a percent.
+	static const size_t CHUNK_SIZE = 1024u * 1024u;
+
+	// number of dictionary probes per compression level, taken from miniz's zlib levels 0, 1, 6 and 10
+	static const int NUM_PROBES[4] = { 0, 1, 128, 1500 };
+
+	// largest prime below 65536, the modulus of Adler-32
+	static const uint32_t ADLER_BASE = 65521u;
+
+
+	struct ZipChunk
+	{
+		const uint8_t* src;
+		size_t size;
+		uint8_t* data;
+		size_t compressedSize;
+		size_t capacity;
+		uint32_t adler;
+		bool succeeded;
+	};
+
+
+	struct CompressChunksData
+	{
+		int flags;
+		Allocator* allocator;
+		ZipChunk* chunks;
+		unsigned int chunkCount;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static mz_bool PutChunkData(const void* buffer, int length, void* user)
+	{
+		ZipChunk* chunk = static_cast<ZipChunk*>(user);
+		const size_t size = static_cast<size_t>(length);
+		if (chunk->compressedSize + size > chunk->capacity)
+			return MZ_FALSE;
+
+		memcpy(chunk->data + chunk->compressedSize, buffer, size);
+		chunk->compressedSize += size;
+
+		return MZ_TRUE;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void CompressChunkTask(void* userData, unsigned int index)
+	{
+		CompressChunksData* data = static_cast<CompressChunksData*>(userData);
+		ZipChunk& chunk = data->chunks[index];
+		const bool isLastChunk = (index == data->chunkCount - 1u);
+
+		// deflate never expands data by more than a few bytes per stored block, plus the bytes of the final flush
+		chunk.capacity = chunk.size + chunk.size / 16u + 1024u;
+		chunk.data = memoryUtil::AllocateArray<uint8_t>(data->allocator, chunk.capacity);
+		chunk.compressedSize = 0u;
+		chunk.adler = static_cast<uint32_t>(mz_adler32(MZ_ADLER32_INIT, chunk.src, chunk.size));
+
+		// all but the last chunk end with a sync flush. this byte-aligns the output and leaves the final block open,
+		// so that the raw deflate data of all chunks can simply be concatenated.
+		tdefl_compressor* compressor = memoryUtil::Allocate<tdefl_compressor>(data->allocator);
+		tdefl_init(compressor, &PutChunkData, &chunk, data->flags);
+		const tdefl_status status = tdefl_compress_buffer(compressor, chunk.src, chunk.size, isLastChunk ? TDEFL_FINISH : TDEFL_SYNC_FLUSH);
+		memoryUtil::Free(data->allocator, compressor);
+
+		chunk.succeeded = isLastChunk ? (status == TDEFL_STATUS_DONE) : (status == TDEFL_STATUS_OKAY);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int GetDeflateFlags(compressionLevel::Enum level, compressionStrategy::Enum strategy)
+	{
+		int flags = NUM_PROBES[level];
+		if (strategy == compressionStrategy::GREEDY)
+			flags |= TDEFL_GREEDY_PARSING_FLAG;
+		else if (strategy == compressionStrategy::RLE)
+			flags |= TDEFL_RLE_MATCHES;
+
+		return flags;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, size_t length2)
+	{
+		// the checksum of two concatenated blocks can be calculated from the checksums of the individual blocks, see
+		// adler32_combine() in zlib.
+		const uint32_t remainder = static_cast<uint32_t>(length2 % ADLER_BASE);
+		uint32_t sum1 = adler1 & 0xFFFFu;
+		uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * sum1) % ADLER_BASE);
+		sum1 += (adler2 & 0xFFFFu) + ADLER_BASE - 1u;
+		sum2 += (adler1 >> 16u) + (adler2 >> 16u) + ADLER_BASE - remainder;
+
+		if (sum1 >= ADLER_BASE)
+			sum1 -= ADLER_BASE;
+		if (sum1 >= ADLER_BASE)
+			sum1 -= ADLER_BASE;
+		if (sum2 >= (ADLER_BASE << 1u))
+			sum2 -= (ADLER_BASE << 1u);
+		if (sum2 >= ADLER_BASE)
+			sum2 -= ADLER_BASE;
+
+		return sum1 | (sum2 << 16u);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void* CompressZip(const void* src, size_t size, size_t* compressedSize, compressionLevel::Enum level, compressionStrategy::Enum strategy, Allocator* allocator, ThreadPool* threadPool)
+	{
+		PSD_ASSERT_NOT_NULL(compressedSize);
+		PSD_ASSERT((level >= compressionLevel::HUFFMAN_ONLY) && (level <= compressionLevel::MAX), "Invalid compression level.");
+
+		const int flags = GetDeflateFlags(level, strategy);
+
+		const unsigned int chunkCount = static_cast<unsigned int>((size + CHUNK_SIZE - 1u) / CHUNK_SIZE);
+		if (chunkCount <= 1u)
+		{
+			return tdefl_compress_mem_to_heap(src, size, compressedSize, flags | TDEFL_WRITE_ZLIB_HEADER);
+		}
+
+		ZipChunk* chunks = memoryUtil::AllocateArray<ZipChunk>(allocator, chunkCount);
+		for (unsigned int i=0; i < chunkCount; ++i)
+		{
+			const size_t offset = i * CHUNK_SIZE;
+			chunks[i].src = static_cast<const uint8_t*>(src) + offset;
+			chunks[i].size = (size - offset < CHUNK_SIZE) ? (size - offset) : CHUNK_SIZE;
+			chunks[i].data = nullptr;
+			chunks[i].succeeded = false;
+		}
+
+		CompressChunksData data = { flags, allocator, chunks, chunkCount };
+		if (threadPool)
+		{
+			threadPool->ParallelFor(chunkCount, &CompressChunkTask, &data);
+		}
+		else
+		{
+			for (unsigned int i=0; i < chunkCount; ++i)
+			{
+				CompressChunkTask(&data, i);
+			}
+		}
+
+		// stitch the chunks together: the zlib header, the raw deflate data of all chunks, and the big-endian Adler-32
+		// checksum of the whole uncompressed data.
+		bool succeeded = true;
+		size_t totalSize = 2u + 4u;
+		uint32_t adler = MZ_ADLER32_INIT;
+		for (unsigned int i=0; i < chunkCount; ++i)
+		{
+			succeeded &= chunks[i].succeeded;
+			totalSize += chunks[i].compressedSize;
+			adler = (i == 0u) ? chunks[i].adler : CombineAdler32(adler, chunks[i].adler, chunks[i].size);
+		}
+
+		uint8_t* zipData = succeeded ? static_cast<uint8_t*>(malloc(totalSize)) : nullptr;
+		if (zipData)
+		{
+			// same header that miniz writes, see tdefl_flush_block()
+			zipData[0] = 0x78u;
+			zipData[1] = 0x01u;
+
+			size_t offset = 2u;
+			for (unsigned int i=0; i < chunkCount; ++i)
+			{
+				memcpy(zipData + offset, chunks[i].data, chunks[i].compressedSize);
+				offset += chunks[i].compressedSize;
+			}
+
+			zipData[offset + 0] = static_cast<uint8_t>(adler >> 24u);
+			zipData[offset + 1] = static_cast<uint8_t>(adler >> 16u);
+			zipData[offset + 2] = static_cast<uint8_t>(adler >> 8u);
+			zipData[offset + 3] = static_cast<uint8_t>(adler);
+
+			*compressedSize = totalSize;
+		}
+
+		for (unsigned int i=0; i < chunkCount; ++i)
+		{
+			memoryUtil::FreeArray(allocator, chunks[i].data);
+		}
+		memoryUtil::FreeArray(allocator, chunks);
+
+		if (!zipData)
+		{
+			// should never happen, but a single stream is always a valid fallback
+			return tdefl_compress_mem_to_heap(src, size, compressedSize, flags | TDEFL_WRITE_ZLIB_HEADER);
+		}
+
+		return zipData;
+	}
+}
+
+PSD_NAMESPACE_END
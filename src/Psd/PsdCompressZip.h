@@ -0,0 +1,28 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdCompressionLevel.h"
+#include "PsdCompressionStrategy.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+class Allocator;
+class ThreadPool;
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Compresses \a size bytes of \a src into a zlib stream, as stored by ZIP-compressed channels, using the given \a level and \a strategy.
+	/// Large blocks of data are split into chunks of 1 MB that are deflated independently, which allows compressing the
+	/// chunks in parallel if a \a threadPool is given. The chunks are concatenated into a single valid zlib stream.
+	/// Because chunking only depends on \a size, the resulting stream is the same no matter how many threads are used.
+	/// \remark The \a allocator is only used for temporary memory, and is used from several threads at the same time.
+	/// \return The compressed data, which must be freed using free(), just like data returned by miniz.
+	/// The size of the compressed data is stored in \a compressedSize.
+	void* CompressZip(const void* src, size_t size, size_t* compressedSize, compressionLevel::Enum level, compressionStrategy::Enum strategy, Allocator* allocator, ThreadPool* threadPool);
+}
+
+PSD_NAMESPACE_END
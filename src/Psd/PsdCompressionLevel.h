@@ -0,0 +1,24 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace compressionLevel
+/// \brief A namespace holding the levels used for ZIP-compressed data, trading compression speed for size.
+namespace compressionLevel
+{
+	enum Enum
+	{
+		HUFFMAN_ONLY = 0,						///< No matches are searched for, only Huffman coding is applied. Fastest, but yields the largest data.
+		FAST = 1,								///< A single dictionary probe per match, equivalent to zlib level 1.
+		NORMAL = 2,								///< 128 dictionary probes per match, equivalent to zlib level 6.
+		MAX = 3,								///< 1500 dictionary probes per match. Smallest data, but can be a lot slower on some data.
+		DEFAULT = 4								///< Only used when updating layers: uses the document's level, see \ref SetZipCompression.
+	};
+}
+
+PSD_NAMESPACE_END
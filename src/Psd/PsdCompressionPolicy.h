@@ -0,0 +1,22 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace compressionPolicy
+/// \brief A namespace holding the policies used for choosing the compression of channels exported with \a compressionType::AUTO.
+namespace compressionPolicy
+{
+	enum Enum
+	{
+		SMALLEST = 0,							///< Picks the compression yielding the smallest data, no matter how long it takes.
+		FASTEST = 1,							///< Only considers raw and RLE-compressed data, which are much faster than ZIP, and picks the smaller one.
+		BALANCED = 2							///< Picks a slower compression only if it saves at least 5% of the raw data size over every faster one.
+	};
+}
+
+PSD_NAMESPACE_END
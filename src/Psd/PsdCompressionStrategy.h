@@ -0,0 +1,23 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace compressionStrategy
+/// \brief A namespace holding the strategies used for finding matches in ZIP-compressed data.
+namespace compressionStrategy
+{
+	enum Enum
+	{
+		LAZY = 0,								///< Lazy parsing, which checks whether the next byte starts a longer match before emitting one.
+		GREEDY = 1,								///< Greedy parsing, which emits the first match found. Faster, but yields slightly larger data.
+		RLE = 2,								///< Only runs of the same byte are matched, independent of the level. Fast, and well suited for flat content.
+		DEFAULT = 3								///< Only used when updating layers: uses the document's strategy, see \ref SetZipCompression.
+	};
+}
+
+PSD_NAMESPACE_END
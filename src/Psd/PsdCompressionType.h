@@ -16,7 +16,8 @@ namespace compressionType
 		RAW = 0,								///< Raw data.
 		RLE = 1,								///< RLE-compressed data (using the PackBits algorithm).
 		ZIP = 2,								///< ZIP-compressed data.
-		ZIP_WITH_PREDICTION = 3					///< ZIP-compressed data with prediction (delta-encoding).
+		ZIP_WITH_PREDICTION = 3,				///< ZIP-compressed data with prediction (delta-encoding).
+		AUTO = 4								///< Only used when exporting: picks one of the above per channel, see \ref compressionPolicy. Never stored in files.
 	};
 }
 
@@ -4,13 +4,120 @@
 #include "PsdPch.h"
 #include "PsdDecompressRle.h"
 
+#include "PsdCompressRleKernels.h"
+#include "PsdExtractionError.h"
+#include "PsdSimd.h"
 #include "PsdAssert.h"
 #include "PsdLog.h"
+#include "PsdThreadPool.h"
 #include <cstring>
 
 
 PSD_NAMESPACE_BEGIN
 
+namespace
+{
+	// each band of rows decompressed by a single task should hold at least this many bytes of decompressed data,
+	// otherwise the overhead of scheduling tasks outweighs the gains.
+	static const unsigned int MIN_BAND_SIZE = 64u * 1024u;
+
+	// upper limit on the number of bands a channel is split into. this is plenty to keep all threads busy.
+	static const unsigned int MAX_BAND_COUNT = 256u;
+
+
+	struct DecompressRowsData
+	{
+		const uint8_t* src;
+		const uint32_t* rowOffsets;
+		unsigned int rowCount;
+		uint8_t* dest;
+		unsigned int rowSize;
+		unsigned int rowsPerBand;
+		int* bandErrorCodes;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int DecompressBand(const DecompressRowsData& data, unsigned int firstRow, unsigned int lastRow)
+	{
+		int errorCode = 0;
+		for (unsigned int i = firstRow; i < lastRow; ++i)
+		{
+			const uint32_t rowStart = data.rowOffsets[i];
+			const uint32_t rowEnd = data.rowOffsets[i + 1u];
+
+			const int rowErrorCode = imageUtil::DecompressRle(data.src + rowStart, rowEnd - rowStart, data.dest + static_cast<size_t>(i)*data.rowSize, data.rowSize);
+			if (errorCode == 0)
+				errorCode = rowErrorCode;
+		}
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DecompressBandTask(void* userData, unsigned int index)
+	{
+		const DecompressRowsData* data = static_cast<const DecompressRowsData*>(userData);
+
+		const unsigned int firstRow = index * data->rowsPerBand;
+		const unsigned int lastRow = (firstRow + data->rowsPerBand < data->rowCount) ? (firstRow + data->rowsPerBand) : data->rowCount;
+		data->bandErrorCodes[index] = DecompressBand(*data, firstRow, lastRow);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::RleKernelTable* table)
+	{
+		// the scalar encoder is used for levels without a dedicated one, e.g. SSSE3 doesn't add anything over SSE2
+		table->compressRle = &imageUtil::CompressRleKernel<imageUtil::ScalarRunScanner>;
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterRleKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterRleKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterRleKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterRleKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::RleKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::RleKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+}
+
+
 namespace imageUtil
 {
 	// ---------------------------------------------------------------------------------------------------------------------
@@ -28,7 +135,7 @@ namespace imageUtil
 			if (bytesRead >= srcSize)
 			{
 				PSD_ERROR("DecompressRle", "Malformed RLE data encountered");
-				return 1;
+				return extractionError::MALFORMED_RLE;
 			}
 
 			const uint8_t byte = *src++;
@@ -46,8 +153,10 @@ namespace imageUtil
 				const unsigned int safeCount = (offset + count <= size) ? count : (size - offset);
 
 				if (safeCount < count)
-					errorCode = 2;
+				{
+					errorCode = extractionError::RLE_EXCEEDS_BUFFER;
 					PSD_ERROR("DecompressRle", "Run-length run exceeds destination buffer, clamping.");
+				}
 
 				memset(dest + offset, *src++, safeCount);
 				offset += count;
@@ -62,8 +171,10 @@ namespace imageUtil
 				const unsigned int safeCount = (offset + count <= size) ? count : (size - offset);
 
 				if (safeCount < count)
-					errorCode = 2;
+				{
+					errorCode = extractionError::RLE_EXCEEDS_BUFFER;
 					PSD_ERROR("DecompressRle", "Literal run exceeds destination buffer, clamping.");
+				}
 
 				memcpy(dest + offset, src, safeCount);
 
@@ -79,104 +190,62 @@ namespace imageUtil
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	unsigned int CompressRle(const uint8_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int size)
+	int DecompressRleRows(const uint8_t* PSD_RESTRICT src, const uint32_t* rowOffsets, unsigned int rowCount, uint8_t* PSD_RESTRICT dest, unsigned int rowSize, ThreadPool* threadPool)
 	{
 		PSD_ASSERT_NOT_NULL(src);
+		PSD_ASSERT_NOT_NULL(rowOffsets);
 		PSD_ASSERT_NOT_NULL(dest);
 
-		unsigned int runLength = 0u;
-		unsigned int nonRunLength = 0u;
+		if (rowCount == 0u)
+			return 0;
 
-		unsigned int rleDataSize = 0u;
-		for (unsigned int i = 1u; i < size; ++i)
+		DecompressRowsData data = { src, rowOffsets, rowCount, dest, rowSize, rowCount, nullptr };
+		if (rowSize != 0u)
 		{
-			const uint8_t previous = src[i - 1];
-			const uint8_t current = src[i];
-			if (previous == current)
-			{
-				if (nonRunLength != 0u)
-				{
-					// first repeat of a character
+			data.rowsPerBand = (rowSize < MIN_BAND_SIZE) ? (MIN_BAND_SIZE / rowSize) : 1u;
+		}
 
-					// write non-run bytes so far
-					*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
-					memcpy(dest, src + i - nonRunLength - 1u, nonRunLength);
-					dest += nonRunLength;
-					rleDataSize += 1u + nonRunLength;
+		unsigned int bandCount = (rowCount + data.rowsPerBand - 1u) / data.rowsPerBand;
+		if (!threadPool || (bandCount <= 1u))
+		{
+			return DecompressBand(data, 0u, rowCount);
+		}
 
-					nonRunLength = 0u;
-				}
+		// very tall channels are split into fewer, larger bands
+		if (bandCount > MAX_BAND_COUNT)
+		{
+			data.rowsPerBand = (rowCount + MAX_BAND_COUNT - 1u) / MAX_BAND_COUNT;
+			bandCount = (rowCount + data.rowsPerBand - 1u) / data.rowsPerBand;
+		}
 
-				// belongs to the same run
-				++runLength;
+		// every band stores its own error code. the first one in row order is returned, just like in the serial case.
+		int bandErrorCodes[MAX_BAND_COUNT];
+		data.bandErrorCodes = bandErrorCodes;
 
-				// maximum length of a run is 128
-				if (runLength == 128u)
-				{
-					// need to manually stop this run and write to output
-					*dest++ = static_cast<uint8_t>(257u - runLength);
-					*dest++ = current;
-					rleDataSize += 2u;
+		threadPool->ParallelFor(bandCount, &DecompressBandTask, &data);
 
-					runLength = 0u;
-				}
-			}
-			else
+		int errorCode = 0;
+		for (unsigned int i=0; i < bandCount; ++i)
+		{
+			if (data.bandErrorCodes[i] != 0)
 			{
-				if (runLength != 0u)
-				{
-					// include first character and encode this run
-					++runLength;
-
-					*dest++ = static_cast<uint8_t>(257u - runLength);
-					*dest++ = previous;
-					rleDataSize += 2u;
-
-					runLength = 0u;
-				}
-				else
-				{
-					++nonRunLength;
-				}
-
-				// maximum length of a non-run is 128 bytes
-				if (nonRunLength == 128u)
-				{
-					*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
-					memcpy(dest, src + i - nonRunLength, nonRunLength);
-					dest += nonRunLength;
-					rleDataSize += 1u + nonRunLength;
-
-					nonRunLength = 0u;
-				}
+				errorCode = data.bandErrorCodes[i];
+				break;
 			}
 		}
 
-		if (runLength != 0u)
-		{
-			++runLength;
+		return errorCode;
+	}
 
-			*dest++ = static_cast<uint8_t>(257u - runLength);
-			*dest++ = src[size-1u];
-			rleDataSize += 2u;
-		}
-		else
-		{
-			++nonRunLength;
-			*dest++ = static_cast<uint8_t>(nonRunLength - 1u);
-			memcpy(dest, src + size - nonRunLength, nonRunLength);
-			dest += nonRunLength;
-			rleDataSize += 1u + nonRunLength;
-		}
 
-		// pad to an even number of bytes
-		if (rleDataSize & 1)
-		{
-			*dest++ = 0x80;
-			++rleDataSize;
-		}
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	unsigned int CompressRle(const uint8_t* PSD_RESTRICT src, uint8_t* PSD_RESTRICT dest, unsigned int size)
+	{
+		PSD_ASSERT_NOT_NULL(src);
+		PSD_ASSERT_NOT_NULL(dest);
 
-		return rleDataSize;
+		return GetKernelTable().compressRle(src, dest, size);
 	}
 }
 
@@ -6,13 +6,24 @@
 
 PSD_NAMESPACE_BEGIN
 
+class ThreadPool;
+
 namespace imageUtil
 {
 	/// \ingroup ImageUtil
 	/// Decompresses a block of RLE encoded data using the PackBits (http://en.wikipedia.org/wiki/PackBits) algorithm.
-	/// \return \b 0 if there was no error, otherwise error code is returned. Error codes are defined in \a PsdParseLayerMaskSection.cpp.
+	/// \return \b 0 if there was no error, otherwise error code is returned. Error codes are defined in \ref extractionError.
 	int DecompressRle(const uint8_t* PSD_RESTRICT src, unsigned int srcSize, uint8_t* PSD_RESTRICT dest, unsigned int size);
 
+	/// \ingroup ImageUtil
+	/// Decompresses \a rowCount rows of RLE encoded data, where each row of \a rowSize bytes has been compressed individually.
+	/// The compressed data of row \a i starts at \a src + \a rowOffsets[i] and ends at \a src + \a rowOffsets[i+1], hence \a rowOffsets
+	/// must hold \a rowCount + 1 entries. Because rows don't depend on each other, bands of rows are decompressed in parallel
+	/// if a \a threadPool is given.
+	/// \return \b 0 if there was no error, otherwise the error code of the first erroneous row is returned.
+	/// \sa DecompressRle
+	int DecompressRleRows(const uint8_t* PSD_RESTRICT src, const uint32_t* rowOffsets, unsigned int rowCount, uint8_t* PSD_RESTRICT dest, unsigned int rowSize, ThreadPool* threadPool);
+
 	/// \ingroup ImageUtil
 	/// Compresses a block of data to RLE encoded data using the PackBits (http://en.wikipedia.org/wiki/PackBits) algorithm.
 	/// \a dest must hold \a size * 2 bytes.
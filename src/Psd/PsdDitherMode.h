@@ -0,0 +1,21 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace ditherMode
+/// \brief A namespace holding the dithering modes that can be used when converting data to a lower bit depth.
+namespace ditherMode
+{
+	enum Enum
+	{
+		NONE = 0,								///< Values are rounded to the nearest 8-bit value.
+		ORDERED = 1								///< Values are dithered using an 8x8 Bayer matrix, which avoids banding in smooth gradients.
+	};
+}
+
+PSD_NAMESPACE_END
@@ -96,6 +96,12 @@
 /// OS-specific feature.
 
 
+/// \defgroup Renderer
+/// \brief Provides functions for compositing the layers of a document into a single image.
+/// \details The functions contained in this module render the layers parsed from a .PSD file, without relying on the merged image
+/// stored in the file. This is useful for documents that were saved without maximizing compatibility, or whose merged image is outdated.
+
+
 /// \defgroup Sections
 /// \brief Contains structures pertaining to sections found in a .PSD file.
 
@@ -9,13 +9,16 @@
 #include "PsdMemoryUtil.h"
 #include "PsdImageResourceType.h"
 #include "PsdExportDocument.h"
+#include "PsdExportLayerUpdate.h"
 #include "PsdDecompressRle.h"
+#include "PsdCompressZip.h"
 #include "PsdSyncFileWriter.h"
 #include "PsdSyncFileUtil.h"
 #include "PsdKey.h"
 #include "PsdChannelType.h"
 #include "PsdBitUtil.h"
 #include "PsdThumbnail.h"
+#include "PsdThreadPool.h"
 #include "Psdminiz.h"
 #include <string.h>
 #include <cstring>
@@ -386,6 +389,10 @@ ExportDocument* CreateExportDocument(Allocator* allocator, unsigned int canvasWi
 
 	document->thumbnail = nullptr;
 
+	document->zipLevel = compressionLevel::HUFFMAN_ONLY;
+	document->zipStrategy = compressionStrategy::LAZY;
+	document->compressionPolicy = compressionPolicy::BALANCED;
+
 	return document;
 }
 
@@ -537,6 +544,26 @@ void SetJpegThumbnail(ExportDocument* document, Allocator* allocator, uint32_t w
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void SetZipCompression(ExportDocument* document, compressionLevel::Enum level, compressionStrategy::Enum strategy)
+{
+	PSD_ASSERT(level != compressionLevel::DEFAULT, "The document's level cannot refer to itself.");
+	PSD_ASSERT(strategy != compressionStrategy::DEFAULT, "The document's strategy cannot refer to itself.");
+
+	document->zipLevel = level;
+	document->zipStrategy = strategy;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void SetCompressionPolicy(ExportDocument* document, compressionPolicy::Enum policy)
+{
+	document->compressionPolicy = policy;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 unsigned int AddLayer(ExportDocument* document, const char* name)
@@ -568,7 +595,7 @@ unsigned int AddLayer(ExportDocument* document, const char* name)
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-static void CreateDataRaw(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height)
+static void CreateDataRaw(Allocator* allocator, void** data, uint32_t* dataSize, const T* planarData, uint32_t width, uint32_t height)
 {
 	const uint32_t size = width*height;
 
@@ -578,55 +605,63 @@ static void CreateDataRaw(Allocator* allocator, ExportLayer* layer, unsigned int
 		bigEndianData[i] = endianUtil::NativeToBigEndian(planarData[i]);
 	}
 
-	layer->channelData[channelIndex] = bigEndianData;
-	layer->channelSize[channelIndex] = size*sizeof(T);
+	*data = bigEndianData;
+	*dataSize = size*sizeof(T);
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-static void CreateDataRLE(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height)
+static void CreateDataRLE(Allocator* allocator, void** data, uint32_t* dataSize, const T* planarData, uint32_t width, uint32_t height)
 {
 	const uint32_t size = width*height;
 
 	// each row needs two additional bytes for storing the size of the row's data.
-	// we pack the data row by row, and copy it into the final buffer.
+	// rows are packed one after another, directly into the final buffer. the packed data of a row never needs more than
+	// twice its size, so a row always fits into the space left by the rows before it.
 	uint8_t* rleData = memoryUtil::AllocateArray<uint8_t>(allocator, height*sizeof(uint16_t) + size*sizeof(T) * 2u);
 
-	uint8_t* rleRowData = memoryUtil::AllocateArray<uint8_t>(allocator, width*sizeof(T) * 2u);
-	T* bigEndianRowData = memoryUtil::AllocateArray<T>(allocator, width);
+	// 8-bit rows can be packed as they are, wider rows are converted to big-endian first
+	T* bigEndianRowData = (sizeof(T) > 1u) ? memoryUtil::AllocateArray<T>(allocator, width) : nullptr;
 	unsigned int offset = 0u;
 	for (unsigned int y = 0u; y < height; ++y)
 	{
-		for (unsigned int x = 0u; x < width; ++x)
+		const T* rowData = planarData + y*width;
+		if (bigEndianRowData)
 		{
-			bigEndianRowData[x] = endianUtil::NativeToBigEndian(planarData[y*width + x]);
+			for (unsigned int x = 0u; x < width; ++x)
+			{
+				bigEndianRowData[x] = endianUtil::NativeToBigEndian(rowData[x]);
+			}
+
+			rowData = bigEndianRowData;
 		}
 
-		const unsigned int compressedSize = imageUtil::CompressRle(reinterpret_cast<const uint8_t*>(bigEndianRowData), rleRowData, width*sizeof(T));
+		const unsigned int compressedSize = imageUtil::CompressRle(reinterpret_cast<const uint8_t*>(rowData), rleData + height*sizeof(uint16_t) + offset, width*sizeof(T));
 		PSD_ASSERT(compressedSize <= width*sizeof(T) * 2u, "RLE compressed data doesn't fit into provided buffer.");
 
+		// store 2 bytes row size
 		const uint16_t rleRowSize = endianUtil::NativeToBigEndian(static_cast<uint16_t>(compressedSize));
-
-		// copy 2 bytes row size, and copy RLE data
 		memcpy(rleData + y * sizeof(uint16_t), &rleRowSize, sizeof(uint16_t));
-		memcpy(rleData + height*sizeof(uint16_t) + offset, rleRowData, compressedSize);
 
 		offset += compressedSize;
 	}
-	memoryUtil::FreeArray(allocator, bigEndianRowData);
-	memoryUtil::FreeArray(allocator, rleRowData);
 
-	layer->channelData[channelIndex] = rleData;
-	layer->channelSize[channelIndex] = offset + height * sizeof(uint16_t);
+	if (bigEndianRowData)
+	{
+		memoryUtil::FreeArray(allocator, bigEndianRowData);
+	}
+
+	*data = rleData;
+	*dataSize = offset + height * sizeof(uint16_t);
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-static void CreateDataZipPrediction(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height)
+static void CreateDataZipPrediction(Allocator* allocator, ThreadPool* threadPool, void** data, uint32_t* dataSize, const T* planarData, uint32_t width, uint32_t height, compressionLevel::Enum level, compressionStrategy::Enum strategy)
 {
 	const uint32_t size = width*height;
 
@@ -653,10 +688,10 @@ static void CreateDataZipPrediction(Allocator* allocator, ExportLayer* layer, un
 	}
 
 	size_t zipDataSize = 0u;
-	void* zipData = tdefl_compress_mem_to_heap(allocation, size*sizeof(T), &zipDataSize, TDEFL_WRITE_ZLIB_HEADER);
+	void* zipData = imageUtil::CompressZip(allocation, size*sizeof(T), &zipDataSize, level, strategy, allocator, threadPool);
 
-	layer->channelData[channelIndex] = zipData;
-	layer->channelSize[channelIndex] = static_cast<uint32_t>(zipDataSize);
+	*data = zipData;
+	*dataSize = static_cast<uint32_t>(zipDataSize);
 
 	memoryUtil::FreeArray(allocator, allocation);
 }
@@ -665,7 +700,7 @@ static void CreateDataZipPrediction(Allocator* allocator, ExportLayer* layer, un
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <>
-void CreateDataZipPrediction<float32_t>(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const float32_t* planarData, uint32_t width, uint32_t height)
+void CreateDataZipPrediction<float32_t>(Allocator* allocator, ThreadPool* threadPool, void** data, uint32_t* dataSize, const float32_t* planarData, uint32_t width, uint32_t height, compressionLevel::Enum level, compressionStrategy::Enum strategy)
 {
 	const uint32_t size = width*height;
 
@@ -702,10 +737,10 @@ void CreateDataZipPrediction<float32_t>(Allocator* allocator, ExportLayer* layer
 	}
 
 	size_t zipDataSize = 0u;
-	void* zipData = tdefl_compress_mem_to_heap(deltaData, size*sizeof(float32_t), &zipDataSize, TDEFL_WRITE_ZLIB_HEADER);
+	void* zipData = imageUtil::CompressZip(deltaData, size*sizeof(float32_t), &zipDataSize, level, strategy, allocator, threadPool);
 
-	layer->channelData[channelIndex] = zipData;
-	layer->channelSize[channelIndex] = static_cast<uint32_t>(zipDataSize);
+	*data = zipData;
+	*dataSize = static_cast<uint32_t>(zipDataSize);
 
 	memoryUtil::FreeArray(allocator, deltaData);
 	memoryUtil::FreeArray(allocator, bigEndianPlanarData);
@@ -715,7 +750,7 @@ void CreateDataZipPrediction<float32_t>(Allocator* allocator, ExportLayer* layer
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-static void CreateDataZip(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height)
+static void CreateDataZip(Allocator* allocator, ThreadPool* threadPool, void** data, uint32_t* dataSize, const T* planarData, uint32_t width, uint32_t height, compressionLevel::Enum level, compressionStrategy::Enum strategy)
 {
 	const uint32_t size = width*height;
 
@@ -726,10 +761,10 @@ static void CreateDataZip(Allocator* allocator, ExportLayer* layer, unsigned int
 	}
 
 	size_t zipDataSize = 0u;
-	void* zipData = tdefl_compress_mem_to_heap(bigEndianData, size*sizeof(T), &zipDataSize, TDEFL_WRITE_ZLIB_HEADER);
+	void* zipData = imageUtil::CompressZip(bigEndianData, size*sizeof(T), &zipDataSize, level, strategy, allocator, threadPool);
 
-	layer->channelData[channelIndex] = zipData;
-	layer->channelSize[channelIndex] = static_cast<uint32_t>(zipDataSize);
+	*data = zipData;
+	*dataSize = static_cast<uint32_t>(zipDataSize);
 
 	memoryUtil::FreeArray(allocator, bigEndianData);
 }
@@ -738,19 +773,214 @@ static void CreateDataZip(Allocator* allocator, ExportLayer* layer, unsigned int
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <>
-void CreateDataZip<float32_t>(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const float32_t* planarData, uint32_t width, uint32_t height)
+void CreateDataZip<float32_t>(Allocator* allocator, ThreadPool* threadPool, void** data, uint32_t* dataSize, const float32_t* planarData, uint32_t width, uint32_t height, compressionLevel::Enum level, compressionStrategy::Enum strategy)
 {
 	// yes, this specialization is *not *a bug.
 	// in 32 bit per channel mode, Photoshop treats ZIP and ZIP_WITH_PREDICTION as being the same compression mode.
 	// it insists on delta-encoding the data before zipping, presumably to get better compression.
-	return CreateDataZipPrediction(allocator, layer, channelIndex, planarData, width, height);
+	return CreateDataZipPrediction(allocator, threadPool, data, dataSize, planarData, width, height, level, strategy);
+}
+
+
+namespace
+{
+	// rough single-threaded cost of compressing one byte in nanoseconds. this only needs to be accurate enough for telling
+	// the compression types apart, and for ordering them from fastest to slowest.
+	static const float32_t RAW_COST_PER_BYTE = 0.5f;
+	static const float32_t RLE_COST_PER_BYTE = 1.5f;
+	static const float32_t PREDICTION_COST_PER_BYTE = 1.0f;
+
+	// indexed by compression level and strategy
+	static const float32_t ZIP_COST_PER_BYTE[4][3] =
+	{
+		{ 10.0f, 10.0f, 13.0f },
+		{ 28.0f, 12.0f, 13.0f },
+		{ 55.0f, 40.0f, 13.0f },
+		{ 60.0f, 42.0f, 13.0f }
+	};
+
+	// the rows used for estimating sizes are taken from a few bands spread across the channel, and should amount to
+	// roughly this many bytes.
+	static const unsigned int SAMPLE_BAND_COUNT = 8u;
+	static const size_t SAMPLE_SIZE = 256u * 1024u;
+
+	// savings needed by the balanced policy for choosing a slower compression, relative to the raw data size
+	static const float32_t BALANCED_MIN_SAVINGS = 0.05f;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static compressionType::Enum ChooseCompression(const ExportCompressionReport& report, uint64_t rawSize, bool hasZip, compressionPolicy::Enum policy)
+	{
+		// order the candidates from fastest to slowest
+		unsigned int candidates[ExportCompressionReport::CANDIDATE_COUNT] = {};
+		unsigned int candidateCount = 0u;
+		for (unsigned int i=0; i < ExportCompressionReport::CANDIDATE_COUNT; ++i)
+		{
+			if (hasZip || (i != compressionType::ZIP))
+				candidates[candidateCount++] = i;
+		}
+		std::stable_sort(candidates, candidates + candidateCount, [&report](unsigned int lhs, unsigned int rhs)
+		{
+			return report.estimatedTime[lhs] < report.estimatedTime[rhs];
+		});
+
+		unsigned int chosen = candidates[0];
+		uint64_t smallestFasterSize = report.estimatedSize[chosen];
+		for (unsigned int i=1; i < candidateCount; ++i)
+		{
+			const unsigned int candidate = candidates[i];
+			const uint64_t size = report.estimatedSize[candidate];
+			if (policy == compressionPolicy::SMALLEST)
+			{
+				if (size < report.estimatedSize[chosen])
+					chosen = candidate;
+			}
+			else if (policy == compressionPolicy::FASTEST)
+			{
+				if ((candidate == compressionType::RLE) && (size < report.estimatedSize[compressionType::RAW]))
+					chosen = candidate;
+			}
+			else if (policy == compressionPolicy::BALANCED)
+			{
+				const uint64_t minSavings = static_cast<uint64_t>(static_cast<float64_t>(rawSize) * BALANCED_MIN_SAVINGS);
+				if (size + minSavings <= smallestFasterSize)
+					chosen = candidate;
+			}
+
+			if (size < smallestFasterSize)
+				smallestFasterSize = size;
+		}
+
+		return static_cast<compressionType::Enum>(chosen);
+	}
 }
 
 
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 template <typename T>
-void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const T* planarData, compressionType::Enum compression)
+static compressionType::Enum SelectCompression(Allocator* allocator, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy, compressionPolicy::Enum policy)
+{
+	ExportCompressionReport* report = &layer->compressionReport[channelIndex];
+	memset(report, 0, sizeof(ExportCompressionReport));
+	report->isAutomatic = true;
+	report->compression = compressionType::RAW;
+
+	const uint64_t rawSize = static_cast<uint64_t>(width)*height*sizeof(T);
+	if (rawSize == 0u)
+		return compressionType::RAW;
+
+	// RLE and prediction work row by row, so only whole rows are sampled
+	const size_t rowSize = width*sizeof(T);
+	uint32_t sampleRowCount = static_cast<uint32_t>(SAMPLE_SIZE / rowSize);
+	if (sampleRowCount < SAMPLE_BAND_COUNT)
+		sampleRowCount = SAMPLE_BAND_COUNT;
+	if (sampleRowCount > height)
+		sampleRowCount = height;
+
+	const T* sample = planarData;
+	T* sampleAllocation = nullptr;
+	if (sampleRowCount < height)
+	{
+		sampleAllocation = memoryUtil::AllocateArray<T>(allocator, sampleRowCount*width);
+		uint32_t row = 0u;
+		for (unsigned int band=0u; band < SAMPLE_BAND_COUNT; ++band)
+		{
+			// spread the bands evenly, centering each band in its part of the channel
+			const uint32_t bandRowCount = (sampleRowCount*(band + 1u)) / SAMPLE_BAND_COUNT - (sampleRowCount*band) / SAMPLE_BAND_COUNT;
+			const uint32_t partStart = static_cast<uint32_t>((static_cast<uint64_t>(height)*band) / SAMPLE_BAND_COUNT);
+			const uint32_t partEnd = static_cast<uint32_t>((static_cast<uint64_t>(height)*(band + 1u)) / SAMPLE_BAND_COUNT);
+			uint32_t firstRow = (partEnd - partStart > bandRowCount) ? partStart + (partEnd - partStart - bandRowCount) / 2u : partStart;
+			if (firstRow + bandRowCount > height)
+				firstRow = height - bandRowCount;
+
+			memcpy(sampleAllocation + row*width, planarData + static_cast<size_t>(firstRow)*width, bandRowCount*rowSize);
+			row += bandRowCount;
+		}
+		sample = sampleAllocation;
+	}
+
+	// compress the sample with the very same functions used for the whole channel, each candidate into a buffer of its own
+	void* rleData = nullptr;
+	uint32_t rleSize = 0u;
+	void* zipData = nullptr;
+	uint32_t zipSize = 0u;
+	void* zipPredictionData = nullptr;
+	uint32_t zipPredictionSize = 0u;
+
+	// 32-bit data is always delta-encoded, so ZIP would only duplicate ZIP_WITH_PREDICTION
+	const bool hasZip = (sizeof(T) != sizeof(float32_t));
+	CreateDataRLE(allocator, &rleData, &rleSize, sample, width, sampleRowCount);
+	CreateDataZipPrediction(allocator, nullptr, &zipPredictionData, &zipPredictionSize, sample, width, sampleRowCount, zipLevel, zipStrategy);
+	if (hasZip)
+	{
+		CreateDataZip(allocator, nullptr, &zipData, &zipSize, sample, width, sampleRowCount, zipLevel, zipStrategy);
+	}
+	else
+	{
+		zipSize = zipPredictionSize;
+	}
+
+	memoryUtil::FreeArray(allocator, sampleAllocation);
+
+	const float64_t scale = static_cast<float64_t>(height) / sampleRowCount;
+	const float32_t zipCostPerByte = ZIP_COST_PER_BYTE[zipLevel][zipStrategy];
+	const float32_t costPerByte[ExportCompressionReport::CANDIDATE_COUNT] =
+	{
+		RAW_COST_PER_BYTE,
+		RAW_COST_PER_BYTE + RLE_COST_PER_BYTE,
+		RAW_COST_PER_BYTE + zipCostPerByte,
+		RAW_COST_PER_BYTE + PREDICTION_COST_PER_BYTE + zipCostPerByte
+	};
+
+	report->sampledRowCount = sampleRowCount;
+	report->estimatedSize[compressionType::RAW] = rawSize;
+	report->estimatedSize[compressionType::RLE] = static_cast<uint64_t>(rleSize * scale);
+	report->estimatedSize[compressionType::ZIP] = static_cast<uint64_t>(zipSize * scale);
+	report->estimatedSize[compressionType::ZIP_WITH_PREDICTION] = static_cast<uint64_t>(zipPredictionSize * scale);
+	for (unsigned int i=0u; i < ExportCompressionReport::CANDIDATE_COUNT; ++i)
+	{
+		report->estimatedTime[i] = static_cast<float32_t>(costPerByte[i] * static_cast<float64_t>(rawSize) * 1e-6);
+	}
+
+	report->compression = ChooseCompression(*report, rawSize, hasZip, policy);
+
+	// if the whole channel was sampled, the data of the chosen compression can be used as is
+	if (sample == planarData)
+	{
+		if (report->compression == compressionType::RLE)
+		{
+			layer->channelData[channelIndex] = rleData;
+			layer->channelSize[channelIndex] = rleSize;
+			rleData = nullptr;
+		}
+		else if (report->compression == compressionType::ZIP)
+		{
+			layer->channelData[channelIndex] = zipData;
+			layer->channelSize[channelIndex] = zipSize;
+			zipData = nullptr;
+		}
+		else if (report->compression == compressionType::ZIP_WITH_PREDICTION)
+		{
+			layer->channelData[channelIndex] = zipPredictionData;
+			layer->channelSize[channelIndex] = zipPredictionSize;
+			zipPredictionData = nullptr;
+		}
+	}
+
+	// RLE data comes from the allocator, ZIP data from miniz
+	memoryUtil::FreeArray(allocator, rleData);
+	free(zipData);
+	free(zipPredictionData);
+
+	return report->compression;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static unsigned int PrepareLayerChannel(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, compressionType::Enum compression)
 {
 	if (document->colorMode == exportColorMode::GRAYSCALE)
 	{
@@ -780,6 +1010,9 @@ void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned in
 			{
 				memoryUtil::FreeArray(allocator, data);
 			}
+
+			layer->channelData[channelIndex] = nullptr;
+			layer->channelSize[channelIndex] = 0u;
 		}
 	}
 
@@ -789,35 +1022,127 @@ void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned in
 	layer->bottom = bottom;
 	layer->right = right;
 	layer->channelCompression[channelIndex] = static_cast<uint16_t>(compression);
+	memset(&layer->compressionReport[channelIndex], 0, sizeof(ExportCompressionReport));
 
 	PSD_ASSERT(right >= left, "Invalid layer bounds.");
 	PSD_ASSERT(bottom >= top, "Invalid layer bounds.");
-	const uint32_t width = static_cast<uint32_t>(right - left);
-	const uint32_t height = static_cast<uint32_t>(bottom - top);
+
+	return channelIndex;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+static void CreateData(Allocator* allocator, ThreadPool* threadPool, ExportLayer* layer, unsigned int channelIndex, const T* planarData, uint32_t width, uint32_t height, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy, compressionPolicy::Enum policy)
+{
+	if (compression == compressionType::AUTO)
+	{
+		// store the chosen compression so that the data is read back correctly
+		compression = SelectCompression(allocator, layer, channelIndex, planarData, width, height, zipLevel, zipStrategy, policy);
+		layer->channelCompression[channelIndex] = static_cast<uint16_t>(compression);
+
+		// small channels are compressed as a whole while estimating
+		if (layer->channelData[channelIndex])
+			return;
+	}
 
 	if (compression == compressionType::RAW)
 	{
 		// raw data, copy directly and convert to big endian
-		CreateDataRaw(allocator, layer, channelIndex, planarData, width, height);
+		CreateDataRaw(allocator, &layer->channelData[channelIndex], &layer->channelSize[channelIndex], planarData, width, height);
 	}
 	else if (compression == compressionType::RLE)
 	{
 		// compress with RLE
-		CreateDataRLE(allocator, layer, channelIndex, planarData, width, height);
+		CreateDataRLE(allocator, &layer->channelData[channelIndex], &layer->channelSize[channelIndex], planarData, width, height);
 	}
 	else if (compression == compressionType::ZIP)
 	{
 		// compress with ZIP
 		// note that this has a template specialization for 32-bit float data that forwards to ZipWithPrediction.
-		CreateDataZip(allocator, layer, channelIndex, planarData, width, height);
+		CreateDataZip(allocator, threadPool, &layer->channelData[channelIndex], &layer->channelSize[channelIndex], planarData, width, height, zipLevel, zipStrategy);
 	}
 	else if (compression == compressionType::ZIP_WITH_PREDICTION)
 	{
 		// delta-encode, then compress with ZIP
-		CreateDataZipPrediction(allocator, layer, channelIndex, planarData, width, height);
+		CreateDataZipPrediction(allocator, threadPool, &layer->channelData[channelIndex], &layer->channelSize[channelIndex], planarData, width, height, zipLevel, zipStrategy);
 	}
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static compressionLevel::Enum GetZipLevel(const ExportDocument* document, compressionLevel::Enum level)
+{
+	return (level == compressionLevel::DEFAULT) ? document->zipLevel : level;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static compressionStrategy::Enum GetZipStrategy(const ExportDocument* document, compressionStrategy::Enum strategy)
+{
+	return (strategy == compressionStrategy::DEFAULT) ? document->zipStrategy : strategy;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+template <typename T>
+void UpdateLayerImpl(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const T* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy)
+{
+	const unsigned int channelIndex = PrepareLayerChannel(document, allocator, layerIndex, channel, left, top, right, bottom, compression);
+
+	const uint32_t width = static_cast<uint32_t>(right - left);
+	const uint32_t height = static_cast<uint32_t>(bottom - top);
+	CreateData(allocator, nullptr, document->layers[layerIndex].get(), channelIndex, planarData, width, height, compression, GetZipLevel(document, zipLevel), GetZipStrategy(document, zipStrategy), document->compressionPolicy);
+}
+
+
+namespace
+{
+	struct CompressionJob
+	{
+		ExportLayer* layer;
+		unsigned int channelIndex;
+		const void* planarData;
+		uint32_t width;
+		uint32_t height;
+		compressionType::Enum compression;
+		compressionLevel::Enum zipLevel;
+		compressionStrategy::Enum zipStrategy;
+	};
+
+
+	struct CompressionJobsData
+	{
+		Allocator* allocator;
+		ThreadPool* threadPool;
+		compressionPolicy::Enum policy;
+		unsigned int bitsPerChannel;
+		CompressionJob* jobs;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void CompressChannelTask(void* userData, unsigned int index)
+	{
+		CompressionJobsData* data = static_cast<CompressionJobsData*>(userData);
+		const CompressionJob& job = data->jobs[index];
+
+		// each job writes the data of a different channel only, so jobs never touch the same memory
+		if (data->bitsPerChannel == 8u)
+			CreateData(data->allocator, data->threadPool, job.layer, job.channelIndex, static_cast<const uint8_t*>(job.planarData), job.width, job.height, job.compression, job.zipLevel, job.zipStrategy, data->policy);
+		else if (data->bitsPerChannel == 16u)
+			CreateData(data->allocator, data->threadPool, job.layer, job.channelIndex, static_cast<const uint16_t*>(job.planarData), job.width, job.height, job.compression, job.zipLevel, job.zipStrategy, data->policy);
+		else if (data->bitsPerChannel == 32u)
+			CreateData(data->allocator, data->threadPool, job.layer, job.channelIndex, static_cast<const float32_t*>(job.planarData), job.width, job.height, job.compression, job.zipLevel, job.zipStrategy, data->policy);
+	}
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void UpdateLayerUtfName(ExportDocument* document, unsigned int layerIndex, uint16_t* utf16Name, uint32_t length)
@@ -914,7 +1239,7 @@ void UpdateLayerVisibility(ExportDocument* document, unsigned int layerIndex, bo
 // ---------------------------------------------------------------------------------------------------------------------
 void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint8_t* planarData, compressionType::Enum compression)
 {
-	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression);
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, compressionLevel::DEFAULT, compressionStrategy::DEFAULT);
 }
 
 
@@ -922,7 +1247,7 @@ void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int la
 // ---------------------------------------------------------------------------------------------------------------------
 void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint16_t* planarData, compressionType::Enum compression)
 {
-	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression);
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, compressionLevel::DEFAULT, compressionStrategy::DEFAULT);
 }
 
 
@@ -930,7 +1255,104 @@ void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int la
 // ---------------------------------------------------------------------------------------------------------------------
 void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const float32_t* planarData, compressionType::Enum compression)
 {
-	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression);
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, compressionLevel::DEFAULT, compressionStrategy::DEFAULT);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint8_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy)
+{
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, zipLevel, zipStrategy);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint16_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy)
+{
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, zipLevel, zipStrategy);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const float32_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy)
+{
+	UpdateLayerImpl(document, allocator, layerIndex, channel, left, top, right, bottom, planarData, compression, zipLevel, zipStrategy);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void UpdateLayers(ExportDocument* document, Allocator* allocator, const ExportLayerUpdate* updates, unsigned int updateCount, ThreadPool* threadPool)
+{
+	PSD_ASSERT_NOT_NULL(document);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	// all bookkeeping is done up front on the calling thread, in order. if a channel is updated more than once, only the
+	// last update needs to be compressed, exactly like when calling UpdateLayer() for each update.
+	CompressionJob* jobs = memoryUtil::AllocateArray<CompressionJob>(allocator, updateCount);
+	unsigned int jobCount = 0u;
+	for (unsigned int i=0; i < updateCount; ++i)
+	{
+		const ExportLayerUpdate& update = updates[i];
+		ExportLayer* layer = document->layers[update.layerIndex].get();
+		const unsigned int channelIndex = PrepareLayerChannel(document, allocator, update.layerIndex, update.channel, update.left, update.top, update.right, update.bottom, update.compression);
+
+		CompressionJob* job = nullptr;
+		for (unsigned int j=0; j < jobCount; ++j)
+		{
+			if ((jobs[j].layer == layer) && (jobs[j].channelIndex == channelIndex))
+			{
+				job = &jobs[j];
+				break;
+			}
+		}
+
+		if (!job)
+		{
+			job = &jobs[jobCount++];
+		}
+
+		job->layer = layer;
+		job->channelIndex = channelIndex;
+		job->planarData = update.planarData;
+		job->width = static_cast<uint32_t>(update.right - update.left);
+		job->height = static_cast<uint32_t>(update.bottom - update.top);
+		job->compression = update.compression;
+		job->zipLevel = GetZipLevel(document, update.zipLevel);
+		job->zipStrategy = GetZipStrategy(document, update.zipStrategy);
+	}
+
+	// start with the largest channels so that the threads don't end up waiting for a big channel at the very end
+	std::stable_sort(jobs, jobs + jobCount, [](const CompressionJob& lhs, const CompressionJob& rhs)
+	{
+		return static_cast<uint64_t>(lhs.width) * lhs.height > static_cast<uint64_t>(rhs.width) * rhs.height;
+	});
+
+	CompressionJobsData data = { allocator, threadPool, document->compressionPolicy, document->bitsPerChannel, jobs };
+	if (threadPool)
+	{
+		threadPool->ParallelFor(jobCount, &CompressChannelTask, &data);
+	}
+	else
+	{
+		for (unsigned int i=0; i < jobCount; ++i)
+		{
+			CompressChannelTask(&data, i);
+		}
+	}
+
+	memoryUtil::FreeArray(allocator, jobs);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const ExportCompressionReport& GetCompressionReport(const ExportDocument* document, unsigned int layerIndex, exportChannel::Enum channel)
+{
+	return document->layers[layerIndex]->compressionReport[GetChannelIndex(channel)];
 }
 
 
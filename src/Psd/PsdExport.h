@@ -9,6 +9,10 @@
 #include "PsdExportColorMode.h"
 #include "PsdExportChannel.h"
 #include "PsdCompressionType.h"
+#include "PsdCompressionLevel.h"
+#include "PsdCompressionStrategy.h"
+#include "PsdCompressionPolicy.h"
+#include "PsdExportCompressionReport.h"
 #include "PsdAlphaChannel.h"
 #include "PsdBlendMode.h"
 
@@ -16,8 +20,10 @@
 PSD_NAMESPACE_BEGIN
 
 struct ExportDocument;
+struct ExportLayerUpdate;
 class File;
 class Allocator;
+class ThreadPool;
 
 
 /// \ingroup Exporter
@@ -56,6 +62,18 @@ void SetEXIFData(ExportDocument* document, Allocator* allocator, void* rawExifDa
 /// Sets the JPEG thumbnail of a document. The contents of \a rawJpegData are copied.
 void SetJpegThumbnail(ExportDocument* document, Allocator* allocator, uint32_t width, uint32_t height, void* rawJpegData, uint32_t size);
 
+/// \ingroup Exporter
+/// Sets the level and strategy used for ZIP-compressed layer channels that don't specify their own, see \ref UpdateLayer.
+/// Channels are compressed when they are updated, so this only affects subsequent updates.
+/// By default, documents use \a compressionLevel::HUFFMAN_ONLY and \a compressionStrategy::LAZY, which is fast but yields the largest data.
+/// \a compressionLevel::DEFAULT and \a compressionStrategy::DEFAULT are only valid when updating layers.
+void SetZipCompression(ExportDocument* document, compressionLevel::Enum level, compressionStrategy::Enum strategy);
+
+/// \ingroup Exporter
+/// Sets the policy used for choosing the compression of layer channels updated with \a compressionType::AUTO.
+/// Channels are compressed when they are updated, so this only affects subsequent updates. By default, documents use \a compressionPolicy::BALANCED.
+void SetCompressionPolicy(ExportDocument* document, compressionPolicy::Enum policy);
+
 /// \ingroup Exporter
 /// Adds a layer to a document. The returned index can be used to update layer data by a call to \ref UpdateLayer.
 unsigned int AddLayer(ExportDocument* document, const char* name);
@@ -105,6 +123,8 @@ void UpdateLayerVisibility(ExportDocument* document, unsigned int layerIndex, bo
 /// Updates a layer with planar 8-bit data. The function internally takes ownership over all data, so planar image data passed to this function can be freed afterwards.
 /// Planar data must hold "width*height" bytes, where width = \a right - \a left and height = \a botttom - \a top.
 /// Note that individual layers can be smaller and/or larger than the canvas in PSD documents.
+/// With \a compressionType::AUTO, the compression is chosen by compressing a few sampled rows with every compression type, and
+/// applying the document's \ref compressionPolicy to the results. The decision can be inspected using \ref GetCompressionReport.
 void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint8_t* planarData, compressionType::Enum compression);
 
 /// \ingroup Exporter
@@ -119,6 +139,37 @@ void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int la
 /// Note that individual layers can be smaller and/or larger than the canvas in PSD documents.
 void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const float32_t* planarData, compressionType::Enum compression);
 
+/// \ingroup Exporter
+/// Updates a layer with planar 8-bit data, ZIP-compressing it using the given \a zipLevel and \a zipStrategy instead of the document's settings.
+/// Passing \a compressionLevel::DEFAULT or \a compressionStrategy::DEFAULT uses the document's setting for that value.
+/// \sa UpdateLayer SetZipCompression
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint8_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy);
+
+/// \ingroup Exporter
+/// Updates a layer with planar 16-bit data, ZIP-compressing it using the given \a zipLevel and \a zipStrategy instead of the document's settings.
+/// Passing \a compressionLevel::DEFAULT or \a compressionStrategy::DEFAULT uses the document's setting for that value.
+/// \sa UpdateLayer SetZipCompression
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const uint16_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy);
+
+/// \ingroup Exporter
+/// Updates a layer with planar 32-bit data, ZIP-compressing it using the given \a zipLevel and \a zipStrategy instead of the document's settings.
+/// Passing \a compressionLevel::DEFAULT or \a compressionStrategy::DEFAULT uses the document's setting for that value.
+/// \sa UpdateLayer SetZipCompression
+void UpdateLayer(ExportDocument* document, Allocator* allocator, unsigned int layerIndex, exportChannel::Enum channel, int left, int top, int right, int bottom, const float32_t* planarData, compressionType::Enum compression, compressionLevel::Enum zipLevel, compressionStrategy::Enum zipStrategy);
+
+/// \ingroup Exporter
+/// Updates several layer channels at once, compressing the data of different channels in parallel using the given \a threadPool.
+/// This yields the same result as calling \ref UpdateLayer for each of the \a updates in order, and returns once all channels have been
+/// compressed, so the document can be written right away. If \a threadPool is a nullptr, all channels are compressed on the calling thread.
+/// Large ZIP-compressed channels are additionally split into chunks that are deflated in parallel, see \ref imageUtil::CompressZip.
+/// \remark The \a allocator is used from several threads at the same time, and therefore needs to be thread-safe.
+void UpdateLayers(ExportDocument* document, Allocator* allocator, const ExportLayerUpdate* updates, unsigned int updateCount, ThreadPool* threadPool);
+
+
+/// \ingroup Exporter
+/// Returns how the compression of the given layer channel was chosen. The report is only filled for channels updated with \a compressionType::AUTO.
+const ExportCompressionReport& GetCompressionReport(const ExportDocument* document, unsigned int layerIndex, exportChannel::Enum channel);
+
 
 /// \ingroup Exporter
 /// Adds an alpha channel to a document. The returned index can be used to update channel data by a call to \ref UpdateChannel.
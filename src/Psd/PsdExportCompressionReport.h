@@ -0,0 +1,29 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdCompressionType.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class ExportCompressionReport
+/// \brief A struct describing how the compression of an exported layer channel was chosen, as returned by \ref GetCompressionReport.
+/// \details The estimates are indexed by compression type, i.e. from \a compressionType::RAW to \a compressionType::ZIP_WITH_PREDICTION.
+/// Sizes are extrapolated from the sampled rows, and times are derived from a fixed cost per byte of each compression type, so
+/// they are meant for comparing the candidates rather than predicting absolute numbers.
+/// For 32-bit data, ZIP always uses prediction, so only \a compressionType::ZIP_WITH_PREDICTION is ever chosen.
+struct ExportCompressionReport
+{
+	static const unsigned int CANDIDATE_COUNT = 4u;
+
+	bool isAutomatic;								///< Whether the channel was exported using \a compressionType::AUTO. All other members are only set if this is true.
+	compressionType::Enum compression;				///< The compression that was chosen.
+	uint32_t sampledRowCount;						///< The number of rows compressed for estimating sizes.
+	uint64_t estimatedSize[CANDIDATE_COUNT];		///< The estimated size in bytes of the compressed channel.
+	float32_t estimatedTime[CANDIDATE_COUNT];		///< The estimated time in milliseconds for compressing the channel.
+};
+
+PSD_NAMESPACE_END
@@ -7,6 +7,9 @@
 #include <vector>
 
 #include "PsdExportColorMode.h"
+#include "PsdCompressionLevel.h"
+#include "PsdCompressionStrategy.h"
+#include "PsdCompressionPolicy.h"
 #include "PsdExportMetaDataAttribute.h"
 #include "PsdExportLayer.h"
 #include "PsdAlphaChannel.h"
@@ -56,6 +59,10 @@ struct ExportDocument
 	uint32_t sizeOfExifData;
 
 	Thumbnail* thumbnail;
+
+	compressionLevel::Enum zipLevel;
+	compressionStrategy::Enum zipStrategy;
+	compressionPolicy::Enum compressionPolicy;
 };
 
 PSD_NAMESPACE_END
@@ -4,6 +4,7 @@
 #pragma once
 #include "PsdLayer.h"
 #include "PsdLayerMask.h"
+#include "PsdExportCompressionReport.h"
 
 
 PSD_NAMESPACE_BEGIN
@@ -32,6 +33,7 @@ struct ExportLayer
 	void* channelData[MAX_CHANNEL_COUNT];
 	uint32_t channelSize[MAX_CHANNEL_COUNT];
 	uint16_t channelCompression[MAX_CHANNEL_COUNT];
+	ExportCompressionReport compressionReport[MAX_CHANNEL_COUNT];
 
     bool isTransparencyLocked;
     bool isCompositeLocked;
@@ -0,0 +1,35 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdExportChannel.h"
+#include "PsdCompressionType.h"
+#include "PsdCompressionLevel.h"
+#include "PsdCompressionStrategy.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class ExportLayerUpdate
+/// \brief A struct describing the new data of one layer channel, as passed to \ref UpdateLayers.
+/// \details The members correspond to the arguments of \ref UpdateLayer. \a planarData must hold "width*height" values of the
+/// document's bit depth, i.e. uint8_t, uint16_t or float32_t values for 8-bit, 16-bit or 32-bit documents.
+/// \a zipLevel and \a zipStrategy are only used by ZIP-compressed channels. Set them to \a compressionLevel::DEFAULT and \a compressionStrategy::DEFAULT
+/// to use the document's settings, see \ref SetZipCompression, unless a channel needs different ones.
+struct ExportLayerUpdate
+{
+	unsigned int layerIndex;
+	exportChannel::Enum channel;
+	int left;
+	int top;
+	int right;
+	int bottom;
+	const void* planarData;
+	compressionType::Enum compression;
+	compressionLevel::Enum zipLevel;
+	compressionStrategy::Enum zipStrategy;
+};
+
+PSD_NAMESPACE_END
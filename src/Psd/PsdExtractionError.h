@@ -0,0 +1,24 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace extractionError
+/// \brief A namespace holding the error codes returned when extracting or flattening layer data, e.g. by \ref ExtractLayer.
+namespace extractionError
+{
+	enum Enum
+	{
+		OK = 0,									///< No error.
+		MALFORMED_RLE = 1,						///< The RLE-compressed data ends before the channel is complete.
+		RLE_EXCEEDS_BUFFER = 2,					///< A run of RLE-compressed data exceeds the channel, and was clamped.
+		UNSUPPORTED_COMPRESSION_TYPE = 3,		///< The channel uses an unknown compression type, and holds no data.
+		CHANNEL_TOO_LARGE = 4					///< The channel's planar data would exceed 4 GB, and was not extracted.
+	};
+}
+
+PSD_NAMESPACE_END
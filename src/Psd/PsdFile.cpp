@@ -95,4 +95,21 @@ uint64_t File::GetSize(void) const
 	return DoGetSize();
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* File::Map(uint64_t position, uint64_t count)
+{
+	return DoMap(position, count);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* File::DoMap(uint64_t, uint64_t)
+{
+	// files are not mapped into memory by default
+	return nullptr;
+}
+
 PSD_NAMESPACE_END
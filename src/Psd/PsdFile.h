@@ -16,7 +16,7 @@ class Allocator;
 /// native (platform- and OS-provided) functions for e.g. asynchronous I/O.
 /// \remark Note that the interface only offers asynchronous read operations. The reason for this is that asynchronous reads
 /// allow for parallelizing file accesses to the same file, while still being able to add synchronous reads as a wrapper on top.
-/// \sa NativeFile SyncFileReader
+/// \sa NativeFile MappedFile SyncFileReader
 class File
 {
 public:
@@ -59,6 +59,11 @@ public:
 	/// If the function fails, 0 will be returned.
 	uint64_t GetSize(void) const;
 
+	/// Returns a pointer to \a count bytes starting at \a position if the file is mapped into memory, or a nullptr otherwise.
+	/// The returned memory is read-only and stays valid until the file is closed.
+	/// \remark Callers must be prepared to fall back to Read() for files that do not support mapping.
+	const void* Map(uint64_t position, uint64_t count);
+
 protected:
 	Allocator* m_allocator;
 
@@ -74,6 +79,8 @@ private:
 	virtual bool DoWaitForWrite(WriteOperation& operation) PSD_ABSTRACT;
 
 	virtual uint64_t DoGetSize(void) const PSD_ABSTRACT;
+
+	virtual const void* DoMap(uint64_t position, uint64_t count);
 };
 
 PSD_NAMESPACE_END
@@ -0,0 +1,1333 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdFlattenDocument.h"
+
+#include "PsdDocument.h"
+#include "PsdLayer.h"
+#include "PsdChannel.h"
+#include "PsdChannelType.h"
+#include "PsdLayerMask.h"
+#include "PsdVectorMask.h"
+#include "PsdLayerType.h"
+#include "PsdLayerMaskSection.h"
+#include "PsdLayerRegion.h"
+#include "PsdRenderCache.h"
+#include "PsdAdjustment.h"
+#include "PsdAdjustmentLut.h"
+#include "PsdColorMode.h"
+#include "PsdBlendMode.h"
+#include "PsdBlend.h"
+#include "PsdInterleave.h"
+#include "PsdParseLayerMaskSection.h"
+#include "PsdExtractionError.h"
+#include "PsdThreadPool.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include <cstring>
+#include <mutex>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// the canvas is rendered in square tiles of this size
+	static const unsigned int TILE_SIZE = 256u;
+
+
+	// a rectangle in canvas coordinates
+	struct Rect
+	{
+		int32_t top;
+		int32_t left;
+		int32_t bottom;
+		int32_t right;
+	};
+
+
+	// a plane holding the values of a channel inside a rectangle of the canvas. everything outside the rectangle, or
+	// the whole plane in case it doesn't hold any data, has the plane's default value.
+	template <typename T>
+	struct Plane
+	{
+		const T* data;
+		Rect bounds;
+		T defaultValue;
+	};
+
+
+	// all planes of a layer needed for rendering a tile
+	template <typename T>
+	struct LayerPlanes
+	{
+		Plane<T> color[4];
+		Plane<T> masks[2];
+		unsigned int maskCount;
+		bool hasTransparency;
+		LayerRegion* region;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	// 16-bit values are in the range [0, 32768] used by Photoshop, just like the data in the file
+	template <typename T>
+	static T ExpandColor(uint8_t color);
+
+	template <> uint8_t ExpandColor<uint8_t>(uint8_t color) { return color; }
+	template <> uint16_t ExpandColor<uint16_t>(uint8_t color) { return static_cast<uint16_t>((color*32768u + 127u) / 255u); }
+	template <> float32_t ExpandColor<float32_t>(uint8_t color) { return color / 255.0f; }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static Rect GetBounds(const T* data)
+	{
+		const Rect rect = { data->top, data->left, data->bottom, data->right };
+		return rect;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool Intersect(const Rect& a, const Rect& b, Rect& result)
+	{
+		result.top = (a.top > b.top) ? a.top : b.top;
+		result.left = (a.left > b.left) ? a.left : b.left;
+		result.bottom = (a.bottom < b.bottom) ? a.bottom : b.bottom;
+		result.right = (a.right < b.right) ? a.right : b.right;
+
+		return (result.bottom > result.top) && (result.right > result.left);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsLayerVisible(const Layer* layer)
+	{
+		// hiding a group hides everything inside it
+		for (const Layer* current = layer; current; current = current->parent)
+		{
+			if (!current->isVisible)
+				return false;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IntersectMasks(const Layer* layer, Rect& coverage)
+	{
+		// nothing outside the bounds of a mask hiding everything around it can be seen
+		if (layer->layerMask && (layer->layerMask->defaultColor == 0u))
+		{
+			if (!Intersect(coverage, GetBounds(layer->layerMask.get()), coverage))
+				return false;
+		}
+
+		if (layer->vectorMask && (layer->vectorMask->defaultColor == 0u))
+		{
+			if (!Intersect(coverage, GetBounds(layer->vectorMask), coverage))
+				return false;
+		}
+
+		return (coverage.bottom > coverage.top) && (coverage.right > coverage.left);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool GetCoverage(const Layer* layer, const Rect& canvas, Rect& coverage)
+	{
+		// a layer cannot contribute outside its own bounds, its own masks, and the masks of all groups it belongs to.
+		// adjustment layers don't have pixels of their own, and affect everything below them.
+		coverage = IsAdjustmentLayer(layer) ? canvas : GetBounds(layer);
+		for (const Layer* current = layer; current; current = current->parent)
+		{
+			if (!IntersectMasks(current, coverage))
+				return false;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void Union(Rect& rect, const Rect& other)
+	{
+		if ((rect.bottom <= rect.top) || (rect.right <= rect.left))
+		{
+			rect = other;
+			return;
+		}
+
+		rect.top = (rect.top < other.top) ? rect.top : other.top;
+		rect.left = (rect.left < other.left) ? rect.left : other.left;
+		rect.bottom = (rect.bottom > other.bottom) ? rect.bottom : other.bottom;
+		rect.right = (rect.right > other.right) ? rect.right : other.right;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsLayerExtracted(const Layer* layer)
+	{
+		for (unsigned int i=0; i < layer->channelCount; ++i)
+		{
+			const Channel& channel = layer->channels[i];
+			if ((channel.type >= channelType::R) && (channel.type <= channelType::B) && channel.data)
+				return true;
+		}
+
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int GetColorIndex(int16_t type)
+	{
+		// R, G and B are followed by the transparency mask
+		if ((type >= channelType::R) && (type <= channelType::B))
+			return type;
+		else if (type == channelType::TRANSPARENCY_MASK)
+			return 3;
+
+		return -1;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T, typename Mask>
+	static void SetMaskPlane(const Mask* mask, const void* data, const Rect& bounds, Plane<T>& plane)
+	{
+		plane.data = static_cast<const T*>(data);
+		plane.bounds = bounds;
+		plane.defaultValue = ExpandColor<T>(mask->defaultColor);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int AcquireLayerPlanes(const Document* document, File* file, Allocator* allocator, const Layer* layer, const Rect& rect, LayerPlanes<T>& planes)
+	{
+		const Rect layerBounds = GetBounds(layer);
+		for (unsigned int c=0; c < 4u; ++c)
+		{
+			planes.color[c].data = nullptr;
+			planes.color[c].bounds = layerBounds;
+			planes.color[c].defaultValue = T(0);
+		}
+		planes.hasTransparency = false;
+		planes.region = nullptr;
+
+		// the masks are stored in a fixed order, with the layer mask coming first
+		Plane<T>* layerMaskPlane = nullptr;
+		Plane<T>* vectorMaskPlane = nullptr;
+		planes.maskCount = 0u;
+		if (layer->layerMask)
+		{
+			layerMaskPlane = &planes.masks[planes.maskCount++];
+			SetMaskPlane(layer->layerMask.get(), nullptr, GetBounds(layer->layerMask.get()), *layerMaskPlane);
+		}
+		if (layer->vectorMask)
+		{
+			vectorMaskPlane = &planes.masks[planes.maskCount++];
+			SetMaskPlane(layer->vectorMask, nullptr, GetBounds(layer->vectorMask), *vectorMaskPlane);
+		}
+
+		if (IsLayerExtracted(layer))
+		{
+			// all data is in memory already, with masks having been moved out of the channels
+			for (unsigned int i=0; i < layer->channelCount; ++i)
+			{
+				const Channel& channel = layer->channels[i];
+				const int index = GetColorIndex(channel.type);
+				if (index >= 0)
+				{
+					planes.color[index].data = static_cast<const T*>(channel.data);
+					planes.hasTransparency |= (index == 3);
+				}
+			}
+
+			if (layerMaskPlane)
+				layerMaskPlane->data = static_cast<const T*>(layer->layerMask->data);
+			if (vectorMaskPlane)
+				vectorMaskPlane->data = static_cast<const T*>(layer->vectorMask->data);
+
+			return 0;
+		}
+
+		// only decode the part of the layer inside the tile
+		int errorCode = 0;
+		planes.region = ExtractLayerRegion(document, file, allocator, layer, rect.top, rect.left, rect.bottom, rect.right, errorCode);
+		for (unsigned int i=0; i < planes.region->channelCount; ++i)
+		{
+			const ChannelRegion& channel = planes.region->channels[i];
+			const Rect bounds = GetBounds(&channel);
+			const int index = GetColorIndex(channel.type);
+			if (index >= 0)
+			{
+				planes.color[index].data = static_cast<const T*>(channel.data);
+				planes.color[index].bounds = bounds;
+				planes.hasTransparency |= (index == 3);
+			}
+			else if ((channel.type == channelType::LAYER_OR_VECTOR_MASK) && vectorMaskPlane)
+			{
+				// this type denotes the vector mask whenever a vector mask exists, see ExtractLayer()
+				SetMaskPlane(layer->vectorMask, channel.data, bounds, *vectorMaskPlane);
+			}
+			else if (((channel.type == channelType::LAYER_OR_VECTOR_MASK) || (channel.type == channelType::LAYER_MASK)) && layerMaskPlane)
+			{
+				SetMaskPlane(layer->layerMask.get(), channel.data, bounds, *layerMaskPlane);
+			}
+		}
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ReleaseLayerPlanes(Allocator* allocator, LayerPlanes<T>& planes)
+	{
+		if (planes.region)
+			DestroyLayerRegion(planes.region, allocator);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static const T* GetPlaneRow(const Plane<T>& plane, int32_t y, int32_t left, int32_t right, T* scratch)
+	{
+		// rows lying completely inside the plane are handed out directly, everything else is assembled in scratch memory
+		const Rect& bounds = plane.bounds;
+		const size_t width = static_cast<size_t>(bounds.right - bounds.left);
+		const bool isRowInside = (y >= bounds.top) && (y < bounds.bottom);
+		if (plane.data && isRowInside && (left >= bounds.left) && (right <= bounds.right))
+		{
+			return plane.data + static_cast<size_t>(y - bounds.top)*width + static_cast<size_t>(left - bounds.left);
+		}
+
+		for (int32_t x=left; x < right; ++x)
+		{
+			const bool isInside = plane.data && isRowInside && (x >= bounds.left) && (x < bounds.right);
+			scratch[x - left] = isInside
+				? plane.data[static_cast<size_t>(y - bounds.top)*width + static_cast<size_t>(x - bounds.left)]
+				: plane.defaultValue;
+		}
+
+		return scratch;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void MultiplyRow(const uint8_t* PSD_RESTRICT a, const uint8_t* PSD_RESTRICT b, uint8_t* dest, unsigned int count)
+	{
+		for (unsigned int i=0; i < count; ++i)
+		{
+			// exact a*b/255, rounded
+			const uint32_t product = static_cast<uint32_t>(a[i])*b[i] + 128u;
+			dest[i] = static_cast<uint8_t>((product + (product >> 8u)) >> 8u);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void MultiplyRow(const uint16_t* PSD_RESTRICT a, const uint16_t* PSD_RESTRICT b, uint16_t* dest, unsigned int count)
+	{
+		for (unsigned int i=0; i < count; ++i)
+		{
+			// exact a*b/32768, rounded
+			const uint32_t product = static_cast<uint32_t>(a[i])*b[i] + 16384u;
+			dest[i] = static_cast<uint16_t>(product >> 15u);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void MultiplyRow(const float32_t* PSD_RESTRICT a, const float32_t* PSD_RESTRICT b, float32_t* dest, unsigned int count)
+	{
+		for (unsigned int i=0; i < count; ++i)
+		{
+			dest[i] = a[i]*b[i];
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T Lerp(T a, T b, float32_t t);
+
+	template <> uint8_t Lerp<uint8_t>(uint8_t a, uint8_t b, float32_t t) { return static_cast<uint8_t>(a + (b - a)*t + 0.5f); }
+	template <> uint16_t Lerp<uint16_t>(uint16_t a, uint16_t b, float32_t t) { return static_cast<uint16_t>(a + (b - a)*t + 0.5f); }
+	template <> float32_t Lerp<float32_t>(float32_t a, float32_t b, float32_t t) { return a + (b - a)*t; }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static float32_t ToUnit(T value)
+	{
+		return static_cast<float32_t>(value) / static_cast<float32_t>(ExpandColor<T>(255u));
+	}
+
+
+	// the pixels layers are blended onto, either the canvas or the buffer of a group.
+	// pixel (x, y) of the canvas is stored at data + (y - top)*stride + (x - left)*4 values.
+	template <typename T>
+	struct RenderTarget
+	{
+		uint8_t* data;
+		size_t stride;
+		int32_t top;
+		int32_t left;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T* GetTargetRow(const RenderTarget<T>& target, int32_t y, int32_t x)
+	{
+		return reinterpret_cast<T*>(target.data + static_cast<size_t>(y - target.top)*target.stride) + static_cast<size_t>(x - target.left)*4u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static const T* GetMaskRow(const LayerPlanes<T>& planes, int32_t y, int32_t left, int32_t right, T* const* maskRows)
+	{
+		if (planes.maskCount == 0u)
+			return nullptr;
+
+		// layer and vector mask both hide parts of the layer
+		const T* mask = GetPlaneRow(planes.masks[0], y, left, right, maskRows[0]);
+		if (planes.maskCount == 2u)
+		{
+			const T* vectorMask = GetPlaneRow(planes.masks[1], y, left, right, maskRows[1]);
+			MultiplyRow(mask, vectorMask, maskRows[0], static_cast<unsigned int>(right - left));
+			mask = maskRows[0];
+		}
+
+		return mask;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void BlendLayerPlanes(blendMode::Enum mode, uint8_t opacity, bool isClipped, const AdjustmentLut* adjustment, const LayerPlanes<T>& planes, const Rect& rect, const RenderTarget<T>& target, T* scratch)
+	{
+		const unsigned int count = static_cast<unsigned int>(rect.right - rect.left);
+		T* channelRows[4] = { scratch, scratch + TILE_SIZE, scratch + 2u*TILE_SIZE, scratch + 3u*TILE_SIZE };
+		T* maskRows[2] = { scratch + 4u*TILE_SIZE, scratch + 5u*TILE_SIZE };
+		T* srcRow = scratch + 6u*TILE_SIZE;
+		T* alphaRow = scratch + 10u*TILE_SIZE;
+
+		// adjustment layers never change the alpha of the pixels below them either
+		const bool preserveAlpha = isClipped || adjustment;
+		for (int32_t y=rect.top; y < rect.bottom; ++y)
+		{
+			T* dest = GetTargetRow(target, y, rect.left);
+			if (adjustment)
+			{
+				// the source of an adjustment layer are the adjusted pixels below it
+				imageUtil::ApplyAdjustmentLut(adjustment, dest, srcRow, count);
+			}
+			else
+			{
+				const T* rows[4] = {};
+				for (unsigned int c=0; c < 4u; ++c)
+				{
+					rows[c] = GetPlaneRow(planes.color[c], y, rect.left, rect.right, channelRows[c]);
+				}
+
+				// layers without a transparency mask are fully opaque
+				if (planes.hasTransparency)
+				{
+					imageUtil::InterleaveRGBA(rows[0], rows[1], rows[2], rows[3], srcRow, count, 1u);
+				}
+				else
+				{
+					imageUtil::InterleaveRGB(rows[0], rows[1], rows[2], ExpandColor<T>(255u), srcRow, count, 1u);
+				}
+			}
+
+			const T* mask = GetMaskRow(planes, y, rect.left, rect.right, maskRows);
+			if (preserveAlpha)
+			{
+				// the pixels below are treated as opaque, and their alpha is restored afterwards. for clipped layers, this only
+				// changes colors inside the coverage of the base, and leaves the coverage itself intact.
+				for (unsigned int x=0; x < count; ++x)
+				{
+					alphaRow[x] = dest[x*4u + 3u];
+					dest[x*4u + 3u] = ExpandColor<T>(255u);
+				}
+
+				if (adjustment)
+				{
+					for (unsigned int x=0; x < count; ++x)
+					{
+						srcRow[x*4u + 3u] = ExpandColor<T>(255u);
+					}
+				}
+			}
+
+			imageUtil::BlendRow(mode, srcRow, mask, opacity, dest, count, static_cast<unsigned int>(rect.left), static_cast<unsigned int>(y));
+
+			if (preserveAlpha)
+			{
+				for (unsigned int x=0; x < count; ++x)
+				{
+					dest[x*4u + 3u] = alphaRow[x];
+				}
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void BlendBuffer(const Layer* layer, const LayerPlanes<T>& planes, const Rect& rect, const RenderTarget<T>& source, const RenderTarget<T>& target, T* scratch)
+	{
+		// isolated groups and clipping chains are blended like a single layer, with their rendered layers being the source
+		const unsigned int count = static_cast<unsigned int>(rect.right - rect.left);
+		T* maskRows[2] = { scratch + 4u*TILE_SIZE, scratch + 5u*TILE_SIZE };
+
+		const blendMode::Enum mode = blendMode::KeyToEnum(layer->blendModeKey);
+		for (int32_t y=rect.top; y < rect.bottom; ++y)
+		{
+			const T* mask = GetMaskRow(planes, y, rect.left, rect.right, maskRows);
+			imageUtil::BlendRow(mode, GetTargetRow(source, y, rect.left), mask, layer->opacity, GetTargetRow(target, y, rect.left), count, static_cast<unsigned int>(rect.left), static_cast<unsigned int>(y));
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void FadeGroup(const Layer* group, const LayerPlanes<T>& planes, const Rect& rect, const RenderTarget<T>& backdrop, const RenderTarget<T>& target, T* scratch)
+	{
+		// the layers of a pass-through group have been blended onto the backdrop directly. the group's opacity and masks
+		// fade between the untouched backdrop and that result. colors are faded premultiplied by their alpha, so that
+		// transparent pixels don't darken the result.
+		const unsigned int count = static_cast<unsigned int>(rect.right - rect.left);
+		T* maskRows[2] = { scratch + 4u*TILE_SIZE, scratch + 5u*TILE_SIZE };
+
+		const float32_t opacity = group->opacity / 255.0f;
+		for (int32_t y=rect.top; y < rect.bottom; ++y)
+		{
+			const T* mask = GetMaskRow(planes, y, rect.left, rect.right, maskRows);
+			const T* PSD_RESTRICT src = GetTargetRow(backdrop, y, rect.left);
+			T* PSD_RESTRICT dest = GetTargetRow(target, y, rect.left);
+			for (unsigned int x=0; x < count; ++x)
+			{
+				const float32_t t = mask ? opacity*ToUnit(mask[x]) : opacity;
+				const float32_t srcAlpha = ToUnit(src[x*4u + 3u])*(1.0f - t);
+				const float32_t destAlpha = ToUnit(dest[x*4u + 3u])*t;
+				const float32_t alpha = srcAlpha + destAlpha;
+
+				// (srcC*srcA*(1 - t) + destC*destA*t) / alpha is a lerp weighted by the faded alphas
+				const float32_t colorT = (alpha > 0.0f) ? destAlpha / alpha : 0.0f;
+				for (unsigned int c=0; c < 3u; ++c)
+				{
+					dest[x*4u + c] = (alpha > 0.0f) ? Lerp(src[x*4u + c], dest[x*4u + c], colorT) : static_cast<T>(0);
+				}
+				dest[x*4u + 3u] = Lerp(src[x*4u + 3u], dest[x*4u + 3u], t);
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const Layer* FindClippingBase(const LayerMaskSection* layerMaskSection, unsigned int layerIndex)
+	{
+		// a clipped layer is clipped to the closest layer below it that isn't clipped itself. only pixel layers are supported
+		// as the base of a clipping chain, layers clipped to groups or adjustment layers are rendered like regular layers.
+		const Layer* layers = layerMaskSection->layers;
+		if (layers[layerIndex].clipping == 0u)
+			return nullptr;
+
+		for (unsigned int i=layerIndex; i > 0u; --i)
+		{
+			const Layer* layer = &layers[i - 1u];
+			if (layer->type != layerType::ANY)
+				return nullptr;
+			else if (layer->clipping == 0u)
+				return IsAdjustmentLayer(layer) ? nullptr : layer;
+		}
+
+		return nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ComputeCoverages(const Document* document, const LayerMaskSection* layerMaskSection, bool onlyRenderedLayers, Rect* coverages)
+	{
+		// layers that can never contribute to the canvas get an empty coverage. groups cover everything inside them, so that
+		// groups outside a tile are skipped as a whole.
+		const Rect canvas = { 0, 0, static_cast<int32_t>(document->height), static_cast<int32_t>(document->width) };
+		const Layer* layers = layerMaskSection->layers;
+		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+		{
+			Rect& coverage = coverages[i];
+			coverage.top = coverage.left = coverage.bottom = coverage.right = 0;
+		}
+
+		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+		{
+			const Layer* layer = &layers[i];
+			if (layer->type != layerType::ANY)
+				continue;
+
+			Rect coverage = {};
+			const bool isRendered = (layer->opacity != 0u) && IsLayerVisible(layer);
+			if ((onlyRenderedLayers && !isRendered) || !GetCoverage(layer, canvas, coverage) || !Intersect(coverage, canvas, coverage))
+				continue;
+
+			// clipped layers cannot be seen outside their base, whose coverage is known already
+			const Layer* base = FindClippingBase(layerMaskSection, i);
+			if (base && !Intersect(coverage, coverages[base - layers], coverage))
+				continue;
+
+			coverages[i] = coverage;
+			for (const Layer* group = layer->parent; group; group = group->parent)
+			{
+				Union(coverages[group - layers], coverage);
+			}
+		}
+
+		// section dividers open the group they belong to, and therefore need to end up in the same tiles
+		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+		{
+			const Layer* layer = &layers[i];
+			if ((layer->type == layerType::SECTION_DIVIDER) && layer->parent)
+				coverages[i] = coverages[layer->parent - layers];
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename F>
+	static void ForEachTile(const Rect& rect, unsigned int tileCountX, F function)
+	{
+		if ((rect.bottom <= rect.top) || (rect.right <= rect.left))
+			return;
+
+		const unsigned int firstX = static_cast<unsigned int>(rect.left) / TILE_SIZE;
+		const unsigned int firstY = static_cast<unsigned int>(rect.top) / TILE_SIZE;
+		const unsigned int lastX = static_cast<unsigned int>(rect.right - 1) / TILE_SIZE;
+		const unsigned int lastY = static_cast<unsigned int>(rect.bottom - 1) / TILE_SIZE;
+		for (unsigned int y=firstY; y <= lastY; ++y)
+		{
+			for (unsigned int x=firstX; x <= lastX; ++x)
+			{
+				function(y*tileCountX + x);
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void AssignLayersToTiles(Allocator* allocator, const Rect* coverages, unsigned int layerCount, unsigned int tileCountX, unsigned int tileCount, unsigned int*& tileLayerOffsets, unsigned int*& tileLayers)
+	{
+		// the layers of all tiles are stored in one array, with the layers of each tile being consecutive and ordered bottom
+		// to top. the layers are counted first, so that each tile knows where its layers start.
+		tileLayerOffsets = memoryUtil::AllocateArray<unsigned int>(allocator, tileCount + 1u);
+		memset(tileLayerOffsets, 0, (tileCount + 1u)*sizeof(unsigned int));
+		for (unsigned int i=0; i < layerCount; ++i)
+		{
+			ForEachTile(coverages[i], tileCountX, [tileLayerOffsets](unsigned int tile)
+			{
+				++tileLayerOffsets[tile + 1u];
+			});
+		}
+
+		for (unsigned int i=0; i < tileCount; ++i)
+		{
+			tileLayerOffsets[i + 1u] += tileLayerOffsets[i];
+		}
+
+		const unsigned int totalCount = tileLayerOffsets[tileCount];
+		tileLayers = memoryUtil::AllocateArray<unsigned int>(allocator, (totalCount != 0u) ? totalCount : 1u);
+
+		unsigned int* fillCounts = memoryUtil::AllocateArray<unsigned int>(allocator, tileCount);
+		memset(fillCounts, 0, tileCount*sizeof(unsigned int));
+		for (unsigned int i=0; i < layerCount; ++i)
+		{
+			ForEachTile(coverages[i], tileCountX, [i, tileLayerOffsets, tileLayers, fillCounts](unsigned int tile)
+			{
+				tileLayers[tileLayerOffsets[tile] + fillCounts[tile]++] = i;
+			});
+		}
+		memoryUtil::FreeArray(allocator, fillCounts);
+	}
+
+
+	// tile-sized buffers used by groups. buffers are handed out to whichever tile needs one and reused afterwards, so that
+	// the number of buffers only depends on the number of threads and the nesting depth of groups, not on the number of groups.
+	struct TileBufferPool
+	{
+		std::mutex mutex;
+		void* freeList;
+		size_t bufferSize;
+		Allocator* allocator;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void* AcquireTileBuffer(TileBufferPool* pool)
+	{
+		{
+			// free buffers store a pointer to the next free buffer in their first bytes
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			void* buffer = pool->freeList;
+			if (buffer)
+			{
+				pool->freeList = *static_cast<void**>(buffer);
+				return buffer;
+			}
+		}
+
+		return pool->allocator->Allocate(pool->bufferSize, 16u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ReleaseTileBuffer(TileBufferPool* pool, void* buffer)
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		*static_cast<void**>(buffer) = pool->freeList;
+		pool->freeList = buffer;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void FreeTileBuffers(TileBufferPool* pool)
+	{
+		while (pool->freeList)
+		{
+			void* buffer = pool->freeList;
+			pool->freeList = *static_cast<void**>(buffer);
+			pool->allocator->Free(buffer);
+		}
+	}
+
+
+	struct FlattenData
+	{
+		const Document* document;
+		File* file;
+		Allocator* allocator;
+		const LayerMaskSection* layerMaskSection;
+		const Rect* coverages;
+		const unsigned int* tileLayerOffsets;
+		const unsigned int* tileLayers;
+		unsigned int tileCountX;
+		const unsigned int* tiles;
+		uint8_t* canvasData;
+		size_t stride;
+		int* tileErrorCodes;
+		TileBufferPool* bufferPool;
+		AdjustmentLut** adjustments;
+	};
+
+
+	// the nesting depth of groups is limited to the same depth the parser supports
+	static const unsigned int MAX_GROUP_DEPTH = 256u;
+
+
+	// a group whose layers are currently being rendered
+	template <typename T>
+	struct GroupState
+	{
+		const Layer* group;
+		RenderTarget<T> target;
+		void* buffer;
+		bool isHidden;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void CopyTile(const RenderTarget<T>& source, const RenderTarget<T>& target, const Rect& tile)
+	{
+		const size_t rowSize = static_cast<size_t>(tile.right - tile.left)*4u*sizeof(T);
+		for (int32_t y=tile.top; y < tile.bottom; ++y)
+		{
+			memcpy(GetTargetRow(target, y, tile.left), GetTargetRow(source, y, tile.left), rowSize);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ClearTile(const RenderTarget<T>& target, const Rect& tile)
+	{
+		const size_t rowSize = static_cast<size_t>(tile.right - tile.left)*4u*sizeof(T);
+		for (int32_t y=tile.top; y < tile.bottom; ++y)
+		{
+			memset(GetTargetRow(target, y, tile.left), 0, rowSize);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void OpenGroup(const FlattenData& data, const Layer* group, const Rect& tile, const GroupState<T>& parent, GroupState<T>& state)
+	{
+		state.group = group;
+		state.target = parent.target;
+		state.buffer = nullptr;
+		state.isHidden = parent.isHidden || !group->isVisible || (group->opacity == 0u);
+		if (state.isHidden)
+			return;
+
+		const RenderTarget<T> buffer = { nullptr, TILE_SIZE*4u*sizeof(T), tile.top, tile.left };
+		if (group->isPassThrough)
+		{
+			// layers of pass-through groups are blended onto the backdrop directly. a copy of the backdrop is only needed
+			// in case the group's opacity or masks have to be applied afterwards.
+			if ((group->opacity != 255u) || group->layerMask || group->vectorMask)
+			{
+				state.buffer = AcquireTileBuffer(data.bufferPool);
+				RenderTarget<T> backdrop = buffer;
+				backdrop.data = static_cast<uint8_t*>(state.buffer);
+				CopyTile(parent.target, backdrop, tile);
+			}
+		}
+		else
+		{
+			// all other groups are rendered in isolation, starting out fully transparent
+			state.buffer = AcquireTileBuffer(data.bufferPool);
+			state.target = buffer;
+			state.target.data = static_cast<uint8_t*>(state.buffer);
+			ClearTile(state.target, tile);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int CloseGroup(const FlattenData& data, const Rect& tile, const GroupState<T>& state, const RenderTarget<T>& parentTarget, T* scratch)
+	{
+		if (!state.buffer)
+			return 0;
+
+		// the group's opacity and masks are applied only once, for all its layers at the same time
+		int errorCode = 0;
+		const Layer* group = state.group;
+		Rect rect = {};
+		if (Intersect(data.coverages[group - data.layerMaskSection->layers], tile, rect))
+		{
+			LayerPlanes<T> planes = {};
+			errorCode = AcquireLayerPlanes<T>(data.document, data.file, data.allocator, group, rect, planes);
+			if (errorCode != extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+			{
+				if (group->isPassThrough)
+				{
+					RenderTarget<T> backdrop = { static_cast<uint8_t*>(state.buffer), TILE_SIZE*4u*sizeof(T), tile.top, tile.left };
+					FadeGroup<T>(group, planes, rect, backdrop, parentTarget, scratch);
+				}
+				else
+				{
+					BlendBuffer<T>(group, planes, rect, state.target, parentTarget, scratch);
+				}
+			}
+
+			ReleaseLayerPlanes<T>(data.allocator, planes);
+		}
+
+		ReleaseTileBuffer(data.bufferPool, state.buffer);
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int RenderClippingChain(const FlattenData& data, const Rect& tile, const Rect& rect, unsigned int chainBegin, unsigned int chainEnd, const RenderTarget<T>& target, T* scratch)
+	{
+		// the base is rendered on its own first, which yields the coverage all clipped layers are limited to.
+		// this only needs a tile-sized buffer, no matter how many layers are clipped to the base.
+		const Layer* base = &data.layerMaskSection->layers[data.tileLayers[chainBegin]];
+		RenderTarget<T> chainTarget = { static_cast<uint8_t*>(AcquireTileBuffer(data.bufferPool)), TILE_SIZE*4u*sizeof(T), tile.top, tile.left };
+		ClearTile(chainTarget, rect);
+
+		int errorCode = 0;
+		for (unsigned int i=chainBegin; i < chainEnd; ++i)
+		{
+			const unsigned int layerIndex = data.tileLayers[i];
+			const Layer* layer = &data.layerMaskSection->layers[layerIndex];
+			if (!layer->isVisible || (layer->opacity == 0u))
+				continue;
+
+			Rect layerRect = {};
+			if (!Intersect(data.coverages[layerIndex], tile, layerRect))
+				continue;
+
+			LayerPlanes<T> planes = {};
+			const int layerErrorCode = AcquireLayerPlanes<T>(data.document, data.file, data.allocator, layer, layerRect, planes);
+			if (errorCode == 0)
+				errorCode = layerErrorCode;
+
+			if (layerErrorCode != extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+			{
+				if (layer == base)
+				{
+					// the opacity and blend mode of the base apply to the whole chain
+					BlendLayerPlanes<T>(blendMode::NORMAL, 255u, false, nullptr, planes, layerRect, chainTarget, scratch);
+				}
+				else
+				{
+					BlendLayerPlanes<T>(blendMode::KeyToEnum(layer->blendModeKey), layer->opacity, true, data.adjustments[layerIndex], planes, layerRect, chainTarget, scratch);
+				}
+			}
+
+			ReleaseLayerPlanes<T>(data.allocator, planes);
+		}
+
+		// the base's masks have been applied already
+		const LayerPlanes<T> noMasks = {};
+		BlendBuffer<T>(base, noMasks, rect, chainTarget, target, scratch);
+
+		ReleaseTileBuffer(data.bufferPool, chainTarget.data);
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int FlattenTile(const FlattenData& data, unsigned int tileIndex)
+	{
+		const int32_t canvasWidth = static_cast<int32_t>(data.document->width);
+		const int32_t canvasHeight = static_cast<int32_t>(data.document->height);
+		const int32_t tileLeft = static_cast<int32_t>((tileIndex % data.tileCountX) * TILE_SIZE);
+		const int32_t tileTop = static_cast<int32_t>((tileIndex / data.tileCountX) * TILE_SIZE);
+
+		Rect tile = {};
+		tile.top = tileTop;
+		tile.left = tileLeft;
+		tile.bottom = (tileTop + static_cast<int32_t>(TILE_SIZE) < canvasHeight) ? tileTop + static_cast<int32_t>(TILE_SIZE) : canvasHeight;
+		tile.right = (tileLeft + static_cast<int32_t>(TILE_SIZE) < canvasWidth) ? tileLeft + static_cast<int32_t>(TILE_SIZE) : canvasWidth;
+
+		// every tile starts out fully transparent
+		const RenderTarget<T> canvas = { data.canvasData, data.stride, 0, 0 };
+		ClearTile(canvas, tile);
+
+		const unsigned int firstLayer = data.tileLayerOffsets[tileIndex];
+		const unsigned int lastLayer = data.tileLayerOffsets[tileIndex + 1u];
+		if (firstLayer == lastLayer)
+			return 0;
+
+		// scratch rows for the four channels, two masks, the interleaved source, and the alpha of a clipping base
+		T* scratch = static_cast<T*>(data.allocator->Allocate(11u*TILE_SIZE*sizeof(T), 16u));
+
+		// layers are stored bottom to top. a group is opened by the section divider below its layers, and closed by the
+		// group's own record above them.
+		GroupState<T> groups[MAX_GROUP_DEPTH];
+		unsigned int depth = 0u;
+		groups[0].group = nullptr;
+		groups[0].target = canvas;
+		groups[0].buffer = nullptr;
+		groups[0].isHidden = false;
+
+		int errorCode = 0;
+		for (unsigned int i=firstLayer; i < lastLayer; ++i)
+		{
+			// the layers of a tile are determined up front, but their properties may have changed in the meantime
+			const unsigned int layerIndex = data.tileLayers[i];
+			const Layer* layer = &data.layerMaskSection->layers[layerIndex];
+			if (layer->type == layerType::SECTION_DIVIDER)
+			{
+				if (layer->parent && (depth + 1u < MAX_GROUP_DEPTH))
+				{
+					OpenGroup<T>(data, layer->parent, tile, groups[depth], groups[depth + 1u]);
+					++depth;
+				}
+				continue;
+			}
+			else if ((layer->type == layerType::OPEN_FOLDER) || (layer->type == layerType::CLOSED_FOLDER))
+			{
+				if ((depth != 0u) && (groups[depth].group == layer))
+				{
+					const int groupErrorCode = CloseGroup<T>(data, tile, groups[depth], groups[depth - 1u].target, scratch);
+					if (errorCode == 0)
+						errorCode = groupErrorCode;
+					--depth;
+				}
+				continue;
+			}
+
+			// clipped layers are rendered together with their base
+			if (FindClippingBase(data.layerMaskSection, layerIndex))
+				continue;
+
+			if (groups[depth].isHidden || (layer->opacity == 0u) || !IsLayerVisible(layer))
+				continue;
+
+			Rect rect = {};
+			if (!Intersect(data.coverages[layerIndex], tile, rect))
+				continue;
+
+			// layers clipped to this one directly follow it, unless they don't touch the tile
+			unsigned int chainEnd = i + 1u;
+			bool hasVisibleClippedLayers = false;
+			while ((chainEnd < lastLayer) && (FindClippingBase(data.layerMaskSection, data.tileLayers[chainEnd]) == layer))
+			{
+				const Layer* clippedLayer = &data.layerMaskSection->layers[data.tileLayers[chainEnd]];
+				hasVisibleClippedLayers |= clippedLayer->isVisible && (clippedLayer->opacity != 0u);
+				++chainEnd;
+			}
+
+			int layerErrorCode = 0;
+			if (hasVisibleClippedLayers)
+			{
+				layerErrorCode = RenderClippingChain<T>(data, tile, rect, i, chainEnd, groups[depth].target, scratch);
+			}
+			else
+			{
+				LayerPlanes<T> planes = {};
+				layerErrorCode = AcquireLayerPlanes<T>(data.document, data.file, data.allocator, layer, rect, planes);
+				if (layerErrorCode != extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+				{
+					BlendLayerPlanes<T>(blendMode::KeyToEnum(layer->blendModeKey), layer->opacity, false, data.adjustments[layerIndex], planes, rect, groups[depth].target, scratch);
+				}
+
+				ReleaseLayerPlanes<T>(data.allocator, planes);
+			}
+
+			if (errorCode == 0)
+				errorCode = layerErrorCode;
+		}
+
+		// groups that are never closed only exist in malformed files
+		for (; depth != 0u; --depth)
+		{
+			CloseGroup<T>(data, tile, groups[depth], groups[depth - 1u].target, scratch);
+		}
+
+		data.allocator->Free(scratch);
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void FlattenTileTask(void* userData, unsigned int index)
+	{
+		FlattenData* data = static_cast<FlattenData*>(userData);
+		const unsigned int tileIndex = data->tiles ? data->tiles[index] : index;
+		if (data->document->bitsPerChannel == 8)
+		{
+			data->tileErrorCodes[index] = FlattenTile<uint8_t>(*data, tileIndex);
+		}
+		else if (data->document->bitsPerChannel == 16)
+		{
+			data->tileErrorCodes[index] = FlattenTile<uint16_t>(*data, tileIndex);
+		}
+		else if (data->document->bitsPerChannel == 32)
+		{
+			data->tileErrorCodes[index] = FlattenTile<float32_t>(*data, tileIndex);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static AdjustmentLut* CreateLayerAdjustment(const Document* document, Allocator* allocator, const Layer* layer, const Rect& coverage)
+	{
+		// layers not covering any pixels are never rendered
+		const bool isCovering = (coverage.bottom > coverage.top) && (coverage.right > coverage.left);
+		return isCovering ? CreateAdjustmentLut(layer, document->bitsPerChannel, allocator) : nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static AdjustmentLut** CreateAdjustments(const Document* document, Allocator* allocator, const LayerMaskSection* layerMaskSection, const Rect* coverages)
+	{
+		// the lookup tables of adjustment layers are computed once for all tiles
+		AdjustmentLut** adjustments = memoryUtil::AllocateArray<AdjustmentLut*>(allocator, layerMaskSection->layerCount);
+		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+		{
+			adjustments[i] = CreateLayerAdjustment(document, allocator, &layerMaskSection->layers[i], coverages[i]);
+		}
+
+		return adjustments;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyAdjustments(Allocator* allocator, const LayerMaskSection* layerMaskSection, AdjustmentLut**& adjustments)
+	{
+		for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+		{
+			if (adjustments[i])
+				DestroyAdjustmentLut(adjustments[i], allocator);
+		}
+
+		memoryUtil::FreeArray(allocator, adjustments);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int FlattenTiles(FlattenData& data, unsigned int tileCount, ThreadPool* threadPool)
+	{
+		// renders either all tiles, or the tiles whose indices are given in data.tiles
+		data.tileErrorCodes = memoryUtil::AllocateArray<int>(data.allocator, tileCount);
+		memset(data.tileErrorCodes, 0, tileCount*sizeof(int));
+
+		TileBufferPool bufferPool;
+		bufferPool.freeList = nullptr;
+		bufferPool.bufferSize = TILE_SIZE*TILE_SIZE*4u*data.document->bitsPerChannel / 8u;
+		bufferPool.allocator = data.allocator;
+		data.bufferPool = &bufferPool;
+
+		if (threadPool)
+		{
+			threadPool->ParallelFor(tileCount, &FlattenTileTask, &data);
+		}
+		else
+		{
+			for (unsigned int i=0; i < tileCount; ++i)
+			{
+				FlattenTileTask(&data, i);
+			}
+		}
+
+		int errorCode = 0;
+		for (unsigned int i=0; (i < tileCount) && (errorCode == 0); ++i)
+		{
+			errorCode = data.tileErrorCodes[i];
+		}
+
+		FreeTileBuffers(&bufferPool);
+		memoryUtil::FreeArray(data.allocator, data.tileErrorCodes);
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsInsideGroup(const Layer* layer, const Layer* group)
+	{
+		for (const Layer* current = layer->parent; current; current = current->parent)
+		{
+			if (current == group)
+				return true;
+		}
+
+		return false;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+struct RenderCacheState
+{
+	const Document* document;
+	const LayerMaskSection* layerMaskSection;
+
+	// the coverage of all layers regardless of their visibility, and the layers overlapping each tile
+	Rect* coverages;
+	unsigned int* tileLayerOffsets;
+	unsigned int* tileLayers;
+	unsigned int tileCountX;
+	unsigned int tileCount;
+
+	// the lookup tables of all adjustment layers, only rebuilt for layers that changed
+	AdjustmentLut** adjustments;
+};
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int FlattenDocument(const Document* document, File* file, Allocator* allocator, const LayerMaskSection* layerMaskSection, void* rgbaData, unsigned int stride, ThreadPool* threadPool)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layerMaskSection);
+	PSD_ASSERT_NOT_NULL(rgbaData);
+	PSD_ASSERT(document->colorMode == colorMode::RGB, "Flattening only supports RGB documents, but the document uses color mode %u.", document->colorMode);
+
+	const unsigned int bytesPerPixel = 4u * document->bitsPerChannel / 8u;
+	PSD_ASSERT(stride >= document->width*bytesPerPixel, "Stride %u is smaller than a row of the canvas.", stride);
+
+	// only the layers that are currently visible need to be assigned to tiles
+	const unsigned int tileCountX = (document->width + TILE_SIZE - 1u) / TILE_SIZE;
+	const unsigned int tileCountY = (document->height + TILE_SIZE - 1u) / TILE_SIZE;
+	const unsigned int tileCount = tileCountX * tileCountY;
+
+	Rect* coverages = memoryUtil::AllocateArray<Rect>(allocator, layerMaskSection->layerCount);
+	ComputeCoverages(document, layerMaskSection, true, coverages);
+
+	unsigned int* tileLayerOffsets = nullptr;
+	unsigned int* tileLayers = nullptr;
+	AssignLayersToTiles(allocator, coverages, layerMaskSection->layerCount, tileCountX, tileCount, tileLayerOffsets, tileLayers);
+
+	AdjustmentLut** adjustments = CreateAdjustments(document, allocator, layerMaskSection, coverages);
+
+	FlattenData data = { document, file, allocator, layerMaskSection, coverages, tileLayerOffsets, tileLayers, tileCountX, nullptr, static_cast<uint8_t*>(rgbaData), stride, nullptr, nullptr, adjustments };
+	const int errorCode = FlattenTiles(data, tileCount, threadPool);
+
+	DestroyAdjustments(allocator, layerMaskSection, adjustments);
+
+	memoryUtil::FreeArray(allocator, tileLayers);
+	memoryUtil::FreeArray(allocator, tileLayerOffsets);
+	memoryUtil::FreeArray(allocator, coverages);
+
+	return errorCode;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+RenderCache* CreateRenderCache(const Document* document, File* file, Allocator* allocator, const LayerMaskSection* layerMaskSection, ThreadPool* threadPool, int& errorCode)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layerMaskSection);
+	PSD_ASSERT(document->colorMode == colorMode::RGB, "Flattening only supports RGB documents, but the document uses color mode %u.", document->colorMode);
+
+	RenderCacheState* state = memoryUtil::Allocate<RenderCacheState>(allocator);
+	state->document = document;
+	state->layerMaskSection = layerMaskSection;
+	state->tileCountX = (document->width + TILE_SIZE - 1u) / TILE_SIZE;
+	state->tileCount = state->tileCountX * ((document->height + TILE_SIZE - 1u) / TILE_SIZE);
+
+	// hidden layers are assigned to tiles as well, because they might be shown later on
+	state->coverages = memoryUtil::AllocateArray<Rect>(allocator, layerMaskSection->layerCount);
+	ComputeCoverages(document, layerMaskSection, false, state->coverages);
+	AssignLayersToTiles(allocator, state->coverages, layerMaskSection->layerCount, state->tileCountX, state->tileCount, state->tileLayerOffsets, state->tileLayers);
+	state->adjustments = CreateAdjustments(document, allocator, layerMaskSection, state->coverages);
+
+	RenderCache* cache = memoryUtil::Allocate<RenderCache>(allocator);
+	cache->stride = document->width * 4u * document->bitsPerChannel / 8u;
+	cache->canvasData = allocator->Allocate(static_cast<size_t>(cache->stride)*document->height, 16u);
+	cache->tilesRecomposited = state->tileCount;
+	cache->tilesReused = 0u;
+	cache->state = state;
+
+	FlattenData data = { document, file, allocator, layerMaskSection, state->coverages, state->tileLayerOffsets, state->tileLayers, state->tileCountX, nullptr, static_cast<uint8_t*>(cache->canvasData), cache->stride, nullptr, nullptr, state->adjustments };
+	errorCode = FlattenTiles(data, state->tileCount, threadPool);
+
+	return cache;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int UpdateRenderCache(RenderCache* cache, File* file, Allocator* allocator, const Layer* const* changedLayers, unsigned int changedLayerCount, ThreadPool* threadPool)
+{
+	PSD_ASSERT_NOT_NULL(cache);
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	RenderCacheState* state = cache->state;
+	const LayerMaskSection* layerMaskSection = state->layerMaskSection;
+
+	// mark the tiles touched by the changed layers, and by all layers inside changed groups. the lookup tables of these
+	// layers are rebuilt, because the settings of their adjustments might have changed as well.
+	bool* isDirty = memoryUtil::AllocateArray<bool>(allocator, state->tileCount);
+	memset(isDirty, 0, state->tileCount*sizeof(bool));
+	for (unsigned int i=0; i < layerMaskSection->layerCount; ++i)
+	{
+		const Layer* layer = &layerMaskSection->layers[i];
+		for (unsigned int j=0; j < changedLayerCount; ++j)
+		{
+			PSD_ASSERT((changedLayers[j] >= layerMaskSection->layers) && (changedLayers[j] < layerMaskSection->layers + layerMaskSection->layerCount),
+				"Layer %u does not belong to the layer mask section of the cache.", j);
+
+			if ((changedLayers[j] == layer) || IsInsideGroup(layer, changedLayers[j]))
+			{
+				ForEachTile(state->coverages[i], state->tileCountX, [isDirty](unsigned int tile)
+				{
+					isDirty[tile] = true;
+				});
+
+				if (state->adjustments[i])
+					DestroyAdjustmentLut(state->adjustments[i], allocator);
+				state->adjustments[i] = CreateLayerAdjustment(state->document, allocator, layer, state->coverages[i]);
+				break;
+			}
+		}
+	}
+
+	unsigned int dirtyCount = 0u;
+	unsigned int* dirtyTiles = memoryUtil::AllocateArray<unsigned int>(allocator, state->tileCount);
+	for (unsigned int i=0; i < state->tileCount; ++i)
+	{
+		if (isDirty[i])
+			dirtyTiles[dirtyCount++] = i;
+	}
+
+	FlattenData data = { state->document, file, allocator, layerMaskSection, state->coverages, state->tileLayerOffsets, state->tileLayers, state->tileCountX, dirtyTiles, static_cast<uint8_t*>(cache->canvasData), cache->stride, nullptr, nullptr, state->adjustments };
+	const int errorCode = FlattenTiles(data, dirtyCount, threadPool);
+
+	cache->tilesRecomposited += dirtyCount;
+	cache->tilesReused += state->tileCount - dirtyCount;
+
+	memoryUtil::FreeArray(allocator, dirtyTiles);
+	memoryUtil::FreeArray(allocator, isDirty);
+
+	return errorCode;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyRenderCache(RenderCache*& cache, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(cache);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	RenderCacheState* state = cache->state;
+	DestroyAdjustments(allocator, state->layerMaskSection, state->adjustments);
+	memoryUtil::FreeArray(allocator, state->tileLayers);
+	memoryUtil::FreeArray(allocator, state->tileLayerOffsets);
+	memoryUtil::FreeArray(allocator, state->coverages);
+	memoryUtil::Free(allocator, state);
+
+	allocator->Free(cache->canvasData);
+	memoryUtil::Free(allocator, cache);
+}
+
+PSD_NAMESPACE_END
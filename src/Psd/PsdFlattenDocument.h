@@ -0,0 +1,59 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+struct Document;
+class File;
+class Allocator;
+struct Layer;
+struct LayerMaskSection;
+struct RenderCache;
+class ThreadPool;
+
+
+/// \ingroup Renderer
+/// Flattens all visible layers of the \a layerMaskSection into \a rgbaData, independent of the merged image stored in the document.
+/// The destination holds document->height rows of document->width interleaved RGBA pixels, with rows being \a stride bytes apart.
+/// Layers are blended bottom to top using their blend mode and opacity as well as their layer and vector masks, see \ref imageUtil::BlendRow.
+/// Groups are rendered according to the hierarchy stored in Layer::parent. Layers of pass-through groups are blended onto the layers below
+/// directly, whereas all other groups are rendered in isolation and blended like a single layer. Either way, the opacity and masks of a
+/// group are applied once for all its layers. Groups are skipped as a whole in tiles that none of their layers touch.
+/// Layers clipped to a pixel layer, see Layer::clipping, are rendered together with their base in a single pass per tile. They only ever
+/// touch the base's coverage, and the base's blend mode and opacity apply to the whole chain. Layers clipped to a group or an adjustment layer are rendered like regular layers.
+/// Adjustment layers, see \ref IsAdjustmentLayer, are evaluated using lookup tables computed once per layer, and adjust all pixels below them.
+/// The canvas is split into tiles of 256x256 pixels that are rendered in parallel using the threads of \a threadPool. Each tile only
+/// considers the layers overlapping it, and tiles not touched by any layer are left fully transparent.
+/// Layers that have been extracted already by \ref ExtractLayer or \ref ExtractLayers are read from memory. All other layers are
+/// decoded tile by tile using \ref ExtractLayerRegion, which saves decoding large layers as a whole but has to inflate all rows above a tile
+/// for ZIP-compressed channels. Documents making heavy use of ZIP compression are therefore best extracted up front.
+/// If \a threadPool is a nullptr, all tiles are rendered on the calling thread.
+/// \remark Only documents using \ref colorMode::RGB are supported, with 8, 16 or 32 bits per channel.
+/// \remark Both \a file and \a allocator are used from several threads at the same time, and therefore must be thread-safe.
+/// \return Returns \b 0 if there was no error, otherwise the first error code in tile order as returned by \ref ExtractLayerRegion.
+int FlattenDocument(const Document* document, File* file, Allocator* allocator, const LayerMaskSection* layerMaskSection, void* rgbaData, unsigned int stride, ThreadPool* threadPool);
+
+/// \ingroup Renderer
+/// Flattens all visible layers of the \a layerMaskSection like \ref FlattenDocument, and returns a newly created cache holding the
+/// result that needs to be freed by a call to \ref DestroyRenderCache. The cache refers to \a document and \a layerMaskSection, which
+/// must outlive it. Layers are best extracted before creating the cache, so that updates don't need to decode any data.
+/// \remark \a errorCode is \b 0 if there was no error, otherwise it holds the first error code in tile order as returned by \ref ExtractLayerRegion.
+RenderCache* CreateRenderCache(const Document* document, File* file, Allocator* allocator, const LayerMaskSection* layerMaskSection, ThreadPool* threadPool, int& errorCode);
+
+/// \ingroup Renderer
+/// Re-renders the parts of the \a cache affected by a change to the properties of \a changedLayerCount layers, e.g. their visibility,
+/// opacity, blend mode, adjustment settings, or mask data. Only tiles overlapped by the changed layers are rendered again, all other tiles
+/// are reused, and so are the lookup tables of all adjustment layers that did not change.
+/// Changing a group affects all layers inside the group.
+/// \remark Changing the bounds of a layer or adding and removing layers is not supported, a new cache has to be created in that case.
+/// \return Returns \b 0 if there was no error, otherwise the first error code in tile order as returned by \ref ExtractLayerRegion.
+int UpdateRenderCache(RenderCache* cache, File* file, Allocator* allocator, const Layer* const* changedLayers, unsigned int changedLayerCount, ThreadPool* threadPool);
+
+/// \ingroup Renderer
+/// Destroys and nullifies the given \a cache previously created by a call to \ref CreateRenderCache.
+void DestroyRenderCache(RenderCache*& cache, Allocator* allocator);
+
+PSD_NAMESPACE_END
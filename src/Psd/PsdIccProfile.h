@@ -0,0 +1,49 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class IccCurve
+/// \brief A struct representing a tone curve stored in an ICC profile, either sampled or parametric.
+/// \details Curves not stored in a profile are parametric curves of type 0 with a gamma of 1, which leave values untouched.
+struct IccCurve
+{
+	float32_t* table;						///< Sampled curve values in the range [0, 1], or a nullptr for parametric curves.
+	uint32_t entryCount;					///< The number of sampled values.
+	uint16_t functionType;					///< The type of the parametric function from 0 to 4, as defined by the ICC specification.
+	float32_t parameters[7];				///< The parameters g, a, b, c, d, e and f of the parametric function.
+};
+
+
+/// \ingroup Types
+/// \class IccProfile
+/// \brief A struct representing the transform from device colors to the profile connection space (PCS) stored in an ICC profile.
+/// \details The transform is either stored as lookup tables (A2B0 tag of type lut8, lut16 or lutAtoB), or as colorants and tone curves
+/// (matrix/TRC profiles). Lookup tables are evaluated as input curves, followed by the color lookup table, matrix curves, matrix and output curves.
+/// Profiles for Lab data without either transform are treated as the identity.
+/// \sa ParseIccProfile
+struct IccProfile
+{
+	uint64_t hash;							///< A hash of the raw profile data, identifying profiles across documents.
+	uint32_t colorSpace;					///< The color space of the device data, one of 'GRAY', 'RGB ', 'CMYK' or 'Lab '.
+	uint32_t connectionSpace;				///< The profile connection space, either 'XYZ ' or 'Lab '.
+	unsigned int channelCount;				///< The number of device channels, from 1 to 4.
+
+	bool hasLut;							///< Whether the transform is stored as lookup tables, which take precedence over matrix/TRC.
+	bool isLegacyLabEncoding;				///< Whether Lab values use the 16-bit encoding of ICC version 2, where L=100 is stored as 0xFF00.
+	IccCurve inputCurves[4];				///< The input curves ("A" curves) of the lookup tables, one per device channel.
+	uint8_t gridPoints[4];					///< The number of grid points of the color lookup table in each dimension, or zero if there is none.
+	float32_t* clut;						///< The color lookup table holding three values per grid point, with the first channel varying slowest.
+	IccCurve matrixCurves[3];				///< The curves applied before the matrix ("M" curves).
+	float32_t matrix[12];					///< A 3x3 matrix in row-major order, followed by an offset.
+	IccCurve outputCurves[3];				///< The output curves ("B" curves) of the lookup tables.
+
+	float32_t colorants[9];					///< The XYZ values of the red, green and blue colorants of matrix/TRC profiles, in row-major order with one colorant per column.
+	IccCurve toneCurves[3];					///< The tone curves of matrix/TRC profiles. Grayscale profiles only store a single curve.
+};
+
+PSD_NAMESPACE_END
@@ -4,267 +4,88 @@
 #include "PsdPch.h"
 #include "PsdInterleave.h"
 
-#include "PsdUnionCast.h"
-
-#if !defined(PSD_USE_SSE)
-	#if defined(_M_IX86) || defined(_M_X64)
-		#define PSD_USE_SSE 1
-	#else
-		#define PSD_USE_SSE 0
-	#endif
-#endif
-
-#if PSD_USE_SSE
-	#include <emmintrin.h>
-#endif
+#include "PsdInterleaveKernels.h"
+#include "PsdSimd.h"
 
 
 PSD_NAMESPACE_BEGIN
 
-#if PSD_USE_SSE
-// splats a single 8-bit, 16-bit or 32-bit value into a SSE2 register
 namespace
 {
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
-	__m128i SplatValue(T value);
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <>
-	__m128i SplatValue<uint8_t>(uint8_t value)
+	static void RegisterScalarKernels(imageUtil::InterleaveKernels<T>* kernels)
 	{
-		return _mm_set1_epi8(util::union_cast<char>(value));
+		kernels->interleaveRGB = &imageUtil::InterleaveRGBScalar<T>;
+		kernels->interleaveRGBA = &imageUtil::InterleaveRGBAScalar<T>;
+		kernels->deinterleaveRGB = &imageUtil::DeinterleaveRGBScalar<T>;
+		kernels->deinterleaveRGBA = &imageUtil::DeinterleaveRGBAScalar<T>;
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <>
-	__m128i SplatValue<uint16_t>(uint16_t value)
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::InterleaveKernelTable* table)
 	{
-		return _mm_set1_epi16(util::union_cast<short>(value));
-	}
-
+		// start with the scalar kernels, and let each level replace the kernels it has a better implementation for
+		RegisterScalarKernels(&table->kernels8);
+		RegisterScalarKernels(&table->kernels16);
+		RegisterScalarKernels(&table->kernels32);
 
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <>
-	__m128i SplatValue<float32_t>(float32_t value)
-	{
-		return _mm_castps_si128(_mm_set_ps1(value));
-	}
-}
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
 
-
-// interleaves either 8-bit, 16-bit, 32-bit or 64-bit values from two SSE2 registers
-namespace
-{
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <unsigned int N>
-	__m128i InterleaveLo(__m128i a, __m128i b);
-
-	template <> __m128i InterleaveLo<1>(__m128i a, __m128i b) { return _mm_unpacklo_epi8(a, b); }
-	template <> __m128i InterleaveLo<2>(__m128i a, __m128i b) { return _mm_unpacklo_epi16(a, b); }
-	template <> __m128i InterleaveLo<4>(__m128i a, __m128i b) { return _mm_unpacklo_epi32(a, b); }
-	template <> __m128i InterleaveLo<8>(__m128i a, __m128i b) { return _mm_unpacklo_epi64(a, b); }
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <unsigned int N>
-	__m128i InterleaveHi(__m128i a, __m128i b);
-
-	template <> __m128i InterleaveHi<1>(__m128i a, __m128i b) { return _mm_unpackhi_epi8(a, b); }
-	template <> __m128i InterleaveHi<2>(__m128i a, __m128i b) { return _mm_unpackhi_epi16(a, b); }
-	template <> __m128i InterleaveHi<4>(__m128i a, __m128i b) { return _mm_unpackhi_epi32(a, b); }
-	template <> __m128i InterleaveHi<8>(__m128i a, __m128i b) { return _mm_unpackhi_epi64(a, b); }
-}
+		if (level >= simd::Level::SSE2)
+			imageUtil::RegisterInterleaveKernelsSSE2(table);
+		if (level >= simd::Level::SSSE3)
+			imageUtil::RegisterInterleaveKernelsSSSE3(table);
+		if (level >= simd::Level::AVX2)
+			imageUtil::RegisterInterleaveKernelsAVX2(table);
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterInterleaveKernelsAVX512(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterInterleaveKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
 #endif
-
-
-namespace imageUtil
-{
-#if PSD_USE_SSE
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
-	{
-		const unsigned int pixelCount = width*height;
-		const unsigned int blockCount = pixelCount / blockSize;
-		const __m128i va = SplatValue(alpha);
-
-		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
-		{
-			// load pixels from R, G, B
-			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
-			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
-			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
-
-			// interleave R and G
-			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
-			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
-
-			// interleave B and A
-			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
-			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
-
-			// interleave RG and BA
-			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-
-			// store to memory non-temporal, bypassing cache
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
-		}
-
-		return blockCount;
 	}
 
 
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
+	struct KernelTables
 	{
-		const unsigned int pixelCount = width*height;
-		const unsigned int blockCount = pixelCount / blockSize;
-
-		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		KernelTables(void)
 		{
-			// load pixels from R, G, B, and A
-			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
-			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
-			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
-			const __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(srcA));
-
-			// interleave R and G
-			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
-			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
-
-			// interleave B and A
-			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
-			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
-
-			// interleave RG and BA
-			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
-			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
-
-			// store to memory non-temporal, bypassing cache
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
-			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
 		}
 
-		return blockCount;
-	}
-#endif
+		imageUtil::InterleaveKernelTable tables[simd::Level::COUNT];
+	};
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void CopyRemainingPixels(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	static const imageUtil::InterleaveKernelTable& GetKernelTable(void)
 	{
-		for (unsigned int i=0; i < count; ++i)
-		{
-			const T r = srcR[i];
-			const T g = srcG[i];
-			const T b = srcB[i];
-
-			dest[0] = r;
-			dest[1] = g;
-			dest[2] = b;
-			dest[3] = alpha;
-			dest += 4;
-		}
+		// the tables for all levels are built once up front, so that changing the level never races with running kernels
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
 	}
+}
 
 
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void CopyRemainingPixels(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
-	{
-		for (unsigned int i=0; i < count; ++i)
-		{
-			const T r = srcR[i];
-			const T g = srcG[i];
-			const T b = srcB[i];
-			const T a = srcA[i];
-
-			dest[0] = r;
-			dest[1] = g;
-			dest[2] = b;
-			dest[3] = a;
-			dest += 4;
-		}
-	}
-
-
-#if PSD_USE_SSE
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void InterleaveRGB(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
-	{
-		// do blocks first, and then copy remaining pixels
-		const unsigned int blockCount = InterleaveBlocks(srcR, srcG, srcB, alpha, dest, width, height, blockSize);
-		const unsigned int remaining = width*height - blockCount*blockSize;
-		CopyRemainingPixels(srcR + blockCount*blockSize, srcG + blockCount*blockSize, srcB + blockCount*blockSize, alpha, dest + blockCount*blockSize*4u, remaining);
-	}
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void InterleaveRGBA(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int blockSize)
-	{
-		// do blocks first, and then copy remaining pixels
-		const unsigned int blockCount = InterleaveBlocks(srcR, srcG, srcB, srcA, dest, width, height, blockSize);
-		const unsigned int remaining = width*height - blockCount*blockSize;
-		CopyRemainingPixels(srcR + blockCount*blockSize, srcG + blockCount*blockSize, srcB + blockCount*blockSize, srcA + blockCount*blockSize, dest + blockCount*blockSize*4u, remaining);
-	}
-#else
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void InterleaveRGB(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int /* blockSize */)
-	{
-		// copy pixels
-		const unsigned int count = width * height;
-		CopyRemainingPixels(srcR, srcG, srcB, alpha, dest, count);
-	}
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void InterleaveRGBA(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height, unsigned int /* blockSize */)
-	{
-		// copy pixels
-		const unsigned int count = width * height;
-		CopyRemainingPixels(srcR, srcG, srcB, srcA, dest, count);
-	}
-#endif
-
-
+namespace imageUtil
+{
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, uint8_t alpha, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 16u);
+		GetKernelTable().kernels8.interleaveRGB(srcR, srcG, srcB, alpha, dest, width*height);
 	}
 
 
@@ -272,7 +93,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 16u);
+		GetKernelTable().kernels8.interleaveRGBA(srcR, srcG, srcB, srcA, dest, width*height);
 	}
 
 
@@ -280,7 +101,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, uint16_t alpha, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 8u);
+		GetKernelTable().kernels16.interleaveRGB(srcR, srcG, srcB, alpha, dest, width*height);
 	}
 
 
@@ -288,7 +109,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 8u);
+		GetKernelTable().kernels16.interleaveRGBA(srcR, srcG, srcB, srcA, dest, width*height);
 	}
 
 
@@ -296,7 +117,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGB(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, float32_t alpha, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGB(srcR, srcG, srcB, alpha, dest, width, height, 4u);
+		GetKernelTable().kernels32.interleaveRGB(srcR, srcG, srcB, alpha, dest, width*height);
 	}
 
 
@@ -304,45 +125,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void InterleaveRGBA(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
 	{
-		InterleaveRGBA(srcR, srcG, srcB, srcA, dest, width, height, 4u);
-	}
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void DeinterleaveRGB(const T* PSD_RESTRICT rgb, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, unsigned int count)
-	{
-		for (unsigned int i = 0u; i < count; ++i)
-		{
-			const T r = rgb[i * 3 + 0];
-			const T g = rgb[i * 3 + 1];
-			const T b = rgb[i * 3 + 2];
-
-			destR[i] = r;
-			destG[i] = g;
-			destB[i] = b;
-		}
-	}
-
-
-	// ---------------------------------------------------------------------------------------------------------------------
-	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	void DeinterleaveRGBA(const T* PSD_RESTRICT rgba, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, T* PSD_RESTRICT destA, unsigned int count)
-	{
-		for (unsigned int i = 0u; i < count; ++i)
-		{
-			const T r = rgba[i * 4 + 0];
-			const T g = rgba[i * 4 + 1];
-			const T b = rgba[i * 4 + 2];
-			const T a = rgba[i * 4 + 3];
-
-			destR[i] = r;
-			destG[i] = g;
-			destB[i] = b;
-			destA[i] = a;
-		}
+		GetKernelTable().kernels32.interleaveRGBA(srcR, srcG, srcB, srcA, dest, width*height);
 	}
 
 
@@ -350,8 +133,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGB(const uint8_t* PSD_RESTRICT rgb, uint8_t* PSD_RESTRICT destR, uint8_t* PSD_RESTRICT destG, uint8_t* PSD_RESTRICT destB, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGB(rgb, destR, destG, destB, count);
+		GetKernelTable().kernels8.deinterleaveRGB(rgb, destR, destG, destB, width*height);
 	}
 
 
@@ -359,8 +141,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGBA(const uint8_t* PSD_RESTRICT rgba, uint8_t* PSD_RESTRICT destR, uint8_t* PSD_RESTRICT destG, uint8_t* PSD_RESTRICT destB, uint8_t* PSD_RESTRICT destA, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGBA(rgba, destR, destG, destB, destA, count);
+		GetKernelTable().kernels8.deinterleaveRGBA(rgba, destR, destG, destB, destA, width*height);
 	}
 
 
@@ -368,8 +149,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGB(const uint16_t* PSD_RESTRICT rgb, uint16_t* PSD_RESTRICT destR, uint16_t* PSD_RESTRICT destG, uint16_t* PSD_RESTRICT destB, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGB(rgb, destR, destG, destB, count);
+		GetKernelTable().kernels16.deinterleaveRGB(rgb, destR, destG, destB, width*height);
 	}
 
 
@@ -377,8 +157,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGBA(const uint16_t* PSD_RESTRICT rgba, uint16_t* PSD_RESTRICT destR, uint16_t* PSD_RESTRICT destG, uint16_t* PSD_RESTRICT destB, uint16_t* PSD_RESTRICT destA, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGBA(rgba, destR, destG, destB, destA, count);
+		GetKernelTable().kernels16.deinterleaveRGBA(rgba, destR, destG, destB, destA, width*height);
 	}
 
 
@@ -386,8 +165,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGB(const float32_t* PSD_RESTRICT rgb, float32_t* PSD_RESTRICT destR, float32_t* PSD_RESTRICT destG, float32_t* PSD_RESTRICT destB, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGB(rgb, destR, destG, destB, count);
+		GetKernelTable().kernels32.deinterleaveRGB(rgb, destR, destG, destB, width*height);
 	}
 
 
@@ -395,8 +173,7 @@ namespace imageUtil
 	// ---------------------------------------------------------------------------------------------------------------------
 	void DeinterleaveRGBA(const float32_t* PSD_RESTRICT rgba, float32_t* PSD_RESTRICT destR, float32_t* PSD_RESTRICT destG, float32_t* PSD_RESTRICT destB, float32_t* PSD_RESTRICT destA, unsigned int width, unsigned int height)
 	{
-		const unsigned int count = width*height;
-		DeinterleaveRGBA(rgba, destR, destG, destB, destA, count);
+		GetKernelTable().kernels32.deinterleaveRGBA(rgba, destR, destG, destB, destA, width*height);
 	}
 }
 
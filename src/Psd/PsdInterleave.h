@@ -18,6 +18,7 @@ namespace imageUtil
 	/// Turns planar 8-bit RGBA data into interleaved RGBA data.
 	/// The destination buffer \a dest must hold "width*height*4" bytes.
 	/// \remark All given buffers (both source and destination) must be aligned to 16 bytes.
+	/// \sa InterleaveRGBAPremultiplied
 	void InterleaveRGBA(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
 
 
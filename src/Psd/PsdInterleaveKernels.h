@@ -0,0 +1,136 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief Implementations of the (de)interleaving functions for one pixel type and one \ref simd::Level.
+	/// \details Each kernel works on \a count pixels, and has to deal with pixels that don't fill a whole SIMD register itself.
+	/// \sa InterleaveRGB InterleaveRGBA DeinterleaveRGB DeinterleaveRGBA
+	template <typename T>
+	struct InterleaveKernels
+	{
+		typedef void (*InterleaveRGBFunction)(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count);
+		typedef void (*InterleaveRGBAFunction)(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count);
+		typedef void (*DeinterleaveRGBFunction)(const T* PSD_RESTRICT rgb, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, unsigned int count);
+		typedef void (*DeinterleaveRGBAFunction)(const T* PSD_RESTRICT rgba, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, T* PSD_RESTRICT destA, unsigned int count);
+
+		InterleaveRGBFunction interleaveRGB;
+		InterleaveRGBAFunction interleaveRGBA;
+		DeinterleaveRGBFunction deinterleaveRGB;
+		DeinterleaveRGBAFunction deinterleaveRGBA;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The kernels used for all pixel types at one \ref simd::Level.
+	struct InterleaveKernelTable
+	{
+		InterleaveKernels<uint8_t> kernels8;
+		InterleaveKernels<uint16_t> kernels16;
+		InterleaveKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table that have a dedicated implementation for the given instruction set.
+	/// Tables are built by registering the kernels of all levels up to the wanted level, starting with the lowest.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterInterleaveKernelsSSE2(InterleaveKernelTable* table);
+	void RegisterInterleaveKernelsSSSE3(InterleaveKernelTable* table);
+	void RegisterInterleaveKernelsAVX2(InterleaveKernelTable* table);
+	void RegisterInterleaveKernelsAVX512(InterleaveKernelTable* table);
+	void RegisterInterleaveKernelsNEON(InterleaveKernelTable* table);
+
+
+	// the scalar kernels are also used for the remaining pixels by all SIMD kernels.
+	// they are deliberately given internal linkage: the SIMD kernels are compiled with instruction set flags like -mavx2,
+	// and the linker must never pick such a copy for a translation unit compiled for the baseline instruction set.
+	namespace
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <typename T>
+		void InterleaveRGBScalar(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			for (unsigned int i=0; i < count; ++i)
+			{
+				const T r = srcR[i];
+				const T g = srcG[i];
+				const T b = srcB[i];
+
+				dest[0] = r;
+				dest[1] = g;
+				dest[2] = b;
+				dest[3] = alpha;
+				dest += 4;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <typename T>
+		void InterleaveRGBAScalar(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			for (unsigned int i=0; i < count; ++i)
+			{
+				const T r = srcR[i];
+				const T g = srcG[i];
+				const T b = srcB[i];
+				const T a = srcA[i];
+
+				dest[0] = r;
+				dest[1] = g;
+				dest[2] = b;
+				dest[3] = a;
+				dest += 4;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <typename T>
+		void DeinterleaveRGBScalar(const T* PSD_RESTRICT rgb, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, unsigned int count)
+		{
+			for (unsigned int i = 0u; i < count; ++i)
+			{
+				const T r = rgb[i * 3 + 0];
+				const T g = rgb[i * 3 + 1];
+				const T b = rgb[i * 3 + 2];
+
+				destR[i] = r;
+				destG[i] = g;
+				destB[i] = b;
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <typename T>
+		void DeinterleaveRGBAScalar(const T* PSD_RESTRICT rgba, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, T* PSD_RESTRICT destA, unsigned int count)
+		{
+			for (unsigned int i = 0u; i < count; ++i)
+			{
+				const T r = rgba[i * 4 + 0];
+				const T g = rgba[i * 4 + 1];
+				const T b = rgba[i * 4 + 2];
+				const T a = rgba[i * 4 + 3];
+
+				destR[i] = r;
+				destG[i] = g;
+				destB[i] = b;
+				destA[i] = a;
+			}
+		}
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,190 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInterleaveKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+// splats a single 8-bit, 16-bit or 32-bit value into an AVX2 register
+namespace
+{
+	PSD_INLINE __m256i SplatValue(uint8_t value) { return _mm256_set1_epi8(static_cast<char>(value)); }
+	PSD_INLINE __m256i SplatValue(uint16_t value) { return _mm256_set1_epi16(static_cast<short>(value)); }
+	PSD_INLINE __m256i SplatValue(float32_t value) { return _mm256_castps_si256(_mm256_set1_ps(value)); }
+}
+
+
+// interleaves either 8-bit, 16-bit, 32-bit or 64-bit values from two AVX2 registers, separately for each 128-bit lane
+namespace
+{
+	template <unsigned int N>
+	__m256i InterleaveLo(__m256i a, __m256i b);
+
+	template <> PSD_INLINE __m256i InterleaveLo<1>(__m256i a, __m256i b) { return _mm256_unpacklo_epi8(a, b); }
+	template <> PSD_INLINE __m256i InterleaveLo<2>(__m256i a, __m256i b) { return _mm256_unpacklo_epi16(a, b); }
+	template <> PSD_INLINE __m256i InterleaveLo<4>(__m256i a, __m256i b) { return _mm256_unpacklo_epi32(a, b); }
+	template <> PSD_INLINE __m256i InterleaveLo<8>(__m256i a, __m256i b) { return _mm256_unpacklo_epi64(a, b); }
+
+	template <unsigned int N>
+	__m256i InterleaveHi(__m256i a, __m256i b);
+
+	template <> PSD_INLINE __m256i InterleaveHi<1>(__m256i a, __m256i b) { return _mm256_unpackhi_epi8(a, b); }
+	template <> PSD_INLINE __m256i InterleaveHi<2>(__m256i a, __m256i b) { return _mm256_unpackhi_epi16(a, b); }
+	template <> PSD_INLINE __m256i InterleaveHi<4>(__m256i a, __m256i b) { return _mm256_unpackhi_epi32(a, b); }
+	template <> PSD_INLINE __m256i InterleaveHi<8>(__m256i a, __m256i b) { return _mm256_unpackhi_epi64(a, b); }
+}
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM>
+	PSD_INLINE void Store(void* dest, __m256i value)
+	{
+		if (STREAM)
+		{
+			_mm256_stream_si256(static_cast<__m256i*>(dest), value);
+		}
+		else
+		{
+			_mm256_storeu_si256(static_cast<__m256i*>(dest), value);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	PSD_INLINE void InterleaveAndStore(__m256i vr, __m256i vg, __m256i vb, __m256i va, T* PSD_RESTRICT dest)
+	{
+		const unsigned int blockSize = 32u / sizeof(T);
+
+		// interleave R and G, and B and A
+		const __m256i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
+		const __m256i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
+		const __m256i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
+		const __m256i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
+
+		// interleave RG and BA. the pixels of the lower and upper 128-bit lanes end up in separate registers.
+		const __m256i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m256i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m256i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+		const __m256i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+		// bring the lanes back into pixel order
+		Store<STREAM>(dest, _mm256_permute2x128_si256(rgba_1, rgba_2, 0x20));
+		Store<STREAM>(dest + blockSize*1u, _mm256_permute2x128_si256(rgba_3, rgba_4, 0x20));
+		Store<STREAM>(dest + blockSize*2u, _mm256_permute2x128_si256(rgba_1, rgba_2, 0x31));
+		Store<STREAM>(dest + blockSize*3u, _mm256_permute2x128_si256(rgba_3, rgba_4, 0x31));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 32u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+		const __m256i va = SplatValue(alpha);
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
+		{
+			const __m256i vr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcR));
+			const __m256i vg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcG));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcB));
+			InterleaveAndStore<STREAM>(vr, vg, vb, va, dest);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 32u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		{
+			const __m256i vr = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcR));
+			const __m256i vg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcG));
+			const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcB));
+			const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(srcA));
+			InterleaveAndStore<STREAM>(vr, vg, vb, va, dest);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE bool CanStream(const void* dest)
+	{
+		// non-temporal stores bypass the cache, but need an aligned destination
+		return (reinterpret_cast<size_t>(dest) & 31u) == 0u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int done = CanStream(dest)
+			? InterleaveBlocks<true>(srcR, srcG, srcB, alpha, dest, count)
+			: InterleaveBlocks<false>(srcR, srcG, srcB, alpha, dest, count);
+		_mm_sfence();
+
+		imageUtil::InterleaveRGBScalar(srcR + done, srcG + done, srcB + done, alpha, dest + done*4u, count - done);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBAKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int done = CanStream(dest)
+			? InterleaveBlocks<true>(srcR, srcG, srcB, srcA, dest, count)
+			: InterleaveBlocks<false>(srcR, srcG, srcB, srcA, dest, count);
+		_mm_sfence();
+
+		imageUtil::InterleaveRGBAScalar(srcR + done, srcG + done, srcB + done, srcA + done, dest + done*4u, count - done);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterInterleaveKernelsAVX2(InterleaveKernelTable* table)
+	{
+		table->kernels8.interleaveRGB = &InterleaveRGBKernel<uint8_t>;
+		table->kernels8.interleaveRGBA = &InterleaveRGBAKernel<uint8_t>;
+
+		table->kernels16.interleaveRGB = &InterleaveRGBKernel<uint16_t>;
+		table->kernels16.interleaveRGBA = &InterleaveRGBAKernel<uint16_t>;
+
+		table->kernels32.interleaveRGB = &InterleaveRGBKernel<float32_t>;
+		table->kernels32.interleaveRGBA = &InterleaveRGBAKernel<float32_t>;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
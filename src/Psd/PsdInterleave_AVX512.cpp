@@ -0,0 +1,198 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInterleaveKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+// splats a single 8-bit, 16-bit or 32-bit value into an AVX-512 register
+namespace
+{
+	PSD_INLINE __m512i SplatValue(uint8_t value) { return _mm512_set1_epi8(static_cast<char>(value)); }
+	PSD_INLINE __m512i SplatValue(uint16_t value) { return _mm512_set1_epi16(static_cast<short>(value)); }
+	PSD_INLINE __m512i SplatValue(float32_t value) { return _mm512_castps_si512(_mm512_set1_ps(value)); }
+}
+
+
+// interleaves either 8-bit, 16-bit, 32-bit or 64-bit values from two AVX-512 registers, separately for each 128-bit lane.
+// the 32-bit and 64-bit variants use zero-masking with all lanes enabled, see PsdVector_AVX512.h.
+namespace
+{
+	template <unsigned int N>
+	__m512i InterleaveLo(__m512i a, __m512i b);
+
+	// 8-bit and 16-bit values need AVX-512BW
+	template <> PSD_INLINE __m512i InterleaveLo<1>(__m512i a, __m512i b) { return _mm512_unpacklo_epi8(a, b); }
+	template <> PSD_INLINE __m512i InterleaveLo<2>(__m512i a, __m512i b) { return _mm512_unpacklo_epi16(a, b); }
+	template <> PSD_INLINE __m512i InterleaveLo<4>(__m512i a, __m512i b) { return _mm512_maskz_unpacklo_epi32(0xFFFF, a, b); }
+	template <> PSD_INLINE __m512i InterleaveLo<8>(__m512i a, __m512i b) { return _mm512_maskz_unpacklo_epi64(0xFF, a, b); }
+
+	template <unsigned int N>
+	__m512i InterleaveHi(__m512i a, __m512i b);
+
+	template <> PSD_INLINE __m512i InterleaveHi<1>(__m512i a, __m512i b) { return _mm512_unpackhi_epi8(a, b); }
+	template <> PSD_INLINE __m512i InterleaveHi<2>(__m512i a, __m512i b) { return _mm512_unpackhi_epi16(a, b); }
+	template <> PSD_INLINE __m512i InterleaveHi<4>(__m512i a, __m512i b) { return _mm512_maskz_unpackhi_epi32(0xFFFF, a, b); }
+	template <> PSD_INLINE __m512i InterleaveHi<8>(__m512i a, __m512i b) { return _mm512_maskz_unpackhi_epi64(0xFF, a, b); }
+}
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM>
+	PSD_INLINE void Store(void* dest, __m512i value)
+	{
+		if (STREAM)
+		{
+			_mm512_stream_si512(static_cast<__m512i*>(dest), value);
+		}
+		else
+		{
+			_mm512_storeu_si512(dest, value);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	PSD_INLINE void InterleaveAndStore(__m512i vr, __m512i vg, __m512i vb, __m512i va, T* PSD_RESTRICT dest)
+	{
+		const unsigned int blockSize = 64u / sizeof(T);
+
+		// interleave R and G, and B and A
+		const __m512i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
+		const __m512i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
+		const __m512i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
+		const __m512i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
+
+		// interleave RG and BA. for 8-bit data, each 128-bit lane holds four pixels, with lanes 0-3 of the first register
+		// holding pixels 0-3, 16-19, 32-35 and 48-51, respectively.
+		const __m512i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m512i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+		const __m512i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+		const __m512i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+		// bring the lanes back into pixel order in two steps, by transposing the 4x4 matrix of lanes
+		const __m512i t0 = _mm512_maskz_shuffle_i64x2(0xFF, rgba_1, rgba_2, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m512i t1 = _mm512_maskz_shuffle_i64x2(0xFF, rgba_3, rgba_4, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m512i t2 = _mm512_maskz_shuffle_i64x2(0xFF, rgba_1, rgba_2, _MM_SHUFFLE(3, 1, 3, 1));
+		const __m512i t3 = _mm512_maskz_shuffle_i64x2(0xFF, rgba_3, rgba_4, _MM_SHUFFLE(3, 1, 3, 1));
+
+		Store<STREAM>(dest, _mm512_maskz_shuffle_i64x2(0xFF, t0, t1, _MM_SHUFFLE(2, 0, 2, 0)));
+		Store<STREAM>(dest + blockSize*1u, _mm512_maskz_shuffle_i64x2(0xFF, t2, t3, _MM_SHUFFLE(2, 0, 2, 0)));
+		Store<STREAM>(dest + blockSize*2u, _mm512_maskz_shuffle_i64x2(0xFF, t0, t1, _MM_SHUFFLE(3, 1, 3, 1)));
+		Store<STREAM>(dest + blockSize*3u, _mm512_maskz_shuffle_i64x2(0xFF, t2, t3, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 64u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+		const __m512i va = SplatValue(alpha);
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
+		{
+			const __m512i vr = _mm512_loadu_si512((srcR));
+			const __m512i vg = _mm512_loadu_si512((srcG));
+			const __m512i vb = _mm512_loadu_si512((srcB));
+			InterleaveAndStore<STREAM>(vr, vg, vb, va, dest);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <bool STREAM, typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 64u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		{
+			const __m512i vr = _mm512_loadu_si512((srcR));
+			const __m512i vg = _mm512_loadu_si512((srcG));
+			const __m512i vb = _mm512_loadu_si512((srcB));
+			const __m512i va = _mm512_loadu_si512((srcA));
+			InterleaveAndStore<STREAM>(vr, vg, vb, va, dest);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	PSD_INLINE bool CanStream(const void* dest)
+	{
+		// non-temporal stores bypass the cache, but need an aligned destination
+		return (reinterpret_cast<size_t>(dest) & 63u) == 0u;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int done = CanStream(dest)
+			? InterleaveBlocks<true>(srcR, srcG, srcB, alpha, dest, count)
+			: InterleaveBlocks<false>(srcR, srcG, srcB, alpha, dest, count);
+		_mm_sfence();
+
+		imageUtil::InterleaveRGBScalar(srcR + done, srcG + done, srcB + done, alpha, dest + done*4u, count - done);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBAKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int done = CanStream(dest)
+			? InterleaveBlocks<true>(srcR, srcG, srcB, srcA, dest, count)
+			: InterleaveBlocks<false>(srcR, srcG, srcB, srcA, dest, count);
+		_mm_sfence();
+
+		imageUtil::InterleaveRGBAScalar(srcR + done, srcG + done, srcB + done, srcA + done, dest + done*4u, count - done);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterInterleaveKernelsAVX512(InterleaveKernelTable* table)
+	{
+		table->kernels8.interleaveRGB = &InterleaveRGBKernel<uint8_t>;
+		table->kernels8.interleaveRGBA = &InterleaveRGBAKernel<uint8_t>;
+
+		table->kernels16.interleaveRGB = &InterleaveRGBKernel<uint16_t>;
+		table->kernels16.interleaveRGBA = &InterleaveRGBAKernel<uint16_t>;
+
+		table->kernels32.interleaveRGB = &InterleaveRGBKernel<float32_t>;
+		table->kernels32.interleaveRGBA = &InterleaveRGBAKernel<float32_t>;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
@@ -0,0 +1,264 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInterleaveKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+
+#if PSD_SIMD_NEON
+PSD_NAMESPACE_BEGIN
+
+// NEON has dedicated instructions for loading and storing interleaved structures of 3 and 4 elements
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGB8(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, uint8_t alpha, uint8_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 16u;
+		uint8x16x4_t rgba;
+		rgba.val[3] = vdupq_n_u8(alpha);
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 16u, srcG += 16u, srcB += 16u, dest += 64u)
+		{
+			rgba.val[0] = vld1q_u8(srcR);
+			rgba.val[1] = vld1q_u8(srcG);
+			rgba.val[2] = vld1q_u8(srcB);
+			vst4q_u8(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBScalar(srcR, srcG, srcB, alpha, dest, count - blockCount*16u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGBA8(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 16u;
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 16u, srcG += 16u, srcB += 16u, srcA += 16u, dest += 64u)
+		{
+			uint8x16x4_t rgba;
+			rgba.val[0] = vld1q_u8(srcR);
+			rgba.val[1] = vld1q_u8(srcG);
+			rgba.val[2] = vld1q_u8(srcB);
+			rgba.val[3] = vld1q_u8(srcA);
+			vst4q_u8(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBAScalar(srcR, srcG, srcB, srcA, dest, count - blockCount*16u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGB8(const uint8_t* PSD_RESTRICT rgb, uint8_t* PSD_RESTRICT destR, uint8_t* PSD_RESTRICT destG, uint8_t* PSD_RESTRICT destB, unsigned int count)
+	{
+		const unsigned int blockCount = count / 16u;
+		for (unsigned int i=0; i < blockCount; ++i, rgb += 48u, destR += 16u, destG += 16u, destB += 16u)
+		{
+			const uint8x16x3_t v = vld3q_u8(rgb);
+			vst1q_u8(destR, v.val[0]);
+			vst1q_u8(destG, v.val[1]);
+			vst1q_u8(destB, v.val[2]);
+		}
+
+		imageUtil::DeinterleaveRGBScalar(rgb, destR, destG, destB, count - blockCount*16u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGBA8(const uint8_t* PSD_RESTRICT rgba, uint8_t* PSD_RESTRICT destR, uint8_t* PSD_RESTRICT destG, uint8_t* PSD_RESTRICT destB, uint8_t* PSD_RESTRICT destA, unsigned int count)
+	{
+		const unsigned int blockCount = count / 16u;
+		for (unsigned int i=0; i < blockCount; ++i, rgba += 64u, destR += 16u, destG += 16u, destB += 16u, destA += 16u)
+		{
+			const uint8x16x4_t v = vld4q_u8(rgba);
+			vst1q_u8(destR, v.val[0]);
+			vst1q_u8(destG, v.val[1]);
+			vst1q_u8(destB, v.val[2]);
+			vst1q_u8(destA, v.val[3]);
+		}
+
+		imageUtil::DeinterleaveRGBAScalar(rgba, destR, destG, destB, destA, count - blockCount*16u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGB16(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, uint16_t alpha, uint16_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 8u;
+		uint16x8x4_t rgba;
+		rgba.val[3] = vdupq_n_u16(alpha);
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 8u, srcG += 8u, srcB += 8u, dest += 32u)
+		{
+			rgba.val[0] = vld1q_u16(srcR);
+			rgba.val[1] = vld1q_u16(srcG);
+			rgba.val[2] = vld1q_u16(srcB);
+			vst4q_u16(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBScalar(srcR, srcG, srcB, alpha, dest, count - blockCount*8u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGBA16(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 8u;
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 8u, srcG += 8u, srcB += 8u, srcA += 8u, dest += 32u)
+		{
+			uint16x8x4_t rgba;
+			rgba.val[0] = vld1q_u16(srcR);
+			rgba.val[1] = vld1q_u16(srcG);
+			rgba.val[2] = vld1q_u16(srcB);
+			rgba.val[3] = vld1q_u16(srcA);
+			vst4q_u16(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBAScalar(srcR, srcG, srcB, srcA, dest, count - blockCount*8u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGB16(const uint16_t* PSD_RESTRICT rgb, uint16_t* PSD_RESTRICT destR, uint16_t* PSD_RESTRICT destG, uint16_t* PSD_RESTRICT destB, unsigned int count)
+	{
+		const unsigned int blockCount = count / 8u;
+		for (unsigned int i=0; i < blockCount; ++i, rgb += 24u, destR += 8u, destG += 8u, destB += 8u)
+		{
+			const uint16x8x3_t v = vld3q_u16(rgb);
+			vst1q_u16(destR, v.val[0]);
+			vst1q_u16(destG, v.val[1]);
+			vst1q_u16(destB, v.val[2]);
+		}
+
+		imageUtil::DeinterleaveRGBScalar(rgb, destR, destG, destB, count - blockCount*8u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGBA16(const uint16_t* PSD_RESTRICT rgba, uint16_t* PSD_RESTRICT destR, uint16_t* PSD_RESTRICT destG, uint16_t* PSD_RESTRICT destB, uint16_t* PSD_RESTRICT destA, unsigned int count)
+	{
+		const unsigned int blockCount = count / 8u;
+		for (unsigned int i=0; i < blockCount; ++i, rgba += 32u, destR += 8u, destG += 8u, destB += 8u, destA += 8u)
+		{
+			const uint16x8x4_t v = vld4q_u16(rgba);
+			vst1q_u16(destR, v.val[0]);
+			vst1q_u16(destG, v.val[1]);
+			vst1q_u16(destB, v.val[2]);
+			vst1q_u16(destA, v.val[3]);
+		}
+
+		imageUtil::DeinterleaveRGBAScalar(rgba, destR, destG, destB, destA, count - blockCount*8u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGB32(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, float32_t alpha, float32_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 4u;
+		float32x4x4_t rgba;
+		rgba.val[3] = vdupq_n_f32(alpha);
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 4u, srcG += 4u, srcB += 4u, dest += 16u)
+		{
+			rgba.val[0] = vld1q_f32(srcR);
+			rgba.val[1] = vld1q_f32(srcG);
+			rgba.val[2] = vld1q_f32(srcB);
+			vst4q_f32(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBScalar(srcR, srcG, srcB, alpha, dest, count - blockCount*4u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InterleaveRGBA32(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockCount = count / 4u;
+		for (unsigned int i=0; i < blockCount; ++i, srcR += 4u, srcG += 4u, srcB += 4u, srcA += 4u, dest += 16u)
+		{
+			float32x4x4_t rgba;
+			rgba.val[0] = vld1q_f32(srcR);
+			rgba.val[1] = vld1q_f32(srcG);
+			rgba.val[2] = vld1q_f32(srcB);
+			rgba.val[3] = vld1q_f32(srcA);
+			vst4q_f32(dest, rgba);
+		}
+
+		imageUtil::InterleaveRGBAScalar(srcR, srcG, srcB, srcA, dest, count - blockCount*4u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGB32(const float32_t* PSD_RESTRICT rgb, float32_t* PSD_RESTRICT destR, float32_t* PSD_RESTRICT destG, float32_t* PSD_RESTRICT destB, unsigned int count)
+	{
+		const unsigned int blockCount = count / 4u;
+		for (unsigned int i=0; i < blockCount; ++i, rgb += 12u, destR += 4u, destG += 4u, destB += 4u)
+		{
+			const float32x4x3_t v = vld3q_f32(rgb);
+			vst1q_f32(destR, v.val[0]);
+			vst1q_f32(destG, v.val[1]);
+			vst1q_f32(destB, v.val[2]);
+		}
+
+		imageUtil::DeinterleaveRGBScalar(rgb, destR, destG, destB, count - blockCount*4u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGBA32(const float32_t* PSD_RESTRICT rgba, float32_t* PSD_RESTRICT destR, float32_t* PSD_RESTRICT destG, float32_t* PSD_RESTRICT destB, float32_t* PSD_RESTRICT destA, unsigned int count)
+	{
+		const unsigned int blockCount = count / 4u;
+		for (unsigned int i=0; i < blockCount; ++i, rgba += 16u, destR += 4u, destG += 4u, destB += 4u, destA += 4u)
+		{
+			const float32x4x4_t v = vld4q_f32(rgba);
+			vst1q_f32(destR, v.val[0]);
+			vst1q_f32(destG, v.val[1]);
+			vst1q_f32(destB, v.val[2]);
+			vst1q_f32(destA, v.val[3]);
+		}
+
+		imageUtil::DeinterleaveRGBAScalar(rgba, destR, destG, destB, destA, count - blockCount*4u);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterInterleaveKernelsNEON(InterleaveKernelTable* table)
+	{
+		table->kernels8.interleaveRGB = &InterleaveRGB8;
+		table->kernels8.interleaveRGBA = &InterleaveRGBA8;
+		table->kernels8.deinterleaveRGB = &DeinterleaveRGB8;
+		table->kernels8.deinterleaveRGBA = &DeinterleaveRGBA8;
+
+		table->kernels16.interleaveRGB = &InterleaveRGB16;
+		table->kernels16.interleaveRGBA = &InterleaveRGBA16;
+		table->kernels16.deinterleaveRGB = &DeinterleaveRGB16;
+		table->kernels16.deinterleaveRGBA = &DeinterleaveRGBA16;
+
+		table->kernels32.interleaveRGB = &InterleaveRGB32;
+		table->kernels32.interleaveRGBA = &InterleaveRGBA32;
+		table->kernels32.deinterleaveRGB = &DeinterleaveRGB32;
+		table->kernels32.deinterleaveRGBA = &DeinterleaveRGBA32;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
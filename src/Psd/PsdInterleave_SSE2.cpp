@@ -0,0 +1,231 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInterleaveKernels.h"
+
+#include "PsdSimd.h"
+#include "PsdUnionCast.h"
+
+#if PSD_SIMD_X86
+	#include <emmintrin.h>
+#endif
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+// splats a single 8-bit, 16-bit or 32-bit value into a SSE2 register
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	__m128i SplatValue(T value);
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	__m128i SplatValue<uint8_t>(uint8_t value)
+	{
+		return _mm_set1_epi8(util::union_cast<char>(value));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	__m128i SplatValue<uint16_t>(uint16_t value)
+	{
+		return _mm_set1_epi16(util::union_cast<short>(value));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <>
+	__m128i SplatValue<float32_t>(float32_t value)
+	{
+		return _mm_castps_si128(_mm_set_ps1(value));
+	}
+}
+
+
+// interleaves either 8-bit, 16-bit, 32-bit or 64-bit values from two SSE2 registers
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <unsigned int N>
+	__m128i InterleaveLo(__m128i a, __m128i b);
+
+	template <> __m128i InterleaveLo<1>(__m128i a, __m128i b) { return _mm_unpacklo_epi8(a, b); }
+	template <> __m128i InterleaveLo<2>(__m128i a, __m128i b) { return _mm_unpacklo_epi16(a, b); }
+	template <> __m128i InterleaveLo<4>(__m128i a, __m128i b) { return _mm_unpacklo_epi32(a, b); }
+	template <> __m128i InterleaveLo<8>(__m128i a, __m128i b) { return _mm_unpacklo_epi64(a, b); }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <unsigned int N>
+	__m128i InterleaveHi(__m128i a, __m128i b);
+
+	template <> __m128i InterleaveHi<1>(__m128i a, __m128i b) { return _mm_unpackhi_epi8(a, b); }
+	template <> __m128i InterleaveHi<2>(__m128i a, __m128i b) { return _mm_unpackhi_epi16(a, b); }
+	template <> __m128i InterleaveHi<4>(__m128i a, __m128i b) { return _mm_unpackhi_epi32(a, b); }
+	template <> __m128i InterleaveHi<8>(__m128i a, __m128i b) { return _mm_unpackhi_epi64(a, b); }
+}
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 16u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+		const __m128i va = SplatValue(alpha);
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, dest += blockSize*4u)
+		{
+			// load pixels from R, G, B
+			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
+			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
+			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
+
+			// interleave R and G
+			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
+			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
+
+			// interleave B and A
+			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
+			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
+
+			// interleave RG and BA
+			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+			// store to memory non-temporal, bypassing cache
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	unsigned int InterleaveBlocks(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		const unsigned int blockSize = 16u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i, srcR += blockSize, srcG += blockSize, srcB += blockSize, srcA += blockSize, dest += blockSize*4u)
+		{
+			// load pixels from R, G, B, and A
+			const __m128i vr = _mm_load_si128(reinterpret_cast<const __m128i*>(srcR));
+			const __m128i vg = _mm_load_si128(reinterpret_cast<const __m128i*>(srcG));
+			const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(srcB));
+			const __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(srcA));
+
+			// interleave R and G
+			const __m128i rg_interleaved_lo = InterleaveLo<sizeof(T)>(vr, vg);
+			const __m128i rg_interleaved_hi = InterleaveHi<sizeof(T)>(vr, vg);
+
+			// interleave B and A
+			const __m128i ba_interleaved_lo = InterleaveLo<sizeof(T)>(vb, va);
+			const __m128i ba_interleaved_hi = InterleaveHi<sizeof(T)>(vb, va);
+
+			// interleave RG and BA
+			const __m128i rgba_1 = InterleaveLo<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+			const __m128i rgba_2 = InterleaveHi<sizeof(T)*2>(rg_interleaved_lo, ba_interleaved_lo);
+			const __m128i rgba_3 = InterleaveLo<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+			const __m128i rgba_4 = InterleaveHi<sizeof(T)*2>(rg_interleaved_hi, ba_interleaved_hi);
+
+			// store to memory non-temporal, bypassing cache
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest), rgba_1);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*1u), rgba_2);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*2u), rgba_3);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + blockSize*3u), rgba_4);
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, T alpha, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		// do blocks first, and then copy remaining pixels
+		const unsigned int done = InterleaveBlocks(srcR, srcG, srcB, alpha, dest, count);
+		imageUtil::InterleaveRGBScalar(srcR + done, srcG + done, srcB + done, alpha, dest + done*4u, count - done);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void InterleaveRGBAKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+	{
+		// do blocks first, and then copy remaining pixels
+		const unsigned int done = InterleaveBlocks(srcR, srcG, srcB, srcA, dest, count);
+		imageUtil::InterleaveRGBAScalar(srcR + done, srcG + done, srcB + done, srcA + done, dest + done*4u, count - done);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DeinterleaveRGBAKernel(const float32_t* PSD_RESTRICT rgba, float32_t* PSD_RESTRICT destR, float32_t* PSD_RESTRICT destG, float32_t* PSD_RESTRICT destB, float32_t* PSD_RESTRICT destA, unsigned int count)
+	{
+		// four 32-bit RGBA pixels fill four registers, which turn into R, G, B and A by transposing them
+		const unsigned int blockCount = count / 4u;
+		for (unsigned int i=0; i < blockCount; ++i, rgba += 16u, destR += 4u, destG += 4u, destB += 4u, destA += 4u)
+		{
+			__m128 v0 = _mm_load_ps(rgba);
+			__m128 v1 = _mm_load_ps(rgba + 4u);
+			__m128 v2 = _mm_load_ps(rgba + 8u);
+			__m128 v3 = _mm_load_ps(rgba + 12u);
+			_MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+			_mm_store_ps(destR, v0);
+			_mm_store_ps(destG, v1);
+			_mm_store_ps(destB, v2);
+			_mm_store_ps(destA, v3);
+		}
+
+		imageUtil::DeinterleaveRGBAScalar(rgba, destR, destG, destB, destA, count - blockCount*4u);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterInterleaveKernelsSSE2(InterleaveKernelTable* table)
+	{
+		table->kernels8.interleaveRGB = &InterleaveRGBKernel<uint8_t>;
+		table->kernels8.interleaveRGBA = &InterleaveRGBAKernel<uint8_t>;
+
+		table->kernels16.interleaveRGB = &InterleaveRGBKernel<uint16_t>;
+		table->kernels16.interleaveRGBA = &InterleaveRGBAKernel<uint16_t>;
+
+		table->kernels32.interleaveRGB = &InterleaveRGBKernel<float32_t>;
+		table->kernels32.interleaveRGBA = &InterleaveRGBAKernel<float32_t>;
+		table->kernels32.deinterleaveRGBA = &DeinterleaveRGBAKernel;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
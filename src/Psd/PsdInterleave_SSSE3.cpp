@@ -0,0 +1,125 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdInterleaveKernels.h"
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <tmmintrin.h>
+#endif
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// masks for gathering all values of one channel from the CHANNELS registers that hold a block of interleaved pixels
+	template <unsigned int CHANNELS, typename T>
+	struct ShuffleMasks
+	{
+		ShuffleMasks(void)
+		{
+			// byte j of the destination register holds byte (j % sizeof(T)) of pixel (j / sizeof(T)). source bytes that live
+			// in a different register are set to 0x80, which makes the shuffle output zero.
+			for (unsigned int channel=0; channel < CHANNELS; ++channel)
+			{
+				for (unsigned int reg=0; reg < CHANNELS; ++reg)
+				{
+					int8_t bytes[16];
+					for (unsigned int j=0; j < 16u; ++j)
+					{
+						const unsigned int pixel = j / sizeof(T);
+						const unsigned int byte = j % sizeof(T);
+						const int source = static_cast<int>((pixel*CHANNELS + channel)*sizeof(T) + byte) - static_cast<int>(reg*16u);
+						bytes[j] = ((source >= 0) && (source < 16)) ? static_cast<int8_t>(source) : static_cast<int8_t>(-128);
+					}
+
+					masks[channel][reg] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+				}
+			}
+		}
+
+		__m128i masks[CHANNELS][CHANNELS];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <unsigned int CHANNELS, typename T>
+	unsigned int DeinterleaveBlocks(const T* PSD_RESTRICT src, T* const* dest, unsigned int count)
+	{
+		static const ShuffleMasks<CHANNELS, T> shuffleMasks;
+
+		// each block consists of CHANNELS registers of interleaved data, and yields one register per channel
+		const unsigned int blockSize = 16u / sizeof(T);
+		const unsigned int blockCount = count / blockSize;
+
+		for (unsigned int i=0; i < blockCount; ++i)
+		{
+			__m128i v[CHANNELS];
+			for (unsigned int reg=0; reg < CHANNELS; ++reg)
+			{
+				v[reg] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + i*CHANNELS + reg);
+			}
+
+			for (unsigned int channel=0; channel < CHANNELS; ++channel)
+			{
+				__m128i result = _mm_shuffle_epi8(v[0], shuffleMasks.masks[channel][0]);
+				for (unsigned int reg=1; reg < CHANNELS; ++reg)
+				{
+					result = _mm_or_si128(result, _mm_shuffle_epi8(v[reg], shuffleMasks.masks[channel][reg]));
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest[channel] + i*blockSize), result);
+			}
+		}
+
+		return blockCount*blockSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void DeinterleaveRGBKernel(const T* PSD_RESTRICT rgb, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, unsigned int count)
+	{
+		T* const dest[3] = { destR, destG, destB };
+		const unsigned int done = DeinterleaveBlocks<3u>(rgb, dest, count);
+		imageUtil::DeinterleaveRGBScalar(rgb + done*3u, destR + done, destG + done, destB + done, count - done);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	void DeinterleaveRGBAKernel(const T* PSD_RESTRICT rgba, T* PSD_RESTRICT destR, T* PSD_RESTRICT destG, T* PSD_RESTRICT destB, T* PSD_RESTRICT destA, unsigned int count)
+	{
+		T* const dest[4] = { destR, destG, destB, destA };
+		const unsigned int done = DeinterleaveBlocks<4u>(rgba, dest, count);
+		imageUtil::DeinterleaveRGBAScalar(rgba + done*4u, destR + done, destG + done, destB + done, destA + done, count - done);
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterInterleaveKernelsSSSE3(InterleaveKernelTable* table)
+	{
+		table->kernels8.deinterleaveRGB = &DeinterleaveRGBKernel<uint8_t>;
+		table->kernels8.deinterleaveRGBA = &DeinterleaveRGBAKernel<uint8_t>;
+
+		table->kernels16.deinterleaveRGB = &DeinterleaveRGBKernel<uint16_t>;
+		table->kernels16.deinterleaveRGBA = &DeinterleaveRGBAKernel<uint16_t>;
+
+		// 32-bit RGBA is better off with the SSE2 transpose
+		table->kernels32.deinterleaveRGB = &DeinterleaveRGBKernel<float32_t>;
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
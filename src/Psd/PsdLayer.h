@@ -6,6 +6,7 @@
 #include <memory>
 
 #include "PsdFixedSizeString.h"
+#include "PsdLevelsRecord.h"
 
 PSD_NAMESPACE_BEGIN
 	struct Channel;
@@ -37,7 +38,7 @@ struct Layer
 
 	uint32_t blendModeKey;					///< The key denoting the layer's blend mode. Can be any key described in \ref blendMode::Enum.
 	uint8_t opacity;						///< The layer's opacity value, with the range [0, 255] mapped to [0%, 100%].
-	uint8_t clipping;						///< The layer's clipping mode (not used yet).
+	uint8_t clipping;						///< The layer's clipping mode. A non-zero value clips the layer to the closest non-clipped layer below it.
 
 	uint32_t type;							///< The layer's type. Can be any of \ref layerType::Enum.
 	bool isVisible;							///< The layer's visibility.
@@ -52,8 +53,12 @@ struct Layer
 
 	bool hasGradientFill;					///< If the layer has adjustment layer GradientFill
 	bool hasBrightnessContrast;				///< If the layer has adjustment layer Brightness/Contrast
+	bool isBrightnessContrastLegacy;		///< If the Brightness/Contrast adjustment uses the legacy algorithm.
 	uint32_t brightness;					///< The layer's brightness from adjustment layer.
 	uint32_t contrast;						///< The layer's contrast from adjustment layer.
+
+	bool hasLevels;							///< If the layer has adjustment layer Levels.
+	LevelsRecord levels[4];					///< The layer's levels of the composite, red, green and blue channel from adjustment layer.
 };
 
 PSD_NAMESPACE_END
@@ -0,0 +1,36 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class ChannelRegion
+/// \brief A struct representing the data of a channel inside a rectangular region, as extracted by \ref ExtractLayerRegion.
+/// \details The region is clipped against the bounds of the channel, which are the bounds of the layer for color channels
+/// and the transparency mask, and the bounds of the mask for layer and vector masks. The clipped region is stored in canvas coordinates.
+/// \sa LayerRegion
+struct ChannelRegion
+{
+	int32_t top;						///< Top coordinate of the clipped region.
+	int32_t left;						///< Left coordinate of the clipped region.
+	int32_t bottom;						///< Bottom coordinate of the clipped region.
+	int32_t right;						///< Right coordinate of the clipped region.
+	void* data;							///< Planar data the size of the clipped region, or a nullptr if the region doesn't overlap the channel.
+	int16_t type;						///< One of the \ref channelType constants denoting the type of data.
+};
+
+
+/// \ingroup Types
+/// \class LayerRegion
+/// \brief A struct representing the data of all channels of a layer inside a rectangular region.
+/// \sa ChannelRegion
+struct LayerRegion
+{
+	ChannelRegion* channels;			///< An array of channel regions, one for each channel of the layer, having channelCount entries.
+	unsigned int channelCount;			///< The number of channel regions stored in the array.
+};
+
+PSD_NAMESPACE_END
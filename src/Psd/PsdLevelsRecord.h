@@ -0,0 +1,24 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \class LevelsRecord
+/// \brief A struct representing the levels of one channel as stored in a Levels adjustment layer.
+/// \details Input values between the input floor and ceiling are stretched to the full range, bent by the gamma, and then
+/// mapped to the range between the output floor and ceiling. All values except the gamma are in the range [0, 255].
+/// \sa Layer
+struct LevelsRecord
+{
+	uint16_t inputFloor;					///< The input value that is mapped to the output floor.
+	uint16_t inputCeiling;					///< The input value that is mapped to the output ceiling.
+	uint16_t outputFloor;					///< The lowest output value.
+	uint16_t outputCeiling;					///< The highest output value.
+	uint16_t gamma;							///< The gamma multiplied by 100, in the range [10, 999].
+};
+
+PSD_NAMESPACE_END
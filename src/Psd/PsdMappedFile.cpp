@@ -0,0 +1,420 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdMappedFile.h"
+
+#include "PsdAllocator.h"
+#include "PsdPlatform.h"
+#include "PsdAssert.h"
+#include "PsdLog.h"
+
+#include <filesystem>
+#include <cstring>
+#include <cerrno>
+
+#if PSD_USE_MSVC
+	// Windows.h has already been pulled in by PsdPlatform.h
+#else
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <sys/resource.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// read operations on a mapped file finish immediately, so there is no need to allocate anything per operation.
+	// the returned operation simply tells WaitForRead() whether the read succeeded.
+	static char g_readSucceeded = 0;
+	static char g_readFailed = 0;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void GetPageFaults(uint64_t& minorFaults, uint64_t& majorFaults)
+	{
+#if PSD_USE_MSVC
+		minorFaults = 0ull;
+		majorFaults = 0ull;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+		{
+			minorFaults = static_cast<uint64_t>(usage.ru_minflt);
+			majorFaults = static_cast<uint64_t>(usage.ru_majflt);
+		}
+		else
+		{
+			minorFaults = 0ull;
+			majorFaults = 0ull;
+		}
+#endif
+	}
+
+
+#if !PSD_USE_MSVC
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t GetPageSize(void)
+	{
+		return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+MappedFile::MappedFile(Allocator* allocator, AccessPattern::Enum accessPattern)
+	: File(allocator)
+	, m_data(nullptr)
+	, m_size(0ull)
+	, m_accessPattern(accessPattern)
+	, m_readCount(0ull)
+	, m_bytesRead(0ull)
+	, m_mapCount(0ull)
+	, m_bytesMapped(0ull)
+	, m_prefetchCount(0ull)
+	, m_bytesPrefetched(0ull)
+	, m_minorPageFaultsAtOpen(0ull)
+	, m_majorPageFaultsAtOpen(0ull)
+{
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+MappedFile::~MappedFile(void)
+{
+	DoClose();
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void MappedFile::SetAccessPattern(AccessPattern::Enum accessPattern)
+{
+	m_accessPattern = accessPattern;
+	ApplyAccessPattern();
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::Prefetch(uint64_t position, uint64_t count)
+{
+	if (!m_data || (position >= m_size))
+		return false;
+
+	if (count > m_size - position)
+		count = m_size - position;
+
+	++m_prefetchCount;
+	m_bytesPrefetched += count;
+
+#if PSD_USE_MSVC
+	// PrefetchVirtualMemory() is not available on all supported versions of Windows, the OS readahead has to do.
+	return false;
+#else
+	// the address handed to posix_madvise() must be page-aligned
+	const uint64_t pageSize = GetPageSize();
+	const uint64_t alignedPosition = position & ~(pageSize - 1ull);
+	const int result = posix_madvise(const_cast<uint8_t*>(m_data) + alignedPosition, static_cast<size_t>(count + (position - alignedPosition)), POSIX_MADV_WILLNEED);
+	if (result != 0)
+	{
+		PSD_ERROR("MappedFile", "posix_madvise() failed: %s", strerror(result));
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t MappedFile::GetResidentSize(void) const
+{
+	if (!m_data)
+		return 0ull;
+
+#if PSD_USE_MSVC
+	return 0ull;
+#else
+	const uint64_t pageSize = GetPageSize();
+	const size_t pageCount = static_cast<size_t>((m_size + pageSize - 1ull) / pageSize);
+
+#	if defined(__APPLE__)
+	char* residency = static_cast<char*>(m_allocator->Allocate(pageCount, 16u));
+#	else
+	unsigned char* residency = static_cast<unsigned char*>(m_allocator->Allocate(pageCount, 16u));
+#	endif
+
+	uint64_t residentSize = 0ull;
+	if (mincore(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size), residency) == 0)
+	{
+		for (size_t i=0; i < pageCount; ++i)
+		{
+			if (residency[i] & 1)
+				residentSize += pageSize;
+		}
+	}
+	else
+	{
+		PSD_ERROR("MappedFile", "mincore() failed: %s", strerror(errno));
+	}
+
+	m_allocator->Free(residency);
+
+	// the last page might only be partially used by the file
+	return (residentSize > m_size) ? m_size : residentSize;
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+MappedFile::Statistics MappedFile::GetStatistics(void) const
+{
+	Statistics statistics = {};
+	statistics.readCount = m_readCount;
+	statistics.bytesRead = m_bytesRead;
+	statistics.mapCount = m_mapCount;
+	statistics.bytesMapped = m_bytesMapped;
+	statistics.prefetchCount = m_prefetchCount;
+	statistics.bytesPrefetched = m_bytesPrefetched;
+
+	uint64_t minorFaults = 0ull;
+	uint64_t majorFaults = 0ull;
+	GetPageFaults(minorFaults, majorFaults);
+	statistics.minorPageFaults = minorFaults - m_minorPageFaultsAtOpen;
+	statistics.majorPageFaults = majorFaults - m_majorPageFaultsAtOpen;
+
+	return statistics;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoOpenRead(const wchar_t* filename)
+{
+	DoClose();
+
+	const std::filesystem::path path(filename);
+
+#if PSD_USE_MSVC
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		PSD_ERROR("MappedFile", "Cannot obtain handle for file \"%ls\".", filename);
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(file, &size))
+	{
+		PSD_ERROR("MappedFile", "Cannot determine size of file \"%ls\".", filename);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_size = static_cast<uint64_t>(size.QuadPart);
+	if (m_size != 0ull)
+	{
+		// the view keeps the mapping and the file alive, so both handles can be closed right away
+		const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			CloseHandle(mapping);
+		}
+
+		if (!m_data)
+		{
+			PSD_ERROR("MappedFile", "Cannot map file \"%ls\" into memory.", filename);
+			CloseHandle(file);
+			m_size = 0ull;
+			return false;
+		}
+	}
+
+	CloseHandle(file);
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		PSD_ERROR("MappedFile", "open(%s) failed: %s", path.c_str(), strerror(errno));
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(fd, &status) == -1)
+	{
+		PSD_ERROR("MappedFile", "fstat(%s) failed: %s", path.c_str(), strerror(errno));
+		close(fd);
+		return false;
+	}
+
+	m_size = static_cast<uint64_t>(status.st_size);
+	if (m_size != 0ull)
+	{
+		// the mapping keeps the file alive, so the descriptor can be closed right away
+		void* data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			PSD_ERROR("MappedFile", "mmap(%s) failed: %s", path.c_str(), strerror(errno));
+			close(fd);
+			m_size = 0ull;
+			return false;
+		}
+
+		m_data = static_cast<const uint8_t*>(data);
+	}
+
+	close(fd);
+#endif
+
+	ApplyAccessPattern();
+
+	m_readCount = 0ull;
+	m_bytesRead = 0ull;
+	m_mapCount = 0ull;
+	m_bytesMapped = 0ull;
+	m_prefetchCount = 0ull;
+	m_bytesPrefetched = 0ull;
+	GetPageFaults(m_minorPageFaultsAtOpen, m_majorPageFaultsAtOpen);
+
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoOpenWrite(const wchar_t* filename)
+{
+	PSD_ERROR("MappedFile", "Cannot open file \"%ls\" for writing, memory-mapped files are read-only.", filename);
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoClose(void)
+{
+	bool success = true;
+	if (m_data)
+	{
+#if PSD_USE_MSVC
+		success = (UnmapViewOfFile(m_data) != 0);
+#else
+		success = (munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size)) == 0);
+#endif
+	}
+
+	m_data = nullptr;
+	m_size = 0ull;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::ReadOperation MappedFile::DoRead(void* buffer, uint32_t count, uint64_t position)
+{
+	++m_readCount;
+
+	if ((position > m_size) || (count > m_size - position))
+	{
+		PSD_ERROR("MappedFile", "Cannot read %u bytes at position %llu, file is only %llu bytes large.", count, static_cast<unsigned long long>(position), static_cast<unsigned long long>(m_size));
+		return &g_readFailed;
+	}
+
+	memcpy(buffer, m_data + position, count);
+	m_bytesRead += count;
+
+	return &g_readSucceeded;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoWaitForRead(File::ReadOperation& operation)
+{
+	const bool success = (operation == &g_readSucceeded);
+	operation = nullptr;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::WriteOperation MappedFile::DoWrite(const void*, uint32_t, uint64_t)
+{
+	PSD_ERROR("MappedFile", "Memory-mapped files are read-only.");
+	return nullptr;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool MappedFile::DoWaitForWrite(File::WriteOperation&)
+{
+	return false;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t MappedFile::DoGetSize(void) const
+{
+	return m_size;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* MappedFile::DoMap(uint64_t position, uint64_t count)
+{
+	if (!m_data || (position > m_size) || (count > m_size - position))
+		return nullptr;
+
+	++m_mapCount;
+	m_bytesMapped += count;
+
+	return m_data + position;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void MappedFile::ApplyAccessPattern(void)
+{
+	if (!m_data)
+		return;
+
+#if PSD_USE_MSVC
+	// Windows has no equivalent to madvise() for file mappings, the hint is ignored.
+#else
+	int advice = POSIX_MADV_NORMAL;
+	if (m_accessPattern == AccessPattern::SEQUENTIAL)
+		advice = POSIX_MADV_SEQUENTIAL;
+	else if (m_accessPattern == AccessPattern::RANDOM)
+		advice = POSIX_MADV_RANDOM;
+
+	const int result = posix_madvise(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size), advice);
+	if (result != 0)
+	{
+		PSD_ERROR("MappedFile", "posix_madvise() failed: %s", strerror(result));
+	}
+#endif
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,95 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdFile.h"
+#include <atomic>
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Files
+/// \brief File implementation that maps the whole file into memory for read-only access.
+/// \details Instead of seeking and reading through an OS file handle for every request, the file is mapped into the address space
+/// once when being opened. Reads are served by copying from the mapping, and Map() hands out pointers directly into the mapping,
+/// which allows the parser to decompress channel data without allocating a staging buffer first.
+/// \remark Memory-mapped files can only be read. Calls to OpenWrite() will always fail.
+/// \sa File NativeFile
+class MappedFile : public File
+{
+public:
+	/// \brief Hints passed to the OS about how the mapped file is going to be accessed.
+	struct AccessPattern
+	{
+		enum Enum
+		{
+			NORMAL,							///< No special treatment, the OS applies its default readahead.
+			SEQUENTIAL,						///< Pages are accessed in ascending order, aggressive readahead is beneficial.
+			RANDOM							///< Pages are accessed in random order, readahead should be disabled.
+		};
+	};
+
+	/// \brief Statistics gathered since the file has been opened.
+	struct Statistics
+	{
+		uint64_t readCount;					///< Number of calls to Read().
+		uint64_t bytesRead;					///< Number of bytes copied out of the mapping by calls to Read().
+		uint64_t mapCount;					///< Number of calls to Map() that returned a pointer into the mapping.
+		uint64_t bytesMapped;				///< Number of bytes handed out by calls to Map(), without being copied.
+		uint64_t prefetchCount;				///< Number of calls to Prefetch().
+		uint64_t bytesPrefetched;			///< Number of bytes requested to be paged in by calls to Prefetch().
+		uint64_t minorPageFaults;			///< Number of page faults that did not require I/O. Process-wide, not available on all platforms.
+		uint64_t majorPageFaults;			///< Number of page faults that required I/O. Process-wide, not available on all platforms.
+	};
+
+	/// Constructor.
+	MappedFile(Allocator* allocator, AccessPattern::Enum accessPattern);
+
+	/// Closes the file if it is still open.
+	virtual ~MappedFile(void);
+
+	/// Changes the access pattern hint. Takes effect immediately if the file is open, and is otherwise applied by the next call to OpenRead().
+	void SetAccessPattern(AccessPattern::Enum accessPattern);
+
+	/// Asks the OS to asynchronously page in \a count bytes starting at \a position, and returns whether the request was issued.
+	bool Prefetch(uint64_t position, uint64_t count);
+
+	/// Returns the number of bytes of the mapping that currently reside in physical memory, or 0 if this is not supported by the platform.
+	uint64_t GetResidentSize(void) const;
+
+	/// Returns the statistics gathered since the file has been opened.
+	Statistics GetStatistics(void) const;
+
+private:
+	virtual bool DoOpenRead(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoOpenWrite(const wchar_t* filename) PSD_OVERRIDE;
+	virtual bool DoClose(void) PSD_OVERRIDE;
+
+	virtual File::ReadOperation DoRead(void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForRead(File::ReadOperation& operation) PSD_OVERRIDE;
+
+	virtual File::WriteOperation DoWrite(const void* buffer, uint32_t count, uint64_t position) PSD_OVERRIDE;
+	virtual bool DoWaitForWrite(File::WriteOperation& operation) PSD_OVERRIDE;
+
+	virtual uint64_t DoGetSize(void) const PSD_OVERRIDE;
+
+	virtual const void* DoMap(uint64_t position, uint64_t count) PSD_OVERRIDE;
+
+	void ApplyAccessPattern(void);
+
+	const uint8_t* m_data;
+	uint64_t m_size;
+	AccessPattern::Enum m_accessPattern;
+
+	std::atomic<uint64_t> m_readCount;
+	std::atomic<uint64_t> m_bytesRead;
+	std::atomic<uint64_t> m_mapCount;
+	std::atomic<uint64_t> m_bytesMapped;
+	std::atomic<uint64_t> m_prefetchCount;
+	std::atomic<uint64_t> m_bytesPrefetched;
+	uint64_t m_minorPageFaultsAtOpen;
+	uint64_t m_majorPageFaultsAtOpen;
+};
+
+PSD_NAMESPACE_END
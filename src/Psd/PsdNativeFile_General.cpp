@@ -21,11 +21,20 @@
 
 PSD_NAMESPACE_BEGIN
 
-// Structure to hold the result of a synchronous operation
+// Operations complete synchronously, so instead of allocating a result per operation we hand out
+// the address of one of two static results.
 struct SyncOperationResult {
 	bool success;
 };
 
+static SyncOperationResult g_operationSucceeded = { true };
+static SyncOperationResult g_operationFailed = { false };
+
+static SyncOperationResult* GetOperationResult(bool success)
+{
+	return success ? &g_operationSucceeded : &g_operationFailed;
+}
+
 NativeFile::NativeFile(Allocator* allocator)
     : File(allocator)
 {
@@ -69,9 +78,9 @@ bool NativeFile::DoClose(void)
 
 File::ReadOperation NativeFile::DoRead(void* buffer, uint32_t count, uint64_t position)
 {
-	SyncOperationResult* result = nullptr;
 	bool success = false;
 
+	std::lock_guard<std::mutex> lock(m_mutex);
 	if (m_fileStream.is_open() && buffer != nullptr) {
 		// Clear potential past errors (like EOF) before seeking/reading
 		m_fileStream.clear();
@@ -91,13 +100,7 @@ File::ReadOperation NativeFile::DoRead(void* buffer, uint32_t count, uint64_t po
 		}
 	}
 
-	try {
-		result = new SyncOperationResult{success};
-	} catch (const std::bad_alloc&) {
-		return nullptr;
-	}
-
-	return static_cast<File::ReadOperation>(result);
+	return static_cast<File::ReadOperation>(GetOperationResult(success));
 }
 
 bool NativeFile::DoWaitForRead(ReadOperation& operation)
@@ -108,9 +111,8 @@ bool NativeFile::DoWaitForRead(ReadOperation& operation)
 
 	SyncOperationResult* result = static_cast<SyncOperationResult*>(operation);
 
-	// Retrieve the success status and clean up allocated operation
+	// Retrieve the success status; results are static and must not be freed
 	bool success = result->success;
-	delete result;
 	operation = nullptr;
 
 	return success;
@@ -118,19 +120,17 @@ bool NativeFile::DoWaitForRead(ReadOperation& operation)
 
 File::WriteOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uint64_t position)
 {
-	SyncOperationResult* result = nullptr;
 	bool success = false;
 
 	if (!m_fileStream.is_open() && m_fileStream.bad()) {
-		try { result = new SyncOperationResult{false}; } catch (...) { return nullptr; }
-		return static_cast<WriteOperation>(result);
+		return static_cast<WriteOperation>(GetOperationResult(false));
 	}
 
 	if (buffer == nullptr) {
-		try { result = new SyncOperationResult{false}; } catch (...) { return nullptr; }
-		return static_cast<WriteOperation>(result);
+		return static_cast<WriteOperation>(GetOperationResult(false));
 	}
 
+	std::lock_guard<std::mutex> lock(m_mutex);
 	m_fileStream.clear(); // Clear potential past errors
 	m_fileStream.seekp(static_cast<std::fstream::pos_type>(position));
 
@@ -141,13 +141,7 @@ File::WriteOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uin
 		success = !m_fileStream.fail() && !m_fileStream.bad();
 	}
 
-	try {
-		result = new SyncOperationResult{success};
-	} catch (const std::bad_alloc&) {
-		return nullptr;
-	}
-
-	return static_cast<File::WriteOperation>(result);
+	return static_cast<File::WriteOperation>(GetOperationResult(success));
 }
 
 bool NativeFile::DoWaitForWrite(WriteOperation& operation)
@@ -158,9 +152,8 @@ bool NativeFile::DoWaitForWrite(WriteOperation& operation)
 
 	SyncOperationResult* result = static_cast<SyncOperationResult*>(operation);
 
-	// Retrieve the success status and clean up allocated operation
+	// Retrieve the success status; results are static and must not be freed
 	bool success = result->success;
-	delete result;
 	operation = nullptr;
 
 	return success;
@@ -168,6 +161,8 @@ bool NativeFile::DoWaitForWrite(WriteOperation& operation)
 
 uint64_t NativeFile::DoGetSize(void) const
 {
+	std::lock_guard<std::mutex> lock(m_mutex);
+
 	if (!m_fileStream.is_open() || !m_fileStream.good()) {
 		// Don't attempt if stream isn't open or in a usable state
 		return 0;
@@ -5,6 +5,7 @@
 
 #include "PsdFile.h"
 #include <fstream>
+#include <mutex>
 
 PSD_NAMESPACE_BEGIN
 
@@ -34,6 +35,9 @@ private:
 	// Use std::fstream for cross-platform file I/O
 	// mutable because DoGetSize is const but needs to modify seek position
 	mutable std::fstream m_fileStream;
+
+	// seeking and reading/writing must happen atomically when the file is shared between threads
+	mutable std::mutex m_mutex;
 };
 
 PSD_NAMESPACE_END
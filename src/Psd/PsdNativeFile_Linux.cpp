@@ -1,166 +1,779 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
 
 #include "PsdPch.h"
+#include "PsdNativeFile_Linux.h"
 
-#include "PsdLog.h"
-#include "PsdFile.h"
 #include "PsdAllocator.h"
-#include "PsdNamespace.h"
 #include "PsdMemoryUtil.h"
-#include "PsdStringUtil.h"
-#include "PsdNativeFile_Linux.h"
+#include "PsdAssert.h"
+#include "PsdLog.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <aio.h>
 
+#include <cerrno>
 #include <cstring>
-#include <cstdlib>
-#include <cwchar>
-#include <string>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
 
+// io_uring is used directly through its system calls, so the only build requirement is a recent set of kernel headers
+#if defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		include <linux/io_uring.h>
+#	endif
+#endif
+
+#if defined(IORING_OFF_SQ_RING) && defined(__NR_io_uring_setup)
+#	define PSD_NATIVE_FILE_HAS_IO_URING 1
+#else
+#	define PSD_NATIVE_FILE_HAS_IO_URING 0
+#endif
+
+
+PSD_NAMESPACE_BEGIN
 
 namespace
 {
-	//Wait for R/W
-	namespace _Psd = PSD_NAMESPACE_NAME;
-	static bool generic_wait(aiocb *operation,_Psd::Allocator *alloc){
-		//Wait for it
-		if(aio_suspend(&operation,1,nullptr) == -1)
+	// number of operations that can be in flight per file
+	static const unsigned int QUEUE_DEPTH = 64u;
+
+	// number of buffers that can be registered per file
+	static const unsigned int MAX_REGISTERED_BUFFERS = 64u;
+
+
+	// an asynchronous read or write operation, handed out to the user as ReadOperation/WriteOperation
+	struct Operation
+	{
+		aiocb aio;							// only used by the POSIX AIO backend
+		void* buffer;
+		uint64_t position;
+		uint32_t count;
+		int32_t result;						// number of bytes transferred or a negative error code, set by the io_uring backend
+		bool isWrite;
+		bool isComplete;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool WaitForAio(Operation* operation)
+	{
+		const aiocb* list[1] = { &operation->aio };
+		while (aio_suspend(list, 1, nullptr) == -1)
 		{
-			PSD_ERROR("NativeFile","aio_suspend() => %s",strerror(errno));
-			_Psd::memoryUtil::Free(alloc,operation);
+			if (errno != EINTR)
+			{
+				PSD_ERROR("NativeFile", "aio_suspend() failed: %s", strerror(errno));
+				return false;
+			}
+		}
+
+		const int error = aio_error(&operation->aio);
+		const ssize_t result = aio_return(&operation->aio);
+		if (result == -1)
+		{
+			PSD_ERROR("NativeFile", "Asynchronous operation failed: %s", strerror(error));
 			return false;
 		}
-		//Get status
-		ssize_t ret = aio_return(operation);
-		int errcode = aio_error(operation);
 
-		if(ret == -1)
+		return true;
+	}
+}
+
+
+#if PSD_NATIVE_FILE_HAS_IO_URING
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+struct NativeFile::IoUring
+{
+	int fd;
+
+	void* sqRing;
+	size_t sqRingSize;
+	void* cqRing;
+	size_t cqRingSize;
+	io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	unsigned int* sqHead;
+	unsigned int* sqTail;
+	unsigned int* sqArray;
+	unsigned int sqMask;
+	unsigned int sqEntryCount;
+
+	unsigned int* cqHead;
+	unsigned int* cqTail;
+	io_uring_cqe* cqes;
+	unsigned int cqMask;
+
+	// operations that have been submitted, but not reaped yet
+	unsigned int inFlightCount;
+
+	// only one thread at a time waits for completions, all others wait for the condition to be signaled
+	bool isReaping;
+	std::mutex mutex;
+	std::condition_variable condition;
+
+	const uint8_t* registeredBuffers[MAX_REGISTERED_BUFFERS];
+	uint32_t registeredSizes[MAX_REGISTERED_BUFFERS];
+	unsigned int registeredCount;
+};
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int IoUringSetup(unsigned int entryCount, io_uring_params* params)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_setup, entryCount, params));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int IoUringEnter(int fd, unsigned int submitCount, unsigned int minCompleteCount, unsigned int flags)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_enter, fd, submitCount, minCompleteCount, flags, nullptr, 0));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int IoUringRegister(int fd, unsigned int opcode, const void* arg, unsigned int argCount)
+	{
+		return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, argCount));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T* RingPointer(void* ring, uint32_t offset)
+	{
+		return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool SupportsReadWrite(int fd)
+	{
+		// IORING_OP_READ and IORING_OP_WRITE were introduced with Linux 5.6, the same version that introduced probing.
+		// older kernels reject the probe, and are treated as not supporting io_uring at all.
+		uint8_t storage[sizeof(io_uring_probe) + IORING_OP_LAST*sizeof(io_uring_probe_op)] = {};
+		io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage);
+
+		if (IoUringRegister(fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0)
+			return false;
+
+		if (probe->last_op < IORING_OP_WRITE)
+			return false;
+
+		return ((probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) != 0) &&
+			((probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) != 0) &&
+			((probe->ops[IORING_OP_READ_FIXED].flags & IO_URING_OP_SUPPORTED) != 0);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyRingMappings(NativeFile::IoUring* ring)
+	{
+		if (ring->sqes)
+			munmap(ring->sqes, ring->sqesSize);
+
+		if (ring->cqRing && (ring->cqRing != ring->sqRing))
+			munmap(ring->cqRing, ring->cqRingSize);
+
+		if (ring->sqRing)
+			munmap(ring->sqRing, ring->sqRingSize);
+
+		if (ring->fd != -1)
+			close(ring->fd);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static NativeFile::IoUring* CreateRing(Allocator* allocator)
+	{
+		io_uring_params params = {};
+		const int fd = IoUringSetup(QUEUE_DEPTH, &params);
+		if (fd < 0)
+		{
+			// ENOSYS: the kernel is too old, EPERM: io_uring has been disabled via kernel.io_uring_disabled
+			return nullptr;
+		}
+
+		NativeFile::IoUring* ring = memoryUtil::Allocate<NativeFile::IoUring>(allocator);
+		ring->fd = fd;
+		ring->sqRing = nullptr;
+		ring->cqRing = nullptr;
+		ring->sqes = nullptr;
+		ring->inFlightCount = 0u;
+		ring->isReaping = false;
+		ring->registeredCount = 0u;
+
+		if (!SupportsReadWrite(fd))
+		{
+			DestroyRingMappings(ring);
+			memoryUtil::Free(allocator, ring);
+			return nullptr;
+		}
+
+		// map the submission and completion queue rings. newer kernels allow mapping both with a single call.
+		ring->sqRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+		ring->cqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			if (ring->cqRingSize > ring->sqRingSize)
+				ring->sqRingSize = ring->cqRingSize;
+			ring->cqRingSize = ring->sqRingSize;
+		}
+
+		void* sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+		if (sqRing == MAP_FAILED)
 		{
-			PSD_ERROR("NativeFile","aio_error() %d => %s",errcode,strerror(errcode));
+			PSD_ERROR("NativeFile", "Cannot map io_uring submission queue: %s", strerror(errno));
+			DestroyRingMappings(ring);
+			memoryUtil::Free(allocator, ring);
+			return nullptr;
 		}
-		_Psd::memoryUtil::Free(alloc,operation);
-		return ret != -1;
+		ring->sqRing = sqRing;
+
+		if (params.features & IORING_FEAT_SINGLE_MMAP)
+		{
+			ring->cqRing = sqRing;
+		}
+		else
+		{
+			void* cqRing = mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED)
+			{
+				PSD_ERROR("NativeFile", "Cannot map io_uring completion queue: %s", strerror(errno));
+				DestroyRingMappings(ring);
+				memoryUtil::Free(allocator, ring);
+				return nullptr;
+			}
+			ring->cqRing = cqRing;
+		}
+
+		ring->sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+		void* sqes = mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED)
+		{
+			PSD_ERROR("NativeFile", "Cannot map io_uring submission queue entries: %s", strerror(errno));
+			DestroyRingMappings(ring);
+			memoryUtil::Free(allocator, ring);
+			return nullptr;
+		}
+		ring->sqes = static_cast<io_uring_sqe*>(sqes);
+
+		ring->sqHead = RingPointer<unsigned int>(ring->sqRing, params.sq_off.head);
+		ring->sqTail = RingPointer<unsigned int>(ring->sqRing, params.sq_off.tail);
+		ring->sqArray = RingPointer<unsigned int>(ring->sqRing, params.sq_off.array);
+		ring->sqMask = *RingPointer<unsigned int>(ring->sqRing, params.sq_off.ring_mask);
+		ring->sqEntryCount = params.sq_entries;
+
+		ring->cqHead = RingPointer<unsigned int>(ring->cqRing, params.cq_off.head);
+		ring->cqTail = RingPointer<unsigned int>(ring->cqRing, params.cq_off.tail);
+		ring->cqes = RingPointer<io_uring_cqe>(ring->cqRing, params.cq_off.cqes);
+		ring->cqMask = *RingPointer<unsigned int>(ring->cqRing, params.cq_off.ring_mask);
+
+		return ring;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void DestroyRing(NativeFile::IoUring*& ring, Allocator* allocator)
+	{
+		DestroyRingMappings(ring);
+		memoryUtil::Free(allocator, ring);
+		ring = nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ReapCompletions(NativeFile::IoUring* ring)
+	{
+		// must be called with the ring's mutex held
+		unsigned int head = *ring->cqHead;
+		const unsigned int tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+		while (head != tail)
+		{
+			const io_uring_cqe& cqe = ring->cqes[head & ring->cqMask];
+			Operation* operation = reinterpret_cast<Operation*>(static_cast<uintptr_t>(cqe.user_data));
+			operation->result = cqe.res;
+			operation->isComplete = true;
+
+			--ring->inFlightCount;
+			++head;
+		}
+
+		__atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void WaitForCompletions(NativeFile::IoUring* ring, std::unique_lock<std::mutex>& lock)
+	{
+		// waits until at least one more operation has completed, or another thread reaped completions on our behalf
+		if (ring->isReaping)
+		{
+			ring->condition.wait(lock);
+			return;
+		}
+
+		ring->isReaping = true;
+		lock.unlock();
+
+		int result = 0;
+		do
+		{
+			result = IoUringEnter(ring->fd, 0u, 1u, IORING_ENTER_GETEVENTS);
+		}
+		while ((result < 0) && (errno == EINTR));
+
+		if (result < 0)
+		{
+			PSD_ERROR("NativeFile", "io_uring_enter() failed: %s", strerror(errno));
+		}
+
+		lock.lock();
+		ReapCompletions(ring);
+		ring->isReaping = false;
+		ring->condition.notify_all();
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool Submit(NativeFile::IoUring* ring, int fd, Operation* operation)
+	{
+		std::unique_lock<std::mutex> lock(ring->mutex);
+
+		// make room for the new operation first if the queue is full
+		while (ring->inFlightCount >= ring->sqEntryCount)
+		{
+			ReapCompletions(ring);
+			if (ring->inFlightCount >= ring->sqEntryCount)
+			{
+				WaitForCompletions(ring, lock);
+			}
+		}
+
+		const unsigned int tail = *ring->sqTail;
+		const unsigned int index = tail & ring->sqMask;
+		io_uring_sqe* sqe = &ring->sqes[index];
+		memset(sqe, 0, sizeof(io_uring_sqe));
+
+		sqe->opcode = operation->isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+		sqe->fd = fd;
+		sqe->off = operation->position;
+		sqe->addr = reinterpret_cast<uintptr_t>(operation->buffer);
+		sqe->len = operation->count;
+		sqe->user_data = reinterpret_cast<uintptr_t>(operation);
+
+		// reads into a registered buffer don't need the kernel to pin the buffer's pages for each operation
+		if (!operation->isWrite)
+		{
+			const uint8_t* start = static_cast<const uint8_t*>(operation->buffer);
+			for (unsigned int i=0; i < ring->registeredCount; ++i)
+			{
+				const uint8_t* registeredStart = ring->registeredBuffers[i];
+				if ((start >= registeredStart) && (start + operation->count <= registeredStart + ring->registeredSizes[i]))
+				{
+					sqe->opcode = IORING_OP_READ_FIXED;
+					sqe->buf_index = static_cast<uint16_t>(i);
+					break;
+				}
+			}
+		}
+
+		ring->sqArray[index] = index;
+		__atomic_store_n(ring->sqTail, tail + 1u, __ATOMIC_RELEASE);
+
+		int result = 0;
+		do
+		{
+			result = IoUringEnter(ring->fd, 1u, 0u, 0u);
+		}
+		while ((result < 0) && (errno == EINTR));
+
+		if (result != 1)
+		{
+			// the kernel did not consume the entry, take it back
+			PSD_ERROR("NativeFile", "io_uring_enter() failed to submit operation: %s", strerror(errno));
+			__atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+			return false;
+		}
+
+		++ring->inFlightCount;
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool Wait(NativeFile::IoUring* ring, int fd, Operation* operation)
+	{
+		{
+			std::unique_lock<std::mutex> lock(ring->mutex);
+			while (!operation->isComplete)
+			{
+				ReapCompletions(ring);
+				if (!operation->isComplete)
+				{
+					WaitForCompletions(ring, lock);
+				}
+			}
+		}
+
+		if (operation->result < 0)
+		{
+			PSD_ERROR("NativeFile", "Asynchronous operation failed: %s", strerror(-operation->result));
+			return false;
+		}
+
+		// regular files only transfer less than requested when hitting the end of the file, or when interrupted.
+		// finish the remainder synchronously.
+		uint32_t done = static_cast<uint32_t>(operation->result);
+		while (done < operation->count)
+		{
+			uint8_t* buffer = static_cast<uint8_t*>(operation->buffer) + done;
+			const off_t position = static_cast<off_t>(operation->position + done);
+			const ssize_t result = operation->isWrite
+				? pwrite(fd, buffer, operation->count - done, position)
+				: pread(fd, buffer, operation->count - done, position);
+
+			if (result < 0)
+			{
+				if (errno == EINTR)
+					continue;
+
+				PSD_ERROR("NativeFile", "Finishing short transfer failed: %s", strerror(errno));
+				return false;
+			}
+			else if (result == 0)
+			{
+				// end of file
+				break;
+			}
+
+			done += static_cast<uint32_t>(result);
+		}
+
+		return true;
 	}
 }
 
+#else
 
-PSD_NAMESPACE_BEGIN
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+struct NativeFile::IoUring
+{
+};
+
+#endif
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+NativeFile::NativeFile(Allocator* allocator)
+	: File(allocator)
+	, m_fd(-1)
+	, m_ring(nullptr)
+{
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	m_ring = CreateRing(allocator);
+#endif
+}
 
-NativeFile::NativeFile(Allocator *alloc):
-	File(alloc),
-	m_fd(-1)
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+NativeFile::~NativeFile(void)
 {
+	DoClose();
 
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	if (m_ring)
+	{
+		DestroyRing(m_ring, m_allocator);
+	}
+#endif
 }
 
-//Convert wchar to char and open
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+NativeFile::Backend::Enum NativeFile::GetBackend(void) const
+{
+	return m_ring ? Backend::IO_URING : Backend::POSIX_AIO;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool NativeFile::RegisterBuffers(void* const* buffers, const uint32_t* sizes, unsigned int count)
+{
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	if (!m_ring)
+		return false;
+
+	PSD_ASSERT(m_ring->inFlightCount == 0u, "Buffers cannot be registered while operations are in flight.");
+	UnregisterBuffers();
+
+	if (count > MAX_REGISTERED_BUFFERS)
+	{
+		PSD_ERROR("NativeFile", "Cannot register %u buffers, the maximum is %u.", count, MAX_REGISTERED_BUFFERS);
+		return false;
+	}
+
+	iovec vectors[MAX_REGISTERED_BUFFERS];
+	for (unsigned int i=0; i < count; ++i)
+	{
+		vectors[i].iov_base = buffers[i];
+		vectors[i].iov_len = sizes[i];
+	}
+
+	if (IoUringRegister(m_ring->fd, IORING_REGISTER_BUFFERS, vectors, count) < 0)
+	{
+		PSD_ERROR("NativeFile", "Cannot register buffers: %s", strerror(errno));
+		return false;
+	}
+
+	for (unsigned int i=0; i < count; ++i)
+	{
+		m_ring->registeredBuffers[i] = static_cast<const uint8_t*>(buffers[i]);
+		m_ring->registeredSizes[i] = sizes[i];
+	}
+	m_ring->registeredCount = count;
+
+	return true;
+#else
+	PSD_UNUSED(buffers);
+	PSD_UNUSED(sizes);
+	PSD_UNUSED(count);
+	return false;
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void NativeFile::UnregisterBuffers(void)
+{
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	if (m_ring && (m_ring->registeredCount != 0u))
+	{
+		IoUringRegister(m_ring->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0u);
+		m_ring->registeredCount = 0u;
+	}
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
 bool NativeFile::DoOpenRead(const wchar_t* filename)
 {
-	char *name = stringUtil::ConvertWString(filename,m_allocator);
-	m_fd = open(name,O_RDONLY);
-	if(m_fd == -1)
+	DoClose();
+
+	const std::filesystem::path path(filename);
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd == -1)
 	{
-		PSD_ERROR("NativeFile","open(%s) => %s",name,strerror(errno));
-		m_allocator->Free(name);
+		PSD_ERROR("NativeFile", "open(%s) failed: %s", path.c_str(), strerror(errno));
 		return false;
 	}
-	m_allocator->Free(name);
+
 	return true;
 }
-bool NativeFile::DoOpenWrite(const wchar_t* filename){
-	char *name = stringUtil::ConvertWString(filename,m_allocator);
-	//Create a new file
-	m_fd = open(name,O_WRONLY | O_CREAT,S_IRUSR | S_IWUSR);
-	if(m_fd == -1)
-	{
-		PSD_ERROR("NativeFile","open(%s) => %s",name,strerror(errno));
-		m_allocator->Free(name);
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool NativeFile::DoOpenWrite(const wchar_t* filename)
+{
+	DoClose();
+
+	const std::filesystem::path path(filename);
+	m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (m_fd == -1)
+	{
+		PSD_ERROR("NativeFile", "open(%s) failed: %s", path.c_str(), strerror(errno));
 		return false;
 	}
-	m_allocator->Free(name);
+
 	return true;
 }
-bool NativeFile::DoClose()
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool NativeFile::DoClose(void)
 {
-	int ret = close(m_fd);
+	if (m_fd == -1)
+		return true;
+
+	const int result = close(m_fd);
 	m_fd = -1;
-	return ret == 0;
+
+	return (result == 0);
 }
 
-//Wrtie / Read
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
 File::ReadOperation NativeFile::DoRead(void* buffer, uint32_t count, uint64_t position)
 {
-	aiocb *operation = memoryUtil::Allocate<aiocb>(m_allocator);
-	std::memset(operation,0,sizeof(aiocb));
+	Operation* operation = memoryUtil::Allocate<Operation>(m_allocator);
+	memset(operation, 0, sizeof(Operation));
+	operation->buffer = buffer;
+	operation->position = position;
+	operation->count = count;
+	operation->isWrite = false;
+
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	if (m_ring)
+	{
+		if (!Submit(m_ring, m_fd, operation))
+		{
+			memoryUtil::Free(m_allocator, operation);
+			return nullptr;
+		}
+
+		return operation;
+	}
+#endif
 
-	operation->aio_buf = buffer;
-	operation->aio_fildes = m_fd;
-	operation->aio_lio_opcode = LIO_READ;//Do read
-	operation->aio_nbytes = count;
-	operation->aio_offset = position;
-	operation->aio_reqprio = 0;
-	operation->aio_sigevent.sigev_notify = SIGEV_NONE;//No signal will be send 
+	operation->aio.aio_fildes = m_fd;
+	operation->aio.aio_buf = buffer;
+	operation->aio.aio_nbytes = count;
+	operation->aio.aio_offset = static_cast<off_t>(position);
+	operation->aio.aio_sigevent.sigev_notify = SIGEV_NONE;
 
-	//OK Execute it
-	if(aio_read(operation) == -1)
+	if (aio_read(&operation->aio) == -1)
 	{
-		//Has Error
-		PSD_ERROR("NativeFile","On DoRead aio_read(m_fd:%d) => %s",m_fd,strerror(errno));
-		memoryUtil::Free(m_allocator,operation);
+		PSD_ERROR("NativeFile", "aio_read() failed: %s", strerror(errno));
+		memoryUtil::Free(m_allocator, operation);
 		return nullptr;
 	}
+
 	return operation;
 }
-File::ReadOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uint64_t position)
-{
-	aiocb *operation = memoryUtil::Allocate<aiocb>(m_allocator);
-	std::memset(operation,0,sizeof(aiocb));
-	
-	operation->aio_buf = const_cast<void*>(buffer);
-	operation->aio_fildes = m_fd;
-	operation->aio_lio_opcode = LIO_WRITE;//Do Write
-	operation->aio_nbytes = count;
-	operation->aio_offset = position;
-	operation->aio_reqprio = 0;
-	operation->aio_sigevent.sigev_notify = SIGEV_NONE;//No signal will be send 
-
-	//OK Execute it
-	if(aio_write(operation) == -1)
-	{
-		//Has Error
-		PSD_ERROR("NativeFile","On DoWrite aio_write(m_fd:%d) => %s",m_fd,strerror(errno));
-		memoryUtil::Free(m_allocator,operation);
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool NativeFile::DoWaitForRead(File::ReadOperation& readOperation)
+{
+	Operation* operation = static_cast<Operation*>(readOperation);
+	if (!operation)
+		return false;
+
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	const bool success = m_ring ? Wait(m_ring, m_fd, operation) : WaitForAio(operation);
+#else
+	const bool success = WaitForAio(operation);
+#endif
+
+	memoryUtil::Free(m_allocator, operation);
+	readOperation = nullptr;
+
+	return success;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+File::WriteOperation NativeFile::DoWrite(const void* buffer, uint32_t count, uint64_t position)
+{
+	Operation* operation = memoryUtil::Allocate<Operation>(m_allocator);
+	memset(operation, 0, sizeof(Operation));
+	operation->buffer = const_cast<void*>(buffer);
+	operation->position = position;
+	operation->count = count;
+	operation->isWrite = true;
+
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	if (m_ring)
+	{
+		if (!Submit(m_ring, m_fd, operation))
+		{
+			memoryUtil::Free(m_allocator, operation);
+			return nullptr;
+		}
+
+		return operation;
+	}
+#endif
+
+	operation->aio.aio_fildes = m_fd;
+	operation->aio.aio_buf = const_cast<void*>(buffer);
+	operation->aio.aio_nbytes = count;
+	operation->aio.aio_offset = static_cast<off_t>(position);
+	operation->aio.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+	if (aio_write(&operation->aio) == -1)
+	{
+		PSD_ERROR("NativeFile", "aio_write() failed: %s", strerror(errno));
+		memoryUtil::Free(m_allocator, operation);
 		return nullptr;
 	}
+
 	return operation;
 }
 
 
-bool NativeFile::DoWaitForRead(ReadOperation &_operation)
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool NativeFile::DoWaitForWrite(File::WriteOperation& writeOperation)
 {
-	aiocb *operation = static_cast<aiocb*>(_operation);
-	return generic_wait(operation,m_allocator);
-}
-bool NativeFile::DoWaitForWrite(ReadOperation &_operation)
-{
-	aiocb *operation = static_cast<aiocb*>(_operation);
-	return generic_wait(operation,m_allocator);
+	Operation* operation = static_cast<Operation*>(writeOperation);
+	if (!operation)
+		return false;
+
+#if PSD_NATIVE_FILE_HAS_IO_URING
+	const bool success = m_ring ? Wait(m_ring, m_fd, operation) : WaitForAio(operation);
+#else
+	const bool success = WaitForAio(operation);
+#endif
+
+	memoryUtil::Free(m_allocator, operation);
+	writeOperation = nullptr;
+
+	return success;
 }
 
 
-uint64_t NativeFile::DoGetSize() const
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t NativeFile::DoGetSize(void) const
 {
-	struct stat s;
-	if(fstat(m_fd,&s) == -1){
-		PSD_ERROR("NativeFile","fstat(%d) => %s",m_fd,strerror(errno));
-		//Emm,return 0 on error
-		return 0;
+	struct stat status;
+	if (fstat(m_fd, &status) == -1)
+	{
+		PSD_ERROR("NativeFile", "fstat() failed: %s", strerror(errno));
+		return 0ull;
 	}
-	return s.st_size;
+
+	return static_cast<uint64_t>(status.st_size);
 }
 
 PSD_NAMESPACE_END
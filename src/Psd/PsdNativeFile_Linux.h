@@ -1,22 +1,56 @@
-//Linux 
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
 #pragma once
 
-#include "PsdPch.h"
-#include "PsdAllocator.h"
 #include "PsdFile.h"
-#include "PsdNamespace.h"
+
 
 PSD_NAMESPACE_BEGIN
 
 /// \ingroup Files
-/// \brief Simple file implementation that uses Posix asio internally.
+/// \brief File implementation using truly asynchronous I/O on Linux.
+/// \details Reads and writes are queued to an io_uring instance owned by the file, so that a caller issuing reads for
+/// e.g. all channels of a layer up front gets overlapped I/O. Buffers that are used over and over again can be registered
+/// with the kernel by calling RegisterBuffers(), which saves the kernel from mapping them for each operation.
+/// If the running kernel does not support io_uring (or it has been disabled by the administrator), the implementation
+/// falls back to POSIX AIO.
 /// \sa File
 class NativeFile : public File
 {
 public:
+	/// \brief The asynchronous I/O mechanism used by a file.
+	struct Backend
+	{
+		enum Enum
+		{
+			IO_URING,						///< Operations are queued to an io_uring instance.
+			POSIX_AIO						///< Operations are issued using POSIX AIO.
+		};
+	};
+
 	/// Constructor.
 	explicit NativeFile(Allocator* allocator);
 
+	/// Closes the file if it is still open, and tears down the io_uring instance.
+	virtual ~NativeFile(void);
+
+	/// Returns the mechanism that is used for asynchronous operations.
+	Backend::Enum GetBackend(void) const;
+
+	/// Registers \a count buffers with the kernel. Reads into any of these buffers (or parts thereof) don't need to map the
+	/// buffer's pages for every operation. Previously registered buffers are unregistered first.
+	/// Returns whether the buffers could be registered. Always fails when not using the io_uring backend.
+	/// \remark No operation must be in flight when calling this method.
+	bool RegisterBuffers(void* const* buffers, const uint32_t* sizes, unsigned int count);
+
+	/// Unregisters all buffers registered by a previous call to RegisterBuffers().
+	/// \remark No operation must be in flight when calling this method.
+	void UnregisterBuffers(void);
+
+	/// Opaque state of the io_uring instance owned by the file.
+	struct IoUring;
+
 private:
 	virtual bool DoOpenRead(const wchar_t* filename) PSD_OVERRIDE;
 	virtual bool DoOpenWrite(const wchar_t* filename) PSD_OVERRIDE;
@@ -29,10 +63,9 @@ private:
 	virtual bool DoWaitForWrite(File::WriteOperation& operation) PSD_OVERRIDE;
 
 	virtual uint64_t DoGetSize(void) const PSD_OVERRIDE;
-	
+
 	int m_fd;
+	IoUring* m_ring;
 };
 
-
 PSD_NAMESPACE_END
-
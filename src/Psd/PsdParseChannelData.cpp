@@ -0,0 +1,101 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdParseChannelData.h"
+
+#include "PsdSyncFileReader.h"
+#include "PsdEndianConversion.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAllocator.h"
+#include "PsdLog.h"
+#include "Psdinttypes.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+bool GetPlanarDataSize(unsigned int width, unsigned int height, unsigned int bytesPerValue, uint32_t& size)
+{
+	// PSB documents can be up to 300,000 pixels on a side, hence a single channel can easily exceed 4 GB
+	const uint64_t size64 = static_cast<uint64_t>(width) * height * bytesPerValue;
+	if (size64 > 0xFFFFFFFFull)
+	{
+		PSD_ERROR("PsdParse", "Planar data of %" PRIu64 " bytes (%ux%u) exceeds 4 GB, which is not supported.", size64, width, height);
+		size = 0u;
+		return false;
+	}
+
+	size = static_cast<uint32_t>(size64);
+	return true;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* AcquireCompressedData(SyncFileReader& reader, Allocator* allocator, uint32_t size, void*& stagingData)
+{
+	// files that are mapped into memory hand out their data directly, so there is no need to copy it into a staging buffer
+	stagingData = nullptr;
+	const void* data = reader.Map(size);
+	if (data)
+		return data;
+
+	stagingData = allocator->Allocate(size, 4u);
+	reader.Read(stagingData, size);
+
+	return stagingData;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ReleaseCompressedData(Allocator* allocator, void* stagingData)
+{
+	if (stagingData)
+		allocator->Free(stagingData);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint32_t ReadRleRowOffsets(SyncFileReader& reader, Allocator* allocator, unsigned int rowCount, unsigned int dataCountSize, uint32_t* rowOffsets)
+{
+	// the RLE-compressed data is preceded by a data count for each scan line, which is 2 bytes wide in .PSD files and
+	// 4 bytes wide in .PSB files. the counts are turned into offsets to the start of each row, with the last of the
+	// rowCount+1 offsets holding the size of the whole RLE data.
+	uint64_t offset = 0u;
+	if (rowCount > 0u)
+	{
+		// the array is large enough to hold either kind of data count
+		uint32_t* dataCounts = memoryUtil::AllocateArray<uint32_t>(allocator, rowCount);
+		reader.Read(dataCounts, rowCount*dataCountSize);
+
+		for (unsigned int i=0; i < rowCount; ++i)
+		{
+			rowOffsets[i] = static_cast<uint32_t>(offset);
+			offset += (dataCountSize == sizeof(uint32_t))
+				? endianUtil::BigEndianToNative(dataCounts[i])
+				: endianUtil::BigEndianToNative(reinterpret_cast<const uint16_t*>(dataCounts)[i]);
+
+			if (offset > 0xFFFFFFFFull)
+			{
+				// the remaining rows are treated as being empty, which makes decompressing them fail
+				PSD_ERROR("PsdParse", "RLE data of a single channel exceeds 4 GB, which is not supported.");
+				offset = rowOffsets[i];
+				for (++i; i < rowCount; ++i)
+				{
+					rowOffsets[i] = static_cast<uint32_t>(offset);
+				}
+			}
+		}
+
+		memoryUtil::FreeArray(allocator, dataCounts);
+	}
+
+	rowOffsets[rowCount] = static_cast<uint32_t>(offset);
+	return static_cast<uint32_t>(offset);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,37 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+class SyncFileReader;
+class Allocator;
+
+
+/// \ingroup Parser
+/// Computes the size in bytes of planar data holding \a width x \a height values of \a bytesPerValue bytes each, which is
+/// stored in \a size. The size is computed using 64-bit arithmetic, so that even the largest PSB documents don't wrap around.
+/// \return \b false if the data exceeds 4 GB, which is the largest planar data supported. An error is logged in that case.
+bool GetPlanarDataSize(unsigned int width, unsigned int height, unsigned int bytesPerValue, uint32_t& size);
+
+/// \ingroup Parser
+/// Returns \a size bytes of compressed data at the current position of \a reader. Memory-mapped files hand out their data
+/// directly, all other files are read into a staging buffer that is returned in \a stagingData.
+/// \remark Internal helper shared by \ref ParseImageDataSection and the layer extraction functions.
+/// \sa ReleaseCompressedData
+const void* AcquireCompressedData(SyncFileReader& reader, Allocator* allocator, uint32_t size, void*& stagingData);
+
+/// \ingroup Parser
+/// Frees the \a stagingData returned by \ref AcquireCompressedData, if any.
+void ReleaseCompressedData(Allocator* allocator, void* stagingData);
+
+/// \ingroup Parser
+/// Reads the data counts of \a rowCount RLE-compressed scan lines, which are \a dataCountSize bytes wide, and turns them into
+/// offsets to the start of each row. \a rowOffsets must hold \a rowCount + 1 entries, the last one receiving the size of the
+/// whole RLE data, which is also returned.
+/// \remark RLE data larger than 4 GB is not supported. The rows beyond that limit are treated as being empty.
+uint32_t ReadRleRowOffsets(SyncFileReader& reader, Allocator* allocator, unsigned int rowCount, unsigned int dataCountSize, uint32_t* rowOffsets);
+
+PSD_NAMESPACE_END
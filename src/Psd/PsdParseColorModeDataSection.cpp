@@ -35,9 +35,11 @@ ColorModeDataSection* ParseColorModeDataSection(const Document* document, File*
 	SyncFileReader reader(file);
 	reader.SetPosition(document->colorModeDataSection.offset);
 
-	colorModeData->colorData = memoryUtil::AllocateArray<uint8_t>(allocator, section.length);
-	colorModeData->sizeOfColorData = section.length;
-	reader.Read(colorModeData->colorData, section.length);
+	// the length of this section is always stored using 4 bytes, even in .PSB files
+	const uint32_t length = static_cast<uint32_t>(section.length);
+	colorModeData->colorData = memoryUtil::AllocateArray<uint8_t>(allocator, length);
+	colorModeData->sizeOfColorData = length;
+	reader.Read(colorModeData->colorData, length);
 
 	return colorModeData;
 }
@@ -21,7 +21,7 @@ PSD_NAMESPACE_BEGIN
 // ---------------------------------------------------------------------------------------------------------------------
 Document* CreateDocument(File* file, Allocator* allocator)
 {
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator, SyncFileReader::DEFAULT_BUFFER_SIZE);
 	reader.SetPosition(0u);
 
 	// check signature, must be "8BPS"
@@ -34,14 +34,13 @@ Document* CreateDocument(File* file, Allocator* allocator)
 		}
 	}
 
-	// check version, must be 1
+	// check version, must be 1 for .PSD files, or 2 for .PSB files (Large Document Format).
+	// .PSB files support documents of up to 300,000 pixels in each dimension, and store some lengths using 8 bytes instead of 4.
+	const uint16_t version = fileUtil::ReadFromFileBE<uint16_t>(reader);
+	if ((version != 1) && (version != 2))
 	{
-		const uint16_t version = fileUtil::ReadFromFileBE<uint16_t>(reader);
-		if (version != 1)
-		{
-			PSD_ERROR("PsdExtract", "File seems to be corrupt, version does not match 1.");
-			return nullptr;
-		}
+		PSD_ERROR("PsdExtract", "File seems to be corrupt, version does not match 1 or 2.");
+		return nullptr;
 	}
 
 	// check reserved bytes, must be zero
@@ -71,6 +70,7 @@ Document* CreateDocument(File* file, Allocator* allocator)
 	document->width = fileUtil::ReadFromFileBE<uint32_t>(reader);
 	document->bitsPerChannel = fileUtil::ReadFromFileBE<uint16_t>(reader);
 	document->colorMode = fileUtil::ReadFromFileBE<uint16_t>(reader);
+	document->version = version;
 
 	// grab offsets into different sections
 	{
@@ -90,7 +90,10 @@ Document* CreateDocument(File* file, Allocator* allocator)
 		reader.Skip(length);
 	}
 	{
-		const uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		// this is the only section whose length is stored using 8 bytes in .PSB files
+		const uint64_t length = (version == 2)
+			? fileUtil::ReadFromFileBE<uint64_t>(reader)
+			: fileUtil::ReadFromFileBE<uint32_t>(reader);
 
 		document->layerMaskInfoSection.offset = reader.GetPosition();
 		document->layerMaskInfoSection.length = length;
@@ -100,7 +103,7 @@ Document* CreateDocument(File* file, Allocator* allocator)
 	{
 		// note that the image data section does NOT store its length in the first 4 bytes
 		document->imageDataSection.offset = reader.GetPosition();
-		document->imageDataSection.length = static_cast<uint32_t>(file->GetSize() - reader.GetPosition());
+		document->imageDataSection.length = file->GetSize() - reader.GetPosition();
 	}
 
 	return document;
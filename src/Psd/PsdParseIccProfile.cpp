@@ -0,0 +1,567 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdParseIccProfile.h"
+
+#include "PsdIccProfile.h"
+#include "PsdKey.h"
+#include "PsdEndianConversion.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAllocator.h"
+#include "PsdLog.h"
+#include "PsdAssert.h"
+#include <cstring>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// the header is followed by the tag count and the tag table, see the ICC specification ICC.1:2010
+	static const uint32_t HEADER_SIZE = 128u;
+	static const uint32_t TAG_ENTRY_SIZE = 12u;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T ReadBE(const uint8_t* data, uint32_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+		return endianUtil::BigEndianToNative(value);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t ReadFixed(const uint8_t* data, uint32_t offset)
+	{
+		// s15Fixed16Number
+		return static_cast<float32_t>(ReadBE<int32_t>(data, offset)) / 65536.0f;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool IsInRange(uint32_t size, uint32_t offset, uint64_t length)
+	{
+		return (offset <= size) && (length <= size - offset);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetChannelCount(uint32_t colorSpace)
+	{
+		switch (colorSpace)
+		{
+			case util::Key<'G', 'R', 'A', 'Y'>::VALUE:
+				return 1u;
+
+			case util::Key<'R', 'G', 'B', ' '>::VALUE:
+			case util::Key<'L', 'a', 'b', ' '>::VALUE:
+				return 3u;
+
+			case util::Key<'C', 'M', 'Y', 'K'>::VALUE:
+				return 4u;
+
+			default:
+				return 0u;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool FindTag(const uint8_t* data, uint32_t size, uint32_t signature, uint32_t& offset, uint32_t& length)
+	{
+		const uint32_t tagCount = ReadBE<uint32_t>(data, HEADER_SIZE);
+		if (!IsInRange(size, HEADER_SIZE + 4u, static_cast<uint64_t>(tagCount) * TAG_ENTRY_SIZE))
+			return false;
+
+		for (uint32_t i=0; i < tagCount; ++i)
+		{
+			const uint32_t entry = HEADER_SIZE + 4u + i*TAG_ENTRY_SIZE;
+			if (ReadBE<uint32_t>(data, entry) == signature)
+			{
+				offset = ReadBE<uint32_t>(data, entry + 4u);
+				length = ReadBE<uint32_t>(data, entry + 8u);
+
+				// every tag starts with its type signature and 4 reserved bytes
+				return IsInRange(size, offset, length) && (length >= 8u);
+			}
+		}
+
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InitializeCurve(IccCurve& curve)
+	{
+		curve.table = nullptr;
+		curve.entryCount = 0u;
+		curve.functionType = 0u;
+		curve.parameters[0] = 1.0f;
+		for (unsigned int i=1u; i < 7u; ++i)
+		{
+			curve.parameters[i] = 0.0f;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void InitializeMatrix(float32_t* matrix)
+	{
+		for (unsigned int i=0u; i < 12u; ++i)
+		{
+			matrix[i] = ((i < 9u) && (i % 4u == 0u)) ? 1.0f : 0.0f;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static float32_t* AllocateTable(Allocator* allocator, IccCurve& curve, uint32_t entryCount)
+	{
+		curve.table = memoryUtil::AllocateArray<float32_t>(allocator, entryCount);
+		curve.entryCount = entryCount;
+		return curve.table;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseCurve(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccCurve& curve, uint32_t& curveSize)
+	{
+		if (!IsInRange(size, offset, 12u))
+			return false;
+
+		const uint32_t type = ReadBE<uint32_t>(data, offset);
+		if (type == util::Key<'c', 'u', 'r', 'v'>::VALUE)
+		{
+			const uint32_t count = ReadBE<uint32_t>(data, offset + 8u);
+			if (!IsInRange(size, offset + 12u, static_cast<uint64_t>(count) * 2u))
+				return false;
+
+			curveSize = 12u + count*2u;
+			if (count == 1u)
+			{
+				// a single entry denotes a gamma value as u8Fixed8Number
+				curve.parameters[0] = ReadBE<uint16_t>(data, offset + 12u) / 256.0f;
+			}
+			else if (count > 1u)
+			{
+				float32_t* table = AllocateTable(allocator, curve, count);
+				for (uint32_t i=0; i < count; ++i)
+				{
+					table[i] = ReadBE<uint16_t>(data, offset + 12u + i*2u) / 65535.0f;
+				}
+			}
+
+			// curves without any entries are the identity
+			return true;
+		}
+		else if (type == util::Key<'p', 'a', 'r', 'a'>::VALUE)
+		{
+			const unsigned int PARAMETER_COUNT[5] = { 1u, 3u, 4u, 5u, 7u };
+			const uint16_t functionType = ReadBE<uint16_t>(data, offset + 8u);
+			if (functionType > 4u)
+				return false;
+
+			const unsigned int parameterCount = PARAMETER_COUNT[functionType];
+			if (!IsInRange(size, offset + 12u, parameterCount*4u))
+				return false;
+
+			curveSize = 12u + parameterCount*4u;
+			curve.functionType = functionType;
+			for (unsigned int i=0; i < parameterCount; ++i)
+			{
+				curve.parameters[i] = ReadFixed(data, offset + 12u + i*4u);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseCurves(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccCurve* curves, unsigned int count)
+	{
+		// curves in lutAtoB tags are stored back to back, each one padded to 4 bytes
+		for (unsigned int i=0; i < count; ++i)
+		{
+			uint32_t curveSize = 0u;
+			if (!ParseCurve(data, size, offset, allocator, curves[i], curveSize))
+				return false;
+
+			offset += (curveSize + 3u) & ~3u;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t GetClutSize(const IccProfile* profile)
+	{
+		uint64_t size = 3u;
+		for (unsigned int i=0; i < profile->channelCount; ++i)
+		{
+			size *= profile->gridPoints[i];
+		}
+
+		return size;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ParseClut(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccProfile* profile)
+	{
+		const uint64_t valueCount = GetClutSize(profile);
+		if ((valueCount == 0u) || !IsInRange(size, offset, valueCount * sizeof(T)))
+			return false;
+
+		const float32_t scale = 1.0f / static_cast<float32_t>(static_cast<T>(~0u));
+		profile->clut = memoryUtil::AllocateArray<float32_t>(allocator, static_cast<size_t>(valueCount));
+		for (uint64_t i=0; i < valueCount; ++i)
+		{
+			profile->clut[i] = ReadBE<T>(data, static_cast<uint32_t>(offset + i*sizeof(T))) * scale;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ParseTables(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccCurve* curves, unsigned int count, uint32_t entryCount)
+	{
+		if ((entryCount < 2u) || !IsInRange(size, offset, static_cast<uint64_t>(count) * entryCount * sizeof(T)))
+			return false;
+
+		const float32_t scale = 1.0f / static_cast<float32_t>(static_cast<T>(~0u));
+		for (unsigned int c=0; c < count; ++c)
+		{
+			float32_t* table = AllocateTable(allocator, curves[c], entryCount);
+			for (uint32_t i=0; i < entryCount; ++i)
+			{
+				table[i] = ReadBE<T>(data, offset + (c*entryCount + i)*sizeof(T)) * scale;
+			}
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseLut8(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccProfile* profile)
+	{
+		// lut8Type: input tables, CLUT and output tables with 8-bit entries. the matrix only applies to XYZ input.
+		const unsigned int gridPoints = data[offset + 10u];
+		for (unsigned int i=0; i < profile->channelCount; ++i)
+		{
+			profile->gridPoints[i] = static_cast<uint8_t>(gridPoints);
+		}
+
+		const uint32_t inputOffset = offset + 48u;
+		const uint32_t clutOffset = inputOffset + profile->channelCount*256u;
+		const uint32_t outputOffset = static_cast<uint32_t>(clutOffset + GetClutSize(profile));
+		return ParseTables<uint8_t>(data, size, inputOffset, allocator, profile->inputCurves, profile->channelCount, 256u) &&
+			ParseClut<uint8_t>(data, size, clutOffset, allocator, profile) &&
+			ParseTables<uint8_t>(data, size, outputOffset, allocator, profile->outputCurves, 3u, 256u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseLut16(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccProfile* profile)
+	{
+		// lut16Type: like lut8Type, but with 16-bit entries and a variable number of entries in the input and output tables
+		if (!IsInRange(size, offset, 52u))
+			return false;
+
+		const unsigned int gridPoints = data[offset + 10u];
+		for (unsigned int i=0; i < profile->channelCount; ++i)
+		{
+			profile->gridPoints[i] = static_cast<uint8_t>(gridPoints);
+		}
+
+		const uint32_t inputEntries = ReadBE<uint16_t>(data, offset + 48u);
+		const uint32_t outputEntries = ReadBE<uint16_t>(data, offset + 50u);
+		const uint32_t inputOffset = offset + 52u;
+		const uint32_t clutOffset = inputOffset + profile->channelCount*inputEntries*2u;
+		const uint32_t outputOffset = static_cast<uint32_t>(clutOffset + GetClutSize(profile)*2u);
+
+		// lut16Type is the only type using the legacy 16-bit Lab encoding
+		profile->isLegacyLabEncoding = true;
+		return ParseTables<uint16_t>(data, size, inputOffset, allocator, profile->inputCurves, profile->channelCount, inputEntries) &&
+			ParseClut<uint16_t>(data, size, clutOffset, allocator, profile) &&
+			ParseTables<uint16_t>(data, size, outputOffset, allocator, profile->outputCurves, 3u, outputEntries);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseLutAtoB(const uint8_t* data, uint32_t size, uint32_t offset, Allocator* allocator, IccProfile* profile)
+	{
+		// lutAtoBType: all elements are optional, and are referenced by offsets relative to the start of the tag
+		if (!IsInRange(size, offset, 32u))
+			return false;
+
+		const uint32_t bOffset = ReadBE<uint32_t>(data, offset + 12u);
+		const uint32_t matrixOffset = ReadBE<uint32_t>(data, offset + 16u);
+		const uint32_t mOffset = ReadBE<uint32_t>(data, offset + 20u);
+		const uint32_t clutOffset = ReadBE<uint32_t>(data, offset + 24u);
+		const uint32_t aOffset = ReadBE<uint32_t>(data, offset + 28u);
+
+		if ((bOffset != 0u) && !ParseCurves(data, size, offset + bOffset, allocator, profile->outputCurves, 3u))
+			return false;
+
+		if (matrixOffset != 0u)
+		{
+			if (!IsInRange(size, offset + matrixOffset, 48u))
+				return false;
+
+			for (unsigned int i=0; i < 12u; ++i)
+			{
+				profile->matrix[i] = ReadFixed(data, offset + matrixOffset + i*4u);
+			}
+		}
+
+		if ((mOffset != 0u) && !ParseCurves(data, size, offset + mOffset, allocator, profile->matrixCurves, 3u))
+			return false;
+
+		if ((aOffset != 0u) && !ParseCurves(data, size, offset + aOffset, allocator, profile->inputCurves, profile->channelCount))
+			return false;
+
+		if (clutOffset != 0u)
+		{
+			const uint32_t clutStart = offset + clutOffset;
+			if (!IsInRange(size, clutStart, 20u))
+				return false;
+
+			for (unsigned int i=0; i < profile->channelCount; ++i)
+			{
+				profile->gridPoints[i] = data[clutStart + i];
+			}
+
+			const uint8_t precision = data[clutStart + 16u];
+			return (precision == 1u) ? ParseClut<uint8_t>(data, size, clutStart + 20u, allocator, profile) : ParseClut<uint16_t>(data, size, clutStart + 20u, allocator, profile);
+		}
+
+		// without a CLUT, the input and output channels are connected directly
+		return (profile->channelCount == 3u);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseLut(const uint8_t* data, uint32_t size, uint32_t offset, uint32_t length, Allocator* allocator, IccProfile* profile)
+	{
+		if (length < 12u)
+			return false;
+
+		// only conversions to the three channels of the PCS are valid
+		const unsigned int inputChannels = data[offset + 8u];
+		const unsigned int outputChannels = data[offset + 9u];
+		if ((inputChannels != profile->channelCount) || (outputChannels != 3u))
+			return false;
+
+		const uint32_t type = ReadBE<uint32_t>(data, offset);
+		switch (type)
+		{
+			case util::Key<'m', 'f', 't', '1'>::VALUE:
+				return ParseLut8(data, size, offset, allocator, profile);
+
+			case util::Key<'m', 'f', 't', '2'>::VALUE:
+				return ParseLut16(data, size, offset, allocator, profile);
+
+			case util::Key<'m', 'A', 'B', ' '>::VALUE:
+				return ParseLutAtoB(data, size, offset, allocator, profile);
+
+			default:
+				return false;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseToneCurve(const uint8_t* data, uint32_t size, uint32_t signature, Allocator* allocator, IccCurve& curve)
+	{
+		uint32_t offset = 0u;
+		uint32_t length = 0u;
+		uint32_t curveSize = 0u;
+		return FindTag(data, size, signature, offset, length) && ParseCurve(data, size, offset, allocator, curve, curveSize);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseColorant(const uint8_t* data, uint32_t size, uint32_t signature, float32_t* colorants, unsigned int column)
+	{
+		uint32_t offset = 0u;
+		uint32_t length = 0u;
+		if (!FindTag(data, size, signature, offset, length) || (length < 20u) || (ReadBE<uint32_t>(data, offset) != util::Key<'X', 'Y', 'Z', ' '>::VALUE))
+			return false;
+
+		for (unsigned int i=0; i < 3u; ++i)
+		{
+			colorants[i*3u + column] = ReadFixed(data, offset + 8u + i*4u);
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ParseMatrixTrc(const uint8_t* data, uint32_t size, Allocator* allocator, IccProfile* profile)
+	{
+		if (profile->colorSpace == util::Key<'G', 'R', 'A', 'Y'>::VALUE)
+		{
+			return ParseToneCurve(data, size, util::Key<'k', 'T', 'R', 'C'>::VALUE, allocator, profile->toneCurves[0]);
+		}
+		else if (profile->colorSpace == util::Key<'R', 'G', 'B', ' '>::VALUE)
+		{
+			return ParseColorant(data, size, util::Key<'r', 'X', 'Y', 'Z'>::VALUE, profile->colorants, 0u) &&
+				ParseColorant(data, size, util::Key<'g', 'X', 'Y', 'Z'>::VALUE, profile->colorants, 1u) &&
+				ParseColorant(data, size, util::Key<'b', 'X', 'Y', 'Z'>::VALUE, profile->colorants, 2u) &&
+				ParseToneCurve(data, size, util::Key<'r', 'T', 'R', 'C'>::VALUE, allocator, profile->toneCurves[0]) &&
+				ParseToneCurve(data, size, util::Key<'g', 'T', 'R', 'C'>::VALUE, allocator, profile->toneCurves[1]) &&
+				ParseToneCurve(data, size, util::Key<'b', 'T', 'R', 'C'>::VALUE, allocator, profile->toneCurves[2]);
+		}
+
+		// Lab data without any transform is already in a connection space
+		return (profile->colorSpace == util::Key<'L', 'a', 'b', ' '>::VALUE);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+IccProfile* ParseIccProfile(const void* data, uint32_t size, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(data);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	if ((size < HEADER_SIZE + 4u) || (ReadBE<uint32_t>(bytes, 36u) != util::Key<'a', 'c', 's', 'p'>::VALUE))
+	{
+		PSD_ERROR("IccProfile", "Data is not a valid ICC profile.");
+		return nullptr;
+	}
+
+	const uint32_t colorSpace = ReadBE<uint32_t>(bytes, 16u);
+	const uint32_t connectionSpace = ReadBE<uint32_t>(bytes, 20u);
+	const unsigned int channelCount = GetChannelCount(colorSpace);
+	if ((channelCount == 0u) || ((connectionSpace != util::Key<'X', 'Y', 'Z', ' '>::VALUE) && (connectionSpace != util::Key<'L', 'a', 'b', ' '>::VALUE)))
+	{
+		PSD_ERROR("IccProfile", "ICC profiles with color space 0x%08X and connection space 0x%08X are not supported.", colorSpace, connectionSpace);
+		return nullptr;
+	}
+
+	IccProfile* profile = memoryUtil::Allocate<IccProfile>(allocator);
+	profile->hash = HashIccProfile(data, size);
+	profile->colorSpace = colorSpace;
+	profile->connectionSpace = connectionSpace;
+	profile->channelCount = channelCount;
+	profile->hasLut = false;
+	profile->isLegacyLabEncoding = false;
+	profile->clut = nullptr;
+	InitializeMatrix(profile->matrix);
+	for (unsigned int i=0; i < 4u; ++i)
+	{
+		InitializeCurve(profile->inputCurves[i]);
+		profile->gridPoints[i] = 0u;
+	}
+	for (unsigned int i=0; i < 3u; ++i)
+	{
+		InitializeCurve(profile->matrixCurves[i]);
+		InitializeCurve(profile->outputCurves[i]);
+		InitializeCurve(profile->toneCurves[i]);
+	}
+	for (unsigned int i=0; i < 9u; ++i)
+	{
+		profile->colorants[i] = 0.0f;
+	}
+
+	// the perceptual lookup tables are preferred, because matrix/TRC profiles may contain both
+	bool isValid = false;
+	uint32_t offset = 0u;
+	uint32_t length = 0u;
+	if (FindTag(bytes, size, util::Key<'A', '2', 'B', '0'>::VALUE, offset, length))
+	{
+		profile->hasLut = true;
+		isValid = ParseLut(bytes, size, offset, length, allocator, profile);
+	}
+	else
+	{
+		isValid = ParseMatrixTrc(bytes, size, allocator, profile);
+	}
+
+	if (!isValid)
+	{
+		PSD_ERROR("IccProfile", "ICC profile is malformed or uses unsupported tag types.");
+		DestroyIccProfile(profile, allocator);
+		return nullptr;
+	}
+
+	return profile;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint64_t HashIccProfile(const void* data, uint32_t size)
+{
+	PSD_ASSERT_NOT_NULL(data);
+
+	// 64-bit FNV-1a
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t i=0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyIccProfile(IccProfile*& profile, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(profile);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	for (unsigned int i=0; i < 4u; ++i)
+	{
+		memoryUtil::FreeArray(allocator, profile->inputCurves[i].table);
+	}
+	for (unsigned int i=0; i < 3u; ++i)
+	{
+		memoryUtil::FreeArray(allocator, profile->matrixCurves[i].table);
+		memoryUtil::FreeArray(allocator, profile->outputCurves[i].table);
+		memoryUtil::FreeArray(allocator, profile->toneCurves[i].table);
+	}
+	memoryUtil::FreeArray(allocator, profile->clut);
+	memoryUtil::Free(allocator, profile);
+}
+
+PSD_NAMESPACE_END
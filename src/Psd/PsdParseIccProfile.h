@@ -0,0 +1,29 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+class Allocator;
+struct IccProfile;
+
+
+/// \ingroup Parser
+/// Parses the raw ICC profile \a data, e.g. ImageResourcesSection::iccProfile, and returns a newly created instance that needs to be
+/// freed by a call to \ref DestroyIccProfile.
+/// \remark Only the transform from device colors to the profile connection space is parsed, which suffices for converting document data
+/// to other color spaces. Both matrix/TRC and LUT-based profiles for grayscale, RGB, CMYK and Lab data are supported.
+/// \return Returns a nullptr if the data is no valid ICC profile, or uses unsupported features.
+IccProfile* ParseIccProfile(const void* data, uint32_t size, Allocator* allocator);
+
+/// \ingroup Parser
+/// Returns the hash of the raw ICC profile \a data that \ref ParseIccProfile stores in IccProfile::hash, without parsing the profile.
+uint64_t HashIccProfile(const void* data, uint32_t size);
+
+/// \ingroup Parser
+/// Destroys and nullifies the given \a profile previously created by a call to \ref ParseIccProfile.
+void DestroyIccProfile(IccProfile*& profile, Allocator* allocator);
+
+PSD_NAMESPACE_END
@@ -5,6 +5,7 @@
 #include "PsdParseImageDataSection.h"
 
 #include "PsdImageDataSection.h"
+#include "PsdParseChannelData.h"
 #include "PsdDocument.h"
 #include "PsdCompressionType.h"
 #include "PsdPlanarImage.h"
@@ -30,11 +31,11 @@ namespace
 	{
 		PSD_ASSERT_NOT_NULL(images);
 
-		const unsigned int size = width*height;
+		const size_t size = static_cast<size_t>(width)*height;
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
 			T* planarData = static_cast<T*>(images[i].data);
-			for (unsigned int j=0; j < size; ++j)
+			for (size_t j=0; j < size; ++j)
 			{
 				planarData[j] = endianUtil::BigEndianToNative(planarData[j]);
 			}
@@ -46,8 +47,8 @@ namespace
 	// ---------------------------------------------------------------------------------------------------------------------
 	static ImageDataSection* ReadImageDataSectionRaw(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel)
 	{
-		const unsigned int size = width*height;
-		if (size == 0)
+		uint32_t size = 0u;
+		if (!GetPlanarDataSize(width, height, bytesPerPixel, size) || (size == 0u))
 			return nullptr;
 
 		ImageDataSection* imageData = memoryUtil::Allocate<ImageDataSection>(allocator);
@@ -57,10 +58,10 @@ namespace
 		// read data for all channels at once
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			void* planarData = allocator->Allocate(size*bytesPerPixel, 16u);
+			void* planarData = allocator->Allocate(size, 16u);
 			imageData->images[i].data = planarData;
 
-			reader.Read(planarData, size*bytesPerPixel);
+			reader.Read(planarData, size);
 		}
 
 		return imageData;
@@ -69,49 +70,50 @@ namespace
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	static ImageDataSection* ReadImageDataSectionRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel)
+	static ImageDataSection* ReadImageDataSectionRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int channelCount, unsigned int bytesPerPixel, unsigned int dataCountSize, ThreadPool* threadPool)
 	{
-		// the RLE-compressed data is preceded by a 2-byte data count for each scan line, per channel.
-		// we store the size of the RLE data per channel, and assume a maximum of 256 channels.
-		PSD_ASSERT(channelCount < 256, "Image data section has too many channels (%d).", channelCount);
-		unsigned int channelSize[256] = {};
+		uint32_t size = 0u;
+		if (!GetPlanarDataSize(width, height, bytesPerPixel, size))
+			return nullptr;
+
+		// the RLE-compressed data is preceded by a data count for each scan line, per channel. the data counts are 2 bytes
+		// wide in .PSD files, and 4 bytes wide in .PSB files.
+		// we keep the offsets to the start of each row, so that the rows can be decompressed independently of each other.
+		uint32_t* rowOffsets = memoryUtil::AllocateArray<uint32_t>(allocator, channelCount*(height + 1u));
 		unsigned int totalSize = 0;
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			unsigned int size = 0u;
-			for (unsigned int j=0; j < height; ++j)
-			{
-				const uint16_t dataCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
-				size += dataCount;
-			}
-
-			channelSize[i] = size;
-			totalSize += size;
+			totalSize += ReadRleRowOffsets(reader, allocator, height, dataCountSize, rowOffsets + i*(height + 1u));
 		}
 
 		if (totalSize == 0)
+		{
+			memoryUtil::FreeArray(allocator, rowOffsets);
 			return nullptr;
+		}
 
-		const unsigned int size = width*height;
 		ImageDataSection* imageData = memoryUtil::Allocate<ImageDataSection>(allocator);
 		imageData->imageCount = channelCount;
 		imageData->images = memoryUtil::AllocateArray<PlanarImage>(allocator, channelCount);
 
 		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			void* planarData = allocator->Allocate(size*bytesPerPixel, 16u);
+			void* planarData = allocator->Allocate(size, 16u);
 			imageData->images[i].data = planarData;
 
 			// read RLE data, and uncompress into planar buffer
-			const unsigned int rleSize = channelSize[i];
-			uint8_t* rleData = static_cast<uint8_t*>(allocator->Allocate(rleSize, 4u));
-			reader.Read(rleData, rleSize);
+			const uint32_t* channelRowOffsets = rowOffsets + i*(height + 1u);
+			const unsigned int rleSize = channelRowOffsets[height];
+			void* stagingData = nullptr;
+			const uint8_t* rleData = static_cast<const uint8_t*>(AcquireCompressedData(reader, allocator, rleSize, stagingData));
 
-			imageUtil::DecompressRle(rleData, rleSize, static_cast<uint8_t*>(planarData), width*height*bytesPerPixel);
+			imageUtil::DecompressRleRows(rleData, channelRowOffsets, height, static_cast<uint8_t*>(planarData), width*bytesPerPixel, threadPool);
 
-			allocator->Free(rleData);
+			ReleaseCompressedData(allocator, stagingData);
 		}
 
+		memoryUtil::FreeArray(allocator, rowOffsets);
+
 		return imageData;
 	}
 }
@@ -120,6 +122,14 @@ namespace
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator)
+{
+	return ParseImageDataSection(document, file, allocator, nullptr);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator, ThreadPool* threadPool)
 {
 	PSD_ASSERT_NOT_NULL(file);
 	PSD_ASSERT_NOT_NULL(allocator);
@@ -139,7 +149,7 @@ ImageDataSection* ParseImageDataSection(const Document* document, File* file, Al
 		return nullptr;
 	}
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator, SyncFileReader::DEFAULT_BUFFER_SIZE);
 	reader.SetPosition(section.offset);
 
 	ImageDataSection* imageData = nullptr;
@@ -154,7 +164,8 @@ ImageDataSection* ParseImageDataSection(const Document* document, File* file, Al
 	}
 	else if (compressionType == compressionType::RLE)
 	{
-		imageData = ReadImageDataSectionRLE(reader, allocator, width, height, channelCount, bitsPerChannel / 8u);
+		const unsigned int dataCountSize = (document->version == 2u) ? sizeof(uint32_t) : sizeof(uint16_t);
+		imageData = ReadImageDataSectionRLE(reader, allocator, width, height, channelCount, bitsPerChannel / 8u, dataCountSize, threadPool);
 	}
 	else
 	{
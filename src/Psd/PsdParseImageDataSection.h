@@ -10,6 +10,7 @@ struct Document;
 class File;
 class Allocator;
 struct ImageDataSection;
+class ThreadPool;
 
 
 /// \ingroup Parser
@@ -19,6 +20,11 @@ struct ImageDataSection;
 /// or \ref ParseLayerMaskSection) in parallel from different threads.
 ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator);
 
+/// \ingroup Parser
+/// Parses the image data section in the document like \ref ParseImageDataSection, decompressing bands of rows of RLE-compressed
+/// channels in parallel using the threads of \a threadPool. If \a threadPool is a nullptr, all data is decompressed on the calling thread.
+ImageDataSection* ParseImageDataSection(const Document* document, File* file, Allocator* allocator, ThreadPool* threadPool);
+
 /// \ingroup Parser
 /// Destroys and nullifies the given \a section previously created by a call to \ref ParseImageDataSection.
 void DestroyImageDataSection(ImageDataSection*& section, Allocator* allocator);
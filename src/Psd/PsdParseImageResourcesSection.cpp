@@ -47,7 +47,7 @@ ImageResourcesSection* ParseImageResourcesSection(const Document* document, File
 	imageResources->verticalUnit = 0u;
 	imageResources->heightUnit = 0u;
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator, SyncFileReader::DEFAULT_BUFFER_SIZE);
 	reader.SetPosition(document->imageResourcesSection.offset);
 
 	int64_t leftToRead = document->imageResourcesSection.length;
@@ -11,9 +11,12 @@
 #include "PsdLayerMask.h"
 #include "PsdVectorMask.h"
 #include "PsdCompressionType.h"
+#include "PsdExtractionError.h"
 #include "PsdLayerType.h"
 #include "PsdFile.h"
 #include "PsdLayerMaskSection.h"
+#include "PsdParseChannelData.h"
+#include "PsdLayerRegion.h"
 #include "PsdKey.h"
 #include "PsdBitUtil.h"
 #include "PsdEndianConversion.h"
@@ -25,7 +28,12 @@
 #include "Psdminiz.h"
 #include "Psdinttypes.h"
 #include "PsdLog.h"
+#include "PsdThreadPool.h"
+#include "PsdInterleave.h"
+#include "PsdColorConversion.h"
+#include "PsdColorMode.h"
 #include <cstring>
+#include <algorithm>
 
 #include <iostream>
 #include <vector>
@@ -200,6 +208,49 @@ PSD_NAMESPACE_BEGIN
 	}
 
 
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	// 16-bit values are in the range [0, 32768] used by Photoshop
+	template <typename T>
+	static T ExpandDefaultColor(uint8_t color);
+
+	template <> uint8_t ExpandDefaultColor<uint8_t>(uint8_t color) { return color; }
+	template <> uint16_t ExpandDefaultColor<uint16_t>(uint8_t color) { return static_cast<uint16_t>((color*32768u + 127u) / 255u); }
+	template <> float32_t ExpandDefaultColor<float32_t>(uint8_t color) { return color / 255.0f; }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void FillDefaultColor(T* data, uint32_t count, uint8_t color)
+	{
+		const T value = ExpandDefaultColor<T>(color);
+		for (uint32_t i=0; i < count; ++i)
+		{
+			data[i] = value;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void FillDefaultColor(const Document* document, void* data, uint32_t size, uint8_t color)
+	{
+		if (document->bitsPerChannel == 16)
+		{
+			FillDefaultColor(static_cast<uint16_t*>(data), size / sizeof(uint16_t), color);
+		}
+		else if (document->bitsPerChannel == 32)
+		{
+			FillDefaultColor(static_cast<float32_t*>(data), size / sizeof(float32_t), color);
+		}
+		else
+		{
+			memset(data, color, size);
+		}
+	}
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	static uint8_t GetChannelDefaultColor(const Layer* layer, const Channel* channel)
@@ -253,9 +304,9 @@ PSD_NAMESPACE_BEGIN
 		PSD_ASSERT_NOT_NULL(src);
 
 		T* data = static_cast<T*>(src);
-		const unsigned int size = width*height;
+		const size_t size = static_cast<size_t>(width)*height;
 
-		for (unsigned int i=0; i < size; ++i)
+		for (size_t i=0; i < size; ++i)
 		{
 			data[i] = endianUtil::BigEndianToNative(data[i]);
 		}
@@ -267,11 +318,12 @@ PSD_NAMESPACE_BEGIN
 	template <typename T>
 	static void* ReadChannelDataRaw(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height)
 	{
-		const unsigned int size = width*height;
+		// the size has been checked against the 4 GB limit by the caller
+		const uint32_t size = static_cast<uint32_t>(static_cast<uint64_t>(width) * height * sizeof(T));
 		if (size > 0)
 		{
-			void* planarData = allocator->Allocate(size*sizeof(T), 16u);
-			reader.Read(planarData, size*sizeof(T));
+			void* planarData = allocator->Allocate(size, 16u);
+			reader.Read(planarData, size);
 
 			EndianConvert<T>(planarData, width, height);
 
@@ -284,37 +336,61 @@ PSD_NAMESPACE_BEGIN
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	static void* ReadChannelDataRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, int& errorCode)
+	static unsigned int GetRleDataCountSize(const Document* document)
 	{
-		// the RLE-compressed data is preceded by a 2-byte data count for each scan line
-		const unsigned int size = width*height;
+		// .PSB files store the data count of each RLE-compressed scan line using 4 bytes instead of 2
+		return (document->version == 2u) ? sizeof(uint32_t) : sizeof(uint16_t);
+	}
 
-		unsigned int rleDataSize = 0u;
-		for (unsigned int i=0; i < height; ++i)
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t GetCompressedDataSize(const Channel* channel)
+	{
+		// note that we need to subtract 2 bytes from the channel data size because we already read the uint16_t
+		// for the compression type.
+		PSD_ASSERT(channel->size >= 2, "Invalid channel data size %" PRIu64 ".", channel->size);
+		const uint64_t size = channel->size - 2u;
+		if (size > 0xFFFFFFFFull)
 		{
-			const uint16_t dataCount = fileUtil::ReadFromFileBE<uint16_t>(reader);
-			rleDataSize += dataCount;
+			PSD_ERROR("PsdExtract", "Compressed channel data of %" PRIu64 " bytes exceeds 4 GB, which is not supported.", size);
+			return 0u;
 		}
 
+		return static_cast<uint32_t>(size);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void* ReadChannelDataRLE(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, unsigned int dataCountSize, ThreadPool* threadPool, int& errorCode)
+	{
+		const uint32_t size = static_cast<uint32_t>(static_cast<uint64_t>(width) * height * sizeof(T));
+
+		// knowing where each row starts allows us to decompress the rows independently of each other
+		uint32_t* rowOffsets = memoryUtil::AllocateArray<uint32_t>(allocator, height + 1u);
+		const uint32_t rleDataSize = ReadRleRowOffsets(reader, allocator, height, dataCountSize, rowOffsets);
+
+		void* planarData = nullptr;
 		if (rleDataSize > 0)
 		{
-			void* planarData = allocator->Allocate(size*sizeof(T), 16u);
+			planarData = allocator->Allocate(size, 16u);
 
 			// decompress RLE
-			void* rleData = allocator->Allocate(rleDataSize, 4u);
+			void* stagingData = nullptr;
+			const void* rleData = AcquireCompressedData(reader, allocator, rleDataSize, stagingData);
 			{
-				reader.Read(rleData, rleDataSize);
-				errorCode = imageUtil::DecompressRle(static_cast<const uint8_t*>(rleData), rleDataSize, static_cast<uint8_t*>(planarData), width*height*sizeof(T));
+				errorCode = imageUtil::DecompressRleRows(static_cast<const uint8_t*>(rleData), rowOffsets, height, static_cast<uint8_t*>(planarData), width*sizeof(T), threadPool);
 			}
-			allocator->Free(rleData);
+			ReleaseCompressedData(allocator, stagingData);
 
 			EndianConvert<T>(planarData, width, height);
-
-			return planarData;
 		}
 
-		return nullptr;
+		memoryUtil::FreeArray(allocator, rowOffsets);
+
+		return planarData;
 	}
 
 
@@ -325,21 +401,21 @@ PSD_NAMESPACE_BEGIN
 	{
 		if (channelSize > 0)
 		{
-			const unsigned int size = width*height;
+			const uint32_t size = static_cast<uint32_t>(static_cast<uint64_t>(width) * height * sizeof(T));
 
-			T* planarData = static_cast<T*>(allocator->Allocate(size*sizeof(T), 16));
+			T* planarData = static_cast<T*>(allocator->Allocate(size, 16));
 
-			void* zipData = allocator->Allocate(channelSize, 4u);
-			reader.Read(zipData, channelSize);
+			void* stagingData = nullptr;
+			const void* zipData = AcquireCompressedData(reader, allocator, channelSize, stagingData);
 
 			// the zipped data stream has a zlib-header
-			const size_t status = tinfl_decompress_mem_to_mem(planarData, size*sizeof(T), zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
+			const size_t status = tinfl_decompress_mem_to_mem(planarData, size, zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
 			if (status == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED)
 			{
 				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
 			}
 
-			allocator->Free(zipData);
+			ReleaseCompressedData(allocator, stagingData);
 
 			EndianConvert<T>(planarData, width, height);
 
@@ -352,8 +428,18 @@ PSD_NAMESPACE_BEGIN
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
+	// 32-bit prediction needs a scratch row for interleaving the bytes of each row, the other types are predicted in place
 	template <typename T>
-	static void ApplyPrediction(Allocator* allocator, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	static uint8_t* AllocatePredictionRow(Allocator* allocator, unsigned int width)
+	{
+		return (sizeof(T) == 4u) ? static_cast<uint8_t*>(allocator->Allocate(width*sizeof(T), 16u)) : nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ApplyPrediction(uint8_t* PSD_RESTRICT predictionRow, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
 		static_assert(sizeof(T) == -1, "Unknown data type.");
 	}
@@ -362,7 +448,7 @@ PSD_NAMESPACE_BEGIN
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <>
-	void ApplyPrediction<uint8_t>(Allocator*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	void ApplyPrediction<uint8_t>(uint8_t* PSD_RESTRICT, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
 		uint8_t* buffer = static_cast<uint8_t*>(planarData);
 		for (unsigned int y = 0; y < height; ++y)
@@ -383,7 +469,7 @@ PSD_NAMESPACE_BEGIN
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <>
-	void ApplyPrediction<uint16_t>(Allocator*, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	void ApplyPrediction<uint16_t>(uint8_t* PSD_RESTRICT, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
 		// 16-bit images are delta-encoded word-by-word.
 		// the deltas are big-endian and must be reversed first for further processing. note that this is done
@@ -413,7 +499,7 @@ PSD_NAMESPACE_BEGIN
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <>
-	void ApplyPrediction<float32_t>(Allocator* allocator, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
+	void ApplyPrediction<float32_t>(uint8_t* PSD_RESTRICT predictionRow, void* PSD_RESTRICT planarData, unsigned int width, unsigned int height)
 	{
 		// delta-decode row by row first
 		{
@@ -427,81 +513,1286 @@ PSD_NAMESPACE_BEGIN
 					const uint32_t current = buffer[0];
 					const uint32_t value = current + previous;
 
-					*buffer++ = static_cast<uint8_t>(value & 0xFFu);
-				}
+					*buffer++ = static_cast<uint8_t>(value & 0xFFu);
+				}
+			}
+		}
+
+		// the bytes of the 32-bit float are stored in planar fashion per row, big-endian format.
+		// interleave the bytes, and store them in little-endian format at the same time.
+		{
+			uint8_t* dest = static_cast<uint8_t*>(planarData);
+			for (unsigned int y=0; y < height; ++y)
+			{
+				// copy first row of data to backup storage, because it will be overwritten inside our loop.
+				// note that this operation cannot be done in-place, that's why we work row by row.
+				memcpy(predictionRow, dest, width*sizeof(float32_t));
+
+				const uint8_t* src0 = predictionRow;
+				const uint8_t* src1 = predictionRow + 1*width;
+				const uint8_t* src2 = predictionRow + 2*width;
+				const uint8_t* src3 = predictionRow + 3*width;
+
+				for (unsigned int x=0; x < width; ++x)
+				{
+					// write data in little-endian format
+					dest[0] = *src3++;
+					dest[1] = *src2++;
+					dest[2] = *src1++;
+					dest[3] = *src0++;
+					dest += 4u;
+				}
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void* ReadChannelDataZipPrediction(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, uint32_t channelSize)
+	{
+		if (channelSize > 0)
+		{
+			const uint32_t size = static_cast<uint32_t>(static_cast<uint64_t>(width) * height * sizeof(T));
+
+			T* planarData = static_cast<T*>(allocator->Allocate(size, 16));
+
+			void* stagingData = nullptr;
+			const void* zipData = AcquireCompressedData(reader, allocator, channelSize, stagingData);
+
+			// the zipped data stream has a zlib-header
+			const size_t status = tinfl_decompress_mem_to_mem(planarData, size, zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
+			if (status == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED)
+			{
+				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
+			}
+
+			ReleaseCompressedData(allocator, stagingData);
+
+			// the data generated by applying the prediction data is already in little-endian format, so it doesn't have to be
+			// endian converted further.
+			uint8_t* predictionRow = AllocatePredictionRow<T>(allocator, width);
+			ApplyPrediction<T>(predictionRow, planarData, width, height);
+			if (predictionRow)
+				allocator->Free(predictionRow);
+
+			return planarData;
+		}
+
+		return nullptr;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void GetBounds(const T* data, int32_t& top, int32_t& left, int32_t& bottom, int32_t& right)
+	{
+		top = data->top;
+		left = data->left;
+		bottom = data->bottom;
+		right = data->right;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void GetChannelBounds(const Layer* layer, const Channel* channel, int32_t& top, int32_t& left, int32_t& bottom, int32_t& right)
+	{
+		// mirrors GetChannelExtents(), but yields the channel's position on the canvas as well
+		if (channel->type == channelType::LAYER_OR_VECTOR_MASK)
+		{
+			if (layer->vectorMask)
+			{
+				return GetBounds(layer->vectorMask, top, left, bottom, right);
+			}
+			else if (layer->layerMask)
+			{
+				return GetBounds(layer->layerMask.get(), top, left, bottom, right);
+			}
+
+			PSD_ASSERT(false, "The code failed to create a mask for this type internally. This should never happen.");
+			top = left = bottom = right = 0;
+			return;
+		}
+		else if (channel->type == channelType::LAYER_MASK)
+		{
+			return GetBounds(layer->layerMask.get(), top, left, bottom, right);
+		}
+
+		// color channels and the transparency mask have the same size as the layer
+		return GetBounds(layer, top, left, bottom, right);
+	}
+
+
+	// the part of a channel that needs to be extracted, in coordinates relative to the channel.
+	// rows of the extracted region are stored regionStride values apart.
+	struct ChannelRegionExtents
+	{
+		unsigned int width;
+		unsigned int height;
+		unsigned int x;
+		unsigned int y;
+		unsigned int regionWidth;
+		unsigned int regionHeight;
+		size_t regionStride;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void EndianConvertRegion(T* regionData, const ChannelRegionExtents& extents)
+	{
+		if (extents.regionStride == extents.regionWidth)
+		{
+			EndianConvert<T>(regionData, extents.regionWidth, extents.regionHeight);
+			return;
+		}
+
+		for (unsigned int y=0; y < extents.regionHeight; ++y)
+		{
+			EndianConvert<T>(regionData + y*extents.regionStride, extents.regionWidth, 1u);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ReadChannelRegionRaw(SyncFileReader& reader, const ChannelRegionExtents& extents, T* regionData)
+	{
+		// raw data can be read row by row, skipping everything outside the region
+		const uint64_t dataOffset = reader.GetPosition();
+		if ((extents.x == 0u) && (extents.regionWidth == extents.width) && (extents.regionStride == extents.width))
+		{
+			// whole rows are needed, which are stored consecutively
+			reader.SetPosition(dataOffset + static_cast<uint64_t>(extents.y)*extents.width*sizeof(T));
+			reader.Read(regionData, extents.regionWidth*extents.regionHeight*sizeof(T));
+		}
+		else
+		{
+			for (unsigned int y=0; y < extents.regionHeight; ++y)
+			{
+				const uint64_t rowOffset = (static_cast<uint64_t>(extents.y + y)*extents.width + extents.x)*sizeof(T);
+				reader.SetPosition(dataOffset + rowOffset);
+				reader.Read(regionData + y*extents.regionStride, extents.regionWidth*sizeof(T));
+			}
+		}
+
+		EndianConvertRegion<T>(regionData, extents);
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ReadChannelRegionRLE(SyncFileReader& reader, Allocator* allocator, const ChannelRegionExtents& extents, unsigned int dataCountSize, T* regionData, int& errorCode)
+	{
+		// only the byte counts of the rows up to the last row of the region are needed to find the region's data
+		const unsigned int lastRow = extents.y + extents.regionHeight;
+		uint32_t* rowOffsets = memoryUtil::AllocateArray<uint32_t>(allocator, lastRow + 1u);
+		ReadRleRowOffsets(reader, allocator, lastRow, dataCountSize, rowOffsets);
+
+		// skip the remaining byte counts, and the data of all rows above the region
+		reader.Skip(static_cast<uint64_t>(extents.height - lastRow)*dataCountSize + rowOffsets[extents.y]);
+
+		const uint32_t rleDataSize = rowOffsets[lastRow] - rowOffsets[extents.y];
+		if (rleDataSize == 0u)
+		{
+			memoryUtil::FreeArray(allocator, rowOffsets);
+			return false;
+		}
+
+		void* stagingData = nullptr;
+		const uint8_t* rleData = static_cast<const uint8_t*>(AcquireCompressedData(reader, allocator, rleDataSize, stagingData));
+		{
+			// rows are always decompressed as a whole, and copied into the region afterwards if only parts of them are needed
+			const bool needsWholeRows = (extents.x == 0u) && (extents.regionWidth == extents.width);
+			uint8_t* rowData = needsWholeRows ? nullptr : static_cast<uint8_t*>(allocator->Allocate(extents.width*sizeof(T), 16u));
+			for (unsigned int y=0; y < extents.regionHeight; ++y)
+			{
+				const uint32_t rowStart = rowOffsets[extents.y + y] - rowOffsets[extents.y];
+				const uint32_t rowSize = rowOffsets[extents.y + y + 1u] - rowOffsets[extents.y + y];
+
+				T* regionRow = regionData + y*extents.regionStride;
+				uint8_t* dest = needsWholeRows ? reinterpret_cast<uint8_t*>(regionRow) : rowData;
+				const int rowErrorCode = imageUtil::DecompressRle(rleData + rowStart, rowSize, dest, extents.width*sizeof(T));
+				if (errorCode == 0)
+					errorCode = rowErrorCode;
+
+				if (!needsWholeRows)
+				{
+					memcpy(regionRow, rowData + extents.x*sizeof(T), extents.regionWidth*sizeof(T));
+				}
+			}
+
+			if (rowData)
+				allocator->Free(rowData);
+		}
+		ReleaseCompressedData(allocator, stagingData);
+		memoryUtil::FreeArray(allocator, rowOffsets);
+
+		EndianConvertRegion<T>(regionData, extents);
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ReadChannelRegionZip(SyncFileReader& reader, Allocator* allocator, const ChannelRegionExtents& extents, uint32_t channelSize, bool hasPrediction, T* regionData)
+	{
+		if (channelSize == 0)
+			return false;
+
+		// deflate streams cannot be entered at arbitrary positions, so all rows above the region need to be inflated.
+		// however, instead of inflating the whole channel, the data is streamed through a small window and inflating stops
+		// as soon as the last row of the region is complete.
+		void* stagingData = nullptr;
+		const uint8_t* zipData = static_cast<const uint8_t*>(AcquireCompressedData(reader, allocator, channelSize, stagingData));
+
+		tinfl_decompressor* decompressor = static_cast<tinfl_decompressor*>(allocator->Allocate(sizeof(tinfl_decompressor), 16u));
+		uint8_t* window = static_cast<uint8_t*>(allocator->Allocate(TINFL_LZ_DICT_SIZE, 16u));
+		uint8_t* rowData = static_cast<uint8_t*>(allocator->Allocate(extents.width*sizeof(T), 16u));
+		uint8_t* predictionRow = hasPrediction ? AllocatePredictionRow<T>(allocator, extents.width) : nullptr;
+		tinfl_init(decompressor);
+
+		const unsigned int rowSize = extents.width*sizeof(T);
+		const unsigned int lastRow = extents.y + extents.regionHeight;
+		unsigned int row = 0u;
+		unsigned int rowFill = 0u;
+
+		size_t zipOffset = 0u;
+		size_t windowOffset = 0u;
+		while (row < lastRow)
+		{
+			// the zipped data stream has a zlib-header
+			size_t inSize = channelSize - zipOffset;
+			size_t outSize = TINFL_LZ_DICT_SIZE - windowOffset;
+			const tinfl_status status = tinfl_decompress(decompressor, zipData + zipOffset, &inSize, window, window + windowOffset, &outSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
+			zipOffset += inSize;
+
+			// distribute the inflated bytes amongst the rows, only keeping rows inside the region
+			const uint8_t* inflated = window + windowOffset;
+			size_t inflatedSize = outSize;
+			while ((inflatedSize != 0u) && (row < lastRow))
+			{
+				const size_t count = (inflatedSize < rowSize - rowFill) ? inflatedSize : (rowSize - rowFill);
+				if (row >= extents.y)
+				{
+					memcpy(rowData + rowFill, inflated, count);
+				}
+
+				inflated += count;
+				inflatedSize -= count;
+				rowFill += static_cast<unsigned int>(count);
+
+				if (rowFill == rowSize)
+				{
+					if (row >= extents.y)
+					{
+						T* regionRow = regionData + (row - extents.y)*extents.regionStride;
+						if (hasPrediction)
+						{
+							// prediction works on whole rows, and already yields data in native endianness
+							ApplyPrediction<T>(predictionRow, rowData, extents.width, 1u);
+							memcpy(regionRow, rowData + extents.x*sizeof(T), extents.regionWidth*sizeof(T));
+						}
+						else
+						{
+							memcpy(regionRow, rowData + extents.x*sizeof(T), extents.regionWidth*sizeof(T));
+							EndianConvert<T>(regionRow, extents.regionWidth, 1u);
+						}
+					}
+
+					++row;
+					rowFill = 0u;
+				}
+			}
+
+			windowOffset = (windowOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1u);
+			if (status != TINFL_STATUS_HAS_MORE_OUTPUT)
+				break;
+		}
+
+		if (row < lastRow)
+		{
+			PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
+		}
+
+		if (predictionRow)
+			allocator->Free(predictionRow);
+
+		allocator->Free(rowData);
+		allocator->Free(window);
+		allocator->Free(decompressor);
+		ReleaseCompressedData(allocator, stagingData);
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool ReadChannelRegion(const Document* document, SyncFileReader& reader, Allocator* allocator, uint16_t compressionType, const Channel* channel, const ChannelRegionExtents& extents, T* regionData, int& errorCode)
+	{
+		if (compressionType == compressionType::RAW)
+		{
+			return ReadChannelRegionRaw<T>(reader, extents, regionData);
+		}
+		else if (compressionType == compressionType::RLE)
+		{
+			return ReadChannelRegionRLE<T>(reader, allocator, extents, GetRleDataCountSize(document), regionData, errorCode);
+		}
+		else if ((compressionType == compressionType::ZIP) || (compressionType == compressionType::ZIP_WITH_PREDICTION))
+		{
+			// just like when extracting whole layers, 32-bit data always uses prediction.
+			const bool hasPrediction = (compressionType == compressionType::ZIP_WITH_PREDICTION) || (sizeof(T) == 4u);
+			return ReadChannelRegionZip<T>(reader, allocator, extents, GetCompressedDataSize(channel), hasPrediction, regionData);
+		}
+
+		PSD_ASSERT(false, "Unsupported compression type %d", compressionType);
+		errorCode = extractionError::UNSUPPORTED_COMPRESSION_TYPE;
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int ExtractChannelRegion(const Document* document, File* file, Allocator* allocator, const Layer* layer, const Channel* channel, int32_t top, int32_t left, int32_t bottom, int32_t right, ChannelRegion* region)
+	{
+		int32_t channelTop = 0;
+		int32_t channelLeft = 0;
+		int32_t channelBottom = 0;
+		int32_t channelRight = 0;
+		GetChannelBounds(layer, channel, channelTop, channelLeft, channelBottom, channelRight);
+
+		// clip the requested region against the channel
+		region->top = (top > channelTop) ? top : channelTop;
+		region->left = (left > channelLeft) ? left : channelLeft;
+		region->bottom = (bottom < channelBottom) ? bottom : channelBottom;
+		region->right = (right < channelRight) ? right : channelRight;
+		region->data = nullptr;
+		region->type = channel->type;
+
+		if ((region->bottom <= region->top) || (region->right <= region->left))
+		{
+			// the region doesn't overlap the channel
+			region->bottom = region->top;
+			region->right = region->left;
+			return 0;
+		}
+
+		ChannelRegionExtents extents = {};
+		GetChannelExtents(layer, channel, extents.width, extents.height);
+		extents.x = static_cast<unsigned int>(region->left - channelLeft);
+		extents.y = static_cast<unsigned int>(region->top - channelTop);
+		extents.regionWidth = static_cast<unsigned int>(region->right - region->left);
+		extents.regionHeight = static_cast<unsigned int>(region->bottom - region->top);
+		extents.regionStride = extents.regionWidth;
+
+		uint32_t dataSize = 0u;
+		if (!GetPlanarDataSize(extents.regionWidth, extents.regionHeight, document->bitsPerChannel / 8u, dataSize))
+		{
+			region->bottom = region->top;
+			region->right = region->left;
+			return extractionError::CHANNEL_TOO_LARGE;
+		}
+
+		SyncFileReader reader(file);
+		reader.SetPosition(channel->fileOffset);
+
+		void* regionData = allocator->Allocate(dataSize, 16u);
+
+		int errorCode = 0;
+		bool hasData = false;
+		const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
+		if (document->bitsPerChannel == 8)
+		{
+			hasData = ReadChannelRegion<uint8_t>(document, reader, allocator, compressionType, channel, extents, static_cast<uint8_t*>(regionData), errorCode);
+		}
+		else if (document->bitsPerChannel == 16)
+		{
+			hasData = ReadChannelRegion<uint16_t>(document, reader, allocator, compressionType, channel, extents, static_cast<uint16_t*>(regionData), errorCode);
+		}
+		else if (document->bitsPerChannel == 32)
+		{
+			hasData = ReadChannelRegion<float32_t>(document, reader, allocator, compressionType, channel, extents, static_cast<float32_t*>(regionData), errorCode);
+		}
+
+		if (hasData)
+		{
+			region->data = regionData;
+		}
+		else if ((channel->type < 0) && (errorCode != extractionError::UNSUPPORTED_COMPRESSION_TYPE))
+		{
+			// masks without any planar data only have a default color, see ExtractChannel()
+			FillDefaultColor(document, regionData, dataSize, GetChannelDefaultColor(layer, channel));
+			region->data = regionData;
+		}
+		else
+		{
+			allocator->Free(regionData);
+		}
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void FillCanvasRect(T* canvasData, size_t canvasStride, int32_t top, int32_t left, int32_t bottom, int32_t right, T value)
+	{
+		for (int32_t y=top; y < bottom; ++y)
+		{
+			T* row = canvasData + static_cast<size_t>(y)*canvasStride;
+			for (int32_t x=left; x < right; ++x)
+			{
+				row[x] = value;
+			}
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int ExtractChannelToCanvas(const Document* document, File* file, Allocator* allocator, const Layer* layer, const Channel* channel, T* canvasData, size_t canvasStride)
+	{
+		const int32_t canvasWidth = static_cast<int32_t>(document->width);
+		const int32_t canvasHeight = static_cast<int32_t>(document->height);
+		const T defaultValue = ExpandDefaultColor<T>(GetChannelDefaultColor(layer, channel));
+
+		int32_t channelTop = 0;
+		int32_t channelLeft = 0;
+		int32_t channelBottom = 0;
+		int32_t channelRight = 0;
+		GetChannelBounds(layer, channel, channelTop, channelLeft, channelBottom, channelRight);
+
+		// clip the channel against the canvas, just like imageUtil::CopyLayerData() does
+		const int32_t top = (channelTop > 0) ? channelTop : 0;
+		const int32_t left = (channelLeft > 0) ? channelLeft : 0;
+		const int32_t bottom = (channelBottom < canvasHeight) ? channelBottom : canvasHeight;
+		const int32_t right = (channelRight < canvasWidth) ? channelRight : canvasWidth;
+		if ((bottom <= top) || (right <= left))
+		{
+			// the channel lies completely outside the canvas
+			FillCanvasRect(canvasData, canvasStride, 0, 0, canvasHeight, canvasWidth, defaultValue);
+			return 0;
+		}
+
+		// everything outside the channel gets the default color
+		FillCanvasRect(canvasData, canvasStride, 0, 0, top, canvasWidth, defaultValue);
+		FillCanvasRect(canvasData, canvasStride, top, 0, bottom, left, defaultValue);
+		FillCanvasRect(canvasData, canvasStride, top, right, bottom, canvasWidth, defaultValue);
+		FillCanvasRect(canvasData, canvasStride, bottom, 0, canvasHeight, canvasWidth, defaultValue);
+
+		ChannelRegionExtents extents = {};
+		GetChannelExtents(layer, channel, extents.width, extents.height);
+		extents.x = static_cast<unsigned int>(left - channelLeft);
+		extents.y = static_cast<unsigned int>(top - channelTop);
+		extents.regionWidth = static_cast<unsigned int>(right - left);
+		extents.regionHeight = static_cast<unsigned int>(bottom - top);
+		extents.regionStride = canvasStride;
+
+		SyncFileReader reader(file);
+		reader.SetPosition(channel->fileOffset);
+
+		// decode straight into the canvas
+		int errorCode = 0;
+		T* regionData = canvasData + static_cast<size_t>(top)*canvasStride + static_cast<size_t>(left);
+		const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
+		const bool hasData = ReadChannelRegion<T>(document, reader, allocator, compressionType, channel, extents, regionData, errorCode);
+		if (!hasData)
+		{
+			// masks without any planar data only have a default color, see ExtractChannel()
+			FillCanvasRect(canvasData, canvasStride, top, left, bottom, right, defaultValue);
+		}
+
+		return errorCode;
+	}
+
+
+	// decodes the rows of a channel one after another, from top to bottom. apart from a single decoded row, only a window
+	// of the compressed data and the inflate dictionary are kept in memory, instead of the whole channel.
+	struct ChannelRowStream
+	{
+		SyncFileReader* reader;
+		uint16_t compressionType;
+		bool hasPrediction;
+		unsigned int width;
+		unsigned int height;
+		unsigned int row;
+
+		// window into the channel's data. files that are mapped into memory hand out all the data at once.
+		uint64_t inputPosition;
+		uint64_t inputEnd;
+		const uint8_t* input;
+		uint8_t* inputBuffer;
+		uint32_t inputBufferSize;
+		uint32_t inputOffset;
+		uint32_t inputSize;
+
+		// RLE-compressed data
+		uint32_t* rowOffsets;
+
+		// ZIP-compressed data. inflated bytes that are not part of a row yet are kept in the dictionary.
+		tinfl_decompressor* decompressor;
+		uint8_t* dictionary;
+		size_t dictionaryOffset;
+		size_t pendingOffset;
+		size_t pendingSize;
+		bool isInflateDone;
+		bool hasFailed;
+
+		// the most recently decoded row, in native endianness
+		uint8_t* rowData;
+
+		// scratch row needed for applying the prediction, allocated once for all rows
+		uint8_t* predictionRow;
+	};
+
+
+	static const uint32_t ROW_STREAM_INPUT_SIZE = 64u * 1024u;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint32_t EnsureInput(ChannelRowStream& stream, uint32_t count)
+	{
+		// makes at least count bytes available in the window, unless the end of the data is reached
+		const uint32_t available = stream.inputSize - stream.inputOffset;
+		if ((available >= count) || (!stream.inputBuffer) || (stream.inputPosition == stream.inputEnd))
+			return available;
+
+		memmove(stream.inputBuffer, stream.inputBuffer + stream.inputOffset, available);
+		stream.inputOffset = 0u;
+		stream.inputSize = available;
+
+		const uint64_t remaining = stream.inputEnd - stream.inputPosition;
+		const uint32_t readSize = (remaining < stream.inputBufferSize - available) ? static_cast<uint32_t>(remaining) : (stream.inputBufferSize - available);
+		stream.reader->SetPosition(stream.inputPosition);
+		stream.reader->Read(stream.inputBuffer + available, readSize);
+		stream.inputPosition += readSize;
+		stream.inputSize += readSize;
+
+		return stream.inputSize;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool OpenChannelRowStream(const Document* document, SyncFileReader& reader, Allocator* allocator, const Layer* layer, const Channel* channel, ChannelRowStream& stream, int& errorCode)
+	{
+		memset(&stream, 0, sizeof(ChannelRowStream));
+		stream.reader = &reader;
+		GetChannelExtents(layer, channel, stream.width, stream.height);
+
+		reader.SetPosition(channel->fileOffset);
+		stream.compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
+
+		const uint32_t rowSize = stream.width*sizeof(T);
+		uint32_t largestRowSize = rowSize;
+		uint64_t dataSize = 0u;
+		if (stream.compressionType == compressionType::RAW)
+		{
+			dataSize = static_cast<uint64_t>(rowSize)*stream.height;
+		}
+		else if (stream.compressionType == compressionType::RLE)
+		{
+			stream.rowOffsets = memoryUtil::AllocateArray<uint32_t>(allocator, stream.height + 1u);
+			dataSize = ReadRleRowOffsets(reader, allocator, stream.height, GetRleDataCountSize(document), stream.rowOffsets);
+
+			// each row needs to fit into the window as a whole
+			largestRowSize = 0u;
+			for (unsigned int i=0; i < stream.height; ++i)
+			{
+				const uint32_t size = stream.rowOffsets[i + 1u] - stream.rowOffsets[i];
+				largestRowSize = (size > largestRowSize) ? size : largestRowSize;
+			}
+		}
+		else if ((stream.compressionType == compressionType::ZIP) || (stream.compressionType == compressionType::ZIP_WITH_PREDICTION))
+		{
+			// just like when extracting whole layers, 32-bit data always uses prediction.
+			stream.hasPrediction = (stream.compressionType == compressionType::ZIP_WITH_PREDICTION) || (sizeof(T) == 4u);
+			stream.predictionRow = stream.hasPrediction ? AllocatePredictionRow<T>(allocator, stream.width) : nullptr;
+			dataSize = GetCompressedDataSize(channel);
+
+			stream.decompressor = static_cast<tinfl_decompressor*>(allocator->Allocate(sizeof(tinfl_decompressor), 16u));
+			stream.dictionary = static_cast<uint8_t*>(allocator->Allocate(TINFL_LZ_DICT_SIZE, 16u));
+			tinfl_init(stream.decompressor);
+		}
+		else
+		{
+			PSD_ASSERT(false, "Unsupported compression type %d", stream.compressionType);
+			errorCode = extractionError::UNSUPPORTED_COMPRESSION_TYPE;
+			return false;
+		}
+
+		if ((dataSize == 0u) || (rowSize == 0u))
+			return false;
+
+		stream.inputPosition = reader.GetPosition();
+		stream.inputEnd = stream.inputPosition + dataSize;
+		stream.input = (dataSize <= 0xFFFFFFFFull) ? static_cast<const uint8_t*>(reader.Map(static_cast<uint32_t>(dataSize))) : nullptr;
+		if (stream.input)
+		{
+			stream.inputPosition = stream.inputEnd;
+			stream.inputSize = static_cast<uint32_t>(dataSize);
+		}
+		else
+		{
+			stream.inputBufferSize = (largestRowSize > ROW_STREAM_INPUT_SIZE) ? largestRowSize : ROW_STREAM_INPUT_SIZE;
+			stream.inputBuffer = static_cast<uint8_t*>(allocator->Allocate(stream.inputBufferSize, 16u));
+			stream.input = stream.inputBuffer;
+		}
+
+		stream.rowData = static_cast<uint8_t*>(allocator->Allocate(rowSize, 16u));
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool InflateRow(ChannelRowStream& stream, uint32_t rowSize)
+	{
+		uint32_t rowFill = 0u;
+		uint32_t requiredInput = 1u;
+		while (rowFill < rowSize)
+		{
+			if (stream.pendingSize != 0u)
+			{
+				// hand out bytes that were inflated before, but did not belong to the previous row anymore
+				const size_t count = (stream.pendingSize < rowSize - rowFill) ? stream.pendingSize : (rowSize - rowFill);
+				memcpy(stream.rowData + rowFill, stream.dictionary + stream.pendingOffset, count);
+				stream.pendingOffset += count;
+				stream.pendingSize -= count;
+				rowFill += static_cast<uint32_t>(count);
+				continue;
+			}
+
+			if (stream.isInflateDone)
+			{
+				memset(stream.rowData + rowFill, 0, rowSize - rowFill);
+				return false;
+			}
+
+			// the zipped data stream has a zlib-header
+			const uint32_t available = EnsureInput(stream, requiredInput);
+			const bool hasMoreInput = (stream.inputPosition != stream.inputEnd);
+			size_t inSize = available;
+			size_t outSize = TINFL_LZ_DICT_SIZE - stream.dictionaryOffset;
+			const tinfl_status status = tinfl_decompress(stream.decompressor, stream.input + stream.inputOffset, &inSize, stream.dictionary, stream.dictionary + stream.dictionaryOffset, &outSize,
+				TINFL_FLAG_PARSE_ZLIB_HEADER | (hasMoreInput ? TINFL_FLAG_HAS_MORE_INPUT : 0));
+			stream.inputOffset += static_cast<uint32_t>(inSize);
+
+			stream.pendingOffset = stream.dictionaryOffset;
+			stream.pendingSize = outSize;
+			stream.dictionaryOffset = (stream.dictionaryOffset + outSize) & (TINFL_LZ_DICT_SIZE - 1u);
+
+			requiredInput = (status == TINFL_STATUS_NEEDS_MORE_INPUT) ? (available - static_cast<uint32_t>(inSize) + 1u) : 1u;
+			if ((status == TINFL_STATUS_HAS_MORE_OUTPUT) || ((status == TINFL_STATUS_NEEDS_MORE_INPUT) && hasMoreInput))
+				continue;
+
+			stream.isInflateDone = true;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int DecodeChannelRow(ChannelRowStream& stream)
+	{
+		PSD_ASSERT(stream.row < stream.height, "Row %u is out of range.", stream.row);
+
+		int errorCode = 0;
+		const uint32_t rowSize = stream.width*sizeof(T);
+		if (stream.compressionType == compressionType::RAW)
+		{
+			EnsureInput(stream, rowSize);
+			memcpy(stream.rowData, stream.input + stream.inputOffset, rowSize);
+			stream.inputOffset += rowSize;
+
+			EndianConvert<T>(stream.rowData, stream.width, 1u);
+		}
+		else if (stream.compressionType == compressionType::RLE)
+		{
+			const uint32_t rleSize = stream.rowOffsets[stream.row + 1u] - stream.rowOffsets[stream.row];
+			EnsureInput(stream, rleSize);
+			errorCode = imageUtil::DecompressRle(stream.input + stream.inputOffset, rleSize, stream.rowData, rowSize);
+			stream.inputOffset += rleSize;
+
+			EndianConvert<T>(stream.rowData, stream.width, 1u);
+		}
+		else
+		{
+			if (!InflateRow(stream, rowSize) && !stream.hasFailed)
+			{
+				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
+				stream.hasFailed = true;
+			}
+
+			if (stream.hasPrediction)
+			{
+				// prediction already yields data in native endianness
+				ApplyPrediction<T>(stream.predictionRow, stream.rowData, stream.width, 1u);
+			}
+			else
+			{
+				EndianConvert<T>(stream.rowData, stream.width, 1u);
+			}
+		}
+
+		++stream.row;
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void CloseChannelRowStream(Allocator* allocator, ChannelRowStream& stream)
+	{
+		if (stream.rowOffsets)
+			memoryUtil::FreeArray(allocator, stream.rowOffsets);
+
+		if (stream.decompressor)
+			allocator->Free(stream.decompressor);
+
+		if (stream.dictionary)
+			allocator->Free(stream.dictionary);
+
+		if (stream.inputBuffer)
+			allocator->Free(stream.inputBuffer);
+
+		if (stream.rowData)
+			allocator->Free(stream.rowData);
+
+		if (stream.predictionRow)
+			allocator->Free(stream.predictionRow);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetColorChannelCount(unsigned int mode)
+	{
+		switch (mode)
+		{
+			case colorMode::GRAYSCALE:
+			case colorMode::DUOTONE:
+				return 1u;
+
+			case colorMode::CMYK:
+				return 4u;
+
+			default:
+				return 3u;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static int ExtractLayerInterleaved(const Document* document, File* file, Allocator* allocator, const Layer* layer, void* rgbaData, size_t stride)
+	{
+		unsigned int width = 0u;
+		unsigned int height = 0u;
+		GetExtents(layer, width, height);
+		if ((width == 0u) || (height == 0u))
+			return 0;
+
+		// up to four color channels, depending on the color mode, and the transparency mask in the last slot.
+		// all of them have the same size as the layer.
+		const unsigned int ALPHA = 4u;
+		const unsigned int colorChannelCount = GetColorChannelCount(document->colorMode);
+		const Channel* channels[5] = {};
+		for (unsigned int i=0; i < layer->channelCount; ++i)
+		{
+			const int16_t type = layer->channels[i].type;
+			if (type == channelType::TRANSPARENCY_MASK)
+				channels[ALPHA] = &layer->channels[i];
+			else if ((type >= 0) && (static_cast<unsigned int>(type) < colorChannelCount))
+				channels[type] = &layer->channels[i];
+		}
+
+		// every channel gets its own stream, but all of them share a reader because reads are positional
+		SyncFileReader reader(file);
+		ChannelRowStream streams[5];
+		bool hasData[5] = {};
+		T* rows[5] = {};
+		T* defaultRow = static_cast<T*>(allocator->Allocate(width*sizeof(T), 16u));
+		FillCanvasRect<T>(defaultRow, width, 0, 0, 1, static_cast<int32_t>(width), T(0));
+
+		int errorCode = 0;
+		for (unsigned int c=0; c < 5u; ++c)
+		{
+			if (channels[c])
+			{
+				hasData[c] = OpenChannelRowStream<T>(document, reader, allocator, layer, channels[c], streams[c], errorCode);
+			}
+
+			rows[c] = hasData[c] ? reinterpret_cast<T*>(streams[c].rowData) : defaultRow;
+		}
+
+		if (errorCode != extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+		{
+			// layers without a transparency mask are fully opaque
+			const T* alphaRow = channels[ALPHA] ? rows[ALPHA] : nullptr;
+
+			uint8_t* dest = static_cast<uint8_t*>(rgbaData);
+			for (unsigned int y=0; y < height; ++y)
+			{
+				for (unsigned int c=0; c < 5u; ++c)
+				{
+					if (hasData[c])
+					{
+						const int rowErrorCode = DecodeChannelRow<T>(streams[c]);
+						if (errorCode == 0)
+							errorCode = rowErrorCode;
+					}
+				}
+
+				// each row is converted right after decoding, while it is still in the cache
+				T* rgbaRow = reinterpret_cast<T*>(dest + y*stride);
+				switch (document->colorMode)
+				{
+					case colorMode::GRAYSCALE:
+					case colorMode::DUOTONE:
+						imageUtil::ConvertGrayscaleToRgba(rows[0], alphaRow, rgbaRow, width, 1u);
+						break;
+
+					case colorMode::CMYK:
+						imageUtil::ConvertCmykToRgba(rows[0], rows[1], rows[2], rows[3], alphaRow, rgbaRow, width, 1u);
+						break;
+
+					case colorMode::LAB:
+						imageUtil::ConvertLabToRgba(rows[0], rows[1], rows[2], alphaRow, rgbaRow, width, 1u);
+						break;
+
+					default:
+						if (alphaRow)
+						{
+							imageUtil::InterleaveRGBA(rows[0], rows[1], rows[2], alphaRow, rgbaRow, width, 1u);
+						}
+						else
+						{
+							imageUtil::InterleaveRGB(rows[0], rows[1], rows[2], ExpandDefaultColor<T>(255u), rgbaRow, width, 1u);
+						}
+						break;
+				}
+			}
+		}
+
+		for (unsigned int c=0; c < 5u; ++c)
+		{
+			if (channels[c])
+				CloseChannelRowStream(allocator, streams[c]);
+		}
+		allocator->Free(defaultRow);
+
+		return errorCode;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static unsigned int GetAdditionalLayerInfoLengthSize(const Document* document, uint32_t key)
+	{
+		// in .PSB files, the blocks that can hold a lot of data store their length using 8 bytes instead of 4
+		if (document->version != 2u)
+			return sizeof(uint32_t);
+
+		switch (key)
+		{
+			case util::Key<'L', 'M', 's', 'k'>::VALUE:
+			case util::Key<'L', 'r', '1', '6'>::VALUE:
+			case util::Key<'L', 'r', '3', '2'>::VALUE:
+			case util::Key<'L', 'a', 'y', 'r'>::VALUE:
+			case util::Key<'M', 't', '1', '6'>::VALUE:
+			case util::Key<'M', 't', '3', '2'>::VALUE:
+			case util::Key<'M', 't', 'r', 'n'>::VALUE:
+			case util::Key<'A', 'l', 'p', 'h'>::VALUE:
+			case util::Key<'F', 'M', 's', 'k'>::VALUE:
+			case util::Key<'l', 'n', 'k', '2'>::VALUE:
+			case util::Key<'F', 'E', 'i', 'd'>::VALUE:
+			case util::Key<'F', 'X', 'i', 'd'>::VALUE:
+			case util::Key<'P', 'x', 'S', 'D'>::VALUE:
+				return sizeof(uint64_t);
+
+			default:
+				return sizeof(uint32_t);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t ReadLength(SyncFileReader& reader, unsigned int lengthSize)
+	{
+		if (lengthSize == sizeof(uint64_t))
+			return fileUtil::ReadFromFileBE<uint64_t>(reader);
+
+		return fileUtil::ReadFromFileBE<uint32_t>(reader);
+	}
+
+
+	// descriptors hold a number of items, each consisting of a key and a typed value. keys are stored either as 4-character
+	// IDs or as strings, and are both handed out as strings, e.g. "Brgh" or "useLegacy".
+	struct DescriptorItem
+	{
+		util::FixedSizeString key;
+		unsigned int depth;					// the nesting depth of the descriptor holding the item, 0 for the outermost one
+		uint32_t type;						// the OSType key of the value, e.g. 'long', 'doub' or 'bool'
+		int32_t integer;					// the value of 'long' items
+		float64_t number;					// the value of 'doub' and 'UntF' items
+		bool boolean;						// the value of 'bool' items
+	};
+
+	// called for each item of a descriptor, including the items of lists and nested descriptors
+	typedef void (*DescriptorItemFunction)(void* userData, const DescriptorItem& item);
+
+	// the values of a Brightness/Contrast adjustment, gathered from its descriptor
+	struct BrightnessContrast
+	{
+		int32_t brightness;
+		int32_t contrast;
+		bool isLegacy;
+	};
+
+	// descriptors can be nested, which is limited to this depth for guarding against malformed files
+	static const unsigned int MAX_DESCRIPTOR_DEPTH = 16u;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool SkipDescriptorData(SyncFileReader& reader, uint64_t end, uint64_t count)
+	{
+		if (reader.GetPosition() + count > end)
+			return false;
+
+		reader.Skip(count);
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadDescriptorKey(SyncFileReader& reader, uint64_t end, util::FixedSizeString& key)
+	{
+		// a length of zero denotes a 4-character ID
+		uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		if (length == 0u)
+			length = 4u;
+
+		if (reader.GetPosition() + length > end)
+			return false;
+
+		// keys never come close to the capacity of the string. should they exceed it nevertheless, they are truncated.
+		key.Clear();
+		while (length != 0u)
+		{
+			char characters[64] = {};
+			const uint32_t count = (length < sizeof(characters)) ? length : static_cast<uint32_t>(sizeof(characters));
+			reader.Read(characters, count);
+			if (key.GetLength() + count < util::FixedSizeString::CAPACITY)
+				key.Append(characters, count);
+
+			length -= count;
+		}
+
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool SkipDescriptorKey(SyncFileReader& reader, uint64_t end)
+	{
+		const uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		return SkipDescriptorData(reader, end, (length == 0u) ? 4u : length);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool SkipUnicodeString(SyncFileReader& reader, uint64_t end)
+	{
+		const uint32_t characterCount = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		return SkipDescriptorData(reader, end, characterCount*sizeof(uint16_t));
+	}
+
+
+	static bool ReadDescriptor(SyncFileReader& reader, uint64_t end, unsigned int depth, DescriptorItemFunction function, void* userData);
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool SkipReference(SyncFileReader& reader, uint64_t end)
+	{
+		const uint32_t itemCount = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		for (uint32_t i=0u; i < itemCount; ++i)
+		{
+			if (reader.GetPosition() + sizeof(uint32_t) > end)
+				return false;
+
+			const uint32_t type = fileUtil::ReadFromFileBE<uint32_t>(reader);
+			switch (type)
+			{
+				// property: name, class ID and key ID
+				case util::Key<'p', 'r', 'o', 'p'>::VALUE:
+					if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end) || !SkipDescriptorKey(reader, end))
+						return false;
+					break;
+
+				// class: name and class ID
+				case util::Key<'C', 'l', 's', 's'>::VALUE:
+					if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end))
+						return false;
+					break;
+
+				// enumerated reference: name, class ID, type ID and enum
+				case util::Key<'E', 'n', 'm', 'r'>::VALUE:
+					if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end) || !SkipDescriptorKey(reader, end) || !SkipDescriptorKey(reader, end))
+						return false;
+					break;
+
+				// offset: name, class ID and value
+				case util::Key<'r', 'e', 'l', 'e'>::VALUE:
+					if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end) || !SkipDescriptorData(reader, end, sizeof(uint32_t)))
+						return false;
+					break;
+
+				// identifier and index
+				case util::Key<'I', 'd', 'n', 't'>::VALUE:
+				case util::Key<'i', 'n', 'd', 'x'>::VALUE:
+					if (!SkipDescriptorData(reader, end, sizeof(uint32_t)))
+						return false;
+					break;
+
+				// name
+				case util::Key<'n', 'a', 'm', 'e'>::VALUE:
+					if (!SkipUnicodeString(reader, end))
+						return false;
+					break;
+
+				default:
+					return false;
 			}
 		}
 
-		// the bytes of the 32-bit float are stored in planar fashion per row, big-endian format.
-		// interleave the bytes, and store them in little-endian format at the same time.
-		uint8_t* rowData = static_cast<uint8_t*>(allocator->Allocate(width*sizeof(float32_t), 16));
+		return true;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool ReadDescriptorValue(SyncFileReader& reader, uint64_t end, unsigned int depth, DescriptorItem& item, DescriptorItemFunction function, void* userData)
+	{
+		if (reader.GetPosition() + sizeof(uint32_t) > end)
+			return false;
+
+		item.type = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		item.integer = 0;
+		item.number = 0.0;
+		item.boolean = false;
+
+		switch (item.type)
 		{
-			uint8_t* dest = static_cast<uint8_t*>(planarData);
-			for (unsigned int y=0; y < height; ++y)
+			case util::Key<'l', 'o', 'n', 'g'>::VALUE:
+				if (reader.GetPosition() + sizeof(int32_t) > end)
+					return false;
+				item.integer = fileUtil::ReadFromFileBE<int32_t>(reader);
+				break;
+
+			case util::Key<'d', 'o', 'u', 'b'>::VALUE:
+				if (reader.GetPosition() + sizeof(float64_t) > end)
+					return false;
+				item.number = fileUtil::ReadFromFileBE<float64_t>(reader);
+				break;
+
+			// unit float: the unit, e.g. '#Pxl' or '#Prc', followed by the value
+			case util::Key<'U', 'n', 't', 'F'>::VALUE:
+				if (reader.GetPosition() + sizeof(uint32_t) + sizeof(float64_t) > end)
+					return false;
+				reader.Skip(sizeof(uint32_t));
+				item.number = fileUtil::ReadFromFileBE<float64_t>(reader);
+				break;
+
+			case util::Key<'b', 'o', 'o', 'l'>::VALUE:
+				if (reader.GetPosition() + sizeof(uint8_t) > end)
+					return false;
+				item.boolean = (fileUtil::ReadFromFileBE<uint8_t>(reader) != 0u);
+				break;
+
+			// large integer
+			case util::Key<'c', 'o', 'm', 'p'>::VALUE:
+				if (!SkipDescriptorData(reader, end, sizeof(uint64_t)))
+					return false;
+				break;
+
+			case util::Key<'T', 'E', 'X', 'T'>::VALUE:
+				if (!SkipUnicodeString(reader, end))
+					return false;
+				break;
+
+			// enumerated: type ID and enum
+			case util::Key<'e', 'n', 'u', 'm'>::VALUE:
+				if (!SkipDescriptorKey(reader, end) || !SkipDescriptorKey(reader, end))
+					return false;
+				break;
+
+			// class: name and class ID
+			case util::Key<'t', 'y', 'p', 'e'>::VALUE:
+			case util::Key<'G', 'l', 'b', 'C'>::VALUE:
+				if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end))
+					return false;
+				break;
+
+			case util::Key<'O', 'b', 'j', 'c'>::VALUE:
+			case util::Key<'G', 'l', 'b', 'O'>::VALUE:
+				if (!ReadDescriptor(reader, end, depth + 1u, function, userData))
+					return false;
+				break;
+
+			// list: a number of values without keys. they are handed out using the key of the list.
+			case util::Key<'V', 'l', 'L', 's'>::VALUE:
 			{
-				// copy first row of data to backup storage, because it will be overwritten inside our loop.
-				// note that this operation cannot be done in-place, that's why we work row by row.
-				memcpy(rowData, dest, width*sizeof(float32_t));
+				if (reader.GetPosition() + sizeof(uint32_t) > end)
+					return false;
 
-				const uint8_t* src0 = rowData;
-				const uint8_t* src1 = rowData + 1*width;
-				const uint8_t* src2 = rowData + 2*width;
-				const uint8_t* src3 = rowData + 3*width;
+				// lists can hold lists and descriptors, so they count towards the nesting depth as well
+				if (depth + 1u > MAX_DESCRIPTOR_DEPTH)
+					return false;
 
-				for (unsigned int x=0; x < width; ++x)
+				const uint32_t count = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				for (uint32_t i=0u; i < count; ++i)
 				{
-					// write data in little-endian format
-					dest[0] = *src3++;
-					dest[1] = *src2++;
-					dest[2] = *src1++;
-					dest[3] = *src0++;
-					dest += 4u;
+					if (!ReadDescriptorValue(reader, end, depth + 1u, item, function, userData))
+						return false;
 				}
+
+				// the list itself is not handed out
+				return true;
+			}
+
+			case util::Key<'o', 'b', 'j', ' '>::VALUE:
+				if (!SkipReference(reader, end))
+					return false;
+				break;
+
+			// raw data: length followed by the data
+			case util::Key<'a', 'l', 'i', 's'>::VALUE:
+			case util::Key<'t', 'd', 't', 'a'>::VALUE:
+			case util::Key<'P', 't', 'h', ' '>::VALUE:
+			{
+				if (reader.GetPosition() + sizeof(uint32_t) > end)
+					return false;
+
+				const uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				if (!SkipDescriptorData(reader, end, length))
+					return false;
+				break;
+			}
+
+			// unit floats: the unit and the number of values, followed by the values
+			case util::Key<'U', 'n', 'F', 'l'>::VALUE:
+			{
+				if (reader.GetPosition() + 2u*sizeof(uint32_t) > end)
+					return false;
+
+				reader.Skip(sizeof(uint32_t));
+				const uint32_t count = fileUtil::ReadFromFileBE<uint32_t>(reader);
+				if (!SkipDescriptorData(reader, end, static_cast<uint64_t>(count)*sizeof(float64_t)))
+					return false;
+				break;
 			}
+
+			// without knowing the size of unknown types, the rest of the descriptor cannot be read
+			default:
+				return false;
 		}
 
-		allocator->Free(rowData);
+		function(userData, item);
+		return true;
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	template <typename T>
-	static void* ReadChannelDataZipPrediction(SyncFileReader& reader, Allocator* allocator, unsigned int width, unsigned int height, uint32_t channelSize)
+	static bool ReadDescriptor(SyncFileReader& reader, uint64_t end, unsigned int depth, DescriptorItemFunction function, void* userData)
 	{
-		if (channelSize > 0)
+		if (depth > MAX_DESCRIPTOR_DEPTH)
+			return false;
+
+		// name and class ID of the descriptor
+		if (!SkipUnicodeString(reader, end) || !SkipDescriptorKey(reader, end))
+			return false;
+
+		if (reader.GetPosition() + sizeof(uint32_t) > end)
+			return false;
+
+		DescriptorItem item;
+		item.depth = depth;
+		const uint32_t itemCount = fileUtil::ReadFromFileBE<uint32_t>(reader);
+		for (uint32_t i=0u; i < itemCount; ++i)
 		{
-			const unsigned int size = width*height;
+			if (reader.GetPosition() + sizeof(uint32_t) > end)
+				return false;
 
-			T* planarData = static_cast<T*>(allocator->Allocate(size*sizeof(T), 16));
+			if (!ReadDescriptorKey(reader, end, item.key))
+				return false;
 
-			void* zipData = allocator->Allocate(channelSize, 4u);
-			reader.Read(zipData, channelSize);
+			if (!ReadDescriptorValue(reader, end, depth, item, function, userData))
+				return false;
+		}
 
-			// the zipped data stream has a zlib-header
-			const size_t status = tinfl_decompress_mem_to_mem(planarData, size*sizeof(T), zipData, channelSize, TINFL_FLAG_PARSE_ZLIB_HEADER);
-			if (status == TINFL_DECOMPRESS_MEM_TO_MEM_FAILED)
-			{
-				PSD_ERROR("PsdExtract", "Error while unzipping channel data.");
-			}
+		return true;
+	}
 
-			allocator->Free(zipData);
 
-			// the data generated by applying the prediction data is already in little-endian format, so it doesn't have to be
-			// endian converted further.
-			ApplyPrediction<T>(allocator, planarData, width, height);
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ReadBrightnessContrastItem(void* userData, const DescriptorItem& item)
+	{
+		// nested descriptors may use the same keys for other purposes
+		BrightnessContrast* adjustment = static_cast<BrightnessContrast*>(userData);
+		if (item.depth != 0u)
+			return;
 
-			return planarData;
+		if (item.type == util::Key<'l', 'o', 'n', 'g'>::VALUE)
+		{
+			if (item.key.IsEqual("Brgh"))
+				adjustment->brightness = item.integer;
+			else if (item.key.IsEqual("Cntr"))
+				adjustment->contrast = item.integer;
+		}
+		else if (item.type == util::Key<'b', 'o', 'o', 'l'>::VALUE)
+		{
+			if (item.key.IsEqual("useLegacy"))
+				adjustment->isLegacy = item.boolean;
 		}
-
-		return nullptr;
 	}
 
 
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
-	static LayerMaskSection* ParseLayer(const Document* document, SyncFileReader& reader, Allocator* allocator, uint64_t sectionOffset, uint32_t sectionLength, uint32_t layerLength)
+	static LayerMaskSection* ParseLayer(const Document* document, SyncFileReader& reader, Allocator* allocator, uint64_t sectionOffset, uint64_t sectionLength, uint64_t layerLength)
 	{
+		// .PSB files store the length of channel data and the length of the layer info using 8 bytes instead of 4
+		const unsigned int lengthSize = (document->version == 2u) ? sizeof(uint64_t) : sizeof(uint32_t);
+
 		LayerMaskSection* layerMaskSection = memoryUtil::Allocate<LayerMaskSection>(allocator);
 		layerMaskSection->layers = nullptr;
 		layerMaskSection->layerCount = 0u;
@@ -540,8 +1831,11 @@ PSD_NAMESPACE_BEGIN
 				layer->sheetColorKey = 0u;
 				layer->hasGradientFill = false;
 				layer->hasBrightnessContrast = false;
+				layer->isBrightnessContrastLegacy = false;
 				layer->brightness = 0u;
 				layer->contrast = 0u;
+				layer->hasLevels = false;
+				memset(layer->levels, 0, sizeof(layer->levels));
 
 				layer->top = fileUtil::ReadFromFileBE<int32_t>(reader);
 				layer->left = fileUtil::ReadFromFileBE<int32_t>(reader);
@@ -561,7 +1855,7 @@ PSD_NAMESPACE_BEGIN
 					channel->fileOffset = 0ull;
 					channel->data = nullptr;
 					channel->type = fileUtil::ReadFromFileBE<int16_t>(reader);
-					channel->size = fileUtil::ReadFromFileBE<uint32_t>(reader);
+					channel->size = ReadLength(reader, lengthSize);
 				}
 
 				// blend mode signature must be '8BIM'
@@ -713,8 +2007,9 @@ PSD_NAMESPACE_BEGIN
 					const uint32_t key = fileUtil::ReadFromFileBE<uint32_t>(reader);
 
 					// length needs to be rounded to an even number
-					uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					length = bitUtil::RoundUpToMultiple(length, 2u);
+					const unsigned int infoLengthSize = GetAdditionalLayerInfoLengthSize(document, key);
+					uint64_t length = ReadLength(reader, infoLengthSize);
+					length = bitUtil::RoundUpToMultiple<uint64_t>(length, 2u);
 
 					// read "Section divider setting" to identify whether a layer is a group, or a section divider
 					if (key == util::Key<'l', 's', 'c', 't'>::VALUE)
@@ -785,80 +2080,67 @@ PSD_NAMESPACE_BEGIN
 					// Brightness and Contrast adjustment layer // Deprecated
 					else if (key == util::Key<'b', 'r', 'i', 't'>::VALUE)
 					{
-						reader.Skip(length);
+						// newer files store the same adjustment in the CgEd descriptor, which takes precedence
+						if (!layer->hasBrightnessContrast && (length >= 7u))
+						{
+							layer->hasBrightnessContrast = true;
+							layer->isBrightnessContrastLegacy = true;
+							layer->brightness = static_cast<uint32_t>(static_cast<int32_t>(fileUtil::ReadFromFileBE<int16_t>(reader)));
+							layer->contrast = static_cast<uint32_t>(static_cast<int32_t>(fileUtil::ReadFromFileBE<int16_t>(reader)));
+							reader.Skip(length - 4u);
+						}
+						else
+						{
+							reader.Skip(length);
+						}
 					}
 					// Content Generator Extra Data
 					else if (key == util::Key<'C', 'g', 'E', 'd'>::VALUE)
 					{
-						uint32_t read = 0u;
-						uint32_t CgEdVersion = fileUtil::ReadFromFileBE<uint32_t>(reader);
-						uint32_t descriptorCounts = fileUtil::ReadFromFileBE<uint32_t>(reader);
-						uint32_t unknown1 = fileUtil::ReadFromFileBE<uint32_t>(reader);
-						uint16_t unknown2 = fileUtil::ReadFromFileBE<uint16_t>(reader);
-
-						uint32_t nullKey = fileUtil::ReadFromFileBE<uint32_t>(reader);
-						read += 18;
-						if (nullKey == util::Key<'n', 'u', 'l', 'l'>::VALUE)
+						// version, descriptor version and the descriptor holding the Brightness/Contrast adjustment
+						const uint64_t end = reader.GetPosition() + length;
+						if (length >= 2u*sizeof(uint32_t))
 						{
-							uint32_t itemsNum = fileUtil::ReadFromFileBE<uint32_t>(reader);
-							read += 4;
-							for (uint32_t c = 0u; c < itemsNum; ++c)
+							const uint32_t version = fileUtil::ReadFromFileBE<uint32_t>(reader);
+							const uint32_t descriptorVersion = fileUtil::ReadFromFileBE<uint32_t>(reader);
+
+							// the adjustment is only taken over once the whole descriptor has been read
+							BrightnessContrast adjustment = { 0, 0, false };
+							if ((version == 1u) && (descriptorVersion == 16u) && ReadDescriptor(reader, end, 0u, &ReadBrightnessContrastItem, &adjustment))
 							{
-								uint32_t keyLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
-								read += 4;
-								if (keyLength == 0)
-								{
-									uint32_t keyName = fileUtil::ReadFromFileBE<uint32_t>(reader);
-									uint32_t keyType = fileUtil::ReadFromFileBE<uint32_t>(reader);
-									read += 8;
-									if (keyType == util::Key<'l', 'o', 'n', 'g'>::VALUE)
-									{
-										if (keyName == util::Key<'B', 'r', 'g', 'h'>::VALUE)
-										{
-											uint32_t brightness = fileUtil::ReadFromFileBE<uint32_t>(reader);
-											layer->brightness = brightness;
-										}
-										else if (keyName == util::Key<'C', 'n', 't', 'r'>::VALUE )
-										{
-											uint32_t contrast = fileUtil::ReadFromFileBE<uint32_t>(reader);
-											layer->contrast = contrast;
-										}
-										else
-										{
-											reader.Skip(4u);
-										}
-										read += 4u;
-									}
-									else if (keyType == util::Key<'b', 'o', 'o', 'l'>::VALUE)
-									{
-										reader.Skip(1u);
-										read += 1u;
-									}
-								}
-								else
-								{
-									reader.Skip(keyLength);
-									uint32_t keyType = fileUtil::ReadFromFileBE<uint32_t>(reader);
-									read += keyLength + 4;
-									if (keyType == util::Key<'l', 'o', 'n', 'g'>::VALUE)
-									{
-										reader.Skip(4u);
-										read += 4u;
-									}
-									else if (keyType == util::Key<'b', 'o', 'o', 'l'>::VALUE)
-									{
-										reader.Skip(1u);
-										read += 1u;
-									}
-								}
+								layer->hasBrightnessContrast = true;
+								layer->isBrightnessContrastLegacy = adjustment.isLegacy;
+								layer->brightness = static_cast<uint32_t>(adjustment.brightness);
+								layer->contrast = static_cast<uint32_t>(adjustment.contrast);
 							}
 						}
-						reader.Skip(length - read);
+						reader.SetPosition(end);
 					}
-					// Levels
+					// Levels adjustment layer
 					else if (key == util::Key<'l', 'e', 'v', 'l'>::VALUE)
 					{
-						reader.Skip(length);
+						// version, followed by 29 records of which the first four hold the levels of the composite, red, green and blue
+						// channel. the remaining records, and the extra data for even more channels, are of no use for RGB.
+						const uint64_t end = reader.GetPosition() + length;
+						if (length >= sizeof(uint16_t) + 4u*sizeof(LevelsRecord))
+						{
+							const uint16_t version = fileUtil::ReadFromFileBE<uint16_t>(reader);
+							if (version == 2u)
+							{
+								for (unsigned int c=0; c < 4u; ++c)
+								{
+									LevelsRecord& levels = layer->levels[c];
+									levels.inputFloor = fileUtil::ReadFromFileBE<uint16_t>(reader);
+									levels.inputCeiling = fileUtil::ReadFromFileBE<uint16_t>(reader);
+									levels.outputFloor = fileUtil::ReadFromFileBE<uint16_t>(reader);
+									levels.outputCeiling = fileUtil::ReadFromFileBE<uint16_t>(reader);
+									levels.gamma = fileUtil::ReadFromFileBE<uint16_t>(reader);
+								}
+
+								layer->hasLevels = true;
+							}
+						}
+						reader.SetPosition(end);
 					}
 					// Gradient Fill adjustment layer
 					else if (key == util::Key<'G', 'd', 'F', 'l'>::VALUE)
@@ -871,7 +2153,7 @@ PSD_NAMESPACE_BEGIN
 						reader.Skip(length);
 					}
 
-					toRead -= 3*sizeof(uint32_t) + length;
+					toRead -= 2*sizeof(uint32_t) + infoLengthSize + length;
 				}
 			}
 
@@ -893,8 +2175,8 @@ PSD_NAMESPACE_BEGIN
 		if (sectionLength > 0)
 		{
 			// start loading at the global layer mask info section, located after the Layer Information Section.
-			// note that the 4 bytes that stored the length of the section are not included in the length itself.
-			const uint64_t globalInfoSectionOffset = sectionOffset + layerLength + 4u;
+			// note that the 4 (or 8) bytes that stored the length of the section are not included in the length itself.
+			const uint64_t globalInfoSectionOffset = sectionOffset + layerLength + lengthSize;
 			reader.SetPosition(globalInfoSectionOffset);
 
 			// work out how many bytes are left to read at this point. we need that to figure out the size of the last
@@ -937,8 +2219,9 @@ PSD_NAMESPACE_BEGIN
 					const uint32_t key = fileUtil::ReadFromFileBE<uint32_t>(reader);
 
 					// again, length is rounded to a multiple of 4
-					uint32_t length = fileUtil::ReadFromFileBE<uint32_t>(reader);
-					length = bitUtil::RoundUpToMultiple(length, 4u);
+					const unsigned int infoLengthSize = GetAdditionalLayerInfoLengthSize(document, key);
+					uint64_t length = ReadLength(reader, infoLengthSize);
+					length = bitUtil::RoundUpToMultiple<uint64_t>(length, 4u);
 
 					if (key == util::Key<'L', 'r', '1', '6'>::VALUE)
 					{
@@ -969,7 +2252,7 @@ PSD_NAMESPACE_BEGIN
 						reader.Skip(length);
 					}
 
-					toRead -= 3u*sizeof(uint32_t) + length;
+					toRead -= 2u*sizeof(uint32_t) + infoLengthSize + length;
 				}
 			}
 		}
@@ -994,10 +2277,12 @@ LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Al
 		return nullptr;
 	}
 
-	SyncFileReader reader(file);
+	SyncFileReader reader(file, allocator, SyncFileReader::DEFAULT_BUFFER_SIZE);
 	reader.SetPosition(section.offset);
 
-	const uint32_t layerInfoSectionLength = fileUtil::ReadFromFileBE<uint32_t>(reader);
+	const uint64_t layerInfoSectionLength = (document->version == 2u)
+		? fileUtil::ReadFromFileBE<uint64_t>(reader)
+		: fileUtil::ReadFromFileBE<uint32_t>(reader);
 	LayerMaskSection* layerMaskSection = ParseLayer(document, reader, allocator, section.offset, section.length, layerInfoSectionLength);
 
 	// build the layer hierarchy
@@ -1037,35 +2322,27 @@ LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Al
 }
 
 
-// ---------------------------------------------------------------------------------------------------------------------
-// ---------------------------------------------------------------------------------------------------------------------
-int ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer)
+namespace
 {
-	PSD_ASSERT_NOT_NULL(file);
-	PSD_ASSERT_NOT_NULL(allocator);
-	PSD_ASSERT_NOT_NULL(layer);
-
-	/* Error codes:
-	 *		0 = OK
-	 *		1 = Malformed RLE
-	 *		2 = RLE exceeds destination buffer
-	 *		3 = Unsupported compression type
-	 */
-
-	SyncFileReader reader(file);
-
-	int errorCode = 0;
-
-	const unsigned int channelCount = layer->channelCount;
-	for (unsigned int i=0; i < channelCount; ++i)
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static int ExtractChannel(const Document* document, File* file, Allocator* allocator, Layer* layer, Channel* channel, ThreadPool* threadPool)
 	{
-		Channel* channel = &layer->channels[i];
+		// every channel uses its own reader. reads are positional, so several channels can be extracted from the same file in parallel.
+		SyncFileReader reader(file);
 		reader.SetPosition(channel->fileOffset);
 
+		int errorCode = 0;
+
 		unsigned int width = 0u;
 		unsigned int height = 0u;
 		GetChannelExtents(layer, channel, width, height);
 
+		// all readers below rely on the planar data not exceeding 4 GB
+		uint32_t planarDataSize = 0u;
+		if (!GetPlanarDataSize(width, height, document->bitsPerChannel / 8u, planarDataSize))
+			return extractionError::CHANNEL_TOO_LARGE;
+
 		// channel data is stored in 4 different formats, which is denoted by a 2-byte integer
 		PSD_ASSERT(channel->data == nullptr, "Channel data has already been loaded.");
 		const uint16_t compressionType = fileUtil::ReadFromFileBE<uint16_t>(reader);
@@ -1088,23 +2365,20 @@ int ExtractLayer(const Document* document, File* file, Allocator* allocator, Lay
 		{
 			if (document->bitsPerChannel == 8)
 			{
-				channel->data = ReadChannelDataRLE<uint8_t>(reader, allocator, width, height, errorCode);
+				channel->data = ReadChannelDataRLE<uint8_t>(reader, allocator, width, height, GetRleDataCountSize(document), threadPool, errorCode);
 			}
 			else if (document->bitsPerChannel == 16)
 			{
-				channel->data = ReadChannelDataRLE<uint16_t>(reader, allocator, width, height, errorCode);
+				channel->data = ReadChannelDataRLE<uint16_t>(reader, allocator, width, height, GetRleDataCountSize(document), threadPool, errorCode);
 			}
 			else if (document->bitsPerChannel == 32)
 			{
-				channel->data = ReadChannelDataRLE<float32_t>(reader, allocator, width, height, errorCode);
+				channel->data = ReadChannelDataRLE<float32_t>(reader, allocator, width, height, GetRleDataCountSize(document), threadPool, errorCode);
 			}
 		}
 		else if (compressionType == compressionType::ZIP)
 		{
-			// note that we need to subtract 2 bytes from the channel data size because we already read the uint16_t
-			// for the compression type.
-			PSD_ASSERT(channel->size >= 2, "Invalid channel data size %d.", channel->size);
-			const uint32_t channelDataSize = channel->size - 2u;
+			const uint32_t channelDataSize = GetCompressedDataSize(channel);
 			if (document->bitsPerChannel == 8)
 			{
 				channel->data = ReadChannelDataZip<uint8_t>(reader, allocator, width, height, channelDataSize);
@@ -1122,10 +2396,7 @@ int ExtractLayer(const Document* document, File* file, Allocator* allocator, Lay
 		}
 		else if (compressionType == compressionType::ZIP_WITH_PREDICTION)
 		{
-			// note that we need to subtract 2 bytes from the channel data size because we already read the uint16_t
-			// for the compression type.
-			PSD_ASSERT(channel->size >= 2, "Invalid channel data size %d.", channel->size);
-			const uint32_t channelDataSize = channel->size - 2u;
+			const uint32_t channelDataSize = GetCompressedDataSize(channel);
 			if (document->bitsPerChannel == 8)
 			{
 				channel->data = ReadChannelDataZipPrediction<uint8_t>(reader, allocator, width, height, channelDataSize);
@@ -1142,7 +2413,7 @@ int ExtractLayer(const Document* document, File* file, Allocator* allocator, Lay
 		else
 		{
 			PSD_ASSERT(false, "Unsupported compression type %d", compressionType);
-			return 3;
+			return extractionError::UNSUPPORTED_COMPRESSION_TYPE;
 		}
 
 		// if the channel doesn't have any data assigned to it, check if it is a mask channel of any kind.
@@ -1153,9 +2424,8 @@ int ExtractLayer(const Document* document, File* file, Allocator* allocator, Lay
 			if (channel->type < 0)
 			{
 				// this is a layer mask, so create planar data for it
-				const size_t dataSize = width * height * document->bitsPerChannel / 8u;
-				void* channelData = allocator->Allocate(dataSize, 16u);
-				memset(channelData, GetChannelDefaultColor(layer, channel), dataSize);
+				void* channelData = allocator->Allocate(planarDataSize, 16u);
+				FillDefaultColor(document, channelData, planarDataSize, GetChannelDefaultColor(layer, channel));
 				channel->data = channelData;
 			}
 			else
@@ -1163,48 +2433,319 @@ int ExtractLayer(const Document* document, File* file, Allocator* allocator, Lay
 				// for layers like groups and group end markers ("</Layer group>") it is ok to not store any data
 			}
 		}
+
+		return errorCode;
 	}
 
-	// now move channel data to our own data structures for layer and vector masks, invalidating the info stored in
-	// that channel.
-	for (unsigned int i=0; i < channelCount; ++i)
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void MoveChannelsToMasks(Layer* layer)
 	{
-		Channel* channel = &layer->channels[i];
-		if (channel->type == channelType::LAYER_OR_VECTOR_MASK)
+		// now move channel data to our own data structures for layer and vector masks, invalidating the info stored in
+		// that channel.
+		const unsigned int channelCount = layer->channelCount;
+		for (unsigned int i=0; i < channelCount; ++i)
 		{
-			if (layer->vectorMask)
+			Channel* channel = &layer->channels[i];
+			if (channel->type == channelType::LAYER_OR_VECTOR_MASK)
 			{
-				// layer has a vector mask, so this type always denotes the vector mask
-				PSD_ASSERT(!layer->vectorMask->data, "Vector mask data has already been assigned.");
-				MoveChannelToMask(channel, layer->vectorMask);
+				if (layer->vectorMask)
+				{
+					// layer has a vector mask, so this type always denotes the vector mask
+					PSD_ASSERT(!layer->vectorMask->data, "Vector mask data has already been assigned.");
+					MoveChannelToMask(channel, layer->vectorMask);
+				}
+				else if (layer->layerMask)
+				{
+					// we don't have a vector but a layer mask, so this type denotes the layer mask
+					PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
+					MoveChannelToMask(channel, layer->layerMask.get());
+				}
+				else
+				{
+					PSD_ASSERT(false, "The code failed to create a mask for this type internally. This should never happen.");
+				}
 			}
-			else if (layer->layerMask)
+			else if (channel->type == channelType::LAYER_MASK)
 			{
-				// we don't have a vector but a layer mask, so this type denotes the layer mask
+				PSD_ASSERT(layer->layerMask, "Layer mask must already exist.");
 				PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
 				MoveChannelToMask(channel, layer->layerMask.get());
 			}
 			else
 			{
-				PSD_ASSERT(false, "The code failed to create a mask for this type internally. This should never happen.");
+				// this channel is either a color channel, or the transparency mask. those should be stored in our channel array,
+				// so there's nothing to do.
 			}
 		}
-		else if (channel->type == channelType::LAYER_MASK)
+	}
+
+
+	struct ChannelJob
+	{
+		Layer* layer;
+		Channel* channel;
+		unsigned int layerIndex;
+		int errorCode;
+	};
+
+
+	struct ExtractChannelsData
+	{
+		const Document* document;
+		File* file;
+		Allocator* allocator;
+		ThreadPool* threadPool;
+		ChannelJob* jobs;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void ExtractChannelTask(void* userData, unsigned int index)
+	{
+		ExtractChannelsData* data = static_cast<ExtractChannelsData*>(userData);
+		ChannelJob& job = data->jobs[index];
+		job.errorCode = ExtractChannel(data->document, data->file, data->allocator, job.layer, job.channel, data->threadPool);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer)
+{
+	return ExtractLayer(document, file, allocator, layer, nullptr);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, ThreadPool* threadPool)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+
+	int errorCode = 0;
+
+	const unsigned int channelCount = layer->channelCount;
+	for (unsigned int i=0; i < channelCount; ++i)
+	{
+		const int channelErrorCode = ExtractChannel(document, file, allocator, layer, &layer->channels[i], threadPool);
+		if (channelErrorCode == extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+			return extractionError::UNSUPPORTED_COMPRESSION_TYPE;
+
+		if (errorCode == 0)
+			errorCode = channelErrorCode;
+	}
+
+	MoveChannelsToMasks(layer);
+
+	return errorCode;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int ExtractLayers(const Document* document, File* file, Allocator* allocator, Layer* layers, unsigned int layerCount, ThreadPool* threadPool)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	// returns the first error encountered, in layer order, using the same error codes as ExtractLayer().
+	// note that the allocator and the file are used from several threads at the same time.
+	int errorCode = 0;
+	if (!threadPool)
+	{
+		for (unsigned int i=0; i < layerCount; ++i)
 		{
-			PSD_ASSERT(layer->layerMask, "Layer mask must already exist.");
-			PSD_ASSERT(!layer->layerMask->data, "Layer mask data has already been assigned.");
-			MoveChannelToMask(channel, layer->layerMask.get());
+			const int layerErrorCode = ExtractLayer(document, file, allocator, &layers[i]);
+			if (errorCode == 0)
+				errorCode = layerErrorCode;
 		}
-		else
+
+		return errorCode;
+	}
+
+	// channels rather than layers are distributed amongst the threads, which balances the load better in documents
+	// containing only a few large layers. RLE-compressed channels are additionally split into bands of rows.
+	unsigned int jobCount = 0u;
+	for (unsigned int i=0; i < layerCount; ++i)
+	{
+		jobCount += layers[i].channelCount;
+	}
+
+	ChannelJob* jobs = memoryUtil::AllocateArray<ChannelJob>(allocator, jobCount);
+	{
+		unsigned int jobIndex = 0u;
+		for (unsigned int i=0; i < layerCount; ++i)
+		{
+			Layer* layer = &layers[i];
+			for (unsigned int j=0; j < layer->channelCount; ++j)
+			{
+				ChannelJob& job = jobs[jobIndex++];
+				job.layer = layer;
+				job.channel = &layer->channels[j];
+				job.layerIndex = i;
+				job.errorCode = 0;
+			}
+		}
+
+		// start with the largest channels so that the threads don't end up waiting for a big channel at the very end
+		std::stable_sort(jobs, jobs + jobCount, [](const ChannelJob& lhs, const ChannelJob& rhs)
+		{
+			return lhs.channel->size > rhs.channel->size;
+		});
+	}
+
+	ExtractChannelsData data = { document, file, allocator, threadPool, jobs };
+	threadPool->ParallelFor(jobCount, &ExtractChannelTask, &data);
+
+	int* layerErrorCodes = memoryUtil::AllocateArray<int>(allocator, layerCount);
+	memset(layerErrorCodes, 0, layerCount*sizeof(int));
+	for (unsigned int i=0; i < jobCount; ++i)
+	{
+		const ChannelJob& job = jobs[i];
+		int& layerErrorCode = layerErrorCodes[job.layerIndex];
+		if ((job.errorCode == extractionError::UNSUPPORTED_COMPRESSION_TYPE) || (layerErrorCode == 0))
+			layerErrorCode = job.errorCode;
+	}
+
+	for (unsigned int i=0; i < layerCount; ++i)
+	{
+		// unsupported compression types leave the layer as it is, like ExtractLayer() does
+		if (layerErrorCodes[i] != extractionError::UNSUPPORTED_COMPRESSION_TYPE)
+			MoveChannelsToMasks(&layers[i]);
+
+		if (errorCode == 0)
+			errorCode = layerErrorCodes[i];
+	}
+
+	memoryUtil::FreeArray(allocator, layerErrorCodes);
+	memoryUtil::FreeArray(allocator, jobs);
+
+	return errorCode;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+LayerRegion* ExtractLayerRegion(const Document* document, File* file, Allocator* allocator, const Layer* layer, int32_t top, int32_t left, int32_t bottom, int32_t right, int& errorCode)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+
+	// error codes are the same as the ones returned by ExtractLayer()
+	errorCode = 0;
+
+	LayerRegion* region = memoryUtil::Allocate<LayerRegion>(allocator);
+	region->channelCount = layer->channelCount;
+	region->channels = memoryUtil::AllocateArray<ChannelRegion>(allocator, layer->channelCount);
+
+	for (unsigned int i=0; i < layer->channelCount; ++i)
+	{
+		const int channelErrorCode = ExtractChannelRegion(document, file, allocator, layer, &layer->channels[i], top, left, bottom, right, &region->channels[i]);
+		if (errorCode == 0)
+			errorCode = channelErrorCode;
+	}
+
+	return region;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int ExtractLayerToCanvas(const Document* document, File* file, Allocator* allocator, const Layer* layer, void* const* canvasData, unsigned int canvasStride)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+	PSD_ASSERT_NOT_NULL(canvasData);
+
+	const unsigned int bytesPerValue = document->bitsPerChannel / 8u;
+	PSD_ASSERT(canvasStride >= document->width*bytesPerValue, "Canvas stride %u is smaller than a row of the canvas.", canvasStride);
+	PSD_ASSERT((canvasStride % bytesPerValue) == 0u, "Canvas stride %u must be a multiple of the size of a value.", canvasStride);
+
+	int errorCode = 0;
+	for (unsigned int i=0; i < layer->channelCount; ++i)
+	{
+		if (!canvasData[i])
+			continue;
+
+		int channelErrorCode = 0;
+		const size_t stride = canvasStride / bytesPerValue;
+		if (document->bitsPerChannel == 8)
+		{
+			channelErrorCode = ExtractChannelToCanvas(document, file, allocator, layer, &layer->channels[i], static_cast<uint8_t*>(canvasData[i]), stride);
+		}
+		else if (document->bitsPerChannel == 16)
+		{
+			channelErrorCode = ExtractChannelToCanvas(document, file, allocator, layer, &layer->channels[i], static_cast<uint16_t*>(canvasData[i]), stride);
+		}
+		else if (document->bitsPerChannel == 32)
 		{
-			// this channel is either a color channel, or the transparency mask. those should be stored in our channel array,
-			// so there's nothing to do.
+			channelErrorCode = ExtractChannelToCanvas(document, file, allocator, layer, &layer->channels[i], static_cast<float32_t*>(canvasData[i]), stride);
 		}
+
+		if (errorCode == 0)
+			errorCode = channelErrorCode;
 	}
+
 	return errorCode;
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int ExtractLayerInterleaved(const Document* document, File* file, Allocator* allocator, const Layer* layer, void* rgbaData, unsigned int stride)
+{
+	PSD_ASSERT_NOT_NULL(file);
+	PSD_ASSERT_NOT_NULL(allocator);
+	PSD_ASSERT_NOT_NULL(layer);
+	PSD_ASSERT_NOT_NULL(rgbaData);
+	PSD_ASSERT((document->colorMode == colorMode::RGB) || (document->colorMode == colorMode::GRAYSCALE) || (document->colorMode == colorMode::DUOTONE) ||
+		(document->colorMode == colorMode::CMYK) || (document->colorMode == colorMode::LAB), "Interleaved extraction doesn't support color mode %u.", document->colorMode);
+
+	const unsigned int bytesPerPixel = 4u * document->bitsPerChannel / 8u;
+	PSD_ASSERT(stride >= static_cast<unsigned int>(layer->right - layer->left)*bytesPerPixel, "Stride %u is smaller than a row of the layer.", stride);
+
+	if (document->bitsPerChannel == 8)
+	{
+		return ExtractLayerInterleaved<uint8_t>(document, file, allocator, layer, rgbaData, stride);
+	}
+	else if (document->bitsPerChannel == 16)
+	{
+		return ExtractLayerInterleaved<uint16_t>(document, file, allocator, layer, rgbaData, stride);
+	}
+	else if (document->bitsPerChannel == 32)
+	{
+		return ExtractLayerInterleaved<float32_t>(document, file, allocator, layer, rgbaData, stride);
+	}
+
+	return 0;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void DestroyLayerRegion(LayerRegion*& region, Allocator* allocator)
+{
+	PSD_ASSERT_NOT_NULL(region);
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	for (unsigned int i=0; i < region->channelCount; ++i)
+	{
+		allocator->Free(region->channels[i].data);
+	}
+
+	memoryUtil::FreeArray(allocator, region->channels);
+	memoryUtil::Free(allocator, region);
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void DestroyLayerMaskSection(LayerMaskSection*& section, Allocator* allocator)
@@ -11,6 +11,8 @@ class File;
 class Allocator;
 struct Layer;
 struct LayerMaskSection;
+struct LayerRegion;
+class ThreadPool;
 
 
 /// \ingroup Parser
@@ -24,9 +26,58 @@ LayerMaskSection* ParseLayerMaskSection(const Document* document, File* file, Al
 /// \ingroup Parser
 /// Extracts data for a given \a layer.
 /// \remark It is valid and suggested to extract the data of individual layers from multiple threads in parallel.
-/// \return Returns \b 0 if there was no error, otherwise error code is returned.
+/// \return Returns \b 0 if there was no error, otherwise one of the codes in \ref extractionError is returned.
 int ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer);
 
+/// \ingroup Parser
+/// Extracts data for a given \a layer like \ref ExtractLayer, decompressing bands of rows of RLE-compressed channels in parallel
+/// using the threads of \a threadPool. This speeds up extracting single layers that are very tall, e.g. background layers.
+/// If \a threadPool is a nullptr, this is equivalent to calling \ref ExtractLayer.
+/// \return Returns \b 0 if there was no error, otherwise one of the codes in \ref extractionError is returned.
+int ExtractLayer(const Document* document, File* file, Allocator* allocator, Layer* layer, ThreadPool* threadPool);
+
+/// \ingroup Parser
+/// Extracts data for \a layerCount layers in parallel, distributing the work amongst the threads of \a threadPool.
+/// If \a threadPool is a nullptr, all layers are extracted on the calling thread.
+/// \remark Both \a file and \a allocator are used from several threads at the same time, and therefore must be thread-safe.
+/// \return Returns \b 0 if there was no error, otherwise the first error code in layer order as returned by \ref ExtractLayer.
+int ExtractLayers(const Document* document, File* file, Allocator* allocator, Layer* layers, unsigned int layerCount, ThreadPool* threadPool);
+
+/// \ingroup Parser
+/// Extracts the data of all channels of a given \a layer that lies inside the rectangle given by \a top, \a left, \a bottom and \a right,
+/// in canvas coordinates, and returns a newly created instance that needs to be freed by a call to \ref DestroyLayerRegion.
+/// The rectangle is clipped against the bounds of each channel, and only the rows inside the clipped rectangle are decoded.
+/// This is much cheaper than calling \ref ExtractLayer when only a small part of a large layer is needed, e.g. to display a tile.
+/// \remark The \a layer itself is not altered, and it is valid to extract different regions from multiple threads in parallel.
+/// \remark \a errorCode is \b 0 if there was no error, otherwise it holds one of the error codes returned by \ref ExtractLayer.
+LayerRegion* ExtractLayerRegion(const Document* document, File* file, Allocator* allocator, const Layer* layer, int32_t top, int32_t left, int32_t bottom, int32_t right, int& errorCode);
+
+/// \ingroup Parser
+/// Extracts the data of all channels of a given \a layer directly into canvas-sized buffers provided by the caller, without
+/// allocating any layer-sized buffers. \a canvasData holds one destination for each channel of the layer, destinations that are a
+/// nullptr are skipped. Each destination holds document->height rows of document->width values, with rows being \a canvasStride bytes apart.
+/// Channels are clipped against the canvas like \ref imageUtil::CopyLayerData does, and the rest of the canvas is filled with the
+/// default color of the mask for layer and vector masks, and with zero for all other channels.
+/// \remark The \a layer itself is not altered, and it is valid to extract different layers from multiple threads in parallel.
+/// \return Returns \b 0 if there was no error, otherwise the first error code in channel order as returned by \ref ExtractLayer.
+int ExtractLayerToCanvas(const Document* document, File* file, Allocator* allocator, const Layer* layer, void* const* canvasData, unsigned int canvasStride);
+
+/// \ingroup Parser
+/// Extracts the color and transparency channels of a given \a layer and writes them as interleaved RGBA pixels into \a rgbaData,
+/// without allocating any planar buffers. The destination holds layer->bottom - layer->top rows of layer->right - layer->left pixels,
+/// with rows being \a stride bytes apart. Channels are decoded row by row, so only a few rows of each channel are held in memory at any time.
+/// Documents using other color modes than RGB are converted to RGB row by row while decoding, see \ref imageUtil::ConvertGrayscaleToRgba,
+/// \ref imageUtil::ConvertCmykToRgba and \ref imageUtil::ConvertLabToRgba. Layers without a transparency mask are written fully opaque.
+/// \remark Documents using \ref colorMode::RGB, \ref colorMode::GRAYSCALE, \ref colorMode::DUOTONE, \ref colorMode::CMYK and \ref colorMode::LAB
+/// are supported, with 8, 16 or 32 bits per channel. Indexed and bitmap documents cannot contain layers.
+/// \remark The \a layer itself is not altered, and it is valid to extract different layers from multiple threads in parallel.
+/// \return Returns \b 0 if there was no error, otherwise the first error code as returned by \ref ExtractLayer.
+int ExtractLayerInterleaved(const Document* document, File* file, Allocator* allocator, const Layer* layer, void* rgbaData, unsigned int stride);
+
+/// \ingroup Parser
+/// Destroys and nullifies the given \a region previously created by a call to \ref ExtractLayerRegion.
+void DestroyLayerRegion(LayerRegion*& region, Allocator* allocator);
+
 /// \ingroup Parser
 /// Destroys and nullifies the given \a section previously created by a call to \ref ParseLayerMaskSection.
 void DestroyLayerMaskSection(LayerMaskSection*& section, Allocator* allocator);
@@ -0,0 +1,229 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdPremultiply.h"
+
+#include "PsdPremultiplyKernels.h"
+#include "PsdSimd.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void BuildKernelTable(simd::Level::Enum level, imageUtil::PremultiplyKernelTable* table)
+	{
+		// the scalar kernels are used for levels without dedicated kernels, e.g. SSSE3 doesn't add anything over SSE2
+		imageUtil::RegisterPremultiplyKernels<imageUtil::ScalarVector>(&table->kernels8);
+		imageUtil::RegisterPremultiplyKernels<imageUtil::ScalarVector>(&table->kernels16);
+		imageUtil::RegisterPremultiplyKernels<imageUtil::ScalarVector>(&table->kernels32);
+
+#if PSD_SIMD_X86
+		if (level == simd::Level::NEON)
+			return;
+
+		if (level >= simd::Level::AVX512)
+			imageUtil::RegisterPremultiplyKernelsAVX512(table);
+		else if (level >= simd::Level::AVX2)
+			imageUtil::RegisterPremultiplyKernelsAVX2(table);
+		else if (level >= simd::Level::SSE2)
+			imageUtil::RegisterPremultiplyKernelsSSE2(table);
+#elif PSD_SIMD_NEON
+		if (level == simd::Level::NEON)
+			imageUtil::RegisterPremultiplyKernelsNEON(table);
+#else
+		PSD_UNUSED(level);
+#endif
+	}
+
+
+	struct KernelTables
+	{
+		KernelTables(void)
+		{
+			for (unsigned int i=0; i < simd::Level::COUNT; ++i)
+			{
+				BuildKernelTable(static_cast<simd::Level::Enum>(i), &tables[i]);
+			}
+		}
+
+		imageUtil::PremultiplyKernelTable tables[simd::Level::COUNT];
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static const imageUtil::PremultiplyKernelTable& GetKernelTable(void)
+	{
+		static const KernelTables kernelTables;
+		return kernelTables.tables[simd::GetLevel()];
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ApplyToChannel(typename imageUtil::PremultiplyKernels<T>::ChannelFunction kernel, T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		// the kernels work on single rows, which keeps the pixel count within range for large documents
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			kernel(channel + offset, alpha + offset, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void ApplyToRGBA(typename imageUtil::PremultiplyKernels<T>::InterleavedFunction kernel, T* rgba, unsigned int width, unsigned int height)
+	{
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			kernel(rgba + offset*4u, width);
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static void InterleavePremultiplied(const imageUtil::PremultiplyKernels<T>& kernels, const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		for (unsigned int y=0; y < height; ++y)
+		{
+			const size_t offset = static_cast<size_t>(y) * width;
+			kernels.interleaveRGBA(srcR + offset, srcG + offset, srcB + offset, srcA + offset, dest + offset*4u, width);
+		}
+	}
+}
+
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyChannel(uint8_t* PSD_RESTRICT channel, const uint8_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<uint8_t>(GetKernelTable().kernels8.premultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyChannel(uint16_t* PSD_RESTRICT channel, const uint16_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<uint16_t>(GetKernelTable().kernels16.premultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyChannel(float32_t* PSD_RESTRICT channel, const float32_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<float32_t>(GetKernelTable().kernels32.premultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyChannel(uint8_t* PSD_RESTRICT channel, const uint8_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<uint8_t>(GetKernelTable().kernels8.unpremultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyChannel(uint16_t* PSD_RESTRICT channel, const uint16_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<uint16_t>(GetKernelTable().kernels16.unpremultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyChannel(float32_t* PSD_RESTRICT channel, const float32_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height)
+	{
+		ApplyToChannel<float32_t>(GetKernelTable().kernels32.unpremultiplyChannel, channel, alpha, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyRGBA(uint8_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<uint8_t>(GetKernelTable().kernels8.premultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyRGBA(uint16_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<uint16_t>(GetKernelTable().kernels16.premultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void PremultiplyRGBA(float32_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<float32_t>(GetKernelTable().kernels32.premultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyRGBA(uint8_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<uint8_t>(GetKernelTable().kernels8.unpremultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyRGBA(uint16_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<uint16_t>(GetKernelTable().kernels16.unpremultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void UnpremultiplyRGBA(float32_t* rgba, unsigned int width, unsigned int height)
+	{
+		ApplyToRGBA<float32_t>(GetKernelTable().kernels32.unpremultiplyRGBA, rgba, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void InterleaveRGBAPremultiplied(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		InterleavePremultiplied(GetKernelTable().kernels8, srcR, srcG, srcB, srcA, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void InterleaveRGBAPremultiplied(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		InterleavePremultiplied(GetKernelTable().kernels16, srcR, srcG, srcB, srcA, dest, width, height);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void InterleaveRGBAPremultiplied(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height)
+	{
+		InterleavePremultiplied(GetKernelTable().kernels32, srcR, srcG, srcB, srcA, dest, width, height);
+	}
+}
+
+PSD_NAMESPACE_END
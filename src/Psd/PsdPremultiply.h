@@ -0,0 +1,98 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// Multiplies one plane of 8-bit color data with the corresponding \a alpha values, in place. Any number of planar channels can be
+	/// premultiplied by calling this function once per channel.
+	/// \remark Buffers don't need to be aligned.
+	void PremultiplyChannel(uint8_t* PSD_RESTRICT channel, const uint8_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Multiplies one plane of 16-bit color data with the corresponding \a alpha values, in place. Alpha values are expected in the
+	/// range [0, 32768] used by Photoshop.
+	/// \sa PremultiplyChannel
+	void PremultiplyChannel(uint16_t* PSD_RESTRICT channel, const uint16_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Multiplies one plane of 32-bit color data with the corresponding \a alpha values, in place.
+	/// \sa PremultiplyChannel
+	void PremultiplyChannel(float32_t* PSD_RESTRICT channel, const float32_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Divides one plane of premultiplied 8-bit color data by the corresponding \a alpha values, in place. Fully transparent pixels
+	/// end up black.
+	/// \remark Buffers don't need to be aligned.
+	void UnpremultiplyChannel(uint8_t* PSD_RESTRICT channel, const uint8_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Divides one plane of premultiplied 16-bit color data by the corresponding \a alpha values, in place.
+	/// \sa UnpremultiplyChannel
+	void UnpremultiplyChannel(uint16_t* PSD_RESTRICT channel, const uint16_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Divides one plane of premultiplied 32-bit color data by the corresponding \a alpha values, in place. Colors are not clamped,
+	/// so high dynamic range values above 1.0 survive a round trip through \ref PremultiplyChannel.
+	/// \sa UnpremultiplyChannel
+	void UnpremultiplyChannel(float32_t* PSD_RESTRICT channel, const float32_t* PSD_RESTRICT alpha, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Multiplies the color of interleaved 8-bit RGBA data with its alpha, in place.
+	/// \remark Buffers don't need to be aligned.
+	void PremultiplyRGBA(uint8_t* rgba, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Multiplies the color of interleaved 16-bit RGBA data with its alpha, in place. Alpha values are expected in the range [0, 32768].
+	/// \sa PremultiplyRGBA
+	void PremultiplyRGBA(uint16_t* rgba, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Multiplies the color of interleaved 32-bit RGBA data with its alpha, in place.
+	/// \sa PremultiplyRGBA
+	void PremultiplyRGBA(float32_t* rgba, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Divides the color of premultiplied, interleaved 8-bit RGBA data by its alpha, in place. Fully transparent pixels end up black.
+	/// \remark Buffers don't need to be aligned.
+	void UnpremultiplyRGBA(uint8_t* rgba, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Divides the color of premultiplied, interleaved 16-bit RGBA data by its alpha, in place.
+	/// \sa UnpremultiplyRGBA
+	void UnpremultiplyRGBA(uint16_t* rgba, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Divides the color of premultiplied, interleaved 32-bit RGBA data by its alpha, in place. Colors are not clamped, so high
+	/// dynamic range values above 1.0 survive a round trip through \ref PremultiplyRGBA.
+	/// \sa UnpremultiplyRGBA
+	void UnpremultiplyRGBA(float32_t* rgba, unsigned int width, unsigned int height);
+
+
+	/// \ingroup ImageUtil
+	/// Turns planar 8-bit RGBA data into interleaved, premultiplied RGBA data. This does the work of \ref InterleaveRGBA and
+	/// \ref PremultiplyRGBA in a single pass over the data.
+	/// The destination buffer \a dest must hold "width*height*4" bytes.
+	/// \remark Buffers don't need to be aligned.
+	void InterleaveRGBAPremultiplied(const uint8_t* PSD_RESTRICT srcR, const uint8_t* PSD_RESTRICT srcG, const uint8_t* PSD_RESTRICT srcB, const uint8_t* PSD_RESTRICT srcA, uint8_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 16-bit RGBA data into interleaved, premultiplied RGBA data.
+	/// \sa InterleaveRGBAPremultiplied
+	void InterleaveRGBAPremultiplied(const uint16_t* PSD_RESTRICT srcR, const uint16_t* PSD_RESTRICT srcG, const uint16_t* PSD_RESTRICT srcB, const uint16_t* PSD_RESTRICT srcA, uint16_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+
+	/// \ingroup ImageUtil
+	/// Turns planar 32-bit RGBA data into interleaved, premultiplied RGBA data.
+	/// \sa InterleaveRGBAPremultiplied
+	void InterleaveRGBAPremultiplied(const float32_t* PSD_RESTRICT srcR, const float32_t* PSD_RESTRICT srcG, const float32_t* PSD_RESTRICT srcB, const float32_t* PSD_RESTRICT srcA, float32_t* PSD_RESTRICT dest, unsigned int width, unsigned int height);
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,235 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdVector_Scalar.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	/// \ingroup ImageUtil
+	/// \brief Implementations of the alpha premultiplication for one pixel type and one \ref simd::Level.
+	/// \details Each kernel works on \a count pixels, and has to deal with pixels that don't fill a whole SIMD register itself.
+	/// \sa PremultiplyChannel UnpremultiplyChannel PremultiplyRGBA UnpremultiplyRGBA InterleaveRGBAPremultiplied
+	template <typename T>
+	struct PremultiplyKernels
+	{
+		typedef void (*ChannelFunction)(T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha, unsigned int count);
+		typedef void (*InterleavedFunction)(T* rgba, unsigned int count);
+		typedef void (*InterleaveFunction)(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count);
+
+		ChannelFunction premultiplyChannel;
+		ChannelFunction unpremultiplyChannel;
+		InterleavedFunction premultiplyRGBA;
+		InterleavedFunction unpremultiplyRGBA;
+		InterleaveFunction interleaveRGBA;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// \brief The premultiplication kernels used for all pixel types at one \ref simd::Level.
+	struct PremultiplyKernelTable
+	{
+		PremultiplyKernels<uint8_t> kernels8;
+		PremultiplyKernels<uint16_t> kernels16;
+		PremultiplyKernels<float32_t> kernels32;
+	};
+
+
+	/// \ingroup ImageUtil
+	/// Each of these replaces the kernels in \a table with the ones for the given instruction set.
+	/// \remark The functions are only available when compiling for the corresponding architecture.
+	void RegisterPremultiplyKernelsSSE2(PremultiplyKernelTable* table);
+	void RegisterPremultiplyKernelsAVX2(PremultiplyKernelTable* table);
+	void RegisterPremultiplyKernelsAVX512(PremultiplyKernelTable* table);
+	void RegisterPremultiplyKernelsNEON(PremultiplyKernelTable* table);
+
+
+	// like the blend kernels, the premultiplication is implemented once, generic over the vector types found in PsdVector_SSE2.h and
+	// friends. all math is done in floats normalized to [0, 1].
+	namespace
+	{
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Premultiply(typename V::Type color, typename V::Type alpha)
+		{
+			return V::Mul(color, alpha);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V>
+		PSD_INLINE typename V::Type Unpremultiply(typename V::Type color, typename V::Type alpha)
+		{
+			// the division yields garbage for transparent pixels, which is discarded by the select. the result is not clamped:
+			// storing 8-bit and 16-bit values saturates anyway, and 32-bit values may legitimately exceed 1.0.
+			const typename V::Type unpremultiplied = V::Div(color, alpha);
+			return V::Select(V::LessEqual(alpha, V::Splat(0.0f)), V::Splat(0.0f), unpremultiplied);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void PremultiplyChannelPixels(T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha)
+		{
+			V::StoreMask(channel, Premultiply<V>(V::LoadMask(channel), V::LoadMask(alpha)));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void UnpremultiplyChannelPixels(T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha)
+		{
+			V::StoreMask(channel, Unpremultiply<V>(V::LoadMask(channel), V::LoadMask(alpha)));
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void PremultiplyRGBAPixels(T* rgba)
+		{
+			typename V::Type r, g, b, a;
+			V::Load(rgba, r, g, b, a);
+			V::Store(rgba, Premultiply<V>(r, a), Premultiply<V>(g, a), Premultiply<V>(b, a), a);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void UnpremultiplyRGBAPixels(T* rgba)
+		{
+			typename V::Type r, g, b, a;
+			V::Load(rgba, r, g, b, a);
+			V::Store(rgba, Unpremultiply<V>(r, a), Unpremultiply<V>(g, a), Unpremultiply<V>(b, a), a);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		PSD_INLINE void InterleavePremultipliedPixels(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest)
+		{
+			const typename V::Type a = V::LoadMask(srcA);
+			V::Store(dest, Premultiply<V>(V::LoadMask(srcR), a), Premultiply<V>(V::LoadMask(srcG), a), Premultiply<V>(V::LoadMask(srcB), a), a);
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void PremultiplyChannelKernel(T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				PremultiplyChannelPixels<V>(channel + i, alpha + i);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				PremultiplyChannelPixels<ScalarVector>(channel + i, alpha + i);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void UnpremultiplyChannelKernel(T* PSD_RESTRICT channel, const T* PSD_RESTRICT alpha, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				UnpremultiplyChannelPixels<V>(channel + i, alpha + i);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				UnpremultiplyChannelPixels<ScalarVector>(channel + i, alpha + i);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void PremultiplyRGBAKernel(T* rgba, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				PremultiplyRGBAPixels<V>(rgba + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				PremultiplyRGBAPixels<ScalarVector>(rgba + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void UnpremultiplyRGBAKernel(T* rgba, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				UnpremultiplyRGBAPixels<V>(rgba + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				UnpremultiplyRGBAPixels<ScalarVector>(rgba + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void InterleavePremultipliedKernel(const T* PSD_RESTRICT srcR, const T* PSD_RESTRICT srcG, const T* PSD_RESTRICT srcB, const T* PSD_RESTRICT srcA, T* PSD_RESTRICT dest, unsigned int count)
+		{
+			unsigned int i = 0u;
+			for (; i + V::WIDTH <= count; i += V::WIDTH)
+			{
+				InterleavePremultipliedPixels<V>(srcR + i, srcG + i, srcB + i, srcA + i, dest + i*4u);
+			}
+
+			// remaining pixels
+			for (; i < count; ++i)
+			{
+				InterleavePremultipliedPixels<ScalarVector>(srcR + i, srcG + i, srcB + i, srcA + i, dest + i*4u);
+			}
+		}
+
+
+		// ---------------------------------------------------------------------------------------------------------------------
+		// ---------------------------------------------------------------------------------------------------------------------
+		template <class V, typename T>
+		void RegisterPremultiplyKernels(PremultiplyKernels<T>* kernels)
+		{
+			kernels->premultiplyChannel = &PremultiplyChannelKernel<V, T>;
+			kernels->unpremultiplyChannel = &UnpremultiplyChannelKernel<V, T>;
+			kernels->premultiplyRGBA = &PremultiplyRGBAKernel<V, T>;
+			kernels->unpremultiplyRGBA = &UnpremultiplyRGBAKernel<V, T>;
+			kernels->interleaveRGBA = &InterleavePremultipliedKernel<V, T>;
+		}
+	}
+}
+
+PSD_NAMESPACE_END
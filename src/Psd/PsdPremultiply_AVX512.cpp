@@ -0,0 +1,26 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdPremultiplyKernels.h"
+
+#include "PsdVector_AVX512.h"
+
+
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	void RegisterPremultiplyKernelsAVX512(PremultiplyKernelTable* table)
+	{
+		RegisterPremultiplyKernels<VectorAVX512>(&table->kernels8);
+		RegisterPremultiplyKernels<VectorAVX512>(&table->kernels16);
+		RegisterPremultiplyKernels<VectorAVX512>(&table->kernels32);
+	}
+}
+
+PSD_NAMESPACE_END
+#endif
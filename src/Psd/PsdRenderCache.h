@@ -0,0 +1,29 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+struct RenderCacheState;
+
+
+/// \ingroup Types
+/// \class RenderCache
+/// \brief A struct holding a flattened image of a document that can be updated incrementally, as created by \ref CreateRenderCache.
+/// \details The canvas is split into the same tiles used by \ref FlattenDocument, and the cache remembers which layers overlap each tile.
+/// Updating the cache after the properties of some layers have changed only re-renders the tiles overlapped by these layers.
+/// \sa UpdateRenderCache
+struct RenderCache
+{
+	void* canvasData;					///< The flattened image, holding document->height rows of document->width interleaved RGBA pixels.
+	unsigned int stride;				///< The number of bytes between two rows of the flattened image.
+
+	uint64_t tilesRecomposited;			///< The number of tiles that have been rendered, including the ones rendered when creating the cache.
+	uint64_t tilesReused;				///< The number of tiles that were left untouched by updates, because none of the changed layers overlaps them.
+
+	RenderCacheState* state;			///< Internal state, e.g. the layers overlapping each tile.
+};
+
+PSD_NAMESPACE_END
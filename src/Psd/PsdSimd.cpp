@@ -0,0 +1,204 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdSimd.h"
+
+#include <atomic>
+
+#if PSD_SIMD_X86
+	#if PSD_USE_MSVC
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+#if PSD_SIMD_X86
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void Cpuid(unsigned int leaf, unsigned int subLeaf, unsigned int registers[4])
+	{
+#if PSD_USE_MSVC
+		int info[4] = {};
+		__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subLeaf));
+		for (unsigned int i=0; i < 4u; ++i)
+		{
+			registers[i] = static_cast<unsigned int>(info[i]);
+		}
+#else
+		registers[0] = registers[1] = registers[2] = registers[3] = 0u;
+		__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t GetEnabledXsaveFeatures(void)
+	{
+		// the intrinsic needs -mxsave with GCC and Clang, which we don't want to enable for the whole translation unit
+#if PSD_USE_MSVC
+		return _xgetbv(0);
+#else
+		unsigned int eax = 0u;
+		unsigned int edx = 0u;
+		__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return (static_cast<uint64_t>(edx) << 32u) | eax;
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static simd::Level::Enum DetectX86Level(void)
+	{
+		unsigned int registers[4] = {};
+		Cpuid(0u, 0u, registers);
+		const unsigned int maxLeaf = registers[0];
+
+		Cpuid(1u, 0u, registers);
+		const unsigned int ecx1 = registers[2];
+		const unsigned int edx1 = registers[3];
+
+		if ((edx1 & (1u << 26u)) == 0u)
+			return simd::Level::SCALAR;
+
+		if ((ecx1 & (1u << 9u)) == 0u)
+			return simd::Level::SSE2;
+
+		// AVX registers can only be used if the OS saves them on context switches
+		const bool hasOsxsave = (ecx1 & (1u << 27u)) != 0u;
+		const bool hasAvx = (ecx1 & (1u << 28u)) != 0u;
+		if (!hasOsxsave || !hasAvx || (maxLeaf < 7u))
+			return simd::Level::SSSE3;
+
+		const uint64_t xsaveFeatures = GetEnabledXsaveFeatures();
+		if ((xsaveFeatures & 0x6u) != 0x6u)
+			return simd::Level::SSSE3;
+
+		Cpuid(7u, 0u, registers);
+		const unsigned int ebx7 = registers[1];
+		if ((ebx7 & (1u << 5u)) == 0u)
+			return simd::Level::SSSE3;
+
+		// AVX-512F and AVX-512BW, and the opmask and upper ZMM state enabled by the OS
+		const bool hasAvx512 = ((ebx7 & (1u << 16u)) != 0u) && ((ebx7 & (1u << 30u)) != 0u);
+		if (!hasAvx512 || ((xsaveFeatures & 0xE6u) != 0xE6u))
+			return simd::Level::AVX2;
+
+		return simd::Level::AVX512;
+	}
+#endif
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static simd::Level::Enum ClampLevel(simd::Level::Enum level, simd::Level::Enum detectedLevel)
+	{
+		// NEON and x86 levels don't mix
+		if ((level == simd::Level::NEON) || (detectedLevel == simd::Level::NEON))
+			return (level == detectedLevel) ? level : simd::Level::SCALAR;
+
+		return (level < detectedLevel) ? level : detectedLevel;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static simd::Level::Enum GetDefaultLevel(void)
+	{
+		const simd::Level::Enum forcedLevel = simd::Level::PSD_SIMD_LEVEL;
+		if (forcedLevel == simd::Level::AUTO)
+			return simd::DetectLevel();
+
+		return ClampLevel(forcedLevel, simd::DetectLevel());
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static std::atomic<int>& GetCurrentLevel(void)
+	{
+		static std::atomic<int> level(GetDefaultLevel());
+		return level;
+	}
+}
+
+
+namespace simd
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	Level::Enum DetectLevel(void)
+	{
+		// the CPU doesn't change while we're running
+#if PSD_SIMD_X86
+		static const Level::Enum level = DetectX86Level();
+		return level;
+#elif PSD_SIMD_NEON
+		return Level::NEON;
+#else
+		return Level::SCALAR;
+#endif
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	Level::Enum GetLevel(void)
+	{
+		return static_cast<Level::Enum>(GetCurrentLevel().load(std::memory_order_relaxed));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	Level::Enum SetLevel(Level::Enum level)
+	{
+		const Level::Enum newLevel = (level == Level::AUTO) ? GetDefaultLevel() : ClampLevel(level, DetectLevel());
+		GetCurrentLevel().store(newLevel, std::memory_order_relaxed);
+
+		return newLevel;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	const char* GetLevelName(Level::Enum level)
+	{
+		switch (level)
+		{
+			case Level::SCALAR:
+				return "Scalar";
+
+			case Level::SSE2:
+				return "SSE2";
+
+			case Level::SSSE3:
+				return "SSSE3";
+
+			case Level::AVX2:
+				return "AVX2";
+
+			case Level::AVX512:
+				return "AVX-512";
+
+			case Level::NEON:
+				return "NEON";
+
+			case Level::AUTO:
+				return "Auto";
+
+			default:
+				return "Unknown";
+		}
+	}
+}
+
+PSD_NAMESPACE_END
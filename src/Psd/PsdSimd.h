@@ -0,0 +1,73 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+// work out which family of SIMD instruction sets can be targeted by the compiler
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define PSD_SIMD_X86 1
+#else
+	#define PSD_SIMD_X86 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+	#define PSD_SIMD_NEON 1
+#else
+	#define PSD_SIMD_NEON 0
+#endif
+
+/// \def PSD_SIMD_LEVEL
+/// \ingroup Platform
+/// \brief Forces the library to use a certain \ref simd::Level instead of the best level supported by the CPU.
+/// \details Set by the PSD_SIMD_LEVEL CMake option, e.g. to SSE2 or SCALAR. Levels not supported by the CPU the library
+/// runs on are still clamped to the best supported level.
+#if !defined(PSD_SIMD_LEVEL)
+	#define PSD_SIMD_LEVEL AUTO
+#endif
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Util
+/// \namespace simd
+/// \brief Provides detection and selection of the SIMD instruction set used by the \ref imageUtil kernels.
+/// \details The level is detected once at startup, and all kernels dispatch to the implementation for the current level.
+namespace simd
+{
+	/// \brief The SIMD instruction sets that have dedicated kernel implementations.
+	/// \remark x86 levels are ordered, each level implies all levels below it.
+	struct Level
+	{
+		enum Enum
+		{
+			SCALAR,							///< Plain C++ only.
+			SSE2,							///< x86 SSE2.
+			SSSE3,							///< x86 SSSE3.
+			AVX2,							///< x86 AVX2.
+			AVX512,							///< x86 AVX-512 Foundation and Byte/Word instructions.
+			NEON,							///< ARM NEON/Advanced SIMD.
+
+			COUNT,
+			AUTO = COUNT					///< Use the best level supported by the CPU.
+		};
+	};
+
+	/// Returns the best level supported by both the CPU and the operating system.
+	Level::Enum DetectLevel(void);
+
+	/// Returns the level currently used by the kernels. Unless changed by SetLevel(), this is the detected level, or the
+	/// level forced by \ref PSD_SIMD_LEVEL.
+	Level::Enum GetLevel(void);
+
+	/// Changes the level used by the kernels, e.g. for comparing implementations against each other, and returns the
+	/// level that is actually used. Levels not supported by the CPU are clamped to the best supported level.
+	/// Passing Level::AUTO restores the default level.
+	/// \remark Kernels running on other threads at the same time use either the old or the new level.
+	Level::Enum SetLevel(Level::Enum level);
+
+	/// Returns the name of a level, e.g. "AVX2".
+	const char* GetLevelName(Level::Enum level);
+}
+
+PSD_NAMESPACE_END
@@ -5,6 +5,9 @@
 #include "PsdSyncFileReader.h"
 
 #include "PsdFile.h"
+#include "PsdAllocator.h"
+#include "PsdAssert.h"
+#include <cstring>
 
 
 PSD_NAMESPACE_BEGIN
@@ -14,14 +17,70 @@ PSD_NAMESPACE_BEGIN
 SyncFileReader::SyncFileReader(File* file)
 	: m_file(file)
 	, m_position(0ull)
+	, m_allocator(nullptr)
+	, m_buffer(nullptr)
+	, m_bufferSize(0u)
+	, m_bufferFill(0u)
+	, m_bufferPosition(0ull)
+	, m_fileSize(0ull)
 {
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+SyncFileReader::SyncFileReader(File* file, Allocator* allocator, uint32_t bufferSize)
+	: m_file(file)
+	, m_position(0ull)
+	, m_allocator(allocator)
+	, m_buffer(nullptr)
+	, m_bufferSize(bufferSize)
+	, m_bufferFill(0u)
+	, m_bufferPosition(0ull)
+	, m_fileSize(file->GetSize())
+{
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	if (bufferSize != 0u)
+	{
+		m_buffer = static_cast<uint8_t*>(allocator->Allocate(bufferSize, 16u));
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+SyncFileReader::~SyncFileReader(void)
+{
+	if (m_buffer)
+	{
+		m_allocator->Free(m_buffer);
+	}
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void SyncFileReader::Read(void* buffer, uint32_t count)
 {
+	if (m_buffer && (count < m_bufferSize))
+	{
+		// serve the read from the read-ahead window, refilling it first if it doesn't hold the requested range
+		if ((m_position < m_bufferPosition) || (m_position + count > m_bufferPosition + m_bufferFill))
+		{
+			FillBuffer();
+		}
+
+		if (m_position + count <= m_bufferPosition + m_bufferFill)
+		{
+			memcpy(buffer, m_buffer + (m_position - m_bufferPosition), count);
+			m_position += count;
+			return;
+		}
+
+		// the read extends beyond the end of the file. let the file deal with it.
+	}
+
 	// do an asynchronous read, wait until it's finished, and update the file position
 	File::ReadOperation op = m_file->Read(buffer, count, m_position);
 	m_file->WaitForRead(op);
@@ -30,6 +89,20 @@ void SyncFileReader::Read(void* buffer, uint32_t count)
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+const void* SyncFileReader::Map(uint32_t count)
+{
+	const void* data = m_file->Map(m_position, count);
+	if (data)
+	{
+		m_position += count;
+	}
+
+	return data;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 void SyncFileReader::Skip(uint64_t count)
@@ -53,4 +126,26 @@ uint64_t SyncFileReader::GetPosition(void) const
 	return m_position;
 }
 
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void SyncFileReader::FillBuffer(void)
+{
+	// read as much as fits into the window, but never beyond the end of the file
+	const uint64_t remaining = (m_position < m_fileSize) ? (m_fileSize - m_position) : 0ull;
+	const uint32_t count = (remaining < m_bufferSize) ? static_cast<uint32_t>(remaining) : m_bufferSize;
+
+	m_bufferPosition = m_position;
+	m_bufferFill = 0u;
+
+	if (count != 0u)
+	{
+		File::ReadOperation op = m_file->Read(m_buffer, count, m_position);
+		if (m_file->WaitForRead(op))
+		{
+			m_bufferFill = count;
+		}
+	}
+}
+
 PSD_NAMESPACE_END
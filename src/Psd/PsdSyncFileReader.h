@@ -7,6 +7,7 @@
 PSD_NAMESPACE_BEGIN
 
 class File;
+class Allocator;
 
 
 /// \ingroup Files
@@ -14,6 +15,9 @@ class File;
 /// \details In certain situations, working with synchronous read operations is much easier than having to deal with a number
 /// of asynchronous reads, keeping track of individual read operations. This is especially true when parsing a file sequentially,
 /// where different read operations depend on previous ones.
+/// \details When constructed with an allocator and a buffer size, the reader keeps a read-ahead window of the file in memory.
+/// Small reads such as the ones issued by \ref fileUtil::ReadFromFileBE are then served from memory, and the window is refilled
+/// from the file on demand. Reads that are at least as large as the window bypass it and go to the file directly.
 /// \sa File
 class SyncFileReader
 {
@@ -22,9 +26,24 @@ public:
 	/// \remark The given \a file must already be open.
 	explicit SyncFileReader(File* file);
 
+	/// Constructor initializing the internal read position to zero, using a read-ahead buffer of \a bufferSize bytes.
+	/// \remark The given \a file must already be open.
+	SyncFileReader(File* file, Allocator* allocator, uint32_t bufferSize);
+
+	/// Frees the read-ahead buffer, if any.
+	~SyncFileReader(void);
+
+	/// The default size of the read-ahead buffer used when parsing headers and layer records.
+	static const uint32_t DEFAULT_BUFFER_SIZE = 64u * 1024u;
+
 	/// Reads \a count bytes into \a buffer synchronously, incrementing the internal read position.
 	void Read(void* buffer, uint32_t count);
 
+	/// Returns a pointer to the next \a count bytes and increments the internal read position, if the underlying \ref File
+	/// supports mapping. Returns a nullptr and leaves the read position untouched otherwise.
+	/// \sa File::Map
+	const void* Map(uint32_t count);
+
 	/// Skips \a count bytes.
 	void Skip(uint64_t count);
 
@@ -35,8 +54,20 @@ public:
 	uint64_t GetPosition(void) const;
 
 private:
+	SyncFileReader(const SyncFileReader&);
+	SyncFileReader& operator=(const SyncFileReader&);
+
+	void FillBuffer(void);
+
 	File* m_file;
 	uint64_t m_position;
+
+	Allocator* m_allocator;
+	uint8_t* m_buffer;
+	uint32_t m_bufferSize;
+	uint32_t m_bufferFill;
+	uint64_t m_bufferPosition;
+	uint64_t m_fileSize;
 };
 
 PSD_NAMESPACE_END
@@ -0,0 +1,329 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "PsdPch.h"
+#include "PsdThreadPool.h"
+
+#include "PsdAllocator.h"
+#include "PsdMemoryUtil.h"
+#include "PsdAssert.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// all tasks of a ParallelFor() call belong to the same batch. the batch lives on the stack of the calling thread.
+	struct Batch
+	{
+		unsigned int pendingCount;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+
+	// a task executes the task function for a contiguous range of indices
+	struct Task
+	{
+		ThreadPool::TaskFunction function;
+		void* userData;
+		unsigned int begin;
+		unsigned int end;
+		Batch* batch;
+	};
+
+
+	// ParallelFor() only queues a few tasks per thread, so the queues rarely need to grow beyond their initial capacity
+	static const unsigned int INITIAL_QUEUE_CAPACITY = 32u;
+
+
+	// a ring buffer of tasks, which grows using the pool's allocator if needed
+	struct Queue
+	{
+		std::mutex mutex;
+		Task* tasks;
+		unsigned int capacity;
+		unsigned int head;
+		unsigned int count;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void Push(Allocator* allocator, Queue& queue, const Task& task)
+	{
+		if (queue.count == queue.capacity)
+		{
+			// unwrap the tasks into a buffer twice the size
+			const unsigned int capacity = queue.capacity * 2u;
+			Task* tasks = memoryUtil::AllocateArray<Task>(allocator, capacity);
+			const unsigned int firstPart = queue.capacity - queue.head;
+			memcpy(tasks, queue.tasks + queue.head, firstPart*sizeof(Task));
+			memcpy(tasks + firstPart, queue.tasks, queue.head*sizeof(Task));
+			memoryUtil::FreeArray(allocator, queue.tasks);
+
+			queue.tasks = tasks;
+			queue.capacity = capacity;
+			queue.head = 0u;
+		}
+
+		queue.tasks[(queue.head + queue.count) % queue.capacity] = task;
+		++queue.count;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static Task Pop(Queue& queue)
+	{
+		const Task task = queue.tasks[queue.head];
+		queue.head = (queue.head + 1u) % queue.capacity;
+		--queue.count;
+
+		return task;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+struct ThreadPool::Shared
+{
+	Allocator* allocator;
+	std::thread* threads;
+
+	// one queue per worker thread
+	Queue* queues;
+	unsigned int queueCount;
+	std::atomic<unsigned int> queuedTaskCount;
+	std::atomic<unsigned int> nextQueue;
+
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	bool isShuttingDown;
+};
+
+
+namespace
+{
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool TryPop(ThreadPool::Shared* shared, unsigned int preferredQueue, Task& task)
+	{
+		// look into the preferred queue first, and try stealing from all other queues afterwards
+		const unsigned int queueCount = shared->queueCount;
+		for (unsigned int i=0; i < queueCount; ++i)
+		{
+			Queue& queue = shared->queues[(preferredQueue + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.count != 0u)
+			{
+				task = Pop(queue);
+				--shared->queuedTaskCount;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void Run(const Task& task)
+	{
+		for (unsigned int i = task.begin; i < task.end; ++i)
+		{
+			task.function(task.userData, i);
+		}
+
+		// the batch must not be touched anymore once the waiting thread observed the count dropping to zero,
+		// which is why the count is only ever changed while holding the lock.
+		Batch* batch = task.batch;
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		if (--batch->pendingCount == 0u)
+		{
+			batch->finished.notify_all();
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void WorkerThread(ThreadPool::Shared* shared, unsigned int index)
+	{
+		for (;;)
+		{
+			Task task;
+			if (TryPop(shared, index, task))
+			{
+				Run(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(shared->sleepMutex);
+			shared->wakeUp.wait(lock, [shared]() { return shared->isShuttingDown || (shared->queuedTaskCount != 0u); });
+			if (shared->isShuttingDown && (shared->queuedTaskCount == 0u))
+				return;
+		}
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ThreadPool::ThreadPool(Allocator* allocator, unsigned int threadCount)
+	: m_shared(nullptr)
+{
+	PSD_ASSERT_NOT_NULL(allocator);
+
+	if (threadCount == 0u)
+	{
+		threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0u)
+			threadCount = 1u;
+	}
+
+	m_shared = memoryUtil::Allocate<Shared>(allocator);
+	m_shared->allocator = allocator;
+	m_shared->queueCount = threadCount;
+	m_shared->queuedTaskCount = 0u;
+	m_shared->nextQueue = 0u;
+	m_shared->isShuttingDown = false;
+
+	// queues and threads are not PODs, so they are constructed in place
+	m_shared->queues = static_cast<Queue*>(allocator->Allocate(threadCount*sizeof(Queue), PSD_ALIGN_OF(Queue)));
+	for (unsigned int i=0; i < threadCount; ++i)
+	{
+		Queue* queue = new (m_shared->queues + i) Queue;
+		queue->tasks = memoryUtil::AllocateArray<Task>(allocator, INITIAL_QUEUE_CAPACITY);
+		queue->capacity = INITIAL_QUEUE_CAPACITY;
+		queue->head = 0u;
+		queue->count = 0u;
+	}
+
+	m_shared->threads = static_cast<std::thread*>(allocator->Allocate(threadCount*sizeof(std::thread), PSD_ALIGN_OF(std::thread)));
+	for (unsigned int i=0; i < threadCount; ++i)
+	{
+		new (m_shared->threads + i) std::thread(WorkerThread, m_shared, i);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+ThreadPool::~ThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_shared->sleepMutex);
+		m_shared->isShuttingDown = true;
+	}
+	m_shared->wakeUp.notify_all();
+
+	Allocator* allocator = m_shared->allocator;
+	for (unsigned int i=0; i < m_shared->queueCount; ++i)
+	{
+		m_shared->threads[i].join();
+		m_shared->threads[i].~thread();
+	}
+	allocator->Free(m_shared->threads);
+
+	for (unsigned int i=0; i < m_shared->queueCount; ++i)
+	{
+		memoryUtil::FreeArray(allocator, m_shared->queues[i].tasks);
+		m_shared->queues[i].~Queue();
+	}
+	allocator->Free(m_shared->queues);
+
+	memoryUtil::Free(allocator, m_shared);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+unsigned int ThreadPool::GetThreadCount(void) const
+{
+	return m_shared->queueCount;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void ThreadPool::ParallelFor(unsigned int count, TaskFunction function, void* userData)
+{
+	PSD_ASSERT_NOT_NULL(function);
+
+	if (count == 0u)
+		return;
+
+	if (count == 1u)
+	{
+		function(userData, 0u);
+		return;
+	}
+
+	// split the indices into a few tasks per thread. this is enough for the workers to balance the load amongst
+	// themselves by stealing, without the overhead of queueing each index individually.
+	const unsigned int queueCount = m_shared->queueCount;
+	unsigned int grainSize = count / (queueCount * 4u);
+	if (grainSize == 0u)
+		grainSize = 1u;
+
+	const unsigned int taskCount = (count + grainSize - 1u) / grainSize;
+
+	Batch batch;
+	batch.pendingCount = taskCount;
+
+	const unsigned int firstQueue = m_shared->nextQueue++;
+	for (unsigned int i=0; i < taskCount; ++i)
+	{
+		Task task;
+		task.function = function;
+		task.userData = userData;
+		task.begin = i * grainSize;
+		task.end = (task.begin + grainSize < count) ? (task.begin + grainSize) : count;
+		task.batch = &batch;
+
+		Queue& queue = m_shared->queues[(firstQueue + i) % queueCount];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			Push(m_shared->allocator, queue, task);
+		}
+		++m_shared->queuedTaskCount;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_shared->sleepMutex);
+	}
+	m_shared->wakeUp.notify_all();
+
+	// help executing tasks until the queues are empty, then wait for the remaining tasks of our batch to finish
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			if (batch.pendingCount == 0u)
+				return;
+		}
+
+		Task task;
+		if (TryPop(m_shared, firstQueue, task))
+		{
+			Run(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(batch.mutex);
+		batch.finished.wait(lock, [&batch]() { return batch.pendingCount == 0u; });
+		return;
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,49 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+class Allocator;
+
+
+/// \ingroup Util
+/// \brief Simple work-stealing thread pool used for decoding and compositing in parallel.
+/// \details Each worker thread owns a queue of tasks. Workers take tasks from their own queue first, and steal tasks from
+/// other queues once their own queue runs dry, which keeps all threads busy even if tasks differ vastly in size.
+/// The thread calling ParallelFor() does not sit idle either, but helps executing tasks until all of them are finished.
+/// This also makes it safe to call ParallelFor() from within a task.
+/// All memory of the pool, including its task queues, is allocated using the \ref Allocator given upon construction. Queues only
+/// grow when many ParallelFor() calls are in flight at the same time, in which case the allocator must be thread-safe.
+class ThreadPool
+{
+public:
+	/// A function executed for each index of a ParallelFor() call.
+	typedef void (*TaskFunction)(void* userData, unsigned int index);
+
+	/// Constructor spawning \a threadCount worker threads. A \a threadCount of zero spawns one thread per hardware thread.
+	/// The \a allocator must outlive the pool.
+	ThreadPool(Allocator* allocator, unsigned int threadCount);
+
+	/// Waits for all worker threads to finish.
+	~ThreadPool(void);
+
+	/// Returns the number of worker threads.
+	unsigned int GetThreadCount(void) const;
+
+	/// Calls \a function for all indices in [0, count) in parallel, and returns once all calls have finished.
+	void ParallelFor(unsigned int count, TaskFunction function, void* userData);
+
+	/// Opaque state shared between the pool and its worker threads.
+	struct Shared;
+
+private:
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	Shared* m_shared;
+};
+
+PSD_NAMESPACE_END
@@ -0,0 +1,21 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+
+PSD_NAMESPACE_BEGIN
+
+/// \ingroup Types
+/// \namespace transferFunction
+/// \brief A namespace holding the transfer functions that can be applied when converting data to a lower bit depth.
+namespace transferFunction
+{
+	enum Enum
+	{
+		NONE = 0,								///< Values are converted as they are, e.g. for 16-bit data that is already gamma-encoded.
+		SRGB = 1								///< Linear values are encoded using the sRGB transfer curve, e.g. for 32-bit data.
+	};
+}
+
+PSD_NAMESPACE_END
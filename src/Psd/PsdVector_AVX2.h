@@ -0,0 +1,176 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+
+// the vector type must only be used by translation units compiled with the AVX2 flags, see CMakeLists.txt.
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// eight pixels per register. most AVX2 shuffles work on 128-bit lanes separately, which is why 16-bit and 32-bit pixels
+	// need an additional cross-lane permutation when being (de)interleaved.
+	struct VectorAVX2
+	{
+		typedef __m256 Type;
+		typedef __m256 Mask;
+
+		static const unsigned int WIDTH = 8u;
+
+		static PSD_INLINE Type Splat(float32_t value) { return _mm256_set1_ps(value); }
+		static PSD_INLINE Type Ramp(void) { return _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f); }
+
+		static PSD_INLINE Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+		static PSD_INLINE Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+		static PSD_INLINE Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+		static PSD_INLINE Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+		static PSD_INLINE Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+		static PSD_INLINE Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+		static PSD_INLINE Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+		static PSD_INLINE Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+		static PSD_INLINE Type Fract(Type a) { return _mm256_sub_ps(a, _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a))); }
+
+		static PSD_INLINE Mask Less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static PSD_INLINE Mask LessEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static PSD_INLINE Type Select(Mask mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+
+		static PSD_INLINE Type Gather(const float32_t* table, Type index) { return _mm256_i32gather_ps(table, _mm256_cvttps_epi32(index), 4); }
+
+		static PSD_INLINE Type ToFloat(__m256i value, float32_t scale) { return _mm256_mul_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(scale)); }
+
+		// clamps to [0, 1], and rounds to the nearest integer in [0, scale]
+		static PSD_INLINE __m256i Quantize(Type value, float32_t scale)
+		{
+			const Type clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, _mm256_set1_ps(scale)), _mm256_set1_ps(0.5f)));
+		}
+
+		static PSD_INLINE void Load(const uint8_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+			const __m256i lowByte = _mm256_set1_epi32(0xFF);
+			r = ToFloat(_mm256_and_si256(pixels, lowByte), 1.0f / 255.0f);
+			g = ToFloat(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), lowByte), 1.0f / 255.0f);
+			b = ToFloat(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), lowByte), 1.0f / 255.0f);
+			a = ToFloat(_mm256_srli_epi32(pixels, 24), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE void Load(const uint16_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			// the shuffles yield the pixels in order 0, 1, 4, 5, 2, 3, 6, 7, which is fixed by swapping the middle 64-bit blocks
+			const __m256 lo = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+			const __m256 hi = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 16)));
+			const __m256i rg = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256i ba = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0));
+
+			const __m256i lowWord = _mm256_set1_epi32(0xFFFF);
+			r = ToFloat(_mm256_and_si256(rg, lowWord), 1.0f / 32768.0f);
+			g = ToFloat(_mm256_srli_epi32(rg, 16), 1.0f / 32768.0f);
+			b = ToFloat(_mm256_and_si256(ba, lowWord), 1.0f / 32768.0f);
+			a = ToFloat(_mm256_srli_epi32(ba, 16), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE void Load(const float32_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			// pair pixel i with pixel i+4, so that a 4x4 transpose inside each lane yields all eight pixels in order
+			const __m256 p04 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src)), _mm_loadu_ps(src + 16), 1);
+			const __m256 p15 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 4)), _mm_loadu_ps(src + 20), 1);
+			const __m256 p26 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 8)), _mm_loadu_ps(src + 24), 1);
+			const __m256 p37 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + 12)), _mm_loadu_ps(src + 28), 1);
+
+			const __m256 rg01 = _mm256_unpacklo_ps(p04, p15);
+			const __m256 rg23 = _mm256_unpacklo_ps(p26, p37);
+			const __m256 ba01 = _mm256_unpackhi_ps(p04, p15);
+			const __m256 ba23 = _mm256_unpackhi_ps(p26, p37);
+
+			r = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(1, 0, 1, 0));
+			g = _mm256_shuffle_ps(rg01, rg23, _MM_SHUFFLE(3, 2, 3, 2));
+			b = _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(1, 0, 1, 0));
+			a = _mm256_shuffle_ps(ba01, ba23, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		static PSD_INLINE Type LoadMask(const uint8_t* mask)
+		{
+			return ToFloat(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask))), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const uint16_t* mask)
+		{
+			return ToFloat(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask))), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const float32_t* mask)
+		{
+			return _mm256_loadu_ps(mask);
+		}
+
+		static PSD_INLINE void Store(uint8_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m256i rg = _mm256_or_si256(Quantize(r, 255.0f), _mm256_slli_epi32(Quantize(g, 255.0f), 8));
+			const __m256i ba = _mm256_or_si256(_mm256_slli_epi32(Quantize(b, 255.0f), 16), _mm256_slli_epi32(Quantize(a, 255.0f), 24));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_or_si256(rg, ba));
+		}
+
+		static PSD_INLINE void Store(uint16_t* dest, Type r, Type g, Type b, Type a)
+		{
+			// unpacking yields pixels 0, 1, 4, 5 and 2, 3, 6, 7, so the 128-bit lanes need to be swapped around
+			const __m256i rg = _mm256_or_si256(Quantize(r, 32768.0f), _mm256_slli_epi32(Quantize(g, 32768.0f), 16));
+			const __m256i ba = _mm256_or_si256(Quantize(b, 32768.0f), _mm256_slli_epi32(Quantize(a, 32768.0f), 16));
+			const __m256i lo = _mm256_unpacklo_epi32(rg, ba);
+			const __m256i hi = _mm256_unpackhi_epi32(rg, ba);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm256_permute2x128_si256(lo, hi, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+		}
+
+		static PSD_INLINE void Store(float32_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m256 rg01 = _mm256_unpacklo_ps(r, g);
+			const __m256 ba01 = _mm256_unpacklo_ps(b, a);
+			const __m256 rg23 = _mm256_unpackhi_ps(r, g);
+			const __m256 ba23 = _mm256_unpackhi_ps(b, a);
+
+			const __m256 p04 = _mm256_shuffle_ps(rg01, ba01, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 p15 = _mm256_shuffle_ps(rg01, ba01, _MM_SHUFFLE(3, 2, 3, 2));
+			const __m256 p26 = _mm256_shuffle_ps(rg23, ba23, _MM_SHUFFLE(1, 0, 1, 0));
+			const __m256 p37 = _mm256_shuffle_ps(rg23, ba23, _MM_SHUFFLE(3, 2, 3, 2));
+
+			_mm_storeu_ps(dest, _mm256_castps256_ps128(p04));
+			_mm_storeu_ps(dest + 4, _mm256_castps256_ps128(p15));
+			_mm_storeu_ps(dest + 8, _mm256_castps256_ps128(p26));
+			_mm_storeu_ps(dest + 12, _mm256_castps256_ps128(p37));
+			_mm_storeu_ps(dest + 16, _mm256_extractf128_ps(p04, 1));
+			_mm_storeu_ps(dest + 20, _mm256_extractf128_ps(p15, 1));
+			_mm_storeu_ps(dest + 24, _mm256_extractf128_ps(p26, 1));
+			_mm_storeu_ps(dest + 28, _mm256_extractf128_ps(p37, 1));
+		}
+
+		static PSD_INLINE void StoreMask(uint8_t* dest, Type value)
+		{
+			const __m256i values = Quantize(value, 255.0f);
+			const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_packus_epi16(words, words));
+		}
+
+		static PSD_INLINE void StoreMask(uint16_t* dest, Type value)
+		{
+			const __m256i values = Quantize(value, 32768.0f);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)));
+		}
+
+		static PSD_INLINE void StoreMask(float32_t* dest, Type value)
+		{
+			_mm256_storeu_ps(dest, value);
+		}
+	};
+}
+
+PSD_NAMESPACE_END
+#endif
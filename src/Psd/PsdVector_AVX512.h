@@ -0,0 +1,172 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdSimd.h"
+
+#if PSD_SIMD_X86
+	#include <immintrin.h>
+#endif
+
+
+// the vector type must only be used by translation units compiled with the AVX512 flags, see CMakeLists.txt.
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// sixteen pixels per register. comparisons yield mask registers, and pixels are (de)interleaved using two-source
+	// permutations, which can pick any of the 32 elements of two registers.
+	// GCC implements many of the plain intrinsics by merging into an uninitialized register, which makes -Wmaybe-uninitialized
+	// fire wherever they are inlined. the zero-masking variants with all lanes enabled compile to the same instructions.
+	struct VectorAVX512
+	{
+		typedef __m512 Type;
+		typedef __mmask16 Mask;
+
+		static const unsigned int WIDTH = 16u;
+
+		static PSD_INLINE Type Splat(float32_t value) { return _mm512_set1_ps(value); }
+		static PSD_INLINE Type Ramp(void) { return _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f, 7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f); }
+
+		static PSD_INLINE Type Add(Type a, Type b) { return _mm512_add_ps(a, b); }
+		static PSD_INLINE Type Sub(Type a, Type b) { return _mm512_sub_ps(a, b); }
+		static PSD_INLINE Type Mul(Type a, Type b) { return _mm512_mul_ps(a, b); }
+		static PSD_INLINE Type Div(Type a, Type b) { return _mm512_div_ps(a, b); }
+		static PSD_INLINE Type Min(Type a, Type b) { return _mm512_maskz_min_ps(0xFFFF, a, b); }
+		static PSD_INLINE Type Max(Type a, Type b) { return _mm512_maskz_max_ps(0xFFFF, a, b); }
+		static PSD_INLINE Type Abs(Type a) { return _mm512_abs_ps(a); }
+		static PSD_INLINE Type Sqrt(Type a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+		static PSD_INLINE Type Fract(Type a) { return _mm512_sub_ps(a, _mm512_maskz_cvtepi32_ps(0xFFFF, _mm512_maskz_cvttps_epi32(0xFFFF, a))); }
+
+		static PSD_INLINE Mask Less(Type a, Type b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+		static PSD_INLINE Mask LessEqual(Type a, Type b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+		static PSD_INLINE Type Select(Mask mask, Type a, Type b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+		static PSD_INLINE Type Gather(const float32_t* table, Type index) { return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, _mm512_maskz_cvttps_epi32(0xFFFF, index), table, 4); }
+
+		static PSD_INLINE Type ToFloat(__m512i value, float32_t scale) { return _mm512_mul_ps(_mm512_maskz_cvtepi32_ps(0xFFFF, value), _mm512_set1_ps(scale)); }
+
+		// clamps to [0, 1], and rounds to the nearest integer in [0, scale]
+		static PSD_INLINE __m512i Quantize(Type value, float32_t scale)
+		{
+			const Type clamped = _mm512_maskz_min_ps(0xFFFF, _mm512_maskz_max_ps(0xFFFF, value, _mm512_setzero_ps()), _mm512_set1_ps(1.0f));
+			return _mm512_maskz_cvttps_epi32(0xFFFF, _mm512_add_ps(_mm512_mul_ps(clamped, _mm512_set1_ps(scale)), _mm512_set1_ps(0.5f)));
+		}
+
+		// indices for picking the even or odd elements of two registers, and for interleaving the lower or upper halves
+		static PSD_INLINE __m512i EvenIndices(void) { return _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0); }
+		static PSD_INLINE __m512i OddIndices(void) { return _mm512_set_epi32(31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1); }
+		static PSD_INLINE __m512i LowerIndices(void) { return _mm512_set_epi32(23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0); }
+		static PSD_INLINE __m512i UpperIndices(void) { return _mm512_set_epi32(31, 15, 30, 14, 29, 13, 28, 12, 27, 11, 26, 10, 25, 9, 24, 8); }
+
+		static PSD_INLINE void Load(const uint8_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const __m512i pixels = _mm512_loadu_si512(src);
+			const __m512i lowByte = _mm512_set1_epi32(0xFF);
+			r = ToFloat(_mm512_and_si512(pixels, lowByte), 1.0f / 255.0f);
+			g = ToFloat(_mm512_and_si512(_mm512_maskz_srli_epi32(0xFFFF, pixels, 8), lowByte), 1.0f / 255.0f);
+			b = ToFloat(_mm512_and_si512(_mm512_maskz_srli_epi32(0xFFFF, pixels, 16), lowByte), 1.0f / 255.0f);
+			a = ToFloat(_mm512_maskz_srli_epi32(0xFFFF, pixels, 24), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE void Load(const uint16_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const __m512i lo = _mm512_loadu_si512(src);
+			const __m512i hi = _mm512_loadu_si512(src + 32);
+			const __m512i rg = _mm512_permutex2var_epi32(lo, EvenIndices(), hi);
+			const __m512i ba = _mm512_permutex2var_epi32(lo, OddIndices(), hi);
+
+			const __m512i lowWord = _mm512_set1_epi32(0xFFFF);
+			r = ToFloat(_mm512_and_si512(rg, lowWord), 1.0f / 32768.0f);
+			g = ToFloat(_mm512_maskz_srli_epi32(0xFFFF, rg, 16), 1.0f / 32768.0f);
+			b = ToFloat(_mm512_and_si512(ba, lowWord), 1.0f / 32768.0f);
+			a = ToFloat(_mm512_maskz_srli_epi32(0xFFFF, ba, 16), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE void Load(const float32_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			// treating RG and BA as 64-bit pairs separates them in a first step, and R, G, B and A in a second one
+			const __m512i p0 = _mm512_loadu_si512(src);
+			const __m512i p1 = _mm512_loadu_si512(src + 16);
+			const __m512i p2 = _mm512_loadu_si512(src + 32);
+			const __m512i p3 = _mm512_loadu_si512(src + 48);
+
+			const __m512i pairEven = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+			const __m512i pairOdd = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+			const __m512i rg01 = _mm512_permutex2var_epi64(p0, pairEven, p1);
+			const __m512i rg23 = _mm512_permutex2var_epi64(p2, pairEven, p3);
+			const __m512i ba01 = _mm512_permutex2var_epi64(p0, pairOdd, p1);
+			const __m512i ba23 = _mm512_permutex2var_epi64(p2, pairOdd, p3);
+
+			r = _mm512_castsi512_ps(_mm512_permutex2var_epi32(rg01, EvenIndices(), rg23));
+			g = _mm512_castsi512_ps(_mm512_permutex2var_epi32(rg01, OddIndices(), rg23));
+			b = _mm512_castsi512_ps(_mm512_permutex2var_epi32(ba01, EvenIndices(), ba23));
+			a = _mm512_castsi512_ps(_mm512_permutex2var_epi32(ba01, OddIndices(), ba23));
+		}
+
+		static PSD_INLINE Type LoadMask(const uint8_t* mask)
+		{
+			return ToFloat(_mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask))), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const uint16_t* mask)
+		{
+			return ToFloat(_mm512_maskz_cvtepu16_epi32(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask))), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const float32_t* mask)
+		{
+			return _mm512_loadu_ps(mask);
+		}
+
+		static PSD_INLINE void Store(uint8_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m512i rg = _mm512_or_si512(Quantize(r, 255.0f), _mm512_maskz_slli_epi32(0xFFFF, Quantize(g, 255.0f), 8));
+			const __m512i ba = _mm512_or_si512(_mm512_maskz_slli_epi32(0xFFFF, Quantize(b, 255.0f), 16), _mm512_maskz_slli_epi32(0xFFFF, Quantize(a, 255.0f), 24));
+			_mm512_storeu_si512(dest, _mm512_or_si512(rg, ba));
+		}
+
+		static PSD_INLINE void Store(uint16_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m512i rg = _mm512_or_si512(Quantize(r, 32768.0f), _mm512_maskz_slli_epi32(0xFFFF, Quantize(g, 32768.0f), 16));
+			const __m512i ba = _mm512_or_si512(Quantize(b, 32768.0f), _mm512_maskz_slli_epi32(0xFFFF, Quantize(a, 32768.0f), 16));
+			_mm512_storeu_si512(dest, _mm512_permutex2var_epi32(rg, LowerIndices(), ba));
+			_mm512_storeu_si512(dest + 32, _mm512_permutex2var_epi32(rg, UpperIndices(), ba));
+		}
+
+		static PSD_INLINE void Store(float32_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m512i rg01 = _mm512_permutex2var_epi32(_mm512_castps_si512(r), LowerIndices(), _mm512_castps_si512(g));
+			const __m512i rg23 = _mm512_permutex2var_epi32(_mm512_castps_si512(r), UpperIndices(), _mm512_castps_si512(g));
+			const __m512i ba01 = _mm512_permutex2var_epi32(_mm512_castps_si512(b), LowerIndices(), _mm512_castps_si512(a));
+			const __m512i ba23 = _mm512_permutex2var_epi32(_mm512_castps_si512(b), UpperIndices(), _mm512_castps_si512(a));
+
+			const __m512i pairLower = _mm512_set_epi64(11, 3, 10, 2, 9, 1, 8, 0);
+			const __m512i pairUpper = _mm512_set_epi64(15, 7, 14, 6, 13, 5, 12, 4);
+			_mm512_storeu_si512(dest, _mm512_permutex2var_epi64(rg01, pairLower, ba01));
+			_mm512_storeu_si512(dest + 16, _mm512_permutex2var_epi64(rg01, pairUpper, ba01));
+			_mm512_storeu_si512(dest + 32, _mm512_permutex2var_epi64(rg23, pairLower, ba23));
+			_mm512_storeu_si512(dest + 48, _mm512_permutex2var_epi64(rg23, pairUpper, ba23));
+		}
+
+		static PSD_INLINE void StoreMask(uint8_t* dest, Type value)
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm512_maskz_cvtepi32_epi8(0xFFFF, Quantize(value, 255.0f)));
+		}
+
+		static PSD_INLINE void StoreMask(uint16_t* dest, Type value)
+		{
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), _mm512_maskz_cvtepi32_epi16(0xFFFF, Quantize(value, 32768.0f)));
+		}
+
+		static PSD_INLINE void StoreMask(float32_t* dest, Type value)
+		{
+			_mm512_storeu_ps(dest, value);
+		}
+	};
+}
+
+PSD_NAMESPACE_END
+#endif
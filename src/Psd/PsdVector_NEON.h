@@ -0,0 +1,181 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdSimd.h"
+
+#include <cstring>
+
+#if PSD_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+
+
+// the vector type must only be used by translation units compiled for ARM.
+#if PSD_SIMD_NEON
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// four pixels per register. 16-bit and 32-bit pixels are (de)interleaved by the structure loads and stores.
+	struct VectorNEON
+	{
+		typedef float32x4_t Type;
+		typedef uint32x4_t Mask;
+
+		static const unsigned int WIDTH = 4u;
+
+		static PSD_INLINE Type Splat(float32_t value) { return vdupq_n_f32(value); }
+		static PSD_INLINE Type Ramp(void)
+		{
+			static const float32_t ramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+			return vld1q_f32(ramp);
+		}
+
+		static PSD_INLINE Type Add(Type a, Type b) { return vaddq_f32(a, b); }
+		static PSD_INLINE Type Sub(Type a, Type b) { return vsubq_f32(a, b); }
+		static PSD_INLINE Type Mul(Type a, Type b) { return vmulq_f32(a, b); }
+		static PSD_INLINE Type Min(Type a, Type b) { return vminq_f32(a, b); }
+		static PSD_INLINE Type Max(Type a, Type b) { return vmaxq_f32(a, b); }
+		static PSD_INLINE Type Abs(Type a) { return vabsq_f32(a); }
+		static PSD_INLINE Type Fract(Type a) { return vsubq_f32(a, vcvtq_f32_s32(vcvtq_s32_f32(a))); }
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+		static PSD_INLINE Type Div(Type a, Type b) { return vdivq_f32(a, b); }
+		static PSD_INLINE Type Sqrt(Type a) { return vsqrtq_f32(a); }
+#else
+		// 32-bit ARM only has estimates, which are refined using Newton-Raphson steps
+		static PSD_INLINE Type Div(Type a, Type b)
+		{
+			Type reciprocal = vrecpeq_f32(b);
+			reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+			reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+			return vmulq_f32(a, reciprocal);
+		}
+
+		static PSD_INLINE Type Sqrt(Type a)
+		{
+			Type reciprocal = vrsqrteq_f32(a);
+			reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocal), reciprocal), reciprocal);
+			reciprocal = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a, reciprocal), reciprocal), reciprocal);
+			return vbslq_f32(vceqq_f32(a, vdupq_n_f32(0.0f)), a, vmulq_f32(a, reciprocal));
+		}
+#endif
+
+		static PSD_INLINE Mask Less(Type a, Type b) { return vcltq_f32(a, b); }
+		static PSD_INLINE Mask LessEqual(Type a, Type b) { return vcleq_f32(a, b); }
+		static PSD_INLINE Type Select(Mask mask, Type a, Type b) { return vbslq_f32(mask, a, b); }
+
+		// NEON has no gather instruction, so the lookups are done one lane at a time
+		static PSD_INLINE Type Gather(const float32_t* table, Type index)
+		{
+			const int32x4_t indices = vcvtq_s32_f32(index);
+			const float32_t values[4] = { table[vgetq_lane_s32(indices, 0)], table[vgetq_lane_s32(indices, 1)], table[vgetq_lane_s32(indices, 2)], table[vgetq_lane_s32(indices, 3)] };
+			return vld1q_f32(values);
+		}
+
+		static PSD_INLINE Type ToFloat(uint32x4_t value, float32_t scale) { return vmulq_n_f32(vcvtq_f32_u32(value), scale); }
+
+		// clamps to [0, 1], and rounds to the nearest integer in [0, scale]
+		static PSD_INLINE uint32x4_t Quantize(Type value, float32_t scale)
+		{
+			const Type clamped = vminq_f32(vmaxq_f32(value, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+			return vcvtq_u32_f32(vaddq_f32(vmulq_n_f32(clamped, scale), vdupq_n_f32(0.5f)));
+		}
+
+		static PSD_INLINE void Load(const uint8_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const uint32x4_t pixels = vreinterpretq_u32_u8(vld1q_u8(src));
+			const uint32x4_t lowByte = vdupq_n_u32(0xFFu);
+			r = ToFloat(vandq_u32(pixels, lowByte), 1.0f / 255.0f);
+			g = ToFloat(vandq_u32(vshrq_n_u32(pixels, 8), lowByte), 1.0f / 255.0f);
+			b = ToFloat(vandq_u32(vshrq_n_u32(pixels, 16), lowByte), 1.0f / 255.0f);
+			a = ToFloat(vshrq_n_u32(pixels, 24), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE void Load(const uint16_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const uint16x4x4_t pixels = vld4_u16(src);
+			r = ToFloat(vmovl_u16(pixels.val[0]), 1.0f / 32768.0f);
+			g = ToFloat(vmovl_u16(pixels.val[1]), 1.0f / 32768.0f);
+			b = ToFloat(vmovl_u16(pixels.val[2]), 1.0f / 32768.0f);
+			a = ToFloat(vmovl_u16(pixels.val[3]), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE void Load(const float32_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const float32x4x4_t pixels = vld4q_f32(src);
+			r = pixels.val[0];
+			g = pixels.val[1];
+			b = pixels.val[2];
+			a = pixels.val[3];
+		}
+
+		static PSD_INLINE Type LoadMask(const uint8_t* mask)
+		{
+			uint32_t values = 0u;
+			memcpy(&values, mask, sizeof(uint32_t));
+
+			const uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(values)));
+			return ToFloat(vmovl_u16(vget_low_u16(words)), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const uint16_t* mask)
+		{
+			return ToFloat(vmovl_u16(vld1_u16(mask)), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const float32_t* mask)
+		{
+			return vld1q_f32(mask);
+		}
+
+		static PSD_INLINE void Store(uint8_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const uint32x4_t rg = vorrq_u32(Quantize(r, 255.0f), vshlq_n_u32(Quantize(g, 255.0f), 8));
+			const uint32x4_t ba = vorrq_u32(vshlq_n_u32(Quantize(b, 255.0f), 16), vshlq_n_u32(Quantize(a, 255.0f), 24));
+			vst1q_u8(dest, vreinterpretq_u8_u32(vorrq_u32(rg, ba)));
+		}
+
+		static PSD_INLINE void Store(uint16_t* dest, Type r, Type g, Type b, Type a)
+		{
+			uint16x4x4_t pixels;
+			pixels.val[0] = vmovn_u32(Quantize(r, 32768.0f));
+			pixels.val[1] = vmovn_u32(Quantize(g, 32768.0f));
+			pixels.val[2] = vmovn_u32(Quantize(b, 32768.0f));
+			pixels.val[3] = vmovn_u32(Quantize(a, 32768.0f));
+			vst4_u16(dest, pixels);
+		}
+
+		static PSD_INLINE void Store(float32_t* dest, Type r, Type g, Type b, Type a)
+		{
+			float32x4x4_t pixels;
+			pixels.val[0] = r;
+			pixels.val[1] = g;
+			pixels.val[2] = b;
+			pixels.val[3] = a;
+			vst4q_f32(dest, pixels);
+		}
+
+		static PSD_INLINE void StoreMask(uint8_t* dest, Type value)
+		{
+			const uint8x8_t bytes = vmovn_u16(vcombine_u16(vmovn_u32(Quantize(value, 255.0f)), vdup_n_u16(0u)));
+			const uint32_t values = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+			memcpy(dest, &values, sizeof(uint32_t));
+		}
+
+		static PSD_INLINE void StoreMask(uint16_t* dest, Type value)
+		{
+			vst1_u16(dest, vmovn_u32(Quantize(value, 32768.0f)));
+		}
+
+		static PSD_INLINE void StoreMask(float32_t* dest, Type value)
+		{
+			vst1q_f32(dest, value);
+		}
+	};
+}
+
+PSD_NAMESPACE_END
+#endif
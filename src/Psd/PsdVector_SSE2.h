@@ -0,0 +1,165 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "PsdSimd.h"
+
+#include <cstring>
+
+#if PSD_SIMD_X86
+	#include <emmintrin.h>
+#endif
+
+
+// the vector type must only be used by translation units compiled with the SSE2 flags, see CMakeLists.txt.
+#if PSD_SIMD_X86
+PSD_NAMESPACE_BEGIN
+
+namespace
+{
+	// four pixels per register. 8-bit pixels fit into a 32-bit lane each, which makes (de)interleaving a matter of shifts.
+	struct VectorSSE2
+	{
+		typedef __m128 Type;
+		typedef __m128 Mask;
+
+		static const unsigned int WIDTH = 4u;
+
+		static PSD_INLINE Type Splat(float32_t value) { return _mm_set1_ps(value); }
+		static PSD_INLINE Type Ramp(void) { return _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f); }
+
+		static PSD_INLINE Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+		static PSD_INLINE Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+		static PSD_INLINE Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+		static PSD_INLINE Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+		static PSD_INLINE Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+		static PSD_INLINE Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+		static PSD_INLINE Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+		static PSD_INLINE Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+		static PSD_INLINE Type Fract(Type a) { return _mm_sub_ps(a, _mm_cvtepi32_ps(_mm_cvttps_epi32(a))); }
+
+		static PSD_INLINE Mask Less(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+		static PSD_INLINE Mask LessEqual(Type a, Type b) { return _mm_cmple_ps(a, b); }
+		static PSD_INLINE Type Select(Mask mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+		// SSE2 has no gather instruction, so the lookups are done one lane at a time
+		static PSD_INLINE Type Gather(const float32_t* table, Type index)
+		{
+			int32_t indices[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(index));
+			return _mm_set_ps(table[indices[3]], table[indices[2]], table[indices[1]], table[indices[0]]);
+		}
+
+		static PSD_INLINE Type ToFloat(__m128i value, float32_t scale) { return _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(scale)); }
+
+		// clamps to [0, 1], and rounds to the nearest integer in [0, scale]
+		static PSD_INLINE __m128i Quantize(Type value, float32_t scale)
+		{
+			const Type clamped = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(scale)), _mm_set1_ps(0.5f)));
+		}
+
+		static PSD_INLINE void Load(const uint8_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			const __m128i lowByte = _mm_set1_epi32(0xFF);
+			r = ToFloat(_mm_and_si128(pixels, lowByte), 1.0f / 255.0f);
+			g = ToFloat(_mm_and_si128(_mm_srli_epi32(pixels, 8), lowByte), 1.0f / 255.0f);
+			b = ToFloat(_mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte), 1.0f / 255.0f);
+			a = ToFloat(_mm_srli_epi32(pixels, 24), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE void Load(const uint16_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			// gather the RG and BA halves of all four pixels into separate registers
+			const __m128 lo = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+			const __m128 hi = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8)));
+			const __m128i rg = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+			const __m128i ba = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+			const __m128i lowWord = _mm_set1_epi32(0xFFFF);
+			r = ToFloat(_mm_and_si128(rg, lowWord), 1.0f / 32768.0f);
+			g = ToFloat(_mm_srli_epi32(rg, 16), 1.0f / 32768.0f);
+			b = ToFloat(_mm_and_si128(ba, lowWord), 1.0f / 32768.0f);
+			a = ToFloat(_mm_srli_epi32(ba, 16), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE void Load(const float32_t* src, Type& r, Type& g, Type& b, Type& a)
+		{
+			r = _mm_loadu_ps(src);
+			g = _mm_loadu_ps(src + 4);
+			b = _mm_loadu_ps(src + 8);
+			a = _mm_loadu_ps(src + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+		}
+
+		static PSD_INLINE Type LoadMask(const uint8_t* mask)
+		{
+			int32_t values = 0;
+			memcpy(&values, mask, sizeof(int32_t));
+
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(values), zero);
+			return ToFloat(_mm_unpacklo_epi16(words, zero), 1.0f / 255.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const uint16_t* mask)
+		{
+			const __m128i words = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask));
+			return ToFloat(_mm_unpacklo_epi16(words, _mm_setzero_si128()), 1.0f / 32768.0f);
+		}
+
+		static PSD_INLINE Type LoadMask(const float32_t* mask)
+		{
+			return _mm_loadu_ps(mask);
+		}
+
+		static PSD_INLINE void Store(uint8_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m128i rg = _mm_or_si128(Quantize(r, 255.0f), _mm_slli_epi32(Quantize(g, 255.0f), 8));
+			const __m128i ba = _mm_or_si128(_mm_slli_epi32(Quantize(b, 255.0f), 16), _mm_slli_epi32(Quantize(a, 255.0f), 24));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_or_si128(rg, ba));
+		}
+
+		static PSD_INLINE void Store(uint16_t* dest, Type r, Type g, Type b, Type a)
+		{
+			const __m128i rg = _mm_or_si128(Quantize(r, 32768.0f), _mm_slli_epi32(Quantize(g, 32768.0f), 16));
+			const __m128i ba = _mm_or_si128(Quantize(b, 32768.0f), _mm_slli_epi32(Quantize(a, 32768.0f), 16));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi32(rg, ba));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 8), _mm_unpackhi_epi32(rg, ba));
+		}
+
+		static PSD_INLINE void Store(float32_t* dest, Type r, Type g, Type b, Type a)
+		{
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			_mm_storeu_ps(dest, r);
+			_mm_storeu_ps(dest + 4, g);
+			_mm_storeu_ps(dest + 8, b);
+			_mm_storeu_ps(dest + 12, a);
+		}
+
+		static PSD_INLINE void StoreMask(uint8_t* dest, Type value)
+		{
+			const __m128i words = _mm_packs_epi32(Quantize(value, 255.0f), _mm_setzero_si128());
+			const int32_t values = _mm_cvtsi128_si32(_mm_packus_epi16(words, _mm_setzero_si128()));
+			memcpy(dest, &values, sizeof(int32_t));
+		}
+
+		static PSD_INLINE void StoreMask(uint16_t* dest, Type value)
+		{
+			// SSE2 can only pack with signed saturation, so the values are biased into the signed range and back
+			const __m128i bias = _mm_set1_epi32(32768);
+			const __m128i words = _mm_packs_epi32(_mm_sub_epi32(Quantize(value, 32768.0f), bias), _mm_setzero_si128());
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dest), _mm_xor_si128(words, _mm_set1_epi16(-32768)));
+		}
+
+		static PSD_INLINE void StoreMask(float32_t* dest, Type value)
+		{
+			_mm_storeu_ps(dest, value);
+		}
+	};
+}
+
+PSD_NAMESPACE_END
+#endif
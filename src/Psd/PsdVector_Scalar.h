@@ -0,0 +1,112 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include <cmath>
+
+
+PSD_NAMESPACE_BEGIN
+
+namespace imageUtil
+{
+	// a vector of one float, used by the scalar kernels and for the remaining pixels of all SIMD kernels.
+	// like the SIMD vector types, it is given internal linkage. all vector types normalize 16-bit values by 32768, because
+	// Photoshop stores them as 15-bit+1 integers in the range [0, 32768].
+	namespace
+	{
+		struct ScalarVector
+		{
+			typedef float32_t Type;
+			typedef bool Mask;
+
+			static const unsigned int WIDTH = 1u;
+
+			static PSD_INLINE Type Splat(float32_t value) { return value; }
+			static PSD_INLINE Type Ramp(void) { return 0.0f; }
+
+			static PSD_INLINE Type Add(Type a, Type b) { return a + b; }
+			static PSD_INLINE Type Sub(Type a, Type b) { return a - b; }
+			static PSD_INLINE Type Mul(Type a, Type b) { return a * b; }
+			static PSD_INLINE Type Div(Type a, Type b) { return a / b; }
+			static PSD_INLINE Type Min(Type a, Type b) { return (a < b) ? a : b; }
+			static PSD_INLINE Type Max(Type a, Type b) { return (a > b) ? a : b; }
+			static PSD_INLINE Type Abs(Type a) { return std::fabs(a); }
+			static PSD_INLINE Type Sqrt(Type a) { return std::sqrt(a); }
+			static PSD_INLINE Type Fract(Type a) { return a - static_cast<float32_t>(static_cast<int32_t>(a)); }
+
+			static PSD_INLINE Mask Less(Type a, Type b) { return a < b; }
+			static PSD_INLINE Mask LessEqual(Type a, Type b) { return a <= b; }
+			static PSD_INLINE Type Select(Mask mask, Type a, Type b) { return mask ? a : b; }
+
+			// looks up the entry of the \a table at the integral \a index
+			static PSD_INLINE Type Gather(const float32_t* table, Type index) { return table[static_cast<int32_t>(index)]; }
+
+			static PSD_INLINE void Load(const uint8_t* src, Type& r, Type& g, Type& b, Type& a)
+			{
+				const float32_t scale = 1.0f / 255.0f;
+				r = src[0] * scale;
+				g = src[1] * scale;
+				b = src[2] * scale;
+				a = src[3] * scale;
+			}
+
+			static PSD_INLINE void Load(const uint16_t* src, Type& r, Type& g, Type& b, Type& a)
+			{
+				const float32_t scale = 1.0f / 32768.0f;
+				r = src[0] * scale;
+				g = src[1] * scale;
+				b = src[2] * scale;
+				a = src[3] * scale;
+			}
+
+			static PSD_INLINE void Load(const float32_t* src, Type& r, Type& g, Type& b, Type& a)
+			{
+				r = src[0];
+				g = src[1];
+				b = src[2];
+				a = src[3];
+			}
+
+			static PSD_INLINE Type LoadMask(const uint8_t* mask) { return mask[0] * (1.0f / 255.0f); }
+			static PSD_INLINE Type LoadMask(const uint16_t* mask) { return mask[0] * (1.0f / 32768.0f); }
+			static PSD_INLINE Type LoadMask(const float32_t* mask) { return mask[0]; }
+
+			static PSD_INLINE void Store(uint8_t* dest, Type r, Type g, Type b, Type a)
+			{
+				dest[0] = static_cast<uint8_t>(Quantize(r, 255.0f));
+				dest[1] = static_cast<uint8_t>(Quantize(g, 255.0f));
+				dest[2] = static_cast<uint8_t>(Quantize(b, 255.0f));
+				dest[3] = static_cast<uint8_t>(Quantize(a, 255.0f));
+			}
+
+			static PSD_INLINE void Store(uint16_t* dest, Type r, Type g, Type b, Type a)
+			{
+				dest[0] = static_cast<uint16_t>(Quantize(r, 32768.0f));
+				dest[1] = static_cast<uint16_t>(Quantize(g, 32768.0f));
+				dest[2] = static_cast<uint16_t>(Quantize(b, 32768.0f));
+				dest[3] = static_cast<uint16_t>(Quantize(a, 32768.0f));
+			}
+
+			static PSD_INLINE void Store(float32_t* dest, Type r, Type g, Type b, Type a)
+			{
+				dest[0] = r;
+				dest[1] = g;
+				dest[2] = b;
+				dest[3] = a;
+			}
+
+			static PSD_INLINE void StoreMask(uint8_t* dest, Type value) { dest[0] = static_cast<uint8_t>(Quantize(value, 255.0f)); }
+			static PSD_INLINE void StoreMask(uint16_t* dest, Type value) { dest[0] = static_cast<uint16_t>(Quantize(value, 32768.0f)); }
+			static PSD_INLINE void StoreMask(float32_t* dest, Type value) { dest[0] = value; }
+
+			// clamps to [0, 1], and rounds to the nearest integer in [0, scale]
+			static PSD_INLINE int32_t Quantize(Type value, float32_t scale)
+			{
+				return static_cast<int32_t>(Min(Max(value, 0.0f), 1.0f) * scale + 0.5f);
+			}
+		};
+	}
+}
+
+PSD_NAMESPACE_END
@@ -0,0 +1,245 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+// micro-benchmarks for the image kernels of the PSD library. each kernel is run using the scalar implementation first,
+// and using the best SIMD implementation supported by the CPU afterwards, reporting the throughput of both. the
+// geometric mean speedup of the blend kernels over all blend modes on an x86-64 CPU is expected to be at least 3.5x
+// (SSE2), 6x (AVX2) and 10x (AVX-512) for 8-bit and 16-bit pixels, and at least 2x, 4x and 5x for 32-bit pixels.
+// speedups below that are reported as regressions. the RLE encoder is benchmarked on flat, noisy and gradient rows, and
+// must produce the very same output at every level. regressions and differing output make the benchmark exit with a
+// non-zero code. use the PSD_SIMD_LEVEL CMake option to benchmark levels other than the best one supported by the CPU.
+#include "../Psd/Psd.h"
+#include "../Psd/PsdPlatform.h"
+#include "../Psd/PsdBlend.h"
+#include "../Psd/PsdBlendMode.h"
+#include "../Psd/PsdDecompressRle.h"
+#include "../Psd/PsdSimd.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+PSD_USING_NAMESPACE;
+
+
+namespace
+{
+	static const unsigned int ROW_LENGTH = 4096u;
+	static const unsigned int ROW_COUNT = 64u;
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static T MakeValue(unsigned int i);
+
+	template <> uint8_t MakeValue<uint8_t>(unsigned int i) { return static_cast<uint8_t>((i * 2654435761u) >> 24u); }
+	template <> uint16_t MakeValue<uint16_t>(unsigned int i) { return static_cast<uint16_t>(((i * 2654435761u) >> 16u) % 32769u); }
+	template <> float32_t MakeValue<float32_t>(unsigned int i) { return static_cast<float32_t>((i * 2654435761u) >> 8u) / 16777215.0f; }
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static double GetExpectedBlendSpeedup(simd::Level::Enum level, unsigned int bitsPerValue)
+	{
+		const bool isFloat = (bitsPerValue == 32u);
+		switch (level)
+		{
+			case simd::Level::SSE2:
+			case simd::Level::SSSE3:
+				return isFloat ? 2.0 : 3.5;
+
+			case simd::Level::AVX2:
+				return isFloat ? 4.0 : 6.0;
+
+			case simd::Level::AVX512:
+				return isFloat ? 5.0 : 10.0;
+
+			// no reference numbers exist for other levels
+			default:
+				return 0.0;
+		}
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static double MeasureBlend(blendMode::Enum mode, const std::vector<T>& src, const std::vector<T>& mask, std::vector<T>& dest)
+	{
+		const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int y=0; y < ROW_COUNT; ++y)
+		{
+			imageUtil::BlendRow(mode, src.data(), mask.data(), 200u, dest.data() + y*ROW_LENGTH*4u, ROW_LENGTH, 0u, y);
+		}
+		const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		// megapixels per second
+		const double seconds = std::chrono::duration<double>(end - start).count();
+		return (static_cast<double>(ROW_LENGTH) * ROW_COUNT) / (seconds * 1000000.0);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	template <typename T>
+	static bool BenchmarkBlend(simd::Level::Enum level)
+	{
+		std::vector<T> src(ROW_LENGTH * 4u);
+		std::vector<T> mask(ROW_LENGTH);
+		std::vector<T> dest(ROW_LENGTH * ROW_COUNT * 4u);
+		for (unsigned int i=0; i < ROW_LENGTH * 4u; ++i)
+		{
+			src[i] = MakeValue<T>(i);
+		}
+		for (unsigned int i=0; i < ROW_LENGTH; ++i)
+		{
+			mask[i] = MakeValue<T>(i + 7u);
+		}
+
+		printf("BlendRow, %u-bit:\n", static_cast<unsigned int>(sizeof(T)*8u));
+		printf("  %-16s %12s %12s %9s\n", "mode", "SCALAR", simd::GetLevelName(level), "speedup");
+
+		double logSpeedup = 0.0;
+		for (unsigned int i=blendMode::NORMAL; i < blendMode::UNKNOWN; ++i)
+		{
+			const blendMode::Enum mode = static_cast<blendMode::Enum>(i);
+
+			// every row is blended onto a separate destination row, so that repeatedly blending doesn't drive the destination
+			// towards denormals. each measurement starts with the same destination, and the best of three runs is kept.
+			double throughput[2] = {};
+			const simd::Level::Enum levels[2] = { simd::Level::SCALAR, level };
+			for (unsigned int l=0; l < 2u; ++l)
+			{
+				simd::SetLevel(levels[l]);
+				for (unsigned int run=0; run < 3u; ++run)
+				{
+					for (unsigned int j=0; j < ROW_LENGTH * ROW_COUNT * 4u; ++j)
+					{
+						dest[j] = MakeValue<T>(j + 13u);
+					}
+
+					const double result = MeasureBlend(mode, src, mask, dest);
+					throughput[l] = (result > throughput[l]) ? result : throughput[l];
+				}
+			}
+
+			const double speedup = throughput[1] / throughput[0];
+			logSpeedup += std::log(speedup);
+			printf("  %-16s %8.1f MP/s %7.1f MP/s %8.2fx\n", blendMode::ToString(mode), throughput[0], throughput[1], speedup);
+		}
+
+		const double meanSpeedup = std::exp(logSpeedup / (blendMode::UNKNOWN - blendMode::NORMAL));
+		const double expectedSpeedup = GetExpectedBlendSpeedup(level, static_cast<unsigned int>(sizeof(T)*8u));
+		const bool isRegression = (meanSpeedup < expectedSpeedup);
+		if (expectedSpeedup > 0.0)
+		{
+			printf("  geometric mean speedup: %.2fx (expected at least %.1fx)%s\n\n", meanSpeedup, expectedSpeedup, isRegression ? "  REGRESSION" : "");
+		}
+		else
+		{
+			printf("  geometric mean speedup: %.2fx\n\n", meanSpeedup);
+		}
+
+		simd::SetLevel(simd::Level::AUTO);
+		return !isRegression;
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint8_t MakeRleValue(unsigned int content, unsigned int x, unsigned int y)
+	{
+		// flat rows consist of a single run, noisy rows of literals only, and gradient rows of short runs
+		if (content == 0u)
+			return static_cast<uint8_t>(y);
+		else if (content == 1u)
+			return MakeValue<uint8_t>(y*ROW_LENGTH + x);
+
+		return static_cast<uint8_t>((x * 256u) / ROW_LENGTH + y);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static double MeasureCompressRle(const std::vector<uint8_t>& src, std::vector<uint8_t>& dest)
+	{
+		const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int y=0; y < ROW_COUNT; ++y)
+		{
+			imageUtil::CompressRle(src.data() + y*ROW_LENGTH, dest.data() + y*ROW_LENGTH*2u, ROW_LENGTH);
+		}
+		const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+		// megabytes per second
+		const double seconds = std::chrono::duration<double>(end - start).count();
+		return (static_cast<double>(ROW_LENGTH) * ROW_COUNT) / (seconds * 1000000.0);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool BenchmarkCompressRle(simd::Level::Enum level)
+	{
+		static const char* const CONTENT_NAMES[3] = { "flat", "noisy", "gradient" };
+
+		std::vector<uint8_t> src(ROW_LENGTH * ROW_COUNT);
+
+		// packed rows never need more than twice their size
+		std::vector<uint8_t> dest[2] = { std::vector<uint8_t>(ROW_LENGTH * ROW_COUNT * 2u), std::vector<uint8_t>(ROW_LENGTH * ROW_COUNT * 2u) };
+
+		printf("CompressRle:\n");
+		printf("  %-16s %12s %12s %9s\n", "content", "SCALAR", simd::GetLevelName(level), "speedup");
+
+		bool isIdentical = true;
+		for (unsigned int content=0; content < 3u; ++content)
+		{
+			for (unsigned int y=0; y < ROW_COUNT; ++y)
+			{
+				for (unsigned int x=0; x < ROW_LENGTH; ++x)
+				{
+					src[y*ROW_LENGTH + x] = MakeRleValue(content, x, y);
+				}
+			}
+
+			// rows are small, so the best of more runs is kept than for blending
+			double throughput[2] = {};
+			const simd::Level::Enum levels[2] = { simd::Level::SCALAR, level };
+			for (unsigned int l=0; l < 2u; ++l)
+			{
+				simd::SetLevel(levels[l]);
+				for (unsigned int run=0; run < 10u; ++run)
+				{
+					const double result = MeasureCompressRle(src, dest[l]);
+					throughput[l] = (result > throughput[l]) ? result : throughput[l];
+				}
+			}
+
+			const double speedup = throughput[1] / throughput[0];
+			const bool isContentIdentical = (dest[0] == dest[1]);
+			isIdentical &= isContentIdentical;
+			printf("  %-16s %8.1f MB/s %7.1f MB/s %8.2fx%s\n", CONTENT_NAMES[content], throughput[0], throughput[1], speedup, isContentIdentical ? "" : "  OUTPUT DIFFERS");
+		}
+
+		printf("\n");
+		simd::SetLevel(simd::Level::AUTO);
+		return isIdentical;
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int main(int /*argc*/, const char * /*argv*/[])
+{
+	const simd::Level::Enum level = simd::GetLevel();
+	printf("SIMD level: %s\n\n", simd::GetLevelName(level));
+
+	bool success = BenchmarkBlend<uint8_t>(level);
+	success &= BenchmarkBlend<uint16_t>(level);
+	success &= BenchmarkBlend<float32_t>(level);
+	success &= BenchmarkCompressRle(level);
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,286 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#include "../Psd/Psd.h"
+#include "../Psd/PsdPlatform.h"
+#include "PsdPsbGenerator.h"
+
+#include "../Psd/PsdFile.h"
+#include "../Psd/PsdEndianConversion.h"
+#include "../Psd/PsdDecompressRle.h"
+
+#include <cstring>
+#include <vector>
+
+
+namespace
+{
+	// the generated document always stores R, G and B
+	static const unsigned int CHANNEL_COUNT = 3u;
+
+
+	// writes big-endian data at arbitrary positions, leaving holes in the file wherever the position is moved ahead.
+	class Writer
+	{
+	public:
+		explicit Writer(psd::File* file)
+			: m_file(file)
+			, m_position(0ull)
+		{
+		}
+
+		void Write(const void* buffer, uint32_t count)
+		{
+			psd::File::WriteOperation op = m_file->Write(buffer, count, m_position);
+			m_file->WaitForWrite(op);
+
+			m_position += count;
+		}
+
+		template <typename T>
+		void WriteBigEndian(T value)
+		{
+			const T bigEndianValue = psd::endianUtil::NativeToBigEndian(value);
+			Write(&bigEndianValue, sizeof(T));
+		}
+
+		void SetPosition(uint64_t position)
+		{
+			m_position = position;
+		}
+
+		uint64_t GetPosition(void) const
+		{
+			return m_position;
+		}
+
+	private:
+		psd::File* m_file;
+		uint64_t m_position;
+	};
+
+
+	// RLE-compressed channel data, including the compression type and the row byte counts
+	struct RleChannel
+	{
+		std::vector<uint32_t> rowSizes;
+		std::vector<uint8_t> data;
+	};
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void CompressRow(RleChannel& channel, const uint8_t* row, unsigned int width)
+	{
+		// be generous with the worst case, like the exporter
+		const size_t offset = channel.data.size();
+		channel.data.resize(offset + width*2u);
+
+		const unsigned int size = psd::imageUtil::CompressRle(row, &channel.data[offset], width);
+		channel.data.resize(offset + size);
+		channel.rowSizes.push_back(size);
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static uint64_t GetRleChannelSize(const RleChannel& channel)
+	{
+		return sizeof(uint16_t) + channel.rowSizes.size()*sizeof(uint32_t) + channel.data.size();
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void WriteRleChannel(Writer& writer, const RleChannel& channel)
+	{
+		// .PSB documents store the byte count of each row using 32-bit instead of 16-bit
+		writer.WriteBigEndian<uint16_t>(1u);
+		for (size_t i=0; i < channel.rowSizes.size(); ++i)
+		{
+			writer.WriteBigEndian<uint32_t>(channel.rowSizes[i]);
+		}
+
+		writer.Write(channel.data.data(), static_cast<uint32_t>(channel.data.size()));
+	}
+
+
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static void WriteLayerRecord(Writer& writer, const char* name, unsigned int top, unsigned int left, unsigned int bottom, unsigned int right, const uint64_t* channelSizes)
+	{
+		writer.WriteBigEndian<int32_t>(static_cast<int32_t>(top));
+		writer.WriteBigEndian<int32_t>(static_cast<int32_t>(left));
+		writer.WriteBigEndian<int32_t>(static_cast<int32_t>(bottom));
+		writer.WriteBigEndian<int32_t>(static_cast<int32_t>(right));
+
+		// channel lengths are stored using 64-bit in .PSB documents
+		writer.WriteBigEndian<uint16_t>(static_cast<uint16_t>(CHANNEL_COUNT));
+		for (unsigned int i=0; i < CHANNEL_COUNT; ++i)
+		{
+			writer.WriteBigEndian<int16_t>(static_cast<int16_t>(i));
+			writer.WriteBigEndian<uint64_t>(channelSizes[i]);
+		}
+
+		writer.Write("8BIMnorm", 8u);
+
+		// opacity, clipping, flags, filler
+		const uint8_t opacityClippingFlagsFiller[4] = { 255u, 0u, 0u, 0u };
+		writer.Write(opacityClippingFlagsFiller, 4u);
+
+		// the name is stored as a Pascal string, padded to a multiple of 4 bytes
+		const uint32_t nameLength = static_cast<uint32_t>(strlen(name));
+		const uint32_t paddedNameLength = (nameLength + 1u + 3u) & ~3u;
+
+		// extra data: no layer mask, no blending ranges, the name, and no additional layer information
+		writer.WriteBigEndian<uint32_t>(sizeof(uint32_t) + sizeof(uint32_t) + paddedNameLength);
+		writer.WriteBigEndian<uint32_t>(0u);
+		writer.WriteBigEndian<uint32_t>(0u);
+
+		uint8_t paddedName[256] = {};
+		paddedName[0] = static_cast<uint8_t>(nameLength);
+		memcpy(paddedName + 1u, name, nameLength);
+		writer.Write(paddedName, paddedNameLength);
+	}
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint8_t psbGenerator::GetLayerValue(unsigned int x, unsigned int y, unsigned int channel)
+{
+	return static_cast<uint8_t>(x*3u + y*5u + channel*64u + 1u);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+uint8_t psbGenerator::GetMergedValue(unsigned int /*x*/, unsigned int y, unsigned int channel)
+{
+	// rows of constant color, which compress well
+	return static_cast<uint8_t>(y*3u + channel*80u);
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+void psbGenerator::Write(psd::File* file)
+{
+	Writer writer(file);
+
+	// header
+	{
+		writer.Write("8BPS", 4u);
+		writer.WriteBigEndian<uint16_t>(2u);
+
+		const uint8_t reserved[6] = {};
+		writer.Write(reserved, 6u);
+
+		writer.WriteBigEndian<uint16_t>(static_cast<uint16_t>(CHANNEL_COUNT));
+		writer.WriteBigEndian<uint32_t>(CANVAS_HEIGHT);
+		writer.WriteBigEndian<uint32_t>(CANVAS_WIDTH);
+		writer.WriteBigEndian<uint16_t>(8u);
+		writer.WriteBigEndian<uint16_t>(3u);
+	}
+
+	// empty color mode data and image resources sections
+	writer.WriteBigEndian<uint32_t>(0u);
+	writer.WriteBigEndian<uint32_t>(0u);
+
+	// compress the small layer up front, because the record needs to know the size of the channels
+	RleChannel smallChannels[CHANNEL_COUNT];
+	uint64_t smallChannelSizes[CHANNEL_COUNT] = {};
+	{
+		uint8_t row[SMALL_LAYER_SIZE];
+		for (unsigned int c=0; c < CHANNEL_COUNT; ++c)
+		{
+			for (unsigned int y=0; y < SMALL_LAYER_SIZE; ++y)
+			{
+				for (unsigned int x=0; x < SMALL_LAYER_SIZE; ++x)
+				{
+					row[x] = GetLayerValue(x, y, c);
+				}
+				CompressRow(smallChannels[c], row, SMALL_LAYER_SIZE);
+			}
+
+			smallChannelSizes[c] = GetRleChannelSize(smallChannels[c]);
+		}
+	}
+
+	const uint64_t hugeChannelSize = sizeof(uint16_t) + static_cast<uint64_t>(HUGE_LAYER_WIDTH)*HUGE_LAYER_HEIGHT;
+	const uint64_t hugeChannelSizes[CHANNEL_COUNT] = { hugeChannelSize, hugeChannelSize, hugeChannelSize };
+
+	// layer and mask information section. both lengths are patched once all the data has been written.
+	const uint64_t sectionLengthPosition = writer.GetPosition();
+	writer.WriteBigEndian<uint64_t>(0ull);
+	writer.WriteBigEndian<uint64_t>(0ull);
+	{
+		const uint64_t layerInfoStart = writer.GetPosition();
+		writer.WriteBigEndian<int16_t>(2);
+		WriteLayerRecord(writer, "Huge", 0u, 0u, HUGE_LAYER_HEIGHT, HUGE_LAYER_WIDTH, hugeChannelSizes);
+		WriteLayerRecord(writer, "Small", SMALL_LAYER_TOP, SMALL_LAYER_LEFT, SMALL_LAYER_TOP + SMALL_LAYER_SIZE, SMALL_LAYER_LEFT + SMALL_LAYER_SIZE, smallChannelSizes);
+
+		// RAW data of the huge layer. only the rows of the patch are written, the rest of the data stays a hole.
+		for (unsigned int c=0; c < CHANNEL_COUNT; ++c)
+		{
+			const uint64_t channelStart = writer.GetPosition();
+			writer.WriteBigEndian<uint16_t>(0u);
+
+			uint8_t row[PATCH_SIZE];
+			for (unsigned int y=0; y < PATCH_SIZE; ++y)
+			{
+				for (unsigned int x=0; x < PATCH_SIZE; ++x)
+				{
+					row[x] = GetLayerValue(PATCH_LEFT + x, PATCH_TOP + y, c);
+				}
+
+				writer.SetPosition(channelStart + sizeof(uint16_t) + static_cast<uint64_t>(PATCH_TOP + y)*HUGE_LAYER_WIDTH + PATCH_LEFT);
+				writer.Write(row, PATCH_SIZE);
+			}
+
+			writer.SetPosition(channelStart + hugeChannelSize);
+		}
+
+		// RLE data of the small layer
+		for (unsigned int c=0; c < CHANNEL_COUNT; ++c)
+		{
+			WriteRleChannel(writer, smallChannels[c]);
+		}
+
+		// the layer info is padded to an even length
+		uint64_t layerInfoLength = writer.GetPosition() - layerInfoStart;
+		if (layerInfoLength & 1u)
+		{
+			writer.WriteBigEndian<uint8_t>(0u);
+			++layerInfoLength;
+		}
+
+		// empty global layer mask info
+		writer.WriteBigEndian<uint32_t>(0u);
+
+		const uint64_t sectionEnd = writer.GetPosition();
+		writer.SetPosition(sectionLengthPosition);
+		writer.WriteBigEndian<uint64_t>(sectionEnd - sectionLengthPosition - sizeof(uint64_t));
+		writer.WriteBigEndian<uint64_t>(layerInfoLength);
+		writer.SetPosition(sectionEnd);
+	}
+
+	// RLE-compressed merged image data. all channels share the compression type and the table of row byte counts.
+	{
+		RleChannel merged;
+		std::vector<uint8_t> row(CANVAS_WIDTH);
+		for (unsigned int c=0; c < CHANNEL_COUNT; ++c)
+		{
+			for (unsigned int y=0; y < CANVAS_HEIGHT; ++y)
+			{
+				for (unsigned int x=0; x < CANVAS_WIDTH; ++x)
+				{
+					row[x] = GetMergedValue(x, y, c);
+				}
+				CompressRow(merged, row.data(), CANVAS_WIDTH);
+			}
+		}
+
+		WriteRleChannel(writer, merged);
+	}
+}
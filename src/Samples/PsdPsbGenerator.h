@@ -0,0 +1,45 @@
+// Copyright 2011-2020, Molecular Matters GmbH <office@molecular-matters.com>
+// See LICENSE.txt for licensing details (2-clause BSD License: https://opensource.org/licenses/BSD-2-Clause)
+
+#pragma once
+
+#include "../Psd/Psd.h"
+
+
+PSD_NAMESPACE_BEGIN
+
+class File;
+
+PSD_NAMESPACE_END
+
+
+/// Generates a synthetic 8-bit RGB .PSB document that is larger than 4 GB, without needing that much disk space.
+/// Only the interesting parts of the file are written, everything else is left as a hole in a sparse file.
+namespace psbGenerator
+{
+	/// The canvas is wider than the 30,000 pixels supported by .PSD documents.
+	static const unsigned int CANVAS_WIDTH = 40000u;
+	static const unsigned int CANVAS_HEIGHT = 1024u;
+
+	/// The first layer stores RAW channels which are larger than 4 GB each. Its data is zero, except for a patch
+	/// that lies beyond the first 4 GB of each channel.
+	static const unsigned int HUGE_LAYER_WIDTH = CANVAS_WIDTH;
+	static const unsigned int HUGE_LAYER_HEIGHT = 110000u;
+	static const unsigned int PATCH_LEFT = 20000u;
+	static const unsigned int PATCH_TOP = 108000u;
+	static const unsigned int PATCH_SIZE = 64u;
+
+	/// The second layer is small and RLE-compressed, and its data is stored behind the data of the first layer.
+	static const unsigned int SMALL_LAYER_LEFT = 1000u;
+	static const unsigned int SMALL_LAYER_TOP = 100u;
+	static const unsigned int SMALL_LAYER_SIZE = 256u;
+
+	/// Returns the value stored in both the patch and the small layer at layer coordinates (\a x, \a y).
+	uint8_t GetLayerValue(unsigned int x, unsigned int y, unsigned int channel);
+
+	/// Returns the value stored in the merged image at canvas coordinates (\a x, \a y).
+	uint8_t GetMergedValue(unsigned int x, unsigned int y, unsigned int channel);
+
+	/// Writes the document to the given \a file, which must already be open for writing.
+	void Write(psd::File* file);
+}
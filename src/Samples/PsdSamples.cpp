@@ -12,7 +12,11 @@
 // native file interface.
 // in your code, feel free to use whatever allocator you have lying around.
 #include "../Psd/PsdMallocAllocator.h"
-#include "../Psd/PsdNativeFile.h"
+#if defined(_WIN32)
+	#include "../Psd/PsdNativeFile.h"
+#else
+	#include "../Psd/PsdNativeFile_General.h"
+#endif
 
 #include "../Psd/PsdDocument.h"
 #include "../Psd/PsdColorMode.h"
@@ -33,8 +37,15 @@
 #include "../Psd/PsdPlanarImage.h"
 #include "../Psd/PsdExport.h"
 #include "../Psd/PsdExportDocument.h"
+#include "../Psd/PsdThreadPool.h"
+#include "../Psd/PsdLayerRegion.h"
+#include "../Psd/PsdLayerType.h"
+#include "../Psd/PsdExtractionError.h"
+#include "../Psd/PsdFlattenDocument.h"
+#include "../Psd/PsdRenderCache.h"
 
 #include "PsdTgaExporter.h"
+#include "PsdPsbGenerator.h"
 #include "PsdDebug.h"
 
 PSD_PUSH_WARNING_LEVEL(0)
@@ -52,6 +63,12 @@ PSD_USING_NAMESPACE;
 	#include <cstring>
 #endif
 
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+	#include <tchar.h>
+#endif
+
 // helpers for reading PSDs
 namespace
 {
@@ -118,6 +135,25 @@ namespace
 	}
 
 
+	// ---------------------------------------------------------------------------------------------------------------------
+	// ---------------------------------------------------------------------------------------------------------------------
+	static bool VerifyGeneratedLayerData(const void* data, unsigned int x0, unsigned int y0, unsigned int width, unsigned int height, unsigned int channel)
+	{
+		// (x0, y0) denote the position of the data in layer coordinates
+		const uint8_t* data8 = static_cast<const uint8_t*>(data);
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				if (data8[y*width + x] != psbGenerator::GetLayerValue(x0 + x, y0 + y, channel))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+
 	// ---------------------------------------------------------------------------------------------------------------------
 	// ---------------------------------------------------------------------------------------------------------------------
 	template <typename T>
@@ -282,11 +318,16 @@ int SampleReadPsd(void)
 	{
 		hasTransparencyMask = layerMaskSection->hasTransparencyMask;
 
-		// extract all layers one by one. this should be done in parallel for maximum efficiency.
+		// extract all layers in parallel, using one thread per hardware thread.
+		// layers can also be extracted one by one using ExtractLayer().
+		{
+			ThreadPool threadPool(&allocator, 0u);
+			ExtractLayers(document, &file, &allocator, layerMaskSection->layers, layerMaskSection->layerCount, &threadPool);
+		}
+
 		for (unsigned int i = 0; i < layerMaskSection->layerCount; ++i)
 		{
 			Layer* layer = &layerMaskSection->layers[i];
-			ExtractLayer(document, &file, &allocator, layer);
 
 			// check availability of R, G, B, and A channels.
 			// we need to determine the indices of channels individually, because there is no guarantee that R is the first channel,
@@ -476,7 +517,7 @@ int SampleReadPsd(void)
 				}
 
 				// use ExpandMaskToCanvas create an image that is the same size as the canvas.
-				void* maskCanvasData = ExpandMaskToCanvas(document, &allocator, layer->layerMask);
+				void* maskCanvasData = ExpandMaskToCanvas(document, &allocator, layer->layerMask.get());
 				{
 					std::wstringstream filename;
 					filename << GetSampleOutputPath();
@@ -684,9 +725,9 @@ int SampleWritePsd(void)
 			// when adding a layer to the document, you first need to get a new index into the layer table.
 			// with a valid index, layers can be updated in parallel, in any order.
 			// this also allows you to only update the layer data that has changed, which is crucial when working with large data sets.
-			const unsigned int layer1 = AddLayer(document, &allocator, "MUL pattern");
-			const unsigned int layer2 = AddLayer(document, &allocator, "XOR pattern");
-			const unsigned int layer3 = AddLayer(document, &allocator, "Mixed pattern with transparency");
+			const unsigned int layer1 = AddLayer(document, "MUL pattern");
+			const unsigned int layer2 = AddLayer(document, "XOR pattern");
+			const unsigned int layer3 = AddLayer(document, "Mixed pattern with transparency");
 
 			// note that each layer has its own compression type. it is perfectly legal to compress different channels of different layers with different settings.
 			// RAW is pretty much just a raw data dump. fastest to write, but large.
@@ -757,16 +798,16 @@ int SampleWritePsd(void)
 		// Grayscale works similar to RGB, only the types of export channels change.
 		ExportDocument* document = CreateExportDocument(&allocator, IMAGE_WIDTH, IMAGE_HEIGHT, 16u, exportColorMode::GRAYSCALE);
 		{
-			const unsigned int layer1 = AddLayer(document, &allocator, "MUL pattern");
+			const unsigned int layer1 = AddLayer(document, "MUL pattern");
 			UpdateLayer(document, &allocator, layer1, exportChannel::GRAY, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_multiplyData16[0][0], compressionType::RAW);
 
-			const unsigned int layer2 = AddLayer(document, &allocator, "XOR pattern");
+			const unsigned int layer2 = AddLayer(document, "XOR pattern");
 			UpdateLayer(document, &allocator, layer2, exportChannel::GRAY, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_xorData16[0][0], compressionType::RLE);
 
-			const unsigned int layer3 = AddLayer(document, &allocator, "AND pattern");
+			const unsigned int layer3 = AddLayer(document, "AND pattern");
 			UpdateLayer(document, &allocator, layer3, exportChannel::GRAY, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_andData16[0][0], compressionType::ZIP);
 
-			const unsigned int layer4 = AddLayer(document, &allocator, "OR pattern with transparency");
+			const unsigned int layer4 = AddLayer(document, "OR pattern with transparency");
 			UpdateLayer(document, &allocator, layer4, exportChannel::GRAY, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_orData16[0][0], compressionType::ZIP_WITH_PREDICTION);
 			UpdateLayer(document, &allocator, layer4, exportChannel::ALPHA, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_checkerBoardData16[0][0], compressionType::ZIP_WITH_PREDICTION);
 
@@ -794,12 +835,12 @@ int SampleWritePsd(void)
 		// write an RGB PSD file, 32-bit
 		ExportDocument* document = CreateExportDocument(&allocator, IMAGE_WIDTH, IMAGE_HEIGHT, 32u, exportColorMode::RGB);
 		{
-			const unsigned int layer1 = AddLayer(document, &allocator, "MUL pattern");
+			const unsigned int layer1 = AddLayer(document, "MUL pattern");
 			UpdateLayer(document, &allocator, layer1, exportChannel::RED, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_multiplyData32[0][0], compressionType::RAW);
 			UpdateLayer(document, &allocator, layer1, exportChannel::GREEN, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_multiplyData32[0][0], compressionType::RLE);
 			UpdateLayer(document, &allocator, layer1, exportChannel::BLUE, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_multiplyData32[0][0], compressionType::ZIP);
 
-			const unsigned int layer2 = AddLayer(document, &allocator, "Mixed pattern with transparency");
+			const unsigned int layer2 = AddLayer(document, "Mixed pattern with transparency");
 			UpdateLayer(document, &allocator, layer2, exportChannel::RED, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_multiplyData32[0][0], compressionType::RLE);
 			UpdateLayer(document, &allocator, layer2, exportChannel::GREEN, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_xorData32[0][0], compressionType::ZIP);
 			UpdateLayer(document, &allocator, layer2, exportChannel::BLUE, 0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, &g_orData32[0][0], compressionType::ZIP_WITH_PREDICTION);
@@ -818,14 +859,309 @@ int SampleWritePsd(void)
 }
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int SampleFlattenPsd(void)
+{
+	const std::wstring srcPath = GetSampleInputPath() + L"Sample.psd";
+
+	MallocAllocator allocator;
+	NativeFile file(&allocator);
+
+	if (!file.OpenRead(srcPath.c_str()))
+	{
+		PSD_SAMPLE_LOG("Cannot open file.\n");
+		return 1;
+	}
+
+	Document* document = CreateDocument(&file, &allocator);
+	if (!document)
+	{
+		PSD_SAMPLE_LOG("Cannot create document.\n");
+		file.Close();
+		return 1;
+	}
+
+	// the renderer only supports RGB colormode
+	if (document->colorMode != colorMode::RGB)
+	{
+		PSD_SAMPLE_LOG("Document is not in RGB color mode.\n");
+		DestroyDocument(document, &allocator);
+		file.Close();
+		return 1;
+	}
+
+	LayerMaskSection* layerMaskSection = ParseLayerMaskSection(document, &file, &allocator);
+	if (!layerMaskSection)
+	{
+		PSD_SAMPLE_LOG("Document does not contain any layers.\n");
+		DestroyDocument(document, &allocator);
+		file.Close();
+		return 1;
+	}
+
+	// the renderer follows the hierarchy stored in Layer::parent. pass-through groups blend their layers onto the layers below
+	// directly, all other groups are rendered in isolation. layers clipped to the layer below them are rendered together with
+	// their base. all of this happens automatically, we only gather a few numbers for the log.
+	Layer* topmostLayer = nullptr;
+	{
+		unsigned int groupCount = 0u;
+		unsigned int passThroughCount = 0u;
+		unsigned int clippedCount = 0u;
+		for (unsigned int i = 0; i < layerMaskSection->layerCount; ++i)
+		{
+			Layer* layer = &layerMaskSection->layers[i];
+			if ((layer->type == layerType::OPEN_FOLDER) || (layer->type == layerType::CLOSED_FOLDER))
+			{
+				++groupCount;
+				passThroughCount += layer->isPassThrough ? 1u : 0u;
+			}
+			else if (layer->type == layerType::ANY)
+			{
+				clippedCount += (layer->clipping != 0u) ? 1u : 0u;
+
+				// layers are stored bottom to top
+				if (layer->isVisible)
+				{
+					topmostLayer = layer;
+				}
+			}
+		}
+
+		std::stringstream message;
+		message << "Flattening " << layerMaskSection->layerCount << " layers, " << groupCount << " groups (" << passThroughCount << " pass-through), ";
+		message << clippedCount << " clipped layers.\n";
+		PSD_SAMPLE_LOG(message.str().c_str());
+	}
+
+	ThreadPool threadPool(&allocator, 0u);
+
+	// layers that have not been extracted are decoded tile by tile while flattening. when flattening the same document more than
+	// once, extracting all layers up front is faster.
+	ExtractLayers(document, &file, &allocator, layerMaskSection->layers, layerMaskSection->layerCount, &threadPool);
+
+	// the render cache holds the flattened image, and remembers which layers touch which tiles of the canvas. if only a
+	// few layers change, only their tiles are rendered again. for flattening a document just once, FlattenDocument() can be used.
+	int errorCode = extractionError::OK;
+	RenderCache* cache = CreateRenderCache(document, &file, &allocator, layerMaskSection, &threadPool, errorCode);
+	if (errorCode != extractionError::OK)
+	{
+		PSD_SAMPLE_LOG("Cannot decode all layers, some of them are missing from the flattened image.\n");
+	}
+
+	if (document->bitsPerChannel == 8)
+	{
+		const std::wstring dstPath = GetSampleOutputPath() + L"flattened.tga";
+		tgaExporter::SaveRGBA(dstPath.c_str(), document->width, document->height, static_cast<const uint8_t*>(cache->canvasData));
+	}
+
+	// hide the topmost layer, and update the cache
+	if (topmostLayer)
+	{
+		topmostLayer->isVisible = false;
+
+		const Layer* changedLayers[1] = { topmostLayer };
+		errorCode = UpdateRenderCache(cache, &file, &allocator, changedLayers, 1u, &threadPool);
+		if (errorCode != extractionError::OK)
+		{
+			PSD_SAMPLE_LOG("Cannot decode all layers, some of them are missing from the flattened image.\n");
+		}
+
+		if (document->bitsPerChannel == 8)
+		{
+			const std::wstring dstPath = GetSampleOutputPath() + L"flattened_without_topmost_layer.tga";
+			tgaExporter::SaveRGBA(dstPath.c_str(), document->width, document->height, static_cast<const uint8_t*>(cache->canvasData));
+		}
+
+		std::stringstream message;
+		message << "Rendered " << cache->tilesRecomposited << " tiles, reused " << cache->tilesReused << " tiles.\n";
+		PSD_SAMPLE_LOG(message.str().c_str());
+	}
+
+	DestroyRenderCache(cache, &allocator);
+	DestroyLayerMaskSection(layerMaskSection, &allocator);
+	DestroyDocument(document, &allocator);
+	file.Close();
+
+	return 0;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static void DeleteSampleFile(const std::wstring& path)
+{
+#ifdef _WIN32
+	_wremove(path.c_str());
+#else
+	// sample paths only consist of ASCII characters
+	const std::string narrowPath(path.begin(), path.end());
+	remove(narrowPath.c_str());
+#endif
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+static int VerifyLargePsb(const std::wstring& path)
+{
+	MallocAllocator allocator;
+
+	NativeFile file(&allocator);
+	if (!file.OpenRead(path.c_str()))
+	{
+		PSD_SAMPLE_LOG("Cannot open file.\n");
+		return 1;
+	}
+
+	// .PSB documents are parsed just like .PSD documents, the version tells them apart
+	Document* document = CreateDocument(&file, &allocator);
+	if (!document)
+	{
+		PSD_SAMPLE_LOG("Cannot create document.\n");
+		file.Close();
+		return 1;
+	}
+
+	bool isValid = (document->version == 2u) && (document->width == psbGenerator::CANVAS_WIDTH) && (document->height == psbGenerator::CANVAS_HEIGHT);
+
+	LayerMaskSection* layerMaskSection = ParseLayerMaskSection(document, &file, &allocator);
+	if (layerMaskSection && (layerMaskSection->layerCount == 2u))
+	{
+		// the channels of the first layer are too large to be extracted as a whole, but any region of it can be extracted.
+		// the region's data is located more than 4 GB into the channel data.
+		{
+			Layer* layer = &layerMaskSection->layers[0];
+			isValid &= (layer->channels[0].size > UINT_MAX);
+			isValid &= (ExtractLayer(document, &file, &allocator, layer) == extractionError::CHANNEL_TOO_LARGE);
+
+			int errorCode = 0;
+			LayerRegion* region = ExtractLayerRegion(document, &file, &allocator, layer,
+				psbGenerator::PATCH_TOP, psbGenerator::PATCH_LEFT, psbGenerator::PATCH_TOP + psbGenerator::PATCH_SIZE, psbGenerator::PATCH_LEFT + psbGenerator::PATCH_SIZE, errorCode);
+			if (region)
+			{
+				for (unsigned int i = 0; i < region->channelCount; ++i)
+				{
+					const ChannelRegion* channelRegion = &region->channels[i];
+					isValid &= (channelRegion->data != nullptr) && VerifyGeneratedLayerData(channelRegion->data, psbGenerator::PATCH_LEFT, psbGenerator::PATCH_TOP, psbGenerator::PATCH_SIZE, psbGenerator::PATCH_SIZE, static_cast<unsigned int>(channelRegion->type));
+				}
+
+				DestroyLayerRegion(region, &allocator);
+			}
+			else
+			{
+				isValid = false;
+			}
+		}
+
+		// the second layer is small, but its data is located behind the first layer's data
+		{
+			Layer* layer = &layerMaskSection->layers[1];
+			if (ExtractLayer(document, &file, &allocator, layer) == extractionError::OK)
+			{
+				for (unsigned int i = 0; i < layer->channelCount; ++i)
+				{
+					const Channel* channel = &layer->channels[i];
+					isValid &= (channel->data != nullptr) && VerifyGeneratedLayerData(channel->data, 0u, 0u, psbGenerator::SMALL_LAYER_SIZE, psbGenerator::SMALL_LAYER_SIZE, static_cast<unsigned int>(channel->type));
+				}
+			}
+			else
+			{
+				isValid = false;
+			}
+		}
+
+		DestroyLayerMaskSection(layerMaskSection, &allocator);
+	}
+	else
+	{
+		isValid = false;
+	}
+
+	// the merged image data follows the layer data
+	ImageDataSection* imageData = ParseImageDataSection(document, &file, &allocator);
+	if (imageData)
+	{
+		isValid &= (imageData->imageCount == 3u);
+		for (unsigned int i = 0; i < imageData->imageCount; ++i)
+		{
+			// sample a few pixels spread across the canvas
+			const uint8_t* data = static_cast<const uint8_t*>(imageData->images[i].data);
+			for (unsigned int y = 0; y < document->height; y += 17u)
+			{
+				const unsigned int x = (y*997u) % document->width;
+				isValid &= (data[y*document->width + x] == psbGenerator::GetMergedValue(x, y, i));
+			}
+		}
+
+		DestroyImageDataSection(imageData, &allocator);
+	}
+	else
+	{
+		isValid = false;
+	}
+
+	DestroyDocument(document, &allocator);
+	file.Close();
+
+	if (!isValid)
+	{
+		PSD_SAMPLE_LOG("Large document does not contain the expected data.\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+int SampleReadLargePsb(void)
+{
+	const std::wstring path = GetSampleOutputPath() + L"SampleLarge.psb";
+
+	// generate a .PSB document that is larger than 4 GB, actually more than 13 GB. most of its data is never written, so the
+	// file only occupies a few megabytes on file systems that support sparse files. on all other file systems, the whole
+	// size is allocated, which is why this sample only runs when asked for, and deletes the file afterwards.
+	{
+		MallocAllocator allocator;
+		NativeFile file(&allocator);
+		if (!file.OpenWrite(path.c_str()))
+		{
+			PSD_SAMPLE_LOG("Cannot open file.\n");
+			return 1;
+		}
+
+		psbGenerator::Write(&file);
+		file.Close();
+	}
+
+	const int result = VerifyLargePsb(path);
+	DeleteSampleFile(path);
+
+	return result;
+}
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------------------------
 #if _WIN32
-int WINAPI WinMain(HINSTANCE, HINSTANCE, LPTSTR, int)
+int WINAPI WinMain(HINSTANCE, HINSTANCE, LPTSTR commandLine, int)
 #else
-int main(int /*argc*/, const char * /*argv[]*/)
+int main(int argc, const char *argv[])
 #endif
 {
+	// the large .PSB sample needs a file system supporting sparse files, and therefore has to be enabled explicitly
+	bool runLargePsbSample = false;
+#if _WIN32
+	runLargePsbSample = (_tcsstr(commandLine, _T("--large-psb")) != nullptr);
+#else
+	for (int i = 1; i < argc; ++i)
+	{
+		runLargePsbSample |= (strcmp(argv[i], "--large-psb") == 0);
+	}
+#endif
+
 	{
 		const int result = SampleReadPsd();
 		if (result != 0)
@@ -840,6 +1176,21 @@ int main(int /*argc*/, const char * /*argv[]*/)
 			return result;
 		}
 	}
+	{
+		const int result = SampleFlattenPsd();
+		if (result != 0)
+		{
+			return result;
+		}
+	}
+	if (runLargePsbSample)
+	{
+		const int result = SampleReadLargePsb();
+		if (result != 0)
+		{
+			return result;
+		}
+	}
 
 	return 0;
 }